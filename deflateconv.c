@@ -8,6 +8,7 @@ the included LICENSE.txt file.
 #include "zstdhl.h"
 #include "zstdhl_util.h"
 #include "zstdhl_internal.h"
+#include "zstdhl_thread.h"
 
 #include <stdio.h>
 
@@ -19,76 +20,16 @@ the included LICENSE.txt file.
 
 #define ZSTDHL_DEFLATECONV_MAX_CODE_LENGTH			15
 
-static const int kLog2Shift = 27;
+#define ZSTDHL_DEFLATECONV_MAX_MATCH_LENGTH			131074
+#define ZSTDHL_DEFLATECONV_MAX_DEFLATE_MATCH_LENGTH	258
 
-static const uint32_t kLog2Table[513] =
-{
-	0, 0, 134217728, 212730065, 268435456, 311643913, 346947793, 376796799,
-	402653184, 425460131, 445861641, 464317052, 481165521, 496664611, 511014527, 524373979,
-	536870912, 548609975, 559677859, 570147179, 580079369, 589526865, 598534780, 607142208,
-	615383249, 623287826, 630882339, 638190197, 645232255, 652027171, 658591707, 664940972,
-	671088640, 677047117, 682827703, 688440712, 693895587, 699200994, 704364907, 709394677,
-	714297097, 719078457, 723744593, 728300926, 732752508, 737104045, 741359936, 745524295,
-	749600977, 753593598, 757505554, 761340041, 765100067, 768788469, 772407925, 775960965,
-	779449983, 782877245, 786244899, 789554984, 792809435, 796010090, 799158700, 802256930,
-	805306368, 808308525, 811264845, 814176708, 817045431, 819872274, 822658440, 825405086,
-	828113315, 830784189, 833418722, 836017892, 838582635, 841113851, 843612405, 846079129,
-	848514825, 850920263, 853296185, 855643308, 857962321, 860253889, 862518654, 864757237,
-	866970236, 869158228, 871321773, 873461410, 875577664, 877671038, 879742023, 881791093,
-	883818705, 885825306, 887811326, 889777183, 891723282, 893650017, 895557769, 897446909,
-	899317795, 901170778, 903006197, 904824382, 906625653, 908410322, 910178693, 911931060,
-	913667711, 915388924, 917094973, 918786121, 920462627, 922124743, 923772712, 925406775,
-	927027163, 928634104, 930227818, 931808523, 933376428, 934931740, 936474658, 938005380,
-	939524096, 941030992, 942526253, 944010055, 945482573, 946943978, 948394436, 949834110,
-	951263159, 952681739, 954090002, 955488096, 956876168, 958254361, 959622814, 960981663,
-	962331043, 963671085, 965001917, 966323664, 967636450, 968940396, 970235620, 971522238,
-	972800363, 974070107, 975331579, 976584886, 977830133, 979067423, 980296857, 981518535,
-	982732553, 983939007, 985137991, 986329596, 987513913, 988691031, 989861036, 991024014,
-	992180049, 993329223, 994471617, 995607311, 996736382, 997858909, 998974965, 1000084626,
-	1001187964, 1002285050, 1003375956, 1004460750, 1005539501, 1006612275, 1007679138, 1008740156,
-	1009795392, 1010844908, 1011888766, 1012927027, 1013959751, 1014986996, 1016008821, 1017025281,
-	1018036433, 1019042333, 1020043034, 1021038590, 1022029054, 1023014477, 1023994911, 1024970406,
-	1025941010, 1026906774, 1027867745, 1028823971, 1029775497, 1030722371, 1031664637, 1032602339,
-	1033535523, 1034464231, 1035388506, 1036308390, 1037223925, 1038135151, 1039042110, 1039944840,
-	1040843381, 1041737772, 1042628050, 1043514254, 1044396421, 1045274587, 1046148788, 1047019060,
-	1047885439, 1048747958, 1049606652, 1050461556, 1051312701, 1052160121, 1053003849, 1053843917,
-	1054680355, 1055513196, 1056342471, 1057168209, 1057990440, 1058809195, 1059624503, 1060436392,
-	1061244891, 1062050028, 1062851832, 1063650329, 1064445546, 1065237512, 1066026251, 1066811791,
-	1067594156, 1068373374, 1069149468, 1069922464, 1070692386, 1071459260, 1072223108, 1072983955,
-	1073741824, 1074496738, 1075248720, 1075997794, 1076743981, 1077487303, 1078227783, 1078965442,
-	1079700301, 1080432383, 1081161706, 1081888294, 1082612164, 1083333339, 1084051838, 1084767681,
-	1085480887, 1086191476, 1086899467, 1087604878, 1088307730, 1089008039, 1089705824, 1090401104,
-	1091093896, 1091784219, 1092472089, 1093157524, 1093840542, 1094521158, 1095199391, 1095875257,
-	1096548771, 1097219951, 1097888813, 1098555372, 1099219645, 1099881646, 1100541392, 1101198898,
-	1101854178, 1102507249, 1103158124, 1103806819, 1104453348, 1105097726, 1105739966, 1106380083,
-	1107018091, 1107654004, 1108287835, 1108919598, 1109549307, 1110176974, 1110802614, 1111426238,
-	1112047861, 1112667494, 1113285151, 1113900844, 1114514585, 1115126388, 1115736263, 1116344223,
-	1116950281, 1117554448, 1118156735, 1118757155, 1119355719, 1119952438, 1120547324, 1121140388,
-	1121731641, 1122321094, 1122908759, 1123494645, 1124078764, 1124661126, 1125241742, 1125820622,
-	1126397777, 1126973216, 1127546951, 1128118990, 1128689345, 1129258024, 1129825039, 1130390397,
-	1130954110, 1131516187, 1132076637, 1132635469, 1133192693, 1133748318, 1134302354, 1134854809,
-	1135405692, 1135955012, 1136502778, 1137048999, 1137593684, 1138136840, 1138678478, 1139218604,
-	1139757229, 1140294359, 1140830003, 1141364169, 1141896866, 1142428102, 1142957884, 1143486221,
-	1144013120, 1144538589, 1145062636, 1145585268, 1146106494, 1146626321, 1147144755, 1147661806,
-	1148177479, 1148691783, 1149204724, 1149716310, 1150226549, 1150735446, 1151243009, 1151749245,
-	1152254161, 1152757764, 1153260061, 1153761058, 1154260762, 1154759180, 1155256318, 1155752184,
-	1156246782, 1156740121, 1157232205, 1157723043, 1158212639, 1158701001, 1159188134, 1159674044,
-	1160158738, 1160642222, 1161124502, 1161605584, 1162085473, 1162564176, 1163041699, 1163518046,
-	1163993225, 1164467241, 1164940099, 1165411805, 1165882365, 1166351784, 1166820067, 1167287221,
-	1167753251, 1168218162, 1168681959, 1169144648, 1169606234, 1170066722, 1170526118, 1170984427,
-	1171441653, 1171897802, 1172352879, 1172806890, 1173259838, 1173711729, 1174162568, 1174612360,
-	1175061109, 1175508821, 1175955500, 1176401151, 1176845778, 1177289387, 1177731982, 1178173568,
-	1178614149, 1179053730, 1179492315, 1179929909, 1180366516, 1180802141, 1181236788, 1181670462,
-	1182103167, 1182534907, 1182965686, 1183395509, 1183824380, 1184252304, 1184679284, 1185105324,
-	1185530429, 1185954603, 1186377849, 1186800173, 1187221577, 1187642066, 1188061645, 1188480316,
-	1188898083, 1189314952, 1189730924, 1190146005, 1190560199, 1190973508, 1191385937, 1191797489,
-	1192208168, 1192617978, 1193026923, 1193435006, 1193842231, 1194248601, 1194654120, 1195058791,
-	1195462619, 1195865606, 1196267756, 1196669073, 1197069560, 1197469220, 1197868057, 1198266074,
-	1198663274, 1199059662, 1199455240, 1199850011, 1200243979, 1200637147, 1201029519, 1201421097,
-	1201811884, 1202201885, 1202591102, 1202979538, 1203367196, 1203754080, 1204140192, 1204525536,
-	1204910114, 1205293931, 1205676988, 1206059288, 1206440836, 1206821633, 1207201683, 1207580988,
-	1207959552
-};
+#define ZSTDHL_DEFLATECONV_WINDOW_SIZE				32768
+
+// Approximate costs in bits used to pick between re-parse candidates
+#define ZSTDHL_DEFLATECONV_REPARSE_LITERAL_COST		8
+#define ZSTDHL_DEFLATECONV_REPARSE_SEQUENCE_COST	12
+#define ZSTDHL_DEFLATECONV_REPARSE_REPEAT_COST		2
+#define ZSTDHL_DEFLATECONV_REPARSE_TABLE_SYMBOL_COST	4	// Per symbol in a table description, used to cost whole blocks
 
 typedef struct zstdhl_DeflateConv_HuffmanTableEntry
 {
@@ -266,8 +207,12 @@ struct zstdhl_DeflateConv_State
 	uint32_t m_streamBits;
 	uint8_t m_numStreamBits;
 	uint8_t m_eof;
-	uint8_t m_isLastBlock;
+	uint8_t m_isLastBlock;			// The exported block is the last zstd block
+	uint8_t m_isLastDeflateBlock;
+	uint8_t m_continueBlock;		// The deflate block didn't fit in one zstd block and continues in the next one
 	uint8_t m_haveEncodedCompressedBlockWithSequences;
+	zstdhl_BlockType_t m_blockType;
+	zstdhl_BlockType_t m_exportBlockType;	// Compressed for re-parsed stored blocks, otherwise the deflate block type
 
 	zstdhl_Vector_t m_literalsVector;
 	zstdhl_Vector_t m_sequencesVector;
@@ -277,7 +222,6 @@ struct zstdhl_DeflateConv_State
 	zstdhl_Vector_t m_litLengthStatsVector;
 	zstdhl_Vector_t m_matchLengthStatsVector;
 	zstdhl_Vector_t m_offsetCodeStatsVector;
-	zstdhl_Vector_t m_litStatsVector;
 
 	zstdhl_Vector_t m_litLengthProbsVector;
 	zstdhl_Vector_t m_matchLengthProbsVector;
@@ -286,6 +230,8 @@ struct zstdhl_DeflateConv_State
 	zstdhl_Vector_t m_tempProbsVector;
 
 	uint32_t m_literalsEmittedSinceLastSequence;
+	uint32_t m_storedBytesRemaining;
+	uint64_t m_decodedSize;	// Total bytes decoded, used to reject distances that reach before the start of the stream
 
 	uint32_t m_repeatedOffset1;
 	uint32_t m_repeatedOffset2;
@@ -305,6 +251,19 @@ struct zstdhl_DeflateConv_State
 	zstdhl_StreamSourceObject_t m_litReader;
 	size_t m_litReadPos;
 	size_t m_sequenceReadPos;
+
+	uint8_t m_reparseEnabled;
+	zstdhl_DeflateConv_ReparseOptions_t m_reparseOptions;
+	zstdhl_Vector_t m_historyVector;
+	uint64_t m_historyStartPos;	// Stream position of the first byte in the history vector
+	uint64_t m_hashNextPos;		// Next stream position to insert into the hash chain
+	uint32_t *m_hashHeads;
+	uint32_t *m_hashChain;
+	uint32_t m_blockStartRepeatedOffsets[3];
+
+	zstdhl_Vector_t m_reparseLiteralsVector;
+	zstdhl_Vector_t m_reparseSequencesVector;
+	zstdhl_Vector_t m_reparseOffsetsVector;
 };
 
 static zstdhl_ResultCode_t zstdhl_DeflateConv_PeekBits(zstdhl_DeflateConv_State_t *state, uint8_t numBitsRequested, uint8_t *outNumBits, uint32_t *outBits, zstdhl_ResultCode_t readFailCode)
@@ -377,14 +336,8 @@ static zstdhl_ResultCode_t zstdhl_DeflateConv_ReadBits(zstdhl_DeflateConv_State_
 }
 
 
-zstdhl_ResultCode_t zstdhl_DeflateConv_CreateState(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_StreamSourceObject_t *streamSource, zstdhl_DeflateConv_State_t **outState)
+static void zstdhl_DeflateConv_InitStreamState(zstdhl_DeflateConv_State_t *state, const zstdhl_StreamSourceObject_t *streamSource)
 {
-	zstdhl_DeflateConv_State_t *state = alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_DeflateConv_State_t));
-	if (!state)
-		return ZSTDHL_RESULT_OUT_OF_MEMORY;
-
-	state->m_memAlloc.m_reallocFunc = alloc->m_reallocFunc;
-	state->m_memAlloc.m_userdata = alloc->m_userdata;
 	state->m_streamSource.m_readBytesFunc = streamSource->m_readBytesFunc;
 	state->m_streamSource.m_userdata = streamSource->m_userdata;
 
@@ -392,8 +345,14 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_CreateState(const zstdhl_MemoryAllocatorO
 	state->m_numStreamBits = 0;
 	state->m_eof = 0;
 	state->m_isLastBlock = 0;
+	state->m_isLastDeflateBlock = 0;
+	state->m_continueBlock = 0;
 	state->m_literalsEmittedSinceLastSequence = 0;
+	state->m_storedBytesRemaining = 0;
+	state->m_decodedSize = 0;
 	state->m_haveEncodedCompressedBlockWithSequences = 0;
+	state->m_blockType = ZSTDHL_BLOCK_TYPE_INVALID;
+	state->m_exportBlockType = ZSTDHL_BLOCK_TYPE_INVALID;
 
 	state->m_repeatedOffset1 = 1;
 	state->m_repeatedOffset2 = 4;
@@ -402,6 +361,24 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_CreateState(const zstdhl_MemoryAllocatorO
 	state->m_trees[0].m_weightTable.m_probabilities = state->m_trees[0].m_weightTableProbabilities;
 	state->m_trees[1].m_weightTable.m_probabilities = state->m_trees[1].m_weightTableProbabilities;
 	state->m_activeTreeIndex = -1;
+}
+
+zstdhl_ResultCode_t zstdhl_DeflateConv_CreateState(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_StreamSourceObject_t *streamSource, zstdhl_DeflateConv_State_t **outState)
+{
+	zstdhl_DeflateConv_State_t *state = alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_DeflateConv_State_t));
+	if (!state)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	state->m_memAlloc.m_reallocFunc = alloc->m_reallocFunc;
+	state->m_memAlloc.m_userdata = alloc->m_userdata;
+
+	zstdhl_DeflateConv_InitStreamState(state, streamSource);
+
+	state->m_reparseEnabled = 0;
+	state->m_historyStartPos = 0;
+	state->m_hashNextPos = 0;
+	state->m_hashHeads = NULL;
+	state->m_hashChain = NULL;
 
 	zstdhl_Vector_Init(&state->m_literalsVector, 1, alloc);
 	zstdhl_Vector_Init(&state->m_sequencesVector, sizeof(zstdhl_SequenceDesc_t), alloc);
@@ -411,7 +388,6 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_CreateState(const zstdhl_MemoryAllocatorO
 	zstdhl_Vector_Init(&state->m_litLengthStatsVector, sizeof(size_t), alloc);
 	zstdhl_Vector_Init(&state->m_matchLengthStatsVector, sizeof(size_t), alloc);
 	zstdhl_Vector_Init(&state->m_offsetCodeStatsVector, sizeof(size_t), alloc);
-	zstdhl_Vector_Init(&state->m_litStatsVector, sizeof(size_t), alloc);
 
 	zstdhl_Vector_Init(&state->m_litLengthProbsVector, sizeof(uint32_t), alloc);
 	zstdhl_Vector_Init(&state->m_matchLengthProbsVector, sizeof(uint32_t), alloc);
@@ -419,11 +395,46 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_CreateState(const zstdhl_MemoryAllocatorO
 
 	zstdhl_Vector_Init(&state->m_tempProbsVector, sizeof(uint32_t), alloc);
 
+	zstdhl_Vector_Init(&state->m_historyVector, 1, alloc);
+	zstdhl_Vector_Init(&state->m_reparseLiteralsVector, 1, alloc);
+	zstdhl_Vector_Init(&state->m_reparseSequencesVector, sizeof(zstdhl_SequenceDesc_t), alloc);
+	zstdhl_Vector_Init(&state->m_reparseOffsetsVector, sizeof(uint32_t), alloc);
+
 	*outState = state;
 
 	return ZSTDHL_RESULT_OK;
 }
 
+void zstdhl_DeflateConv_ResetState(zstdhl_DeflateConv_State_t *state, const zstdhl_StreamSourceObject_t *streamSource)
+{
+	zstdhl_DeflateConv_InitStreamState(state, streamSource);
+
+	zstdhl_Vector_Clear(&state->m_literalsVector);
+	zstdhl_Vector_Clear(&state->m_sequencesVector);
+	zstdhl_Vector_Clear(&state->m_offsetsVector);
+	zstdhl_Vector_Clear(&state->m_exportedSequenceCodesVector);
+
+	zstdhl_Vector_Clear(&state->m_litLengthStatsVector);
+	zstdhl_Vector_Clear(&state->m_matchLengthStatsVector);
+	zstdhl_Vector_Clear(&state->m_offsetCodeStatsVector);
+
+	zstdhl_Vector_Clear(&state->m_litLengthProbsVector);
+	zstdhl_Vector_Clear(&state->m_matchLengthProbsVector);
+	zstdhl_Vector_Clear(&state->m_offsetProbsVector);
+
+	zstdhl_Vector_Clear(&state->m_tempProbsVector);
+
+	// Moving the history start past everything hashed so far invalidates the old hash chain entries
+	// without having to clear the hash tables
+	state->m_historyStartPos += state->m_historyVector.m_count;
+	state->m_hashNextPos = state->m_historyStartPos;
+
+	zstdhl_Vector_Clear(&state->m_historyVector);
+	zstdhl_Vector_Clear(&state->m_reparseLiteralsVector);
+	zstdhl_Vector_Clear(&state->m_reparseSequencesVector);
+	zstdhl_Vector_Clear(&state->m_reparseOffsetsVector);
+}
+
 void zstdhl_DeflateConv_DestroyState(zstdhl_DeflateConv_State_t *state)
 {
 	zstdhl_Vector_Destroy(&state->m_literalsVector);
@@ -434,7 +445,6 @@ void zstdhl_DeflateConv_DestroyState(zstdhl_DeflateConv_State_t *state)
 	zstdhl_Vector_Destroy(&state->m_litLengthStatsVector);
 	zstdhl_Vector_Destroy(&state->m_matchLengthStatsVector);
 	zstdhl_Vector_Destroy(&state->m_offsetCodeStatsVector);
-	zstdhl_Vector_Destroy(&state->m_litStatsVector);
 
 	zstdhl_Vector_Destroy(&state->m_litLengthProbsVector);
 	zstdhl_Vector_Destroy(&state->m_matchLengthProbsVector);
@@ -442,25 +452,98 @@ void zstdhl_DeflateConv_DestroyState(zstdhl_DeflateConv_State_t *state)
 
 	zstdhl_Vector_Destroy(&state->m_tempProbsVector);
 
+	zstdhl_Vector_Destroy(&state->m_historyVector);
+	zstdhl_Vector_Destroy(&state->m_reparseLiteralsVector);
+	zstdhl_Vector_Destroy(&state->m_reparseSequencesVector);
+	zstdhl_Vector_Destroy(&state->m_reparseOffsetsVector);
+
+	if (state->m_hashHeads)
+		state->m_memAlloc.m_reallocFunc(state->m_memAlloc.m_userdata, state->m_hashHeads, 0);
+
+	if (state->m_hashChain)
+		state->m_memAlloc.m_reallocFunc(state->m_memAlloc.m_userdata, state->m_hashChain, 0);
+
 	state->m_memAlloc.m_reallocFunc(state->m_memAlloc.m_userdata, state, 0);
 }
 
-zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertRawBlock(zstdhl_DeflateConv_State_t *state, zstdhl_EncBlockDesc_t *outTempBlockDesc)
+zstdhl_ResultCode_t zstdhl_DeflateConv_EnableReparse(zstdhl_DeflateConv_State_t *state, const zstdhl_DeflateConv_ReparseOptions_t *options)
 {
-	uint32_t len = 0;
-	uint32_t nlen = 0;
-	uint32_t lenRemaining = 0;
-
-	zstdhl_Vector_Clear(&state->m_literalsVector);
+	size_t numHashHeads = 0;
+	size_t i = 0;
 
-	ZSTDHL_CHECKED(zstdhl_DeflateConv_DiscardBits(state, state->m_numStreamBits % 8u));
+	if (state->m_reparseEnabled || state->m_blockType != ZSTDHL_BLOCK_TYPE_INVALID)
+		return ZSTDHL_RESULT_INVALID_VALUE;
 
-	ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, 16, &len));
-	ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, 16, &nlen));
+	if (options->m_windowSize < 32768u || options->m_windowSize > (1u << 30) || !zstdhl_IsPowerOf2(options->m_windowSize))
+		return ZSTDHL_RESULT_INVALID_VALUE;
 
-	if (len != ((~nlen) & 0xffffu))
+	if (options->m_hashLog < 8 || options->m_hashLog > 24 || options->m_maxChainLength == 0)
 		return ZSTDHL_RESULT_INVALID_VALUE;
 
+	numHashHeads = ((size_t)1) << options->m_hashLog;
+
+	state->m_hashHeads = (uint32_t *)state->m_memAlloc.m_reallocFunc(state->m_memAlloc.m_userdata, NULL, numHashHeads * sizeof(uint32_t));
+	if (!state->m_hashHeads)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	state->m_hashChain = (uint32_t *)state->m_memAlloc.m_reallocFunc(state->m_memAlloc.m_userdata, NULL, options->m_windowSize * sizeof(uint32_t));
+	if (!state->m_hashChain)
+	{
+		state->m_memAlloc.m_reallocFunc(state->m_memAlloc.m_userdata, state->m_hashHeads, 0);
+		state->m_hashHeads = NULL;
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+	}
+
+	for (i = 0; i < numHashHeads; i++)
+		state->m_hashHeads[i] = 0;
+
+	for (i = 0; i < options->m_windowSize; i++)
+		state->m_hashChain[i] = 0;
+
+	state->m_reparseOptions = *options;
+	state->m_reparseEnabled = 1;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Blocks must fit in the smallest window that the converted frame can use
+static uint32_t zstdhl_DeflateConv_GetMaxBlockSize(const zstdhl_DeflateConv_State_t *state)
+{
+	uint32_t windowSize = ZSTDHL_DEFLATECONV_WINDOW_SIZE;
+
+	if (state->m_reparseEnabled)
+		windowSize = state->m_reparseOptions.m_windowSize;
+
+	if (windowSize > ZSTDHL_MAX_BLOCK_SIZE)
+		return ZSTDHL_MAX_BLOCK_SIZE;
+
+	return windowSize;
+}
+
+static void zstdhl_DeflateConv_FinishParsedBlock(zstdhl_DeflateConv_State_t *state, uint8_t continueBlock)
+{
+	state->m_continueBlock = continueBlock;
+	state->m_isLastBlock = (state->m_isLastDeflateBlock && !continueBlock);
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ReparseBlock(zstdhl_DeflateConv_State_t *state, size_t blockStartIndex, uint64_t existingParseCost, uint8_t *outIsReparsed);
+static void zstdhl_DeflateConv_LinkOffsets(zstdhl_DeflateConv_State_t *state);
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ParseStoredData(zstdhl_DeflateConv_State_t *state)
+{
+	uint32_t len = state->m_storedBytesRemaining;
+	uint32_t lenRemaining = 0;
+	uint32_t maxBlockSize = zstdhl_DeflateConv_GetMaxBlockSize(state);
+
+	state->m_exportBlockType = ZSTDHL_BLOCK_TYPE_RAW;
+
+	zstdhl_Vector_Clear(&state->m_literalsVector);
+	zstdhl_Vector_Clear(&state->m_sequencesVector);
+	zstdhl_Vector_Clear(&state->m_offsetsVector);
+
+	if (len > maxBlockSize)
+		len = maxBlockSize;
+
 	lenRemaining = len;
 
 	while (lenRemaining > 0)
@@ -499,8 +582,61 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertRawBlock(zstdhl_DeflateConv_State_
 		}
 	}
 
+	state->m_decodedSize += len;
+	state->m_storedBytesRemaining -= len;
+
+	if (state->m_reparseEnabled)
+	{
+		size_t blockStartIndex = state->m_historyVector.m_count;
+		uint8_t isReparsed = 0;
+
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_historyVector, state->m_literalsVector.m_data, state->m_literalsVector.m_count));
+
+		state->m_blockStartRepeatedOffsets[0] = state->m_repeatedOffset1;
+		state->m_blockStartRepeatedOffsets[1] = state->m_repeatedOffset2;
+		state->m_blockStartRepeatedOffsets[2] = state->m_repeatedOffset3;
+
+		// Stored data is re-parsed too, since it is often compressible data from a deflate encoder that didn't search
+		// for matches.  The alternative is a raw block, which costs 8 bits per byte.
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_ReparseBlock(state, blockStartIndex, (uint64_t)len * 8u, &isReparsed));
+
+		if (isReparsed)
+		{
+			zstdhl_DeflateConv_LinkOffsets(state);
+			state->m_exportBlockType = ZSTDHL_BLOCK_TYPE_COMPRESSED;
+		}
+	}
+
+	zstdhl_DeflateConv_FinishParsedBlock(state, state->m_storedBytesRemaining > 0);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ParseRawBlock(zstdhl_DeflateConv_State_t *state)
+{
+	uint32_t len = 0;
+	uint32_t nlen = 0;
+
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_DiscardBits(state, state->m_numStreamBits % 8u));
+
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, 16, &len));
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, 16, &nlen));
+
+	if (len != ((~nlen) & 0xffffu))
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	state->m_storedBytesRemaining = len;
+
+	return zstdhl_DeflateConv_ParseStoredData(state);
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ExportRawBlock(zstdhl_DeflateConv_State_t *state, zstdhl_EncBlockDesc_t *outTempBlockDesc)
+{
+	if (state->m_literalsVector.m_count > 0xffffffffu)
+		return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+
 	// Export the block
-	outTempBlockDesc->m_blockHeader.m_blockSize = len;
+	outTempBlockDesc->m_blockHeader.m_blockSize = (uint32_t)state->m_literalsVector.m_count;
 	outTempBlockDesc->m_blockHeader.m_blockType = ZSTDHL_BLOCK_TYPE_RAW;
 	outTempBlockDesc->m_blockHeader.m_isLastBlock = state->m_isLastBlock;
 
@@ -672,61 +808,16 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_LoadDynamicHuffmanCodes(zstdhl_DeflateCon
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_DeflateConv_DecodeMatch(zstdhl_DeflateConv_State_t *state, uint16_t litLengthSym)
+static zstdhl_ResultCode_t zstdhl_DeflateConv_AppendSequence(zstdhl_DeflateConv_State_t *state, zstdhl_Vector_t *sequencesVector, zstdhl_Vector_t *offsetsVector, uint32_t litLength, uint32_t matchLength, uint32_t dist)
 {
-	uint32_t length = 0;
-	uint32_t dist = 0;	// This must be uint32_t since it is added to the offsets bignum vector
-	uint8_t extraBits = 0;
-	uint16_t distSym = 0;
 	uint8_t emitNewSequence = 1;
 
-	if (litLengthSym < 261)
-		length = litLengthSym - 254;
-	else if (litLengthSym == 285)
-		length = 258;
-	else if (litLengthSym < 285)
-	{
-		extraBits = (litLengthSym - 261) / 4;
-		length = ((4 + ((litLengthSym - 261) & 3)) << extraBits) + 3;
-	}
-	else
-		return ZSTDHL_RESULT_INVALID_VALUE;
-
-	if (extraBits > 0)
-	{
-		uint32_t bits = 0;
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, extraBits, &bits));
-		length += bits;
-	}
-
-	ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadHuffmanCode(state, &state->m_distTree, &distSym));
-
-	if (distSym < 2)
-	{
-		extraBits = 0;
-		dist = distSym + 1;
-	}
-	else if (distSym < 30)
-	{
-		extraBits = (distSym - 2) / 2;
-		dist = ((2 + (distSym & 1)) << extraBits) + 1;
-	}
-	else
-		return ZSTDHL_RESULT_INVALID_VALUE;
-
-	if (extraBits > 0)
-	{
-		uint32_t bits = 0;
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, extraBits, &bits));
-		dist += bits;
-	}
-
-	if (state->m_literalsEmittedSinceLastSequence == 0 && state->m_sequencesVector.m_count > 0 && dist == state->m_repeatedOffset1)
+	if (litLength == 0 && sequencesVector->m_count > 0 && dist == state->m_repeatedOffset1)
 	{
-		zstdhl_SequenceDesc_t *prevSeq = (zstdhl_SequenceDesc_t *)(state->m_sequencesVector.m_data) + (state->m_sequencesVector.m_count - 1u);
-		uint32_t extendedMatch = prevSeq->m_matchLength + length;
+		zstdhl_SequenceDesc_t *prevSeq = (zstdhl_SequenceDesc_t *)(sequencesVector->m_data) + (sequencesVector->m_count - 1u);
+		uint32_t extendedMatch = prevSeq->m_matchLength + matchLength;
 
-		if (extendedMatch <= 131074)
+		if (extendedMatch <= ZSTDHL_DEFLATECONV_MAX_MATCH_LENGTH)
 		{
 			prevSeq->m_matchLength = extendedMatch;
 			emitNewSequence = 0;
@@ -736,8 +827,8 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_DecodeMatch(zstdhl_DeflateConv_State_t *s
 	if (emitNewSequence)
 	{
 		zstdhl_SequenceDesc_t seq;
-		seq.m_litLength = state->m_literalsEmittedSinceLastSequence;
-		seq.m_matchLength = length;
+		seq.m_litLength = litLength;
+		seq.m_matchLength = matchLength;
 		seq.m_offsetValueBigNum = NULL;
 		seq.m_offsetValueNumBits = 0;
 
@@ -776,365 +867,106 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_DecodeMatch(zstdhl_DeflateConv_State_t *s
 			seq.m_offsetType = ZSTDHL_OFFSET_TYPE_SPECIFIED;
 		}
 
-		ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_sequencesVector, &seq, 1));
-		ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_offsetsVector, &dist, 1));
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(sequencesVector, &seq, 1));
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(offsetsVector, &dist, 1));
 	}
 
-	state->m_literalsEmittedSinceLastSequence = 0;
-
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_DeflateConv_AddToStats(zstdhl_Vector_t *statsVector, uint32_t symbol)
+zstdhl_ResultCode_t zstdhl_DeflateConv_DecodeMatch(zstdhl_DeflateConv_State_t *state, uint16_t litLengthSym)
 {
-	while (statsVector->m_count <= symbol)
-	{
-		size_t zero = 0;
-
-		ZSTDHL_CHECKED(zstdhl_Vector_Append(statsVector, &zero, 1));
-	}
-
-	((size_t *)statsVector->m_data)[symbol]++;
-
-	return ZSTDHL_RESULT_OK;
-}
+	uint32_t length = 0;
+	uint32_t dist = 0;	// This must be uint32_t since it is added to the offsets bignum vector
+	uint8_t extraBits = 0;
+	uint16_t distSym = 0;
 
-static void zstdhl_ComputeFSETableUsage(uint32_t fseProb, uint8_t accuracyLog, uint16_t *outNumLargeShares, uint8_t *outLargeShareSize, uint16_t *outNumSmallShares, uint8_t *outSmallShareSize, uint8_t *outShareTotalBits)
-{
-	uint16_t numLargeShares = 0;
-	uint16_t numSmallShares = 0;
-	uint8_t largeShareSize = 0;
-	uint8_t smallShareSize = 0;
-	uint8_t shareTotalBits = 0;
-	int log2Prob = zstdhl_Log2_32(fseProb);
-
-	if (fseProb == (uint32_t)(1 << log2Prob))
+	if (litLengthSym < 261)
+		length = litLengthSym - 254;
+	else if (litLengthSym == 285)
+		length = 258;
+	else if (litLengthSym < 285)
 	{
-		smallShareSize = accuracyLog - (uint8_t)log2Prob;
-		numSmallShares = fseProb;
+		extraBits = (litLengthSym - 261) / 4;
+		length = ((4 + ((litLengthSym - 261) & 3)) << extraBits) + 3;
 	}
 	else
-	{
-		log2Prob++;	// For 5, log2prob == 3
-
-		smallShareSize = accuracyLog - log2Prob;
-		largeShareSize = smallShareSize + 1;
+		return ZSTDHL_RESULT_INVALID_VALUE;
 
-		numLargeShares = (uint32_t)(1 << log2Prob) - fseProb;
-		numSmallShares = fseProb - numLargeShares;
+	if (extraBits > 0)
+	{
+		uint32_t bits = 0;
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, extraBits, &bits));
+		length += bits;
 	}
 
-	*outNumLargeShares = numLargeShares;
-	*outNumSmallShares = numSmallShares;
-	*outLargeShareSize = largeShareSize;
-	*outSmallShareSize = smallShareSize;
-	*outShareTotalBits = (uint8_t)log2Prob;
-}
-
-zstdhl_ResultCode_t zstdhl_CreateFSEProbsFromStats(const size_t *stats, size_t numStats, uint32_t *outProbs, uint8_t accuracyLog, uint8_t *outProbsFit)
-{
-	size_t targetProbTotal = (size_t)1 << accuracyLog;
-	size_t numNonZeroStats = 0;
-	size_t i = 0;
-	size_t probsRemaining = targetProbTotal;
-	uint64_t score = 0;
-	size_t statsTotal = 0;
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadHuffmanCode(state, &state->m_distTree, &distSym));
 
-	for (i = 0; i < numStats; i++)
+	if (distSym < 2)
 	{
-		if (stats[i])
-			numNonZeroStats++;
-
-		statsTotal += stats[i];
+		extraBits = 0;
+		dist = distSym + 1;
 	}
-
-	if (numNonZeroStats > targetProbTotal || numNonZeroStats == 0)
+	else if (distSym < 30)
 	{
-		*outProbsFit = 0;
-		return ZSTDHL_RESULT_OK;
+		extraBits = (distSym - 2) / 2;
+		dist = ((2 + (distSym & 1)) << extraBits) + 1;
 	}
+	else
+		return ZSTDHL_RESULT_INVALID_VALUE;
 
-	for (i = 0; i < numStats; i++)
-		outProbs[i] = 0;
-
-	// Detect RLE-like table
-	if (numNonZeroStats == 1)
+	if (extraBits > 0)
 	{
-		for (i = 0; i < numStats; i++)
-		{
-			if (stats[i])
-			{
-				outProbs[i] = 1 << accuracyLog;
-				break;
-			}
-		}
-
-		*outProbsFit = 1;
-		return ZSTDHL_RESULT_OK;
+		uint32_t bits = 0;
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, extraBits, &bits));
+		dist += bits;
 	}
 
-	for (i = 0; i < numStats; i++)
-	{
-		if (stats[i])
-		{
-			outProbs[i] = 1;
-			probsRemaining--;
-		}
-	}
+	if (dist > state->m_decodedSize)
+		return ZSTDHL_RESULT_INVALID_VALUE;
 
-	while (probsRemaining > 0)
+	state->m_decodedSize += length;
+
+	if (state->m_reparseEnabled)
 	{
-		uint64_t bestScore = 0;
-		size_t bestIndex = numStats;
+		zstdhl_Vector_t *historyVector = &state->m_historyVector;
+		uint8_t *historyBytes = NULL;
+		size_t copyStart = 0;
+		size_t i = 0;
 
-		for (i = 0; i < numStats; i++)
-		{
-			uint32_t prob = outProbs[i];
-			if (prob)
-			{
-				uint64_t score = (uint64_t)stats[i] * (uint64_t)(kLog2Table[prob + 1] - kLog2Table[prob]);
-				if (bestIndex == numStats || score > bestScore)
-				{
-					bestScore = score;
-					bestIndex = i;
-				}
-			}
-		}
+		if (dist > historyVector->m_count)
+			return ZSTDHL_RESULT_INVALID_VALUE;
 
-		if (bestIndex == numStats)
-			return ZSTDHL_RESULT_INTERNAL_ERROR;
+		copyStart = historyVector->m_count - dist;
 
-		outProbs[bestIndex]++;
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(historyVector, NULL, length));
 
-		probsRemaining--;
+		historyBytes = (uint8_t *)historyVector->m_data;
+		for (i = 0; i < length; i++)
+			historyBytes[copyStart + dist + i] = historyBytes[copyStart + i];
 	}
 
-	for (i = 0; i < numStats; i++)
-	{
-		// if ((stats[i] / statsTotal) < (1 / (1 << accuracyLog)))
-		if (outProbs[i] == 1 && (stats[i] << accuracyLog) < statsTotal)
-			outProbs[i] = zstdhl_GetLessThanOneConstant();
-	}
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_AppendSequence(state, &state->m_sequencesVector, &state->m_offsetsVector, state->m_literalsEmittedSinceLastSequence, length, dist));
+
+	state->m_literalsEmittedSinceLastSequence = 0;
 
-	*outProbsFit = 1;
 	return ZSTDHL_RESULT_OK;
 }
 
-uint64_t zstdhl_DeflateConv_ScoreTable(const size_t *stats, size_t numStats, const zstdhl_FSETableDef_t *tableDef, uint8_t needEncodeTable, uint8_t *outIsValid)
+zstdhl_ResultCode_t zstdhl_DeflateConv_AddToStats(zstdhl_Vector_t *statsVector, uint32_t symbol)
 {
-	uint8_t accuracyLog = tableDef->m_accuracyLog;
-	uint64_t score = 0;
-	size_t i = 0;
-
-	*outIsValid = 0;
-
-	for (i = 0; i < numStats; i++)
+	while (statsVector->m_count <= symbol)
 	{
-		size_t count = stats[i];
+		size_t zero = 0;
 
-		if (count != 0)
-		{
-			uint32_t effectiveProb = 0;
-			if (i >= tableDef->m_numProbabilities || tableDef->m_probabilities[i] == 0)
-				return 0;
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(statsVector, &zero, 1));
+	}
 
-			effectiveProb = tableDef->m_probabilities[i];
-			if (effectiveProb == zstdhl_GetLessThanOneConstant())
-				effectiveProb = 1;
-
-			score += ((uint64_t)count) * (uint64_t)((9 << kLog2Shift) - kLog2Table[effectiveProb << (9 - accuracyLog)]);
-		}
-	}
-
-	score += ((uint64_t)1) << kLog2Shift;
-	score--;
-	score >>= kLog2Shift;
-
-	if (needEncodeTable)
-	{
-		uint32_t remainingProbPoints = (uint32_t)(1 << tableDef->m_accuracyLog);
-		uint32_t probIndex = 0;
-
-		score += 4;	// Accuracy log desc
-
-		while (remainingProbPoints > 0)
-		{
-			uint32_t maxEncodableValue = remainingProbPoints + 1;
-			int maxBitsRequired = zstdhl_Log2_32(maxEncodableValue) + 1;
-			uint32_t smallValueCutoff = (uint32_t)((1 << maxBitsRequired) - 1) - maxEncodableValue;
-			uint32_t prob = tableDef->m_probabilities[probIndex];
-			uint32_t codedProbValue = prob + 1;
-
-			if (prob == zstdhl_GetLessThanOneConstant())
-			{
-				codedProbValue = 0;
-				prob = 1;
-			}
-
-			remainingProbPoints -= prob;
-
-			score += (uint32_t)maxBitsRequired;
-			if (codedProbValue < smallValueCutoff)
-				score--;
-
-			probIndex++;
-			if (prob == 0)
-			{
-				uint32_t repeatCount = 0;
-				while (tableDef->m_probabilities[probIndex] == 0)
-				{
-					repeatCount++;
-					probIndex++;
-				}
-
-				score += ((repeatCount / 3u) + 1u) * 2u;
-			}
-		}
-	}
-
-	*outIsValid = 1;
-	return score;
-}
-
-zstdhl_ResultCode_t zstdhl_DeflateConv_TryFSETable(const size_t *stats, size_t numStats, zstdhl_Vector_t *probsVector, const zstdhl_FSETableDef_t *candidateTableDef, zstdhl_FSETableDef_t *outTableDef, uint8_t *outHaveScore, uint64_t *inOutBestScore, zstdhl_SequencesCompressionMode_t *outBestMode, zstdhl_SequencesCompressionMode_t newMode, uint8_t needEncodeTable, uint8_t numExtraBits)
-{
-	uint8_t isValid = 0;
-	uint64_t score = zstdhl_DeflateConv_ScoreTable(stats, numStats, candidateTableDef, needEncodeTable, &isValid) + numExtraBits;
-
-	if (isValid && (((*outHaveScore) == 0) || score < (*inOutBestScore)))
-	{
-		*outBestMode = newMode;
-		*inOutBestScore = score;
-		*outHaveScore = 1;
-
-		outTableDef->m_accuracyLog = candidateTableDef->m_accuracyLog;
-		outTableDef->m_numProbabilities = candidateTableDef->m_numProbabilities;
-
-		if (candidateTableDef->m_probabilities != probsVector->m_data)
-		{
-			size_t i = 0;
-			const uint32_t *probs = candidateTableDef->m_probabilities;
-			size_t numProbs = candidateTableDef->m_numProbabilities;
-
-			zstdhl_Vector_Clear(probsVector);
-
-			ZSTDHL_CHECKED(zstdhl_Vector_Append(probsVector, probs, numProbs));
-		}
-
-		outTableDef->m_probabilities = (const uint32_t *)probsVector->m_data;
-	}
-
-	return ZSTDHL_RESULT_OK;
-}
-
-zstdhl_ResultCode_t zstdhl_DeflateConv_SelectOptimalFSETable(const zstdhl_Vector_t *statsVector, zstdhl_Vector_t *probsVector, zstdhl_Vector_t *tempVectorU32, zstdhl_FSETableDef_t *table, zstdhl_SequencesCompressionMode_t *outMode, const zstdhl_SubstreamCompressionStructureDef_t *sdef, uint8_t isFirstCompressedBlock)
-{
-	uint8_t haveScore = 0;
-	uint64_t bestScore = 0;
-	const size_t *stats = (const size_t *)statsVector->m_data;
-	size_t numStats = statsVector->m_count;
-	size_t accuracyLog = 0;
-
-	// Try reuse
-	if (!isFirstCompressedBlock)
-	{
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_TryFSETable(stats, numStats, probsVector, table, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_REUSE, 0, 0));
-	}
-
-	// Try predefined
-	{
-		zstdhl_FSETableDef_t tableDef;
-		tableDef.m_accuracyLog = sdef->m_defaultAccuracyLog;
-		tableDef.m_numProbabilities = sdef->m_numProbs;
-		tableDef.m_probabilities = sdef->m_defaultProbs;
-
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_TryFSETable(stats, numStats, probsVector, &tableDef, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED, 0, 0));
-	}
-
-	// Try RLE
-	{
-		size_t i = 0;
-		size_t rleSym = 0;
-		uint8_t numStatsFound = 0;
-		uint8_t foundMultipleStat = 0;
-
-		for (i = 0; i < numStats; i++)
-		{
-			if (stats[i] != 0)
-			{
-				numStatsFound++;
-
-				if (numStatsFound > 1)
-					break;
-
-				rleSym = i;
-			}
-		}
-
-		if (numStatsFound == 1)
-		{
-			zstdhl_FSETableDef_t rleTableDef;
-			uint32_t fullStat = 1 << ZSTDHL_MIN_ACCURACY_LOG;
-
-			zstdhl_Vector_Clear(tempVectorU32);
-
-			for (i = 0; i < rleSym; i++)
-			{
-				uint32_t zero = 0;
-				ZSTDHL_CHECKED(zstdhl_Vector_Append(tempVectorU32, &zero, 1));
-			}
-
-			ZSTDHL_CHECKED(zstdhl_Vector_Append(tempVectorU32, &fullStat, 1));
-
-			rleTableDef.m_accuracyLog = ZSTDHL_MIN_ACCURACY_LOG;
-			rleTableDef.m_numProbabilities = rleSym + 1;
-			rleTableDef.m_probabilities = (const uint32_t *)tempVectorU32->m_data;
-
-			ZSTDHL_CHECKED(zstdhl_DeflateConv_TryFSETable(stats, numStats, probsVector, &rleTableDef, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_RLE, 0, 8));
-
-			zstdhl_Vector_Clear(tempVectorU32);
-		}
-	}
-
-	// Try FSE
-	if (numStats >= 2)
-	{
-		for (accuracyLog = ZSTDHL_MIN_ACCURACY_LOG; accuracyLog <= sdef->m_maxAccuracyLog; accuracyLog++)
-		{
-			size_t i = 0;
-			zstdhl_FSETableDef_t fseTableDef;
-			uint32_t *probs = NULL;
-			uint8_t probsFit = 0;
-
-			zstdhl_Vector_Clear(tempVectorU32);
-			for (i = 0; i < numStats; i++)
-			{
-				uint32_t zero = 0;
-
-				ZSTDHL_CHECKED(zstdhl_Vector_Append(tempVectorU32, &zero, 1));
-			}
-
-			probs = (uint32_t *)tempVectorU32->m_data;
-
-			ZSTDHL_CHECKED(zstdhl_CreateFSEProbsFromStats(stats, numStats, probs, (uint8_t)accuracyLog, &probsFit));
-
-			if (probsFit)
-			{
-				fseTableDef.m_numProbabilities = numStats;
-				fseTableDef.m_probabilities = probs;
-				fseTableDef.m_accuracyLog = (uint8_t)accuracyLog;
-
-				ZSTDHL_CHECKED(zstdhl_DeflateConv_TryFSETable(stats, numStats, probsVector, &fseTableDef, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_FSE, 1, 0));
-
-				zstdhl_Vector_Clear(tempVectorU32);
-			}
-		}
-	}
+	((size_t *)statsVector->m_data)[symbol]++;
 
 	return ZSTDHL_RESULT_OK;
 }
 
-
 size_t zstdhl_DeflateConv_ReadLits(void *userdata, void *dest, size_t numBytes)
 {
 	zstdhl_DeflateConv_State_t *state = (zstdhl_DeflateConv_State_t *)userdata;
@@ -1173,493 +1005,452 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ReadSequence(void *userdata, zstdhl_Seque
 	return ZSTDHL_RESULT_OK;
 }
 
-typedef struct zstdhl_DeflateConv_HuffmanTreeNode
-{
-	size_t m_count;
-	uint16_t m_depth;
-	uint16_t m_id;
-	struct zstdhl_DeflateConv_HuffmanTreeNode *m_parent;
-	struct zstdhl_DeflateConv_HuffmanTreeNode *m_children[2];
-	uint8_t m_symbol;
-} zstdhl_DeflateConv_HuffmanTreeNode_t;
-
-static void zstdhl_DeflateConv_RecursiveComputeHuffmanDepths(zstdhl_DeflateConv_HuffmanTreeNode_t *tree, size_t depth)
+zstdhl_ResultCode_t zstdhl_DeflateConv_FindRLEByte(const zstdhl_FSETableDef_t *table, uint8_t *rleByte)
 {
-	tree->m_depth = (uint16_t)depth;
+	size_t i = 0;
+	uint8_t numSyms = 0;
+
+	for (i = 0; i < table->m_numProbabilities; i++)
+	{
+		if (table->m_probabilities[i] != 0)
+		{
+			numSyms++;
+			if (numSyms == 2)
+				return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+			*rleByte = (uint8_t)i;
+		}
+	}
 
-	if (tree->m_children[0])
-		zstdhl_DeflateConv_RecursiveComputeHuffmanDepths(tree->m_children[0], depth + 1);
-	if (tree->m_children[1])
-		zstdhl_DeflateConv_RecursiveComputeHuffmanDepths(tree->m_children[1], depth + 1);
+	return ZSTDHL_RESULT_OK;
 }
 
-static zstdhl_ResultCode_t zstdhl_DeflateConv_CreateHuffmanTreeForStats(zstdhl_HuffmanTreeDesc_t *tree, const size_t *stats, size_t numStats)
+
+static void zstdhl_DeflateConv_SlideHistory(zstdhl_DeflateConv_State_t *state)
 {
-	zstdhl_DeflateConv_HuffmanTreeNode_t treeNodes[512];
-	zstdhl_DeflateConv_HuffmanTreeNode_t *unprocessedNodes[257];
-	size_t numNodes = 0;
-	size_t numUnprocessedNodes = 0;
+	zstdhl_Vector_t *historyVector = &state->m_historyVector;
+	size_t windowSize = state->m_reparseOptions.m_windowSize;
+	size_t discardSize = 0;
+	uint8_t *historyBytes = NULL;
 	size_t i = 0;
-	size_t numLeafNodes = 0;
-	size_t largestDepth = 0;
-	size_t numSpecifiedWeights = 0;
-	size_t weightStats[ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1];
-	uint32_t weightProbs[2][ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1];
-	size_t leafsWithBitCount[256];
-	size_t sortedLeafs[256];
-	uint8_t weightProbsFit[3];
-	uint64_t scores[3];
-	uint8_t haveValidScore = 0;
-	uint64_t bestScoreIndex = 0;
-	uint64_t weightRepeatsScore = 0;
-	uint8_t haveBadLeafs = 0;
-
-	if (numStats < 2)
-		return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-	{
-		size_t sortedLeafIndex = 0;
+	if (historyVector->m_count <= windowSize * 2u)
+		return;
 
-		for (i = 0; i < 256; i++)
-			sortedLeafs[i] = 0;
+	discardSize = historyVector->m_count - windowSize;
+	historyBytes = (uint8_t *)historyVector->m_data;
 
-		for (i = 0; i < sizeof(leafsWithBitCount) / sizeof(leafsWithBitCount[0]); i++)
-			leafsWithBitCount[i] = 0;
+	for (i = 0; i < windowSize; i++)
+		historyBytes[i] = historyBytes[discardSize + i];
 
-		numNodes = 0;
-		numUnprocessedNodes = 0;
-		numLeafNodes = 0;
-		largestDepth = 0;
+	zstdhl_Vector_Shrink(historyVector, windowSize);
+	state->m_historyStartPos += discardSize;
 
-		for (i = 0; i < numStats; i++)
-		{
-			size_t count = stats[i];
-			if (count)
-			{
-				zstdhl_DeflateConv_HuffmanTreeNode_t *node = treeNodes + numLeafNodes;
+	if (state->m_hashNextPos < state->m_historyStartPos)
+		state->m_hashNextPos = state->m_historyStartPos;
+}
 
-				node->m_symbol = (uint8_t)i;
-				node->m_count = count;
-				node->m_children[0] = NULL;
-				node->m_children[1] = NULL;
-				node->m_parent = NULL;
-				node->m_id = (uint16_t)numLeafNodes;
+static uint32_t zstdhl_DeflateConv_HashHistory(const uint8_t *bytes, uint8_t hashLog)
+{
+	uint32_t value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
 
-				unprocessedNodes[numLeafNodes] = &treeNodes[numLeafNodes];
+	return (value * 2654435761u) >> (32 - hashLog);
+}
 
-				numLeafNodes++;
-			}
-		}
+// Inserts all positions before endIndex into the hash chain
+static void zstdhl_DeflateConv_InsertHashes(zstdhl_DeflateConv_State_t *state, size_t endIndex)
+{
+	const uint8_t *historyBytes = (const uint8_t *)state->m_historyVector.m_data;
+	size_t historySize = state->m_historyVector.m_count;
+	size_t index = (size_t)(state->m_hashNextPos - state->m_historyStartPos);
+	uint32_t chainMask = state->m_reparseOptions.m_windowSize - 1u;
+	uint8_t hashLog = state->m_reparseOptions.m_hashLog;
 
-		numUnprocessedNodes = numLeafNodes;
-		numNodes = numLeafNodes;
+	if (historySize < 4)
+		return;
 
-		while (numUnprocessedNodes > 1)
-		{
-			size_t smallestIndex = 0;
-			size_t secondSmallestIndex = 0;
-			zstdhl_DeflateConv_HuffmanTreeNode_t *up0 = NULL;
-			zstdhl_DeflateConv_HuffmanTreeNode_t *up1 = NULL;
-			zstdhl_DeflateConv_HuffmanTreeNode_t *newParent = &treeNodes[numNodes];
-			size_t firstIndexToRemove = 0;
-			size_t secondIndexToRemove = 0;
-
-			for (i = 1; i < numUnprocessedNodes; i++)
-			{
-				if (unprocessedNodes[i]->m_count < unprocessedNodes[smallestIndex]->m_count)
-					smallestIndex = i;
-			}
+	if (endIndex > historySize - 3u)
+		endIndex = historySize - 3u;
 
-			if (smallestIndex == 0)
-				secondSmallestIndex = 1;
+	while (index < endIndex)
+	{
+		uint64_t pos = state->m_historyStartPos + index;
+		uint32_t hash = zstdhl_DeflateConv_HashHistory(historyBytes + index, hashLog);
 
-			for (i = 0; i < numUnprocessedNodes; i++)
-			{
-				if (i != smallestIndex && unprocessedNodes[i]->m_count < unprocessedNodes[secondSmallestIndex]->m_count)
-					secondSmallestIndex = i;
-			}
+		state->m_hashChain[pos & chainMask] = state->m_hashHeads[hash];
+		state->m_hashHeads[hash] = (uint32_t)(pos + 1u);
+		index++;
+	}
 
-			up0 = &treeNodes[smallestIndex];
-			up1 = &treeNodes[secondSmallestIndex];
+	if (state->m_historyStartPos + index > state->m_hashNextPos)
+		state->m_hashNextPos = state->m_historyStartPos + index;
+}
 
-			if (unprocessedNodes[smallestIndex]->m_children[0] == NULL)
-			{
-				size_t nodeID = unprocessedNodes[smallestIndex]->m_id;
-				if (nodeID < numLeafNodes)
-					sortedLeafs[sortedLeafIndex++] = nodeID;
-			}
-			if (unprocessedNodes[secondSmallestIndex]->m_children[0] == NULL)
-			{
-				size_t nodeID = unprocessedNodes[secondSmallestIndex]->m_id;
-				if (nodeID < numLeafNodes)
-					sortedLeafs[sortedLeafIndex++] = nodeID;
-			}
+static uint32_t zstdhl_DeflateConv_CountMatch(const uint8_t *historyBytes, size_t index, uint32_t dist, size_t endIndex)
+{
+	const uint8_t *src = historyBytes + index - dist;
+	const uint8_t *dest = historyBytes + index;
+	size_t maxLength = endIndex - index;
+	size_t length = 0;
 
-			firstIndexToRemove = smallestIndex;
-			secondIndexToRemove = secondSmallestIndex;
-			if (secondSmallestIndex > firstIndexToRemove)
-			{
-				firstIndexToRemove = secondSmallestIndex;
-				secondIndexToRemove = smallestIndex;
-			}
+	if (maxLength > ZSTDHL_DEFLATECONV_MAX_MATCH_LENGTH)
+		maxLength = ZSTDHL_DEFLATECONV_MAX_MATCH_LENGTH;
 
-			up0 = unprocessedNodes[smallestIndex];
-			up1 = unprocessedNodes[secondSmallestIndex];
+	while (length < maxLength && src[length] == dest[length])
+		length++;
 
-			newParent->m_children[0] = up0;
-			newParent->m_children[1] = up1;
-			newParent->m_count = up0->m_count + up1->m_count;
-			newParent->m_symbol = 0;
-			newParent->m_id = (uint16_t)numNodes;
-			newParent->m_parent = NULL;
-			up0->m_parent = newParent;
-			up1->m_parent = newParent;
+	return (uint32_t)length;
+}
 
-			unprocessedNodes[firstIndexToRemove] = unprocessedNodes[--numUnprocessedNodes];
-			unprocessedNodes[secondIndexToRemove] = unprocessedNodes[--numUnprocessedNodes];
-			unprocessedNodes[numUnprocessedNodes++] = newParent;
+static int32_t zstdhl_DeflateConv_ScoreMatch(const zstdhl_DeflateConv_State_t *state, uint32_t litLength, uint32_t matchLength, uint32_t dist)
+{
+	int32_t cost = ZSTDHL_DEFLATECONV_REPARSE_SEQUENCE_COST;
+	uint8_t isRepeat = 0;
 
-			numNodes++;
-		}
+	if (litLength != 0)
+		isRepeat = (dist == state->m_repeatedOffset1 || dist == state->m_repeatedOffset2 || dist == state->m_repeatedOffset3);
+	else
+		isRepeat = (dist == state->m_repeatedOffset2 || dist == state->m_repeatedOffset3 || dist + 1u == state->m_repeatedOffset1);
 
-		if (sortedLeafIndex != numLeafNodes)
-			return ZSTDHL_RESULT_INTERNAL_ERROR;
+	if (isRepeat)
+		cost += ZSTDHL_DEFLATECONV_REPARSE_REPEAT_COST;
+	else
+		cost += zstdhl_Log2_32(dist + 3u);
 
-		zstdhl_DeflateConv_RecursiveComputeHuffmanDepths(unprocessedNodes[0], 0);
+	return (int32_t)matchLength * ZSTDHL_DEFLATECONV_REPARSE_LITERAL_COST - cost;
+}
 
-		for (i = 0; i < numLeafNodes; i++)
-		{
-			uint16_t depth = treeNodes[i].m_depth;
-			if (depth > ZSTDHL_MAX_HUFFMAN_CODE_LENGTH)
-				haveBadLeafs = 1;
+static void zstdhl_DeflateConv_TryReparseCandidate(const zstdhl_DeflateConv_State_t *state, size_t index, size_t endIndex, uint32_t litLength, uint32_t dist, uint32_t *inOutLength, uint32_t *inOutDist, int32_t *inOutScore)
+{
+	const uint8_t *historyBytes = (const uint8_t *)state->m_historyVector.m_data;
+	uint32_t length = 0;
+	int32_t score = 0;
 
-			leafsWithBitCount[depth]++;
+	if (dist == 0 || dist > index || dist > state->m_reparseOptions.m_windowSize)
+		return;
 
-			if (depth > largestDepth)
-				largestDepth = depth;
-		}
-	}
+	length = zstdhl_DeflateConv_CountMatch(historyBytes, index, dist, endIndex);
+	if (length < 3)
+		return;
 
-	// Fix oversized codes
-	if (haveBadLeafs)
+	score = zstdhl_DeflateConv_ScoreMatch(state, litLength, length, dist);
+	if (score > *inOutScore)
 	{
-		size_t depthToRemove = largestDepth;
-		size_t numLeafsToReinsert = 0;
-
-		// Go through layers bottom-up and collapse them upward by removing 1 leaf
-		while (depthToRemove > ZSTDHL_MAX_HUFFMAN_CODE_LENGTH)
-		{
-			size_t leafsRemoved = leafsWithBitCount[depthToRemove] / 2u;
+		*inOutLength = length;
+		*inOutDist = dist;
+		*inOutScore = score;
+	}
+}
 
-			if (leafsWithBitCount[depthToRemove] & 1)
-				return ZSTDHL_RESULT_INTERNAL_ERROR;
+static void zstdhl_DeflateConv_FindReparseMatch(zstdhl_DeflateConv_State_t *state, size_t index, size_t endIndex, uint32_t litLength, uint32_t originalDist, uint32_t *outLength, uint32_t *outDist, int32_t *outScore)
+{
+	const uint8_t *historyBytes = NULL;
+	uint32_t bestLength = 0;
+	uint32_t bestDist = 0;
+	int32_t bestScore = 0;
+	uint32_t windowSize = state->m_reparseOptions.m_windowSize;
+	uint32_t chainMask = windowSize - 1u;
+	uint32_t chainRemaining = state->m_reparseOptions.m_maxChainLength;
+	uint32_t posPlusOne = 0;
+	uint32_t entry = 0;
+	uint32_t prevDist = 0;
 
-			numLeafsToReinsert += leafsRemoved;
-			leafsWithBitCount[depthToRemove - 1] += leafsRemoved;
-			leafsWithBitCount[depthToRemove] = 0;
+	zstdhl_DeflateConv_InsertHashes(state, index);
 
-			depthToRemove--;
-		}
+	historyBytes = (const uint8_t *)state->m_historyVector.m_data;
 
-		// Re-add removed leafs
-		while (numLeafsToReinsert > 0)
-		{
-			uint8_t skippedALevel = 0;
+	if (originalDist != 0)
+		zstdhl_DeflateConv_TryReparseCandidate(state, index, endIndex, litLength, originalDist, &bestLength, &bestDist, &bestScore);
 
-			size_t depthToSplit = ZSTDHL_MAX_HUFFMAN_CODE_LENGTH - 1;
+	zstdhl_DeflateConv_TryReparseCandidate(state, index, endIndex, litLength, state->m_repeatedOffset1, &bestLength, &bestDist, &bestScore);
+	zstdhl_DeflateConv_TryReparseCandidate(state, index, endIndex, litLength, state->m_repeatedOffset2, &bestLength, &bestDist, &bestScore);
+	zstdhl_DeflateConv_TryReparseCandidate(state, index, endIndex, litLength, state->m_repeatedOffset3, &bestLength, &bestDist, &bestScore);
 
-			// Find a splittable level
-			while (leafsWithBitCount[depthToSplit] == 0)
-			{
-				skippedALevel = 1;
-				depthToSplit--;
-			}
+	if (litLength == 0 && state->m_repeatedOffset1 > 1)
+		zstdhl_DeflateConv_TryReparseCandidate(state, index, endIndex, litLength, state->m_repeatedOffset1 - 1u, &bestLength, &bestDist, &bestScore);
 
-			// Split leafs at this level.  If there are deeper levels than this, only split 1 leaf and cycle the loop again
-			{
+	if (endIndex - index >= 4 && index + 4 <= state->m_historyVector.m_count)
+	{
+		posPlusOne = (uint32_t)(state->m_historyStartPos + index + 1u);
+		entry = state->m_hashHeads[zstdhl_DeflateConv_HashHistory(historyBytes + index, state->m_reparseOptions.m_hashLog)];
 
-				size_t leafsToSplit = leafsWithBitCount[depthToSplit];
-				if (leafsToSplit > numLeafsToReinsert)
-					leafsToSplit = numLeafsToReinsert;
+		while (entry != 0 && chainRemaining > 0)
+		{
+			uint32_t dist = posPlusOne - entry;
 
-				if (skippedALevel)
-					leafsToSplit = 1;
+			if (dist <= prevDist || dist > windowSize || dist > index)
+				break;
 
-				leafsWithBitCount[depthToSplit] -= leafsToSplit;
-				leafsWithBitCount[depthToSplit + 1] += leafsToSplit * 2u;
+			// Skip candidates that can't be longer than the current best
+			if (bestLength == 0 || (index + bestLength < endIndex && historyBytes[index + bestLength] == historyBytes[index + bestLength - dist]))
+				zstdhl_DeflateConv_TryReparseCandidate(state, index, endIndex, litLength, dist, &bestLength, &bestDist, &bestScore);
 
-				numLeafsToReinsert -= leafsToSplit;
-			}
+			prevDist = dist;
+			entry = state->m_hashChain[(entry - 1u) & chainMask];
+			chainRemaining--;
 		}
 	}
 
-	largestDepth = 0;
+	*outLength = bestLength;
+	*outDist = bestDist;
+	*outScore = bestScore;
+}
 
-	for (i = 0; i <= ZSTDHL_MAX_HUFFMAN_CODE_LENGTH; i++)
-		if (leafsWithBitCount[i])
-			largestDepth = i;
+// Estimates the encoded size in bits of a stream of codes from its entropy, plus a rough cost for the table description
+static uint64_t zstdhl_DeflateConv_EstimateCodeStreamCost(const size_t *stats, size_t numStats)
+{
+	size_t numCountedSymbols = 0;
+	size_t numDistinct = 0;
+	size_t i = 0;
 
-	// Redistribute leafs if there were bad nodes
-	if (haveBadLeafs)
+	for (i = 0; i < numStats; i++)
 	{
-		size_t bitCount = ZSTDHL_MAX_HUFFMAN_CODE_LENGTH;
-
-		for (i = 0; i < numLeafNodes; i++)
+		if (stats[i] != 0)
 		{
-			while (leafsWithBitCount[bitCount] == 0)
-				bitCount--;
-
-			leafsWithBitCount[bitCount]--;
-
-			treeNodes[sortedLeafs[i]].m_depth = (uint16_t)bitCount;
+			numDistinct++;
+			numCountedSymbols = i + 1;
 		}
 	}
 
-	if (numLeafNodes == 0)
-		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	if (numDistinct == 0)
+		return 0;
 
-	tree->m_partialWeightDesc.m_numSpecifiedWeights = 0;
-	for (i = 0; i < 256; i++)
-		tree->m_weightTableProbabilities[i] = 0;
+	// RLE byte
+	if (numDistinct == 1)
+		return 8;
 
-	for (i = 0; i < 255; i++)
-		tree->m_partialWeightDesc.m_specifiedWeights[i] = 0;
+	return zstdhl_EstimateEntropyBits(stats, numStats) + numCountedSymbols * ZSTDHL_DEFLATECONV_REPARSE_TABLE_SYMBOL_COST;
+}
 
-	for (i = 0; i < (ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1); i++)
-	{
-		weightStats[i] = 0;
-		weightProbs[0][i] = 0;
-		weightProbs[1][i] = 0;
-	}
+// Estimates the encoded size in bits of a parsed block
+static zstdhl_ResultCode_t zstdhl_DeflateConv_EstimateParseCost(const zstdhl_Vector_t *literalsVector, const zstdhl_Vector_t *sequencesVector, const zstdhl_Vector_t *offsetsVector, uint64_t *outCost)
+{
+	size_t litStats[256];
+	size_t litLengthStats[ZSTDHL_MAX_LIT_LENGTH_CODE + 1];
+	size_t matchLengthStats[ZSTDHL_MAX_MATCH_LENGTH_CODE + 1];
+	size_t offsetCodeStats[32];
+	const uint8_t *lits = (const uint8_t *)literalsVector->m_data;
+	const zstdhl_SequenceDesc_t *sequences = (const zstdhl_SequenceDesc_t *)sequencesVector->m_data;
+	const uint32_t *offsets = (const uint32_t *)offsetsVector->m_data;
+	uint64_t cost = 0;
+	size_t i = 0;
 
-	for (i = 0; i < numLeafNodes; i++)
-	{
-		uint8_t symbol = treeNodes[i].m_symbol;
-		uint8_t weight = 0;
+	for (i = 0; i < 256; i++)
+		litStats[i] = 0;
+	for (i = 0; i <= ZSTDHL_MAX_LIT_LENGTH_CODE; i++)
+		litLengthStats[i] = 0;
+	for (i = 0; i <= ZSTDHL_MAX_MATCH_LENGTH_CODE; i++)
+		matchLengthStats[i] = 0;
+	for (i = 0; i < 32; i++)
+		offsetCodeStats[i] = 0;
 
-		weight = (uint8_t)(largestDepth + 1 - treeNodes[i].m_depth);
+	for (i = 0; i < literalsVector->m_count; i++)
+		litStats[lits[i]]++;
 
-		if (symbol < 255)
-			tree->m_partialWeightDesc.m_specifiedWeights[symbol] = weight;
+	for (i = 0; i < sequencesVector->m_count; i++)
+	{
+		uint32_t litLengthCode = 0;
+		uint32_t matchLengthCode = 0;
+		uint32_t offsetCode = 0;
+		uint32_t offsetCodeEncoded = 0;
+		uint32_t offsetSpecifiedValue = 0;
+		uint32_t extraBits = 0;
+		uint8_t extraNumBits = 0;
 
-		if (symbol > numSpecifiedWeights)
-			numSpecifiedWeights = symbol;
+		if (sequences[i].m_offsetType == ZSTDHL_OFFSET_TYPE_SPECIFIED)
+			offsetSpecifiedValue = offsets[i];
 
-		if (weight > ZSTDHL_MAX_HUFFMAN_WEIGHT)
-			return ZSTDHL_RESULT_INTERNAL_ERROR;
-	}
+		ZSTDHL_CHECKED(zstdhl_EncodeLitLength(sequences[i].m_litLength, &litLengthCode, &extraBits, &extraNumBits));
+		cost += extraNumBits;
 
-	tree->m_partialWeightDesc.m_numSpecifiedWeights = (uint8_t)numSpecifiedWeights;
+		ZSTDHL_CHECKED(zstdhl_EncodeMatchLength(sequences[i].m_matchLength, &matchLengthCode, &extraBits, &extraNumBits));
+		cost += extraNumBits;
 
-	if (numSpecifiedWeights < 1)
-		return ZSTDHL_RESULT_INTERNAL_ERROR;
+		ZSTDHL_CHECKED(zstdhl_ResolveOffsetCode32(sequences[i].m_offsetType, sequences[i].m_litLength, offsetSpecifiedValue, &offsetCode));
+		ZSTDHL_CHECKED(zstdhl_EncodeOffsetCode(offsetCode, &offsetCodeEncoded, &extraBits, &extraNumBits));
+		cost += extraNumBits;
 
-	for (i = 0; i < numSpecifiedWeights; i++)
-		weightStats[tree->m_partialWeightDesc.m_specifiedWeights[i]]++;
+		if (offsetCodeEncoded >= 32)
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-	if (numSpecifiedWeights < 2)
-	{
-		weightProbsFit[0] = 0;
-		weightProbsFit[1] = 0;
+		litLengthStats[litLengthCode]++;
+		matchLengthStats[matchLengthCode]++;
+		offsetCodeStats[offsetCodeEncoded]++;
 	}
-	else
-	{
-		for (i = 0; i < 2; i++)
-		{
-			uint8_t accuracyLog = (uint8_t)(i + ZSTDHL_MIN_ACCURACY_LOG);
-			uint8_t probsFit = 0;
-
-			ZSTDHL_CHECKED(zstdhl_CreateFSEProbsFromStats(weightStats, ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1, weightProbs[i], accuracyLog, &weightProbsFit[i]));
 
-			if (weightProbsFit[i])
-			{
-				zstdhl_FSETableDef_t tableDef;
-				tableDef.m_accuracyLog = accuracyLog;
-				tableDef.m_numProbabilities = ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1;
-				tableDef.m_probabilities = weightProbs[i];
+	cost += zstdhl_DeflateConv_EstimateCodeStreamCost(litStats, 256);
+	cost += zstdhl_DeflateConv_EstimateCodeStreamCost(litLengthStats, ZSTDHL_MAX_LIT_LENGTH_CODE + 1);
+	cost += zstdhl_DeflateConv_EstimateCodeStreamCost(matchLengthStats, ZSTDHL_MAX_MATCH_LENGTH_CODE + 1);
+	cost += zstdhl_DeflateConv_EstimateCodeStreamCost(offsetCodeStats, 32);
 
-				scores[i] = zstdhl_DeflateConv_ScoreTable(weightStats, ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1, &tableDef, 1, &weightProbsFit[i]);
-			}
-		}
-	}
+	*outCost = cost;
+	return ZSTDHL_RESULT_OK;
+}
 
-	if (numSpecifiedWeights <= 128)
+// Re-parses the block decoded into the history vector starting at blockStartIndex, using matches found with the full
+// window and repeat offsets.  The re-parse replaces the existing parse only if its estimated cost is lower than
+// existingParseCost bits.
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ReparseBlock(zstdhl_DeflateConv_State_t *state, size_t blockStartIndex, uint64_t existingParseCost, uint8_t *outIsReparsed)
+{
+	const zstdhl_SequenceDesc_t *origSequences = (const zstdhl_SequenceDesc_t *)state->m_sequencesVector.m_data;
+	const uint32_t *origOffsets = (const uint32_t *)state->m_offsetsVector.m_data;
+	size_t numOrigSequences = state->m_sequencesVector.m_count;
+	size_t origSequenceIndex = 0;
+	size_t origMatchStart = blockStartIndex;
+	size_t origMatchEnd = blockStartIndex;
+	uint32_t origDist = 0;
+	size_t endIndex = state->m_historyVector.m_count;
+	size_t index = blockStartIndex;
+	size_t litStart = blockStartIndex;
+	uint32_t existingRepeatedOffsets[3];
+	uint64_t reparseCost = 0;
+
+	*outIsReparsed = 0;
+
+	existingRepeatedOffsets[0] = state->m_repeatedOffset1;
+	existingRepeatedOffsets[1] = state->m_repeatedOffset2;
+	existingRepeatedOffsets[2] = state->m_repeatedOffset3;
+
+	state->m_repeatedOffset1 = state->m_blockStartRepeatedOffsets[0];
+	state->m_repeatedOffset2 = state->m_blockStartRepeatedOffsets[1];
+	state->m_repeatedOffset3 = state->m_blockStartRepeatedOffsets[2];
+
+	zstdhl_Vector_Clear(&state->m_reparseLiteralsVector);
+	zstdhl_Vector_Clear(&state->m_reparseSequencesVector);
+	zstdhl_Vector_Clear(&state->m_reparseOffsetsVector);
+
+	while (index < endIndex)
 	{
-		size_t numBytes = (numSpecifiedWeights + 1) / 2;
+		uint32_t length = 0;
+		uint32_t dist = 0;
+		int32_t score = 0;
 
-		weightProbsFit[2] = 1;
-		scores[2] = numBytes * 8u;
-	}
-	else
-		weightProbsFit[2] = 0;
-
-	for (i = 0; i < 3; i++)
-	{
-		if (weightProbsFit[i])
+		// Advance to the deflate match covering this position, if any
+		while (index >= origMatchEnd && origSequenceIndex < numOrigSequences)
 		{
-			if (haveValidScore == 0 || scores[i] < scores[bestScoreIndex])
-			{
-				bestScoreIndex = i;
-				haveValidScore = 1;
-			}
+			origMatchStart = origMatchEnd + origSequences[origSequenceIndex].m_litLength;
+			origMatchEnd = origMatchStart + origSequences[origSequenceIndex].m_matchLength;
+			origDist = origOffsets[origSequenceIndex];
+			origSequenceIndex++;
 		}
-	}
 
-	if (!haveValidScore)
-		return ZSTDHL_RESULT_INTERNAL_ERROR;
+		zstdhl_DeflateConv_FindReparseMatch(state, index, endIndex, (uint32_t)(index - litStart), (index >= origMatchStart && index < origMatchEnd) ? origDist : 0, &length, &dist, &score);
 
-	if (bestScoreIndex == 0 || bestScoreIndex == 1)
-	{
-		tree->m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE;
-		tree->m_weightTable.m_probabilities = tree->m_weightTableProbabilities;
-		tree->m_weightTable.m_accuracyLog = (uint8_t)(bestScoreIndex + ZSTDHL_MIN_ACCURACY_LOG);
+		if (length == 0)
+		{
+			index++;
+			continue;
+		}
 
-		for (i = 0; i <= ZSTDHL_MAX_HUFFMAN_CODE_LENGTH; i++)
+		// Defer by one byte if that finds a better match
+		if (index + 1u < endIndex)
 		{
-			uint32_t prob = weightProbs[bestScoreIndex][i];
-			if (prob != 0)
-				tree->m_weightTable.m_numProbabilities = i + 1;
+			uint32_t nextLength = 0;
+			uint32_t nextDist = 0;
+			int32_t nextScore = 0;
+			uint32_t nextOrigDist = (index + 1u >= origMatchStart && index + 1u < origMatchEnd) ? origDist : 0;
 
-			tree->m_weightTableProbabilities[i] = prob;
-		}
-	}
-	else
-		tree->m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_UNCOMPRESSED;
+			zstdhl_DeflateConv_FindReparseMatch(state, index + 1u, endIndex, (uint32_t)(index + 1u - litStart), nextOrigDist, &nextLength, &nextDist, &nextScore);
 
-	return ZSTDHL_RESULT_OK;
-}
+			if (nextScore > score + ZSTDHL_DEFLATECONV_REPARSE_LITERAL_COST)
+			{
+				index++;
+				length = nextLength;
+				dist = nextDist;
+			}
+		}
 
-zstdhl_ResultCode_t zstdhl_DeflateConv_ScoreHuffmanTree(zstdhl_HuffmanTreeDesc_t *tree, const size_t *stats, size_t numStats, uint8_t encodeTree, uint64_t *outScore, uint8_t *outIsValid)
-{
-	uint32_t runningTotal = 0;
-	size_t i = 0;
-	uint8_t maxBits = 0;
-	uint32_t nextPO2 = 0;
-	uint8_t lastWeight = 0;
-	uint8_t codeLengths[256];
-	size_t weightStats[ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1];
-	uint64_t score = 0;
-	
-	for (i = 0; i < (ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1); i++)
-		weightStats[i] = 0;
-
-	for (i = 0; i < tree->m_partialWeightDesc.m_numSpecifiedWeights; i++)
-	{
-		uint8_t weight = tree->m_partialWeightDesc.m_specifiedWeights[i];
-		if (weight != 0)
-			runningTotal += (uint32_t)1 << (weight - 1);
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_reparseLiteralsVector, (const uint8_t *)state->m_historyVector.m_data + litStart, index - litStart));
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_AppendSequence(state, &state->m_reparseSequencesVector, &state->m_reparseOffsetsVector, (uint32_t)(index - litStart), length, dist));
 
-		weightStats[weight]++;
+		index += length;
+		litStart = index;
 	}
 
-	for (i = 0; i < 256; i++)
-		codeLengths[i] = 0;
-
-	maxBits = zstdhl_Log2_32(runningTotal) + 1;
-	nextPO2 = (uint32_t)1 << maxBits;
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_reparseLiteralsVector, (const uint8_t *)state->m_historyVector.m_data + litStart, endIndex - litStart));
 
-	lastWeight = zstdhl_Log2_32(nextPO2 - runningTotal) + 1;
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_EstimateParseCost(&state->m_reparseLiteralsVector, &state->m_reparseSequencesVector, &state->m_reparseOffsetsVector, &reparseCost));
 
-	for (i = 0; i < tree->m_partialWeightDesc.m_numSpecifiedWeights; i++)
+	if (reparseCost >= existingParseCost)
 	{
-		uint8_t weight = tree->m_partialWeightDesc.m_specifiedWeights[i];
-		if (weight != 0)
-			codeLengths[i] = maxBits + 1 - weight;
+		// Keep the existing parse and the repeat offsets that it leaves
+		state->m_repeatedOffset1 = existingRepeatedOffsets[0];
+		state->m_repeatedOffset2 = existingRepeatedOffsets[1];
+		state->m_repeatedOffset3 = existingRepeatedOffsets[2];
+		return ZSTDHL_RESULT_OK;
 	}
 
-	codeLengths[tree->m_partialWeightDesc.m_numSpecifiedWeights] = maxBits + 1 - lastWeight;
+	*outIsReparsed = 1;
 
-	for (i = 0; i < numStats; i++)
 	{
-		if (stats[i])
-		{
-			score += (uint64_t)codeLengths[i] * stats[i];
-			if (codeLengths[i] == 0)
-			{
-				*outIsValid = 0;
-				return ZSTDHL_RESULT_OK;
-			}
-		}
-	}
+		zstdhl_Vector_t tempVector;
 
-	if (encodeTree)
-	{
-		if (tree->m_huffmanWeightFormat == ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE)
-		{
-			uint64_t fseTabScore;
-			uint8_t isValid = 0;
-
-			score += 4;	// For accuracy log
+		tempVector = state->m_literalsVector;
+		state->m_literalsVector = state->m_reparseLiteralsVector;
+		state->m_reparseLiteralsVector = tempVector;
 
-			fseTabScore = zstdhl_DeflateConv_ScoreTable(weightStats, ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1, &tree->m_weightTable, 1, &isValid);
+		tempVector = state->m_sequencesVector;
+		state->m_sequencesVector = state->m_reparseSequencesVector;
+		state->m_reparseSequencesVector = tempVector;
 
-			if (!isValid)
-			{
-				*outIsValid = 0;
-				return ZSTDHL_RESULT_OK;
-			}
-			score += fseTabScore;
-		}
-		else if (tree->m_huffmanWeightFormat == ZSTDHL_HUFFMAN_WEIGHT_ENCODING_UNCOMPRESSED)
-		{
-			uint16_t numWeightBytes = (((uint16_t)tree->m_partialWeightDesc.m_numSpecifiedWeights) + 1u) / 2u;
-			score += numWeightBytes * 8u;
-		}
-		else
-			return ZSTDHL_RESULT_INTERNAL_ERROR;
+		tempVector = state->m_offsetsVector;
+		state->m_offsetsVector = state->m_reparseOffsetsVector;
+		state->m_reparseOffsetsVector = tempVector;
 	}
 
-	*outIsValid = 1;
-	*outScore = score;
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_DeflateConv_FindRLEByte(const zstdhl_FSETableDef_t *table, uint8_t *rleByte)
+// Points specified-offset sequences at their offsets
+static void zstdhl_DeflateConv_LinkOffsets(zstdhl_DeflateConv_State_t *state)
 {
+	size_t numSequences = state->m_sequencesVector.m_count;
+	uint32_t *offsets = (uint32_t *)(state->m_offsetsVector.m_data);
+	zstdhl_SequenceDesc_t *sequences = (zstdhl_SequenceDesc_t *)(state->m_sequencesVector.m_data);
 	size_t i = 0;
-	uint8_t numSyms = 0;
 
-	for (i = 0; i < table->m_numProbabilities; i++)
+	for (i = 0; i < numSequences; i++)
 	{
-		if (table->m_probabilities[i] != 0)
-		{
-			numSyms++;
-			if (numSyms == 2)
-				return ZSTDHL_RESULT_INTERNAL_ERROR;
+		zstdhl_SequenceDesc_t *sequence = sequences + i;
+		uint32_t *offset = offsets + i;
 
-			*rleByte = (uint8_t)i;
+		if (sequence->m_offsetType == ZSTDHL_OFFSET_TYPE_SPECIFIED)
+		{
+			sequence->m_offsetValueBigNum = offset;
+			sequence->m_offsetValueNumBits = zstdhl_Log2_32(*offset) + 1;
 		}
 	}
-
-	return ZSTDHL_RESULT_OK;
 }
 
-
-zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_State_t *state, zstdhl_EncBlockDesc_t *outTempBlockDesc, uint8_t usePredefined)
+// Parses Huffman-coded symbols until the end of the deflate block, or until the next match might not fit in the zstd block
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ParseHuffmanData(zstdhl_DeflateConv_State_t *state)
 {
-	uint8_t isFirstCompressedBlockWithSequences = !state->m_haveEncodedCompressedBlockWithSequences;
-	uint8_t isRLELitBlock = 1;
-	uint8_t useNewHuffmanTree = 0;
-	uint8_t useRawLits = 0;
+	size_t blockStartIndex = state->m_historyVector.m_count;
+	uint64_t blockStartDecodedSize = state->m_decodedSize;
+	uint32_t maxBlockSize = zstdhl_DeflateConv_GetMaxBlockSize(state);
+	uint8_t continueBlock = 0;
+
+	state->m_exportBlockType = ZSTDHL_BLOCK_TYPE_COMPRESSED;
+
+	state->m_blockStartRepeatedOffsets[0] = state->m_repeatedOffset1;
+	state->m_blockStartRepeatedOffsets[1] = state->m_repeatedOffset2;
+	state->m_blockStartRepeatedOffsets[2] = state->m_repeatedOffset3;
 
 	state->m_literalsEmittedSinceLastSequence = 0;
 	zstdhl_Vector_Clear(&state->m_literalsVector);
 	zstdhl_Vector_Clear(&state->m_sequencesVector);
 	zstdhl_Vector_Clear(&state->m_offsetsVector);
 
-	if (usePredefined)
-	{
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_UseStaticHuffmanCodes(state));
-	}
-	else
-	{
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_LoadDynamicHuffmanCodes(state));
-	}
-
 	for (;;)
 	{
 		uint16_t litLengthSym = 0;
 
+		if (state->m_decodedSize - blockStartDecodedSize > maxBlockSize - ZSTDHL_DEFLATECONV_MAX_DEFLATE_MATCH_LENGTH)
+		{
+			continueBlock = 1;
+			break;
+		}
+
 		ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadHuffmanCode(state, &state->m_litLengthTree, &litLengthSym));
 
 		if (litLengthSym < 256)
@@ -1668,6 +1459,12 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_St
 
 			ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_literalsVector, &lit, 1));
 			state->m_literalsEmittedSinceLastSequence++;
+			state->m_decodedSize++;
+
+			if (state->m_reparseEnabled)
+			{
+				ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_historyVector, &lit, 1));
+			}
 		}
 		else
 		{
@@ -1678,36 +1475,48 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_St
 		}
 	}
 
-	// Link up offsets
+	if (state->m_reparseEnabled)
 	{
-		size_t numSequences = state->m_sequencesVector.m_count;
-		uint32_t *offsets = (uint32_t *)(state->m_offsetsVector.m_data);
-		zstdhl_SequenceDesc_t *sequences = (zstdhl_SequenceDesc_t *)(state->m_sequencesVector.m_data);
-		size_t i = 0;
+		uint64_t deflateParseCost = 0;
+		uint8_t isReparsed = 0;
 
-		for (i = 0; i < numSequences; i++)
-		{
-			zstdhl_SequenceDesc_t *sequence = sequences + i;
-			uint32_t *offset = offsets + i;
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_EstimateParseCost(&state->m_literalsVector, &state->m_sequencesVector, &state->m_offsetsVector, &deflateParseCost));
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_ReparseBlock(state, blockStartIndex, deflateParseCost, &isReparsed));
+	}
 
-			if (sequence->m_offsetType == ZSTDHL_OFFSET_TYPE_SPECIFIED)
-			{
-				sequence->m_offsetValueBigNum = offset;
-				sequence->m_offsetValueNumBits = zstdhl_Log2_32(*offset) + 1;
-			}
-		}
+	zstdhl_DeflateConv_LinkOffsets(state);
+	zstdhl_DeflateConv_FinishParsedBlock(state, continueBlock);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ParseHuffmanBlock(zstdhl_DeflateConv_State_t *state, uint8_t usePredefined)
+{
+	if (usePredefined)
+	{
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_UseStaticHuffmanCodes(state));
+	}
+	else
+	{
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_LoadDynamicHuffmanCodes(state));
 	}
 
+	return zstdhl_DeflateConv_ParseHuffmanData(state);
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ExportCompressedBlock(zstdhl_DeflateConv_State_t *state, zstdhl_EncBlockDesc_t *outTempBlockDesc)
+{
+	uint8_t isFirstCompressedBlockWithSequences = !state->m_haveEncodedCompressedBlockWithSequences;
+	zstdhl_LiteralsSectionType_t litSectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+	zstdhl_HuffmanStreamMode_t huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+
 	// Collect stats
 	{
 		size_t i = 0;
 		size_t numSequences = state->m_sequencesVector.m_count;
 		const zstdhl_SequenceDesc_t *sequences = (const zstdhl_SequenceDesc_t *)state->m_sequencesVector.m_data;
-		size_t numLits = state->m_literalsVector.m_count;
-		const uint8_t *lits = (const uint8_t *)state->m_literalsVector.m_data;
 
 		zstdhl_Vector_Clear(&state->m_exportedSequenceCodesVector);
-		zstdhl_Vector_Clear(&state->m_litStatsVector);
 		zstdhl_Vector_Clear(&state->m_litLengthStatsVector);
 		zstdhl_Vector_Clear(&state->m_matchLengthStatsVector);
 		zstdhl_Vector_Clear(&state->m_offsetCodeStatsVector);
@@ -1735,26 +1544,13 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_St
 			ZSTDHL_CHECKED(zstdhl_DeflateConv_AddToStats(&state->m_matchLengthStatsVector, matchLengthCode));
 			ZSTDHL_CHECKED(zstdhl_DeflateConv_AddToStats(&state->m_offsetCodeStatsVector, offsetCodeEncoded));
 		}
-
-		for (i = 0; i < numLits; i++)
-		{
-			ZSTDHL_CHECKED(zstdhl_DeflateConv_AddToStats(&state->m_litStatsVector, lits[i]));
-			if (isRLELitBlock && lits[i] != lits[0])
-				isRLELitBlock = 0;
-		}
-
-		if (numLits == 0)
-		{
-			useRawLits = 1;
-			isRLELitBlock = 0;
-		}
 	}
 
 	if (state->m_sequencesVector.m_count > 0)
 	{
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_SelectOptimalFSETable(&state->m_litLengthStatsVector, &state->m_litLengthProbsVector, &state->m_tempProbsVector, &state->m_prevLitLengthsTable, &state->m_litLengthMode, zstdhl_GetDefaultLitLengthFSEProperties(), isFirstCompressedBlockWithSequences));
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_SelectOptimalFSETable(&state->m_matchLengthStatsVector, &state->m_matchLengthProbsVector, &state->m_tempProbsVector, &state->m_prevMatchLengthTable, &state->m_matchLengthMode, zstdhl_GetDefaultMatchLengthFSEProperties(), isFirstCompressedBlockWithSequences));
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_SelectOptimalFSETable(&state->m_offsetCodeStatsVector, &state->m_offsetProbsVector, &state->m_tempProbsVector, &state->m_prevOffsetsTable, &state->m_offsetMode, zstdhl_GetDefaultOffsetFSEProperties(), isFirstCompressedBlockWithSequences));
+		ZSTDHL_CHECKED(zstdhl_SelectOptimalFSETable((const size_t *)state->m_litLengthStatsVector.m_data, state->m_litLengthStatsVector.m_count, &state->m_litLengthProbsVector, &state->m_tempProbsVector, &state->m_prevLitLengthsTable, &state->m_litLengthMode, zstdhl_GetDefaultLitLengthFSEProperties(), isFirstCompressedBlockWithSequences));
+		ZSTDHL_CHECKED(zstdhl_SelectOptimalFSETable((const size_t *)state->m_matchLengthStatsVector.m_data, state->m_matchLengthStatsVector.m_count, &state->m_matchLengthProbsVector, &state->m_tempProbsVector, &state->m_prevMatchLengthTable, &state->m_matchLengthMode, zstdhl_GetDefaultMatchLengthFSEProperties(), isFirstCompressedBlockWithSequences));
+		ZSTDHL_CHECKED(zstdhl_SelectOptimalFSETable((const size_t *)state->m_offsetCodeStatsVector.m_data, state->m_offsetCodeStatsVector.m_count, &state->m_offsetProbsVector, &state->m_tempProbsVector, &state->m_prevOffsetsTable, &state->m_offsetMode, zstdhl_GetDefaultOffsetFSEProperties(), isFirstCompressedBlockWithSequences));
 
 		state->m_haveEncodedCompressedBlockWithSequences = 1;
 	}
@@ -1765,59 +1561,17 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_St
 		state->m_offsetMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
 	}
 
-	if (!isRLELitBlock && !useRawLits)
 	{
-		uint8_t newTreeIsValid = 0;
-		uint64_t newTreeScore = 0;
-		uint64_t rawScore = 0;
-		const size_t *litStats = (const size_t *)state->m_litStatsVector.m_data;
-		size_t numLitStats = state->m_litStatsVector.m_count;
+		const zstdhl_HuffmanTreeDesc_t *prevTree = NULL;
 		int newTreeIndex = !state->m_activeTreeIndex;
-		size_t i = 0;
-
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_CreateHuffmanTreeForStats(&state->m_trees[newTreeIndex], litStats, numLitStats));
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_ScoreHuffmanTree(&state->m_trees[newTreeIndex], litStats, numLitStats, 1, &newTreeScore, &newTreeIsValid));
-
-		if (!newTreeIsValid)
-			return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-		rawScore = (uint64_t)state->m_literalsVector.m_count * 8u;
-
-		if (state->m_activeTreeIndex < 0)
-		{
-			// No existing tree, can only use new tree or raw
-			if (rawScore > newTreeScore)
-			{
-				state->m_activeTreeIndex = !state->m_activeTreeIndex;
-				useNewHuffmanTree = 1;
-			}
-			else
-				useRawLits = 1;
-		}
-		else
-		{
-			uint8_t oldTreeIsValid = 0;
-			uint64_t oldTreeScore = 0;
-			size_t i = 0;
+		if (state->m_activeTreeIndex >= 0)
+			prevTree = &state->m_trees[state->m_activeTreeIndex];
 
-			ZSTDHL_CHECKED(zstdhl_DeflateConv_ScoreHuffmanTree(&state->m_trees[state->m_activeTreeIndex], litStats, numLitStats, 0, &oldTreeScore, &oldTreeIsValid));
+		ZSTDHL_CHECKED(zstdhl_SelectLiteralsSection((const uint8_t *)state->m_literalsVector.m_data, state->m_literalsVector.m_count, prevTree, &state->m_trees[newTreeIndex], &litSectionType, &huffmanStreamMode));
 
-			if (rawScore <= newTreeScore)
-			{
-				// Best is either raw or old tree
-				if (rawScore <= oldTreeScore || !oldTreeIsValid)
-					useRawLits = 1;
-			}
-			else
-			{
-				// Best is either new tree or old tree
-				if (newTreeScore <= oldTreeScore || !oldTreeIsValid)
-				{
-					state->m_activeTreeIndex = !state->m_activeTreeIndex;
-					useNewHuffmanTree = 1;
-				}
-			}
-		}
+		if (litSectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN)
+			state->m_activeTreeIndex = newTreeIndex;
 	}
 
 	// Export the block
@@ -1825,29 +1579,19 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_St
 	outTempBlockDesc->m_blockHeader.m_isLastBlock = state->m_isLastBlock;
 	outTempBlockDesc->m_blockHeader.m_blockSize = 0;
 
-	if (useRawLits)
-		outTempBlockDesc->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
-	else if (useNewHuffmanTree)
-		outTempBlockDesc->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN;
-	else if (isRLELitBlock)
-		outTempBlockDesc->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RLE;
-	else
-		outTempBlockDesc->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE;
+	outTempBlockDesc->m_litSectionHeader.m_sectionType = litSectionType;
 
 	outTempBlockDesc->m_litSectionHeader.m_regeneratedSize = (uint32_t)state->m_literalsVector.m_count;
 	outTempBlockDesc->m_litSectionHeader.m_compressedSize = 0;
 
-	if (state->m_literalsVector.m_count >= 256)
-		outTempBlockDesc->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_4_STREAMS;
-	else
-		outTempBlockDesc->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_1_STREAM;
+	outTempBlockDesc->m_litSectionDesc.m_huffmanStreamMode = huffmanStreamMode;
 
 	outTempBlockDesc->m_litSectionDesc.m_huffmanStreamSizes[0] = 0;
 	outTempBlockDesc->m_litSectionDesc.m_huffmanStreamSizes[1] = 0;
 	outTempBlockDesc->m_litSectionDesc.m_huffmanStreamSizes[2] = 0;
 	outTempBlockDesc->m_litSectionDesc.m_huffmanStreamSizes[3] = 0;
 
-	if (isRLELitBlock)
+	if (litSectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE)
 		outTempBlockDesc->m_litSectionDesc.m_numValues = 1;
 	else
 		outTempBlockDesc->m_litSectionDesc.m_numValues = state->m_literalsVector.m_count;
@@ -1863,7 +1607,7 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_St
 	outTempBlockDesc->m_seqSectionDesc.m_matchLengthsMode = state->m_matchLengthMode;
 	outTempBlockDesc->m_seqSectionDesc.m_literalLengthsMode = state->m_litLengthMode;
 
-	if (!useRawLits && !isRLELitBlock)
+	if (litSectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN || litSectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE)
 	{
 		size_t i = 0;
 		const zstdhl_HuffmanTreeDesc_t *activeTree = &state->m_trees[state->m_activeTreeIndex];
@@ -1903,13 +1647,15 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertHuffmanBlock(zstdhl_DeflateConv_St
 	outTempBlockDesc->m_autoHuffmanStreamSizesFlags[1] = 1;
 	outTempBlockDesc->m_autoHuffmanStreamSizesFlags[2] = 1;
 	outTempBlockDesc->m_autoHuffmanStreamSizesFlags[3] = 1;
+	outTempBlockDesc->m_autoLitSectionModeFlag = 0;
+	outTempBlockDesc->m_autoSeqCompressionModeFlag = 0;
 
 	outTempBlockDesc->m_uncompressedOrRLEData = NULL;
 
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_DeflateConv_Convert(zstdhl_DeflateConv_State_t *state, uint8_t *outEOFFlag, zstdhl_EncBlockDesc_t *outTempBlockDesc)
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ParseBlock(zstdhl_DeflateConv_State_t *state, uint8_t *outEOFFlag)
 {
 	uint8_t blockType = 0;
 	uint32_t bits = 0;
@@ -1922,24 +1668,458 @@ zstdhl_ResultCode_t zstdhl_DeflateConv_Convert(zstdhl_DeflateConv_State_t *state
 
 	*outEOFFlag = 0;
 
+	if (state->m_reparseEnabled)
+		zstdhl_DeflateConv_SlideHistory(state);
+
+	if (state->m_continueBlock)
+	{
+		if (state->m_blockType == ZSTDHL_BLOCK_TYPE_RAW)
+			return zstdhl_DeflateConv_ParseStoredData(state);
+
+		return zstdhl_DeflateConv_ParseHuffmanData(state);
+	}
+
 	ZSTDHL_CHECKED(zstdhl_DeflateConv_ReadBits(state, 3, &bits));
 
-	state->m_isLastBlock = (bits & 1);
+	state->m_isLastDeflateBlock = (bits & 1);
 	blockType = (bits >> 1);
 
 	switch (blockType)
 	{
 	case 0:
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_ConvertRawBlock(state, outTempBlockDesc));
-		return ZSTDHL_RESULT_OK;
+		state->m_blockType = ZSTDHL_BLOCK_TYPE_RAW;
+		return zstdhl_DeflateConv_ParseRawBlock(state);
 	case 1:
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_ConvertHuffmanBlock(state, outTempBlockDesc, 1));
-		return ZSTDHL_RESULT_OK;
+		state->m_blockType = ZSTDHL_BLOCK_TYPE_COMPRESSED;
+		return zstdhl_DeflateConv_ParseHuffmanBlock(state, 1);
 	case 2:
-		ZSTDHL_CHECKED(zstdhl_DeflateConv_ConvertHuffmanBlock(state, outTempBlockDesc, 0));
-		return ZSTDHL_RESULT_OK;
+		state->m_blockType = ZSTDHL_BLOCK_TYPE_COMPRESSED;
+		return zstdhl_DeflateConv_ParseHuffmanBlock(state, 0);
 	case 3:
 	default:
 		return ZSTDHL_RESULT_INVALID_VALUE;
 	}
 }
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ExportBlock(zstdhl_DeflateConv_State_t *state, zstdhl_EncBlockDesc_t *outTempBlockDesc)
+{
+	if (state->m_exportBlockType == ZSTDHL_BLOCK_TYPE_RAW)
+		return zstdhl_DeflateConv_ExportRawBlock(state, outTempBlockDesc);
+
+	return zstdhl_DeflateConv_ExportCompressedBlock(state, outTempBlockDesc);
+}
+
+zstdhl_ResultCode_t zstdhl_DeflateConv_Convert(zstdhl_DeflateConv_State_t *state, uint8_t *outEOFFlag, zstdhl_EncBlockDesc_t *outTempBlockDesc)
+{
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_ParseBlock(state, outEOFFlag));
+
+	if (*outEOFFlag)
+		return ZSTDHL_RESULT_OK;
+
+	return zstdhl_DeflateConv_ExportBlock(state, outTempBlockDesc);
+}
+
+typedef enum zstdhl_DeflateConv_BatchStatus
+{
+	ZSTDHL_DEFLATECONV_BATCH_STATUS_FREE,
+	ZSTDHL_DEFLATECONV_BATCH_STATUS_PARSED,
+	ZSTDHL_DEFLATECONV_BATCH_STATUS_CONVERTING,
+	ZSTDHL_DEFLATECONV_BATCH_STATUS_CONVERTED,
+} zstdhl_DeflateConv_BatchStatus_t;
+
+typedef struct zstdhl_DeflateConv_Batch
+{
+	zstdhl_Vector_t m_literalsVector;
+	zstdhl_Vector_t m_sequencesVector;
+	zstdhl_Vector_t m_offsetsVector;
+	zstdhl_Vector_t m_outputVector;
+
+	zstdhl_BlockType_t m_blockType;
+	uint8_t m_isLastBlock;
+
+	zstdhl_DeflateConv_BatchStatus_t m_status;
+	zstdhl_ResultCode_t m_resultCode;
+} zstdhl_DeflateConv_Batch_t;
+
+struct zstdhl_DeflateConv_Pipeline;
+
+typedef struct zstdhl_DeflateConv_Worker
+{
+	struct zstdhl_DeflateConv_Pipeline *m_pipeline;
+	zstdhl_DeflateConv_State_t *m_convState;
+	zstdhl_AssemblerContext_t *m_asmContext;
+	zstdhl_Thread_t m_thread;
+	uint8_t m_threadStarted;
+} zstdhl_DeflateConv_Worker_t;
+
+typedef struct zstdhl_DeflateConv_Pipeline
+{
+	zstdhl_MemoryAllocatorObject_t m_alloc;
+
+	zstdhl_Mutex_t m_mutex;
+	zstdhl_CondVar_t m_workAvailableCV;
+	zstdhl_CondVar_t m_workFinishedCV;
+	uint8_t m_haveMutex;
+	uint8_t m_haveWorkAvailableCV;
+	uint8_t m_haveWorkFinishedCV;
+
+	zstdhl_DeflateConv_State_t *m_parseState;
+
+	zstdhl_DeflateConv_Batch_t *m_batches;
+	size_t m_numBatches;
+
+	zstdhl_DeflateConv_Worker_t *m_workers;
+	size_t m_numWorkers;
+
+	// Running block counts, batch for block N is N % m_numBatches
+	size_t m_numParsed;
+	size_t m_numDispatched;
+	size_t m_numWritten;
+
+	uint8_t m_shutdown;
+} zstdhl_DeflateConv_Pipeline_t;
+
+static void zstdhl_DeflateConv_SwapVector(zstdhl_Vector_t *a, zstdhl_Vector_t *b)
+{
+	zstdhl_Vector_t temp = *a;
+	*a = *b;
+	*b = temp;
+}
+
+static void zstdhl_DeflateConv_SwapBatchVectors(zstdhl_DeflateConv_State_t *state, zstdhl_DeflateConv_Batch_t *batch)
+{
+	zstdhl_DeflateConv_SwapVector(&state->m_literalsVector, &batch->m_literalsVector);
+	zstdhl_DeflateConv_SwapVector(&state->m_sequencesVector, &batch->m_sequencesVector);
+	zstdhl_DeflateConv_SwapVector(&state->m_offsetsVector, &batch->m_offsetsVector);
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_WriteToVector(void *userdata, const void *data, size_t size)
+{
+	return zstdhl_Vector_Append((zstdhl_Vector_t *)userdata, data, size);
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertBatch(zstdhl_DeflateConv_Worker_t *worker, zstdhl_DeflateConv_Batch_t *batch)
+{
+	zstdhl_DeflateConv_State_t *convState = worker->m_convState;
+	zstdhl_EncBlockDesc_t blockDesc;
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
+
+	zstdhl_DeflateConv_SwapBatchVectors(convState, batch);
+
+	convState->m_exportBlockType = batch->m_blockType;
+	convState->m_isLastBlock = batch->m_isLastBlock;
+
+	// Blocks are converted independently of each other, so there is never a table to reuse
+	convState->m_haveEncodedCompressedBlockWithSequences = 0;
+	convState->m_activeTreeIndex = -1;
+
+	zstdhl_Vector_Clear(&batch->m_outputVector);
+
+	output.m_writeBitstreamFunc = zstdhl_DeflateConv_WriteToVector;
+	output.m_userdata = &batch->m_outputVector;
+
+	zstdhl_ResetAssemblerContext(worker->m_asmContext);
+
+	resultCode = zstdhl_DeflateConv_ExportBlock(convState, &blockDesc);
+
+	if (resultCode == ZSTDHL_RESULT_OK)
+		resultCode = zstdhl_AssembleBlockWithContext(worker->m_asmContext, &blockDesc, &output);
+
+	zstdhl_DeflateConv_SwapBatchVectors(convState, batch);
+
+	return resultCode;
+}
+
+static void zstdhl_DeflateConv_WorkerThreadFunc(void *userdata)
+{
+	zstdhl_DeflateConv_Worker_t *worker = (zstdhl_DeflateConv_Worker_t *)userdata;
+	zstdhl_DeflateConv_Pipeline_t *pipeline = worker->m_pipeline;
+
+	zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+	for (;;)
+	{
+		zstdhl_DeflateConv_Batch_t *batch = NULL;
+		zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
+
+		while (!pipeline->m_shutdown && pipeline->m_numDispatched == pipeline->m_numParsed)
+			zstdhl_CondVar_Wait(&pipeline->m_workAvailableCV, &pipeline->m_mutex);
+
+		if (pipeline->m_shutdown)
+			break;
+
+		batch = pipeline->m_batches + (pipeline->m_numDispatched % pipeline->m_numBatches);
+		batch->m_status = ZSTDHL_DEFLATECONV_BATCH_STATUS_CONVERTING;
+		pipeline->m_numDispatched++;
+
+		zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+		resultCode = zstdhl_DeflateConv_ConvertBatch(worker, batch);
+
+		zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+		batch->m_resultCode = resultCode;
+		batch->m_status = ZSTDHL_DEFLATECONV_BATCH_STATUS_CONVERTED;
+
+		zstdhl_CondVar_Signal(&pipeline->m_workFinishedCV);
+	}
+
+	zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+}
+
+static void zstdhl_DeflateConv_Pipeline_Destroy(zstdhl_DeflateConv_Pipeline_t *pipeline)
+{
+	size_t i = 0;
+
+	if (pipeline->m_workers)
+	{
+		if (pipeline->m_haveMutex)
+		{
+			zstdhl_Mutex_Lock(&pipeline->m_mutex);
+			pipeline->m_shutdown = 1;
+			if (pipeline->m_haveWorkAvailableCV)
+				zstdhl_CondVar_Broadcast(&pipeline->m_workAvailableCV);
+			zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+		}
+
+		for (i = 0; i < pipeline->m_numWorkers; i++)
+		{
+			zstdhl_DeflateConv_Worker_t *worker = pipeline->m_workers + i;
+
+			if (worker->m_threadStarted)
+				zstdhl_Thread_Join(&worker->m_thread);
+
+			if (worker->m_convState)
+				zstdhl_DeflateConv_DestroyState(worker->m_convState);
+
+			if (worker->m_asmContext)
+				zstdhl_DestroyAssemblerContext(worker->m_asmContext);
+		}
+
+		pipeline->m_alloc.m_reallocFunc(pipeline->m_alloc.m_userdata, pipeline->m_workers, 0);
+	}
+
+	if (pipeline->m_batches)
+	{
+		for (i = 0; i < pipeline->m_numBatches; i++)
+		{
+			zstdhl_DeflateConv_Batch_t *batch = pipeline->m_batches + i;
+
+			zstdhl_Vector_Destroy(&batch->m_literalsVector);
+			zstdhl_Vector_Destroy(&batch->m_sequencesVector);
+			zstdhl_Vector_Destroy(&batch->m_offsetsVector);
+			zstdhl_Vector_Destroy(&batch->m_outputVector);
+		}
+
+		pipeline->m_alloc.m_reallocFunc(pipeline->m_alloc.m_userdata, pipeline->m_batches, 0);
+	}
+
+	if (pipeline->m_parseState)
+		zstdhl_DeflateConv_DestroyState(pipeline->m_parseState);
+
+	if (pipeline->m_haveWorkFinishedCV)
+		zstdhl_CondVar_Destroy(&pipeline->m_workFinishedCV);
+	if (pipeline->m_haveWorkAvailableCV)
+		zstdhl_CondVar_Destroy(&pipeline->m_workAvailableCV);
+	if (pipeline->m_haveMutex)
+		zstdhl_Mutex_Destroy(&pipeline->m_mutex);
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_Pipeline_Init(zstdhl_DeflateConv_Pipeline_t *pipeline, const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_StreamSourceObject_t *streamSource, size_t numWorkerThreads, size_t maxBlocksInFlight, const zstdhl_DeflateConv_ReparseOptions_t *reparseOptions)
+{
+	size_t i = 0;
+	size_t numWorkers = numWorkerThreads;
+
+	if (numWorkers == 0)
+		numWorkers = 1;
+
+	if (maxBlocksInFlight < numWorkerThreads + 1)
+		maxBlocksInFlight = numWorkerThreads * 2 + 1;
+
+	pipeline->m_alloc.m_reallocFunc = alloc->m_reallocFunc;
+	pipeline->m_alloc.m_userdata = alloc->m_userdata;
+	pipeline->m_haveMutex = 0;
+	pipeline->m_haveWorkAvailableCV = 0;
+	pipeline->m_haveWorkFinishedCV = 0;
+	pipeline->m_parseState = NULL;
+	pipeline->m_batches = NULL;
+	pipeline->m_numBatches = 0;
+	pipeline->m_workers = NULL;
+	pipeline->m_numWorkers = 0;
+	pipeline->m_numParsed = 0;
+	pipeline->m_numDispatched = 0;
+	pipeline->m_numWritten = 0;
+	pipeline->m_shutdown = 0;
+
+	ZSTDHL_CHECKED(zstdhl_Mutex_Init(&pipeline->m_mutex));
+	pipeline->m_haveMutex = 1;
+
+	ZSTDHL_CHECKED(zstdhl_CondVar_Init(&pipeline->m_workAvailableCV));
+	pipeline->m_haveWorkAvailableCV = 1;
+
+	ZSTDHL_CHECKED(zstdhl_CondVar_Init(&pipeline->m_workFinishedCV));
+	pipeline->m_haveWorkFinishedCV = 1;
+
+	ZSTDHL_CHECKED(zstdhl_DeflateConv_CreateState(alloc, streamSource, &pipeline->m_parseState));
+
+	if (reparseOptions)
+	{
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_EnableReparse(pipeline->m_parseState, reparseOptions));
+	}
+
+	pipeline->m_batches = (zstdhl_DeflateConv_Batch_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_DeflateConv_Batch_t) * maxBlocksInFlight);
+	if (!pipeline->m_batches)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	pipeline->m_numBatches = maxBlocksInFlight;
+
+	for (i = 0; i < maxBlocksInFlight; i++)
+	{
+		zstdhl_DeflateConv_Batch_t *batch = pipeline->m_batches + i;
+
+		zstdhl_Vector_Init(&batch->m_literalsVector, 1, alloc);
+		zstdhl_Vector_Init(&batch->m_sequencesVector, sizeof(zstdhl_SequenceDesc_t), alloc);
+		zstdhl_Vector_Init(&batch->m_offsetsVector, sizeof(uint32_t), alloc);
+		zstdhl_Vector_Init(&batch->m_outputVector, 1, alloc);
+
+		batch->m_blockType = ZSTDHL_BLOCK_TYPE_INVALID;
+		batch->m_isLastBlock = 0;
+		batch->m_status = ZSTDHL_DEFLATECONV_BATCH_STATUS_FREE;
+		batch->m_resultCode = ZSTDHL_RESULT_OK;
+	}
+
+	pipeline->m_workers = (zstdhl_DeflateConv_Worker_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_DeflateConv_Worker_t) * numWorkers);
+	if (!pipeline->m_workers)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	pipeline->m_numWorkers = numWorkers;
+
+	for (i = 0; i < numWorkers; i++)
+	{
+		zstdhl_DeflateConv_Worker_t *worker = pipeline->m_workers + i;
+
+		worker->m_pipeline = pipeline;
+		worker->m_convState = NULL;
+		worker->m_asmContext = NULL;
+		worker->m_threadStarted = 0;
+	}
+
+	for (i = 0; i < numWorkers; i++)
+	{
+		zstdhl_DeflateConv_Worker_t *worker = pipeline->m_workers + i;
+
+		ZSTDHL_CHECKED(zstdhl_DeflateConv_CreateState(alloc, streamSource, &worker->m_convState));
+
+		ZSTDHL_CHECKED(zstdhl_CreateAssemblerContext(alloc, &worker->m_asmContext));
+	}
+
+	for (i = 0; i < numWorkerThreads; i++)
+	{
+		zstdhl_DeflateConv_Worker_t *worker = pipeline->m_workers + i;
+
+		ZSTDHL_CHECKED(zstdhl_Thread_Create(&worker->m_thread, zstdhl_DeflateConv_WorkerThreadFunc, worker));
+		worker->m_threadStarted = 1;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_DeflateConv_Pipeline_Run(zstdhl_DeflateConv_Pipeline_t *pipeline, const zstdhl_EncoderOutputObject_t *assemblyOutput, uint8_t isThreaded)
+{
+	zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
+	zstdhl_DeflateConv_State_t *parseState = pipeline->m_parseState;
+	uint8_t eof = 0;
+
+	zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+	for (;;)
+	{
+		zstdhl_DeflateConv_Batch_t *batch = NULL;
+
+		// Write out converted blocks in order
+		while (pipeline->m_numWritten < pipeline->m_numParsed)
+		{
+			batch = pipeline->m_batches + (pipeline->m_numWritten % pipeline->m_numBatches);
+			if (batch->m_status != ZSTDHL_DEFLATECONV_BATCH_STATUS_CONVERTED)
+				break;
+
+			zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+			resultCode = batch->m_resultCode;
+			if (resultCode == ZSTDHL_RESULT_OK)
+				resultCode = assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, batch->m_outputVector.m_data, batch->m_outputVector.m_count);
+
+			zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+			batch->m_status = ZSTDHL_DEFLATECONV_BATCH_STATUS_FREE;
+			pipeline->m_numWritten++;
+
+			if (resultCode != ZSTDHL_RESULT_OK)
+				break;
+		}
+
+		if (resultCode != ZSTDHL_RESULT_OK || (eof && pipeline->m_numWritten == pipeline->m_numParsed))
+			break;
+
+		// Parse the next block if there is a free batch
+		if (!eof && pipeline->m_numParsed - pipeline->m_numWritten < pipeline->m_numBatches)
+		{
+			batch = pipeline->m_batches + (pipeline->m_numParsed % pipeline->m_numBatches);
+
+			zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+			zstdhl_DeflateConv_SwapBatchVectors(parseState, batch);
+			resultCode = zstdhl_DeflateConv_ParseBlock(parseState, &eof);
+			zstdhl_DeflateConv_SwapBatchVectors(parseState, batch);
+
+			if (resultCode == ZSTDHL_RESULT_OK && !eof)
+			{
+				batch->m_blockType = parseState->m_exportBlockType;
+				batch->m_isLastBlock = parseState->m_isLastBlock;
+				batch->m_status = ZSTDHL_DEFLATECONV_BATCH_STATUS_PARSED;
+
+				if (!isThreaded)
+				{
+					batch->m_resultCode = zstdhl_DeflateConv_ConvertBatch(pipeline->m_workers, batch);
+					batch->m_status = ZSTDHL_DEFLATECONV_BATCH_STATUS_CONVERTED;
+					pipeline->m_numDispatched++;
+				}
+			}
+
+			zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+			if (resultCode != ZSTDHL_RESULT_OK)
+				break;
+
+			if (!eof)
+			{
+				pipeline->m_numParsed++;
+				zstdhl_CondVar_Signal(&pipeline->m_workAvailableCV);
+			}
+
+			continue;
+		}
+
+		zstdhl_CondVar_Wait(&pipeline->m_workFinishedCV, &pipeline->m_mutex);
+	}
+
+	zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+	return resultCode;
+}
+
+zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertParallel(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_EncoderOutputObject_t *assemblyOutput, size_t numWorkerThreads, size_t maxBlocksInFlight, const zstdhl_DeflateConv_ReparseOptions_t *reparseOptions)
+{
+	zstdhl_DeflateConv_Pipeline_t pipeline;
+	zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
+
+	resultCode = zstdhl_DeflateConv_Pipeline_Init(&pipeline, alloc, streamSource, numWorkerThreads, maxBlocksInFlight, reparseOptions);
+
+	if (resultCode == ZSTDHL_RESULT_OK)
+		resultCode = zstdhl_DeflateConv_Pipeline_Run(&pipeline, assemblyOutput, numWorkerThreads > 0);
+
+	zstdhl_DeflateConv_Pipeline_Destroy(&pipeline);
+
+	return resultCode;
+}
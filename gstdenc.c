@@ -11,6 +11,7 @@ the included LICENSE.txt file.
 #include "zstdhl_internal.h"
 
 #include "gstdenc.h"
+#include "zstdhl_thread.h"
 
 typedef struct gstd_LaneState gstd_LaneState_t;
 
@@ -74,6 +75,11 @@ typedef struct gstd_EncoderState
 	gstd_RANSTable_t m_matchLengthTable;
 	gstd_RANSTable_t m_offsetTable;
 
+	// Either the tables above or the shared predefined tables
+	const gstd_RANSTable_t *m_activeLitLengthTable;
+	const gstd_RANSTable_t *m_activeMatchLengthTable;
+	const gstd_RANSTable_t *m_activeOffsetTable;
+
 	uint32_t m_huffWeightBaselines[GSTD_MAX_HUFFMAN_WEIGHT + 1];
 	uint32_t m_offsetBaselines[GSTD_MAX_OFFSET_CODE + 1];
 	uint32_t m_matchLengthBaselines[GSTD_MAX_MATCH_LENGTH_CODE + 1];
@@ -99,6 +105,8 @@ typedef struct gstd_EncoderState
 	uint32_t m_numLiteralsWritten;
 
 	uint32_t m_tweaks;
+
+	const zstdhl_InstrumentationObject_t *m_instrumentation;
 } gstd_EncoderState_t;
 
 void gstd_InterleavedBitstream_Init(gstd_InterleavedBitstream_t *bitstream)
@@ -137,6 +145,7 @@ void gstd_LaneState_Init(gstd_LaneState_t *laneState, const zstdhl_MemoryAllocat
 {
 	gstd_InterleavedBitstream_Init(&laneState->m_interleavedBitstream);
 	zstdhl_FSEEncStack_Init(&laneState->m_ransStack, alloc);
+	laneState->m_ransStack.m_statesStackVector.m_allocSite = ZSTDHL_ALLOC_SITE_GSTD_LANES;
 	laneState->m_currentRANSState = 1;
 }
 
@@ -146,6 +155,45 @@ void gstd_LaneState_Destroy(gstd_LaneState_t *laneState)
 }
 
 
+typedef struct gstd_PredefinedRANSTable
+{
+	gstd_RANSTable_t m_table;
+	uint32_t m_probs[GSTD_MAX_MATCH_LENGTH_CODE + 1];
+	uint32_t m_baselines[GSTD_MAX_MATCH_LENGTH_CODE + 1];
+} gstd_PredefinedRANSTable_t;
+
+static gstd_PredefinedRANSTable_t gstd_predefinedLitLengthTable;
+static gstd_PredefinedRANSTable_t gstd_predefinedMatchLengthTable;
+static gstd_PredefinedRANSTable_t gstd_predefinedOffsetTable;
+static zstdhl_Once_t gstd_predefinedTablesOnce = ZSTDHL_ONCE_INIT;
+
+static void gstd_BuildPredefinedRANSTable(gstd_PredefinedRANSTable_t *predefined, const zstdhl_SubstreamCompressionStructureDef_t *sdef)
+{
+	zstdhl_FSETableDef_t tableDef;
+
+	tableDef.m_accuracyLog = sdef->m_defaultAccuracyLog;
+	tableDef.m_numProbabilities = sdef->m_numProbs;
+	tableDef.m_probabilities = sdef->m_defaultProbs;
+
+	predefined->m_table.m_probs = predefined->m_probs;
+	predefined->m_table.m_baselines = predefined->m_baselines;
+
+	// The predefined distributions are always valid
+	gstd_BuildRANSTable(&predefined->m_table, &tableDef, 0);
+}
+
+static void gstd_BuildPredefinedRANSTables(void)
+{
+	gstd_BuildPredefinedRANSTable(&gstd_predefinedLitLengthTable, zstdhl_GetDefaultLitLengthFSEProperties());
+	gstd_BuildPredefinedRANSTable(&gstd_predefinedMatchLengthTable, zstdhl_GetDefaultMatchLengthFSEProperties());
+	gstd_BuildPredefinedRANSTable(&gstd_predefinedOffsetTable, zstdhl_GetDefaultOffsetFSEProperties());
+}
+
+static void gstd_InitPredefinedRANSTables(void)
+{
+	zstdhl_Once_Call(&gstd_predefinedTablesOnce, gstd_BuildPredefinedRANSTables);
+}
+
 zstdhl_ResultCode_t gstd_EncoderState_Init(gstd_EncoderState_t *encState, const zstdhl_EncoderOutputObject_t *output, size_t numLanes, uint8_t maxOffsetExtraBits, uint32_t tweakFlags, const zstdhl_MemoryAllocatorObject_t *alloc)
 {
 	size_t i = 0;
@@ -154,6 +202,7 @@ zstdhl_ResultCode_t gstd_EncoderState_Init(gstd_EncoderState_t *encState, const
 	encState->m_alloc.m_userdata = alloc->m_userdata;
 
 	zstdhl_Vector_Init(&encState->m_laneStateVector, sizeof(gstd_LaneState_t), alloc);
+	encState->m_laneStateVector.m_allocSite = ZSTDHL_ALLOC_SITE_GSTD_LANES;
 	zstdhl_Vector_Init(&encState->m_pendingOutputVector, 1, alloc);
 	zstdhl_Vector_Init(&encState->m_pendingSequencesVector, sizeof(gstd_PendingSequence_t), alloc);
 	zstdhl_Vector_Init(&encState->m_allBitstreamsVector, sizeof(gstd_InterleavedBitstream_t*), alloc);
@@ -164,6 +213,7 @@ zstdhl_ResultCode_t gstd_EncoderState_Init(gstd_EncoderState_t *encState, const
 	encState->m_maxOffsetExtraBits = GSTD_MAX_OFFSET_CODE;
 	encState->m_syncCommandReadOffset = 0;
 	encState->m_tweaks = tweakFlags;
+	encState->m_instrumentation = NULL;
 	encState->m_haveHuffmanTree = 0;
 
 	ZSTDHL_CHECKED(zstdhl_Vector_Append(&encState->m_laneStateVector, NULL, numLanes));
@@ -212,6 +262,12 @@ zstdhl_ResultCode_t gstd_EncoderState_Init(gstd_EncoderState_t *encState, const
 	encState->m_matchLengthTable.m_baselines = encState->m_matchLengthBaselines;
 	encState->m_offsetTable.m_baselines = encState->m_offsetBaselines;
 
+	gstd_InitPredefinedRANSTables();
+
+	encState->m_activeLitLengthTable = NULL;
+	encState->m_activeMatchLengthTable = NULL;
+	encState->m_activeOffsetTable = NULL;
+
 	encState->m_offsetMode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
 	encState->m_matchLengthMode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
 	encState->m_litLengthMode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
@@ -314,7 +370,7 @@ static zstdhl_ResultCode_t gstd_GenerateHuffmanEncodeTable(const zstdhl_HuffmanT
 }
 
 
-zstdhl_ResultCode_t gstd_Encoder_ImportTable(zstdhl_SequencesCompressionMode_t sectionType, const zstdhl_EncSeqCompressionDesc_t *compressionDesc, zstdhl_SequencesCompressionMode_t *inOutMode, zstdhl_FSETableDef_t *tableDef, gstd_RANSTable_t *table, uint32_t *probs, const zstdhl_SubstreamCompressionStructureDef_t *sdef, size_t numSymbols, uint32_t tweaks)
+zstdhl_ResultCode_t gstd_Encoder_ImportTable(zstdhl_SequencesCompressionMode_t sectionType, const zstdhl_EncSeqCompressionDesc_t *compressionDesc, zstdhl_SequencesCompressionMode_t *inOutMode, zstdhl_FSETableDef_t *tableDef, gstd_RANSTable_t *table, const gstd_RANSTable_t *predefinedTable, const gstd_RANSTable_t **outActiveTable, uint32_t *probs, size_t numSymbols, uint32_t tweaks)
 {
 	if (sectionType == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
 	{
@@ -327,42 +383,36 @@ zstdhl_ResultCode_t gstd_Encoder_ImportTable(zstdhl_SequencesCompressionMode_t s
 			probs[i] = compressionDesc->m_fseProbs->m_probabilities[i];
 
 		*inOutMode = ZSTDHL_SEQ_COMPRESSION_MODE_FSE;
+
+		ZSTDHL_CHECKED(gstd_BuildRANSTable(table, tableDef, tweaks));
+		*outActiveTable = table;
 	}
 	else if (sectionType == ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED)
 	{
-		size_t i = 0;
-
-		if ((*inOutMode) == ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED)
-			return ZSTDHL_RESULT_OK;	// Don't need to rebuild
-
-		tableDef->m_accuracyLog = sdef->m_defaultAccuracyLog;
-		tableDef->m_numProbabilities = sdef->m_numProbs;
-
-		for (i = 0; i < sdef->m_numProbs; i++)
-			probs[i] = sdef->m_defaultProbs[i];
-
+		// The table definition is only encoded in FSE mode, so the shared table is all that's needed
 		*inOutMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+		*outActiveTable = predefinedTable;
 	}
 	else if (sectionType == ZSTDHL_SEQ_COMPRESSION_MODE_RLE)
 	{
 		*inOutMode = ZSTDHL_SEQ_COMPRESSION_MODE_RLE;
-		return ZSTDHL_RESULT_OK;
 	}
 	else if (sectionType == ZSTDHL_SEQ_COMPRESSION_MODE_REUSE)
 	{
 		if ((*inOutMode) == ZSTDHL_SEQ_COMPRESSION_MODE_INVALID)
 			return ZSTDHL_RESULT_INTERNAL_ERROR;
-
-		return ZSTDHL_RESULT_OK;
 	}
 	else
 		return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-	ZSTDHL_CHECKED(gstd_BuildRANSTable(table, tableDef, tweaks));
-
 	return ZSTDHL_RESULT_OK;
 }
 
+void gstd_Encoder_SetInstrumentation(gstd_EncoderState_t *enc, const zstdhl_InstrumentationObject_t *instrumentation)
+{
+	enc->m_instrumentation = instrumentation;
+}
+
 zstdhl_ResultCode_t gstd_Encoder_Reset(gstd_EncoderState_t *enc, const zstdhl_DictDesc_t *dict)
 {
 	enc->m_offsetMode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
@@ -384,9 +434,9 @@ zstdhl_ResultCode_t gstd_Encoder_Reset(gstd_EncoderState_t *enc, const zstdhl_Di
 		matchLengthsSeqDesc.m_fseProbs = &dict->m_matchLengthDesc;
 		litLengthsSeqDesc.m_fseProbs = &dict->m_litLengthDesc;
 
-		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(ZSTDHL_SEQ_COMPRESSION_MODE_FSE, &offsetsSeqDesc, &enc->m_offsetMode, &enc->m_offsetTableDef, &enc->m_offsetTable, enc->m_offsetProbs, zstdhl_GetDefaultOffsetFSEProperties(), GSTD_MAX_OFFSET_CODE + 1, enc->m_tweaks));
-		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(ZSTDHL_SEQ_COMPRESSION_MODE_FSE, &matchLengthsSeqDesc, &enc->m_matchLengthMode, &enc->m_matchLengthTableDef, &enc->m_matchLengthTable, enc->m_matchLengthProbs, zstdhl_GetDefaultMatchLengthFSEProperties(), GSTD_MAX_MATCH_LENGTH_CODE + 1, enc->m_tweaks));
-		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(ZSTDHL_SEQ_COMPRESSION_MODE_FSE, &litLengthsSeqDesc, &enc->m_litLengthMode, &enc->m_litLengthTableDef, &enc->m_litLengthTable, enc->m_litLengthProbs, zstdhl_GetDefaultLitLengthFSEProperties(), GSTD_MAX_LIT_LENGTH_CODE + 1, enc->m_tweaks));
+		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(ZSTDHL_SEQ_COMPRESSION_MODE_FSE, &offsetsSeqDesc, &enc->m_offsetMode, &enc->m_offsetTableDef, &enc->m_offsetTable, &gstd_predefinedOffsetTable.m_table, &enc->m_activeOffsetTable, enc->m_offsetProbs, GSTD_MAX_OFFSET_CODE + 1, enc->m_tweaks));
+		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(ZSTDHL_SEQ_COMPRESSION_MODE_FSE, &matchLengthsSeqDesc, &enc->m_matchLengthMode, &enc->m_matchLengthTableDef, &enc->m_matchLengthTable, &gstd_predefinedMatchLengthTable.m_table, &enc->m_activeMatchLengthTable, enc->m_matchLengthProbs, GSTD_MAX_MATCH_LENGTH_CODE + 1, enc->m_tweaks));
+		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(ZSTDHL_SEQ_COMPRESSION_MODE_FSE, &litLengthsSeqDesc, &enc->m_litLengthMode, &enc->m_litLengthTableDef, &enc->m_litLengthTable, &gstd_predefinedLitLengthTable.m_table, &enc->m_activeLitLengthTable, enc->m_litLengthProbs, GSTD_MAX_LIT_LENGTH_CODE + 1, enc->m_tweaks));
 	}
 
 	return ZSTDHL_RESULT_OK;
@@ -1073,6 +1123,9 @@ zstdhl_ResultCode_t gstd_Encoder_PutLiteralPacket(gstd_EncoderState_t *enc, cons
 			// Some were buffered, determine the actual quantity
 			if (literalsBuffered > remainingLiteralsAvailableToWrite)
 				literalsBuffered = remainingLiteralsAvailableToWrite;
+
+			if (literalsBuffered == 0)
+				return ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED;
 		}
 
 		numLiteralsToFlush = literalsBuffered;
@@ -1170,7 +1223,7 @@ zstdhl_ResultCode_t gstd_Encoder_EncodeSequencesSection(gstd_EncoderState_t *enc
 			ZSTDHL_CHECKED(gstd_Encoder_FlushStateRefill(enc, broadcastSize));
 
 			for (laneIndex = 0; laneIndex < broadcastSize; laneIndex++)
-				ZSTDHL_CHECKED(gstd_Encoder_CheckAndPutRANSValue(enc, laneIndex, &enc->m_litLengthTable, enc->m_laneStates[laneIndex].m_pendingLitLength.m_value));
+				ZSTDHL_CHECKED(gstd_Encoder_CheckAndPutRANSValue(enc, laneIndex, enc->m_activeLitLengthTable, enc->m_laneStates[laneIndex].m_pendingLitLength.m_value));
 		}
 
 		if (enc->m_matchLengthMode == ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED || enc->m_matchLengthMode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
@@ -1178,7 +1231,7 @@ zstdhl_ResultCode_t gstd_Encoder_EncodeSequencesSection(gstd_EncoderState_t *enc
 			ZSTDHL_CHECKED(gstd_Encoder_FlushStateRefill(enc, broadcastSize));
 
 			for (laneIndex = 0; laneIndex < broadcastSize; laneIndex++)
-				ZSTDHL_CHECKED(gstd_Encoder_CheckAndPutRANSValue(enc, laneIndex, &enc->m_matchLengthTable, enc->m_laneStates[laneIndex].m_pendingMatchLength.m_value));
+				ZSTDHL_CHECKED(gstd_Encoder_CheckAndPutRANSValue(enc, laneIndex, enc->m_activeMatchLengthTable, enc->m_laneStates[laneIndex].m_pendingMatchLength.m_value));
 		}
 
 		if (enc->m_offsetMode == ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED || enc->m_offsetMode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
@@ -1186,7 +1239,7 @@ zstdhl_ResultCode_t gstd_Encoder_EncodeSequencesSection(gstd_EncoderState_t *enc
 			ZSTDHL_CHECKED(gstd_Encoder_FlushStateRefill(enc, broadcastSize));
 
 			for (laneIndex = 0; laneIndex < broadcastSize; laneIndex++)
-				ZSTDHL_CHECKED(gstd_Encoder_CheckAndPutRANSValue(enc, laneIndex, &enc->m_offsetTable, enc->m_laneStates[laneIndex].m_pendingOffset.m_value));
+				ZSTDHL_CHECKED(gstd_Encoder_CheckAndPutRANSValue(enc, laneIndex, enc->m_activeOffsetTable, enc->m_laneStates[laneIndex].m_pendingOffset.m_value));
 		}
 
 		ZSTDHL_CHECKED(gstd_Encoder_SyncBroadcastPeek(enc, GSTD_MAX_LIT_LENGTH_EXTRA_BITS + GSTD_MAX_MATCH_LENGTH_EXTRA_BITS, broadcastSize));
@@ -1235,10 +1288,11 @@ zstdhl_ResultCode_t gstd_Encoder_EncodeSequencesSection(gstd_EncoderState_t *enc
 		}
 	}
 
-	if (maxDecompressedSize - decompressedSize < block->m_litSectionDesc.m_numValues)
+	// RLE literal sections only have 1 value, so use the regenerated size
+	if (maxDecompressedSize - decompressedSize < block->m_litSectionHeader.m_regeneratedSize)
 		return ZSTDHL_RESULT_INTEGER_OVERFLOW;
 
-	decompressedSize += (uint32_t) block->m_litSectionDesc.m_numValues;
+	decompressedSize += block->m_litSectionHeader.m_regeneratedSize;
 
 	*outDecompressedSize = decompressedSize;
 
@@ -1313,9 +1367,9 @@ zstdhl_ResultCode_t gstd_Encoder_ResolveInitialANSStates(gstd_EncoderState_t *en
 
 	if (enc->m_pendingSequencesVector.m_count > 0)
 	{
-		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(block->m_seqSectionDesc.m_offsetsMode, &block->m_offsetsModeCompressionDesc, &enc->m_offsetMode, &enc->m_offsetTableDef, &enc->m_offsetTable, enc->m_offsetProbs, zstdhl_GetDefaultOffsetFSEProperties(), GSTD_MAX_OFFSET_CODE + 1, enc->m_tweaks));
-		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(block->m_seqSectionDesc.m_matchLengthsMode, &block->m_matchLengthsCompressionDesc, &enc->m_matchLengthMode, &enc->m_matchLengthTableDef, &enc->m_matchLengthTable, enc->m_matchLengthProbs, zstdhl_GetDefaultMatchLengthFSEProperties(), GSTD_MAX_MATCH_LENGTH_CODE + 1, enc->m_tweaks));
-		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(block->m_seqSectionDesc.m_literalLengthsMode, &block->m_literalLengthsCompressionDesc, &enc->m_litLengthMode, &enc->m_litLengthTableDef, &enc->m_litLengthTable, enc->m_litLengthProbs, zstdhl_GetDefaultLitLengthFSEProperties(), GSTD_MAX_LIT_LENGTH_CODE + 1, enc->m_tweaks));
+		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(block->m_seqSectionDesc.m_offsetsMode, &block->m_offsetsModeCompressionDesc, &enc->m_offsetMode, &enc->m_offsetTableDef, &enc->m_offsetTable, &gstd_predefinedOffsetTable.m_table, &enc->m_activeOffsetTable, enc->m_offsetProbs, GSTD_MAX_OFFSET_CODE + 1, enc->m_tweaks));
+		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(block->m_seqSectionDesc.m_matchLengthsMode, &block->m_matchLengthsCompressionDesc, &enc->m_matchLengthMode, &enc->m_matchLengthTableDef, &enc->m_matchLengthTable, &gstd_predefinedMatchLengthTable.m_table, &enc->m_activeMatchLengthTable, enc->m_matchLengthProbs, GSTD_MAX_MATCH_LENGTH_CODE + 1, enc->m_tweaks));
+		ZSTDHL_CHECKED(gstd_Encoder_ImportTable(block->m_seqSectionDesc.m_literalLengthsMode, &block->m_literalLengthsCompressionDesc, &enc->m_litLengthMode, &enc->m_litLengthTableDef, &enc->m_litLengthTable, &gstd_predefinedLitLengthTable.m_table, &enc->m_activeLitLengthTable, enc->m_litLengthProbs, GSTD_MAX_LIT_LENGTH_CODE + 1, enc->m_tweaks));
 
 		if (enc->m_offsetMode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE || enc->m_offsetMode == ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED)
 			haveOffsetFSE = 1;
@@ -1339,19 +1393,19 @@ zstdhl_ResultCode_t gstd_Encoder_ResolveInitialANSStates(gstd_EncoderState_t *en
 		if (haveOffsetFSE)
 		{
 			ZSTDHL_CHECKED(zstdhl_EncodeOffsetCode(seq->m_offsetCode, &fseValue, &extraValue, &extraBits));
-			ZSTDHL_CHECKED(gstd_EncodeRANSValue(&enc->m_laneStates[laneIndex].m_ransStack, &enc->m_offsetTable, fseValue));
+			ZSTDHL_CHECKED(gstd_EncodeRANSValue(&enc->m_laneStates[laneIndex].m_ransStack, enc->m_activeOffsetTable, fseValue));
 		}
 
 		if (haveMatchLengthFSE)
 		{
 			ZSTDHL_CHECKED(zstdhl_EncodeMatchLength(seq->m_matchLength, &fseValue, &extraValue, &extraBits));
-			ZSTDHL_CHECKED(gstd_EncodeRANSValue(&enc->m_laneStates[laneIndex].m_ransStack, &enc->m_matchLengthTable, fseValue));
+			ZSTDHL_CHECKED(gstd_EncodeRANSValue(&enc->m_laneStates[laneIndex].m_ransStack, enc->m_activeMatchLengthTable, fseValue));
 		}
 
 		if (haveLitLengthFSE)
 		{
 			ZSTDHL_CHECKED(zstdhl_EncodeLitLength(seq->m_litLength, &fseValue, &extraValue, &extraBits));
-			ZSTDHL_CHECKED(gstd_EncodeRANSValue(&enc->m_laneStates[laneIndex].m_ransStack, &enc->m_litLengthTable, fseValue));
+			ZSTDHL_CHECKED(gstd_EncodeRANSValue(&enc->m_laneStates[laneIndex].m_ransStack, enc->m_activeLitLengthTable, fseValue));
 		}
 	}
 
@@ -1437,12 +1491,12 @@ zstdhl_ResultCode_t gstd_Encoder_EncodeCompressedBlock(gstd_EncoderState_t *enc,
 {
 	enc->m_numLiteralsWritten = 0;
 
-	ZSTDHL_CHECKED(gstd_Encoder_QueueAllSequences(enc, block));
+	ZSTDHL_CHECKED_PHASE(enc->m_instrumentation, ZSTDHL_PHASE_GSTD_QUEUE_SEQUENCES, 0, block->m_seqSectionDesc.m_numSequences, gstd_Encoder_QueueAllSequences(enc, block));
 
-	ZSTDHL_CHECKED(gstd_Encoder_ResolveInitialANSStates(enc, block));
+	ZSTDHL_CHECKED_PHASE(enc->m_instrumentation, ZSTDHL_PHASE_GSTD_RESOLVE_STATES, 0, block->m_seqSectionDesc.m_numSequences, gstd_Encoder_ResolveInitialANSStates(enc, block));
 
-	ZSTDHL_CHECKED(gstd_Encoder_EncodeLiteralsSection(enc, block, outAuxBit));
-	ZSTDHL_CHECKED(gstd_Encoder_EncodeSequencesSection(enc, block, outDecompressedSize));
+	ZSTDHL_CHECKED_PHASE(enc->m_instrumentation, ZSTDHL_PHASE_GSTD_LITERALS_SECTION, 0, block->m_litSectionDesc.m_numValues, gstd_Encoder_EncodeLiteralsSection(enc, block, outAuxBit));
+	ZSTDHL_CHECKED_PHASE(enc->m_instrumentation, ZSTDHL_PHASE_GSTD_SEQUENCES_SECTION, 0, block->m_seqSectionDesc.m_numSequences, gstd_Encoder_EncodeSequencesSection(enc, block, outDecompressedSize));
 
 	zstdhl_Vector_Clear(&enc->m_pendingSequencesVector);
 	zstdhl_Vector_Clear(&enc->m_pendingLiteralsVector);
@@ -1464,11 +1518,11 @@ zstdhl_ResultCode_t gstd_Encoder_AddBlock(gstd_EncoderState_t *enc, const zstdhl
 	{
 	case ZSTDHL_BLOCK_TYPE_RAW:
 		ZSTDHL_CHECKED(gstd_Encoder_EncodeRawBlock(enc, block, &decompressedSize, &extraByte));
-		controlWord |= (extraByte << GSTD_CONTROL_RAW_FIRST_BYTE_OFFSET);
+		controlWord |= ((uint32_t)extraByte << GSTD_CONTROL_RAW_FIRST_BYTE_OFFSET);
 		break;
 	case ZSTDHL_BLOCK_TYPE_RLE:
 		ZSTDHL_CHECKED(gstd_Encoder_EncodeRLEBlock(enc, block, &decompressedSize, &extraByte));
-		controlWord |= (extraByte << GSTD_CONTROL_RAW_FIRST_BYTE_OFFSET);
+		controlWord |= ((uint32_t)extraByte << GSTD_CONTROL_RAW_FIRST_BYTE_OFFSET);
 		break;
 	case ZSTDHL_BLOCK_TYPE_COMPRESSED:
 		controlWord |= (block->m_litSectionHeader.m_sectionType << GSTD_CONTROL_LIT_SECTION_TYPE_OFFSET);
@@ -1482,6 +1536,10 @@ zstdhl_ResultCode_t gstd_Encoder_AddBlock(gstd_EncoderState_t *enc, const zstdhl
 		return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
 	};
 
+	// Oversized blocks would wrap in the control word
+	if (decompressedSize > GSTD_CONTROL_DECOMPRESSED_SIZE_MASK)
+		return ZSTDHL_RESULT_BLOCK_SIZE_INVALID;
+
 	if (!block->m_blockHeader.m_isLastBlock)
 		controlWord |= (1 << GSTD_CONTROL_MORE_BLOCKS_BIT_OFFSET);
 
@@ -1525,7 +1583,7 @@ zstdhl_ResultCode_t gstd_Encoder_Finish(gstd_EncoderState_t *enc)
 
 	ZSTDHL_CHECKED(gstd_Encoder_FlushBitstream(enc, &enc->m_controlWordBitstream));
 
-	ZSTDHL_CHECKED(enc->m_output->m_writeBitstreamFunc(enc->m_output->m_userdata, enc->m_pendingOutputVector.m_data, enc->m_pendingOutputVector.m_count));
+	ZSTDHL_CHECKED_PHASE(enc->m_instrumentation, ZSTDHL_PHASE_GSTD_FINISH, enc->m_pendingOutputVector.m_count, 0, enc->m_output->m_writeBitstreamFunc(enc->m_output->m_userdata, enc->m_pendingOutputVector.m_data, enc->m_pendingOutputVector.m_count));
 
 	zstdhl_Vector_Reset(&enc->m_pendingOutputVector);
 
@@ -1726,6 +1784,8 @@ zstdhl_ResultCode_t gstd_TranscodeState_Init(gstd_TranscodeState_t *state, gstd_
 	state->m_encBlock.m_autoHuffmanStreamSizesFlags[1] = 1;
 	state->m_encBlock.m_autoHuffmanStreamSizesFlags[2] = 1;
 	state->m_encBlock.m_autoHuffmanStreamSizesFlags[3] = 1;
+	state->m_encBlock.m_autoLitSectionModeFlag = 0;
+	state->m_encBlock.m_autoSeqCompressionModeFlag = 0;
 
 	state->m_encBlock.m_litSectionHeader.m_compressedSize = 0;
 	state->m_encBlock.m_litSectionHeader.m_regeneratedSize = 0;
@@ -2192,6 +2252,9 @@ zstdhl_ResultCode_t gstd_TranscodeElement(void *userdata, int elementType, const
 	case ZSTDHL_ELEMENT_TYPE_BLOCK_END:
 		return gstd_TranscodeBlockEnd(state);
 
+	case ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM:
+		return ZSTDHL_RESULT_OK;
+
 	case ZSTDHL_ELEMENT_TYPE_FRAME_END:
 		return gstd_TranscodeFrameEnd(state);
 
@@ -2250,7 +2313,7 @@ zstdhl_ResultCode_t gstd_Encoder_Transcode(gstd_EncoderState_t *enc, const zstdh
 	}
 
 	if (resultCode == ZSTDHL_RESULT_OK)
-		resultCode = zstdhl_Disassemble(streamSource, dictDesc, &disasmOutputObj, alloc);
+		resultCode = zstdhl_DisassembleWithOptions(streamSource, dictDesc, NULL, 0, enc->m_instrumentation, NULL, &disasmOutputObj, alloc);
 
 	gstd_TranscodeState_Destroy(&tcState);
 
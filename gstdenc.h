@@ -45,6 +45,9 @@ zstdhl_ResultCode_t gstd_Encoder_AddBlock(gstd_EncoderState_t *encState, const z
 zstdhl_ResultCode_t gstd_Encoder_Finish(gstd_EncoderState_t *encState);
 void gstd_Encoder_Destroy(gstd_EncoderState_t *encState);
 
+// Reports encoding phases, and disassembly phases of gstd_Encoder_Transcode, to instrumentation.  NULL stops reporting.
+void gstd_Encoder_SetInstrumentation(gstd_EncoderState_t *encState, const zstdhl_InstrumentationObject_t *instrumentation);
+
 uint8_t gstd_ComputeMaxOffsetExtraBits(uint32_t maxFrameSize);
 
 zstdhl_ResultCode_t gstd_Encoder_Transcode(gstd_EncoderState_t *encState, const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_StreamSourceObject_t *dictStreamSource, const zstdhl_MemoryAllocatorObject_t *alloc);
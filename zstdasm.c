@@ -14,7 +14,18 @@ the included LICENSE.txt file.
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define ZSTDASM_TOKEN_BLOCK_HEADER "blockHeader"
+#define ZSTDASM_OUTPUT_BUFFER_SIZE (1024 * 1024)
+#define ZSTDASM_DATA_BLOCK_COLUMNS 16
 
 #define ZSTDASM_CHECKED(n)	\
 	do\
@@ -29,6 +40,9 @@ typedef enum AsmMode
 	AsmMode_Asm,
 	AsmMode_Disasm,
 	AsmMode_GstdEnc,
+	AsmMode_BinDisasm,
+	AsmMode_BinAsm,
+	AsmMode_BinToText,
 
 	AsmMode_Invalid,
 } AsmMode_t;
@@ -39,6 +53,9 @@ typedef struct DisasmState
 	zstdhl_MemoryAllocatorObject_t m_alloc;
 	zstdhl_Vector_t m_bigNumU32Vector;
 	zstdhl_Vector_t m_bigNumDigitVector;
+
+	char *m_outBuffer;
+	size_t m_outBufferUsed;
 } DisasmState_t;
 
 size_t ReadBytes(void *userdata, void *dest, size_t numBytes)
@@ -46,6 +63,135 @@ size_t ReadBytes(void *userdata, void *dest, size_t numBytes)
 	return fread(dest, 1, numBytes, (FILE *)userdata);
 }
 
+// Input file, which is memory-mapped if possible and otherwise read as a stream
+typedef struct InputFile
+{
+	FILE *m_f;
+	const uint8_t *m_mappedData;
+	size_t m_mappedSize;
+
+#ifdef _WIN32
+	HANDLE m_fileHandle;
+	HANDLE m_mappingHandle;
+#endif
+} InputFile_t;
+
+static int MapInputFile(InputFile_t *inputFile, const char *path)
+{
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+	HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	HANDLE mappingHandle = NULL;
+	const void *mappedData = NULL;
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return 0;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart <= 0 || (uint64_t)fileSize.QuadPart > (size_t)-1)
+	{
+		CloseHandle(fileHandle);
+		return 0;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle)
+		mappedData = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!mappedData)
+	{
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return 0;
+	}
+
+	inputFile->m_fileHandle = fileHandle;
+	inputFile->m_mappingHandle = mappingHandle;
+	inputFile->m_mappedData = (const uint8_t *)mappedData;
+	inputFile->m_mappedSize = (size_t)fileSize.QuadPart;
+
+	return 1;
+#else
+	struct stat fileStat;
+	void *mappedData = NULL;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return 0;
+
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size <= 0 || (uint64_t)fileStat.st_size > (size_t)-1)
+	{
+		close(fd);
+		return 0;
+	}
+
+	mappedData = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping stays valid after the descriptor is closed
+	close(fd);
+
+	if (mappedData == MAP_FAILED)
+		return 0;
+
+#ifdef MADV_SEQUENTIAL
+	madvise(mappedData, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+#endif
+
+	inputFile->m_mappedData = (const uint8_t *)mappedData;
+	inputFile->m_mappedSize = (size_t)fileStat.st_size;
+
+	return 1;
+#endif
+}
+
+int OpenInputFile(InputFile_t *inputFile, const char *path)
+{
+	inputFile->m_f = NULL;
+	inputFile->m_mappedData = NULL;
+	inputFile->m_mappedSize = 0;
+
+	if (MapInputFile(inputFile, path))
+		return 1;
+
+	// Empty files, pipes, and devices can't be mapped
+	inputFile->m_f = fopen(path, "rb");
+
+	return inputFile->m_f != NULL;
+}
+
+void CloseInputFile(InputFile_t *inputFile)
+{
+	if (inputFile->m_f)
+		fclose(inputFile->m_f);
+
+	if (inputFile->m_mappedData)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(inputFile->m_mappedData);
+		CloseHandle(inputFile->m_mappingHandle);
+		CloseHandle(inputFile->m_fileHandle);
+#else
+		munmap((void *)inputFile->m_mappedData, inputFile->m_mappedSize);
+#endif
+	}
+}
+
+void InputFile_InitStreamSource(const InputFile_t *inputFile, zstdhl_MemBufferStreamSource_t *memSource, zstdhl_StreamSourceObject_t *streamSourceObj)
+{
+	if (inputFile->m_f)
+	{
+		streamSourceObj->m_readBytesFunc = ReadBytes;
+		streamSourceObj->m_userdata = inputFile->m_f;
+	}
+	else
+	{
+		zstdhl_MemBufferStreamSource_Init(memSource, inputFile->m_mappedData, inputFile->m_mappedSize);
+
+		streamSourceObj->m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+		streamSourceObj->m_userdata = memSource;
+	}
+}
+
 typedef struct GstdEncodeState
 {
 	FILE *m_f;
@@ -73,11 +219,38 @@ void *Realloc(void *userdata, void *ptr, size_t numBytes)
 	return result;
 }
 
+zstdhl_ResultCode_t FlushOutput(DisasmState_t *dstate)
+{
+	if (dstate->m_outBufferUsed > 0)
+	{
+		size_t numWritten = fwrite(dstate->m_outBuffer, 1, dstate->m_outBufferUsed, dstate->m_f);
+		if (numWritten != dstate->m_outBufferUsed)
+			return ZSTDHL_RESULT_OUTPUT_FAILED;
+
+		dstate->m_outBufferUsed = 0;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
 zstdhl_ResultCode_t WriteBuffer(DisasmState_t *dstate, const void *data, size_t len)
 {
-	size_t numWritten = fwrite(data, 1, len, dstate->m_f);
-	if (numWritten != len)
-		return ZSTDHL_RESULT_OUTPUT_FAILED;
+	if (len > ZSTDASM_OUTPUT_BUFFER_SIZE - dstate->m_outBufferUsed)
+	{
+		ZSTDASM_CHECKED(FlushOutput(dstate));
+
+		if (len >= ZSTDASM_OUTPUT_BUFFER_SIZE)
+		{
+			size_t numWritten = fwrite(data, 1, len, dstate->m_f);
+			if (numWritten != len)
+				return ZSTDHL_RESULT_OUTPUT_FAILED;
+
+			return ZSTDHL_RESULT_OK;
+		}
+	}
+
+	memcpy(dstate->m_outBuffer + dstate->m_outBufferUsed, data, len);
+	dstate->m_outBufferUsed += len;
 
 	return ZSTDHL_RESULT_OK;
 }
@@ -89,28 +262,45 @@ zstdhl_ResultCode_t WriteString(DisasmState_t *dstate, const char *str)
 	return WriteBuffer(dstate, str, len);
 }
 
+static const char g_decimalDigitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
 #define CREATE_INTEGER_WRITE_WRITE_FUNC(funcName, type)	\
 zstdhl_ResultCode_t funcName(DisasmState_t *dstate, type v)\
 {\
 	char chars[sizeof(v) * 8 / 3 + 2];\
-	char *outChar = chars + sizeof(chars) - 1;\
-	*outChar = '\0';\
-	if (v == 0)\
+	char *charsEnd = chars + sizeof(chars);\
+	char *outChar = charsEnd;\
+	while (v >= 100u)\
 	{\
-		outChar--;\
-		*outChar = '0';\
+		const char *pair = g_decimalDigitPairs + (size_t)(v % 100u) * 2u;\
+		v /= 100u;\
+		outChar -= 2;\
+		outChar[0] = pair[0];\
+		outChar[1] = pair[1];\
+	}\
+	if (v >= 10u)\
+	{\
+		const char *pair = g_decimalDigitPairs + (size_t)v * 2u;\
+		outChar -= 2;\
+		outChar[0] = pair[0];\
+		outChar[1] = pair[1];\
 	}\
 	else\
 	{\
-		do\
-		{\
-			size_t digit = v % 10u;\
-			outChar--;\
-			*outChar = (char)('0' + digit);\
-			v /= 10u;\
-		} while (v != 0);\
+		outChar--;\
+		*outChar = (char)('0' + v);\
 	}\
-	return WriteString(dstate, outChar);\
+	return WriteBuffer(dstate, outChar, (size_t)(charsEnd - outChar));\
 }
 
 CREATE_INTEGER_WRITE_WRITE_FUNC(WriteSize, size_t)
@@ -123,7 +313,16 @@ zstdhl_ResultCode_t WriteBigNum(DisasmState_t *dstate, uint32_t *dwords, size_t
 {
 	size_t numWords = (numBits + 15u) / 16u;
 	zstdhl_Vector_t *digitVector = &dstate->m_bigNumDigitVector;
-	char terminator = '\0';
+
+	// Offsets almost always fit in a machine word
+	if (numBits == 0)
+		return WriteU32(dstate, 0);
+
+	if (numBits <= 32)
+		return WriteU32(dstate, dwords[0]);
+
+	if (numBits <= 64)
+		return WriteU64(dstate, (((uint64_t)dwords[1]) << 32) | dwords[0]);
 
 	zstdhl_Vector_Clear(digitVector);
 
@@ -248,51 +447,69 @@ zstdhl_ResultCode_t WriteChar(DisasmState_t *dstate, int16_t ch)
 
 zstdhl_ResultCode_t WriteCommentedDataBlock(DisasmState_t *dstate, size_t numValues, const zstdhl_StreamSourceObject_t *streamSource)
 {
+	const char *hexStr = "0123456789abcdef";
+	const size_t numColumns = ZSTDASM_DATA_BLOCK_COLUMNS;
+	uint8_t chunkBytes[ZSTDASM_DATA_BLOCK_COLUMNS * 64];
+	char lineChars[ZSTDASM_DATA_BLOCK_COLUMNS * 4 + 8];
 	size_t i = 0;
-	size_t col = 0;
-	uint8_t colBytes[16];
-	char commentChars[sizeof(colBytes)];
-	size_t numColumns = sizeof(colBytes);
 
-	for (size_t i = 0; i < numValues; i += numColumns)
+	while (i < numValues)
 	{
 		size_t bytesToRead = numValues - i;
 		size_t bytesRead = 0;
+		size_t chunkPos = 0;
 
-		if (bytesToRead > numColumns)
-			bytesToRead = numColumns;
+		if (bytesToRead > sizeof(chunkBytes))
+			bytesToRead = sizeof(chunkBytes);
 
-		bytesRead = streamSource->m_readBytesFunc(streamSource->m_userdata, colBytes, bytesToRead);
+		bytesRead = streamSource->m_readBytesFunc(streamSource->m_userdata, chunkBytes, bytesToRead);
 
 		if (bytesRead != bytesToRead)
 			return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-		for (col = 0; col < bytesRead; col++)
+		// Each line is formatted in full and then written once
+		for (chunkPos = 0; chunkPos < bytesRead; chunkPos += numColumns)
 		{
-			const char *hexStr = "0123456789abcdef";
-			uint8_t byte = colBytes[col];
-			char byteChars[3];
+			const uint8_t *colBytes = chunkBytes + chunkPos;
+			size_t lineBytes = bytesRead - chunkPos;
+			char *commentChars = NULL;
+			size_t col = 0;
 
+			if (lineBytes > numColumns)
+				lineBytes = numColumns;
 
-			if (byte < 32 || byte > 126)
-				commentChars[col] = '.';
-			else
-				commentChars[col] = (char)byte;
+			for (col = 0; col < lineBytes; col++)
+			{
+				uint8_t byte = colBytes[col];
+
+				lineChars[col * 3 + 0] = hexStr[(byte >> 4) & 0xf];
+				lineChars[col * 3 + 1] = hexStr[byte & 0xf];
+				lineChars[col * 3 + 2] = ' ';
+			}
 
-			byteChars[0] = hexStr[(byte >> 4) & 0xf];
-			byteChars[1] = hexStr[byte & 0xf];
-			byteChars[2] = ' ';
+			for (col = lineBytes * 3; col < numColumns * 3; col++)
+				lineChars[col] = ' ';
 
-			ZSTDASM_CHECKED(WriteBuffer(dstate, byteChars, 3));
-		}
+			memcpy(lineChars + numColumns * 3, "    ; ", 6);
 
-		for (col = bytesRead; col < numColumns; col++)
-		{
-			ZSTDASM_CHECKED(WriteString(dstate, "   "));
+			commentChars = lineChars + numColumns * 3 + 6;
+
+			for (col = 0; col < lineBytes; col++)
+			{
+				uint8_t byte = colBytes[col];
+
+				if (byte < 32 || byte > 126)
+					commentChars[col] = '.';
+				else
+					commentChars[col] = (char)byte;
+			}
+
+			commentChars[lineBytes] = '\n';
+
+			ZSTDASM_CHECKED(WriteBuffer(dstate, lineChars, numColumns * 3 + 6 + lineBytes + 1));
 		}
-		ZSTDASM_CHECKED(WriteString(dstate, "    ; "));
-		ZSTDASM_CHECKED(WriteBuffer(dstate, commentChars, bytesRead));
-		ZSTDASM_CHECKED(WriteString(dstate, "\n"));
+
+		i += bytesRead;
 	}
 
 	return ZSTDHL_RESULT_OK;
@@ -320,6 +537,11 @@ zstdhl_ResultCode_t WriteFrameHeader(DisasmState_t *dstate, const zstdhl_FrameHe
 		ZSTDASM_CHECKED(WriteString(dstate, " checksum"));
 	}
 
+	if (element->m_isSingleSegment)
+	{
+		ZSTDASM_CHECKED(WriteString(dstate, " singleSegment"));
+	}
+
 	ZSTDASM_CHECKED(WriteString(dstate, "\n"));
 
 	return ZSTDHL_RESULT_OK;
@@ -393,7 +615,21 @@ zstdhl_ResultCode_t WriteLiteralsSectionHeader(DisasmState_t *dstate, const zstd
 
 zstdhl_ResultCode_t WriteLiteralsSection(DisasmState_t *dstate, const zstdhl_LiteralsSectionDesc_t *element)
 {
-	ZSTDASM_CHECKED(WriteString(dstate, "literalValues\n"));
+	ZSTDASM_CHECKED(WriteString(dstate, "literalValues"));
+
+	switch (element->m_huffmanStreamMode)
+	{
+	case ZSTDHL_HUFFMAN_STREAM_MODE_1_STREAM:
+		ZSTDASM_CHECKED(WriteString(dstate, " streams 1"));
+		break;
+	case ZSTDHL_HUFFMAN_STREAM_MODE_4_STREAMS:
+		ZSTDASM_CHECKED(WriteString(dstate, " streams 4"));
+		break;
+	default:
+		break;
+	}
+
+	ZSTDASM_CHECKED(WriteString(dstate, "\n"));
 	ZSTDASM_CHECKED(WriteCommentedDataBlock(dstate, element->m_numValues, element->m_decompressedLiteralsStream));
 	ZSTDASM_CHECKED(WriteString(dstate, "endLiteralValues\n"));
 
@@ -488,6 +724,14 @@ zstdhl_ResultCode_t WriteBlockEnd(DisasmState_t *dstate)
 	return ZSTDHL_RESULT_OK;
 }
 
+zstdhl_ResultCode_t WriteContentChecksum(DisasmState_t *dstate, const uint32_t *checksum)
+{
+	ZSTDASM_CHECKED(WriteString(dstate, "contentChecksum "));
+	ZSTDASM_CHECKED(WriteU32(dstate, *checksum));
+	ZSTDASM_CHECKED(WriteString(dstate, "\n"));
+	return ZSTDHL_RESULT_OK;
+}
+
 zstdhl_ResultCode_t WriteFrameEnd(DisasmState_t *dstate)
 {
 	ZSTDASM_CHECKED(WriteString(dstate, "frameEnd\n"));
@@ -638,6 +882,9 @@ zstdhl_ResultCode_t DisassembleElement(void *userdata, int elementType, const vo
 	case ZSTDHL_ELEMENT_TYPE_BLOCK_END:
 		return WriteBlockEnd(dstate);
 
+	case ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM:
+		return WriteContentChecksum(dstate, element);
+
 	case ZSTDHL_ELEMENT_TYPE_FRAME_END:
 		return WriteFrameEnd(dstate);
 
@@ -649,116 +896,2730 @@ zstdhl_ResultCode_t DisassembleElement(void *userdata, int elementType, const vo
 }
 
 
-int main(int argc, const char **argv)
+// Compact binary element stream.  Each record is an element type byte followed by the element's fields,
+// with integers stored as LEB128 varints.  Sequences are batched into chunks stored as arrays of each field.
+#define ZSTDASM_BIN_MAGIC "ZHLB"
+#define ZSTDASM_BIN_VERSION 1
+#define ZSTDASM_BIN_SEQUENCE_CHUNK_SIZE 4096
+#define ZSTDASM_BIN_MAX_OFFSET_DWORDS 31
+
+// Element tags stored in the file.  These are part of the format and are mapped explicitly, so edits to
+// zstdhl_ElementType_t don't change the meaning of existing files.
+typedef enum BinElementTag
 {
-	const char *modeStr = NULL;
-	AsmMode_t asmMode = AsmMode_Invalid;
-	FILE *inputF = NULL;
-	FILE *outputF = NULL;
-	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
-	zstdhl_DisassemblyOutputObject_t disasmObject;
-	zstdhl_StreamSourceObject_t streamSourceObj;
-	zstdhl_MemoryAllocatorObject_t memAllocObj;
+	BinElementTag_FrameHeader = 0,
+	BinElementTag_BlockHeader = 1,
+	BinElementTag_LiteralsSectionHeader = 2,
+	BinElementTag_LiteralsSection = 3,
+	BinElementTag_SequencesSection = 4,
+	BinElementTag_BlockRLEData = 5,
+	BinElementTag_BlockUncompressedData = 6,
+	BinElementTag_FSETableStart = 7,
+	BinElementTag_FSETableEnd = 8,
+	BinElementTag_FSEProbability = 9,
+	BinElementTag_SequenceRLEByte = 10,
+	BinElementTag_WasteBits = 11,
+	BinElementTag_HuffmanTree = 12,
+	BinElementTag_Sequences = 13,
+	BinElementTag_BlockEnd = 14,
+	BinElementTag_ContentChecksum = 15,
+	BinElementTag_FrameEnd = 16,
+	BinElementTag_DictStart = 17,
+	BinElementTag_DictRecentOffsets = 18,
+	BinElementTag_DictEnd = 19,
+
+	BinElementTag_Count,
+} BinElementTag_t;
+
+#define ZSTDASM_BIN_MAX_ELEMENT_TYPES 32
+
+typedef struct BinElementTagMapping
+{
+	uint8_t m_isMapped;
+	uint8_t m_tag;
+} BinElementTagMapping_t;
+
+static const int g_binTagToElementType[BinElementTag_Count] =
+{
+	[BinElementTag_FrameHeader] = ZSTDHL_ELEMENT_TYPE_FRAME_HEADER,
+	[BinElementTag_BlockHeader] = ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER,
+	[BinElementTag_LiteralsSectionHeader] = ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER,
+	[BinElementTag_LiteralsSection] = ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION,
+	[BinElementTag_SequencesSection] = ZSTDHL_ELEMENT_TYPE_SEQUENCES_SECTION,
+	[BinElementTag_BlockRLEData] = ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA,
+	[BinElementTag_BlockUncompressedData] = ZSTDHL_ELEMENT_TYPE_BLOCK_UNCOMPRESSED_DATA,
+	[BinElementTag_FSETableStart] = ZSTDHL_ELEMENT_TYPE_FSE_TABLE_START,
+	[BinElementTag_FSETableEnd] = ZSTDHL_ELEMENT_TYPE_FSE_TABLE_END,
+	[BinElementTag_FSEProbability] = ZSTDHL_ELEMENT_TYPE_FSE_PROBABILITY,
+	[BinElementTag_SequenceRLEByte] = ZSTDHL_ELEMENT_TYPE_SEQUENCE_RLE_BYTE,
+	[BinElementTag_WasteBits] = ZSTDHL_ELEMENT_TYPE_WASTE_BITS,
+	[BinElementTag_HuffmanTree] = ZSTDHL_ELEMENT_TYPE_HUFFMAN_TREE,
+	[BinElementTag_Sequences] = ZSTDHL_ELEMENT_TYPE_SEQUENCE,
+	[BinElementTag_BlockEnd] = ZSTDHL_ELEMENT_TYPE_BLOCK_END,
+	[BinElementTag_ContentChecksum] = ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM,
+	[BinElementTag_FrameEnd] = ZSTDHL_ELEMENT_TYPE_FRAME_END,
+	[BinElementTag_DictStart] = ZSTDHL_ELEMENT_TYPE_DICT_START,
+	[BinElementTag_DictRecentOffsets] = ZSTDHL_ELEMENT_TYPE_DICT_RECENT_OFFSETS,
+	[BinElementTag_DictEnd] = ZSTDHL_ELEMENT_TYPE_DICT_END,
+};
+
+static const BinElementTagMapping_t g_binElementTypeToTag[ZSTDASM_BIN_MAX_ELEMENT_TYPES] =
+{
+	[ZSTDHL_ELEMENT_TYPE_FRAME_HEADER] = { 1, BinElementTag_FrameHeader },
+	[ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER] = { 1, BinElementTag_BlockHeader },
+	[ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER] = { 1, BinElementTag_LiteralsSectionHeader },
+	[ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION] = { 1, BinElementTag_LiteralsSection },
+	[ZSTDHL_ELEMENT_TYPE_SEQUENCES_SECTION] = { 1, BinElementTag_SequencesSection },
+	[ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA] = { 1, BinElementTag_BlockRLEData },
+	[ZSTDHL_ELEMENT_TYPE_BLOCK_UNCOMPRESSED_DATA] = { 1, BinElementTag_BlockUncompressedData },
+	[ZSTDHL_ELEMENT_TYPE_FSE_TABLE_START] = { 1, BinElementTag_FSETableStart },
+	[ZSTDHL_ELEMENT_TYPE_FSE_TABLE_END] = { 1, BinElementTag_FSETableEnd },
+	[ZSTDHL_ELEMENT_TYPE_FSE_PROBABILITY] = { 1, BinElementTag_FSEProbability },
+	[ZSTDHL_ELEMENT_TYPE_SEQUENCE_RLE_BYTE] = { 1, BinElementTag_SequenceRLEByte },
+	[ZSTDHL_ELEMENT_TYPE_WASTE_BITS] = { 1, BinElementTag_WasteBits },
+	[ZSTDHL_ELEMENT_TYPE_HUFFMAN_TREE] = { 1, BinElementTag_HuffmanTree },
+	[ZSTDHL_ELEMENT_TYPE_SEQUENCE] = { 1, BinElementTag_Sequences },
+	[ZSTDHL_ELEMENT_TYPE_BLOCK_END] = { 1, BinElementTag_BlockEnd },
+	[ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM] = { 1, BinElementTag_ContentChecksum },
+	[ZSTDHL_ELEMENT_TYPE_FRAME_END] = { 1, BinElementTag_FrameEnd },
+	[ZSTDHL_ELEMENT_TYPE_DICT_START] = { 1, BinElementTag_DictStart },
+	[ZSTDHL_ELEMENT_TYPE_DICT_RECENT_OFFSETS] = { 1, BinElementTag_DictRecentOffsets },
+	[ZSTDHL_ELEMENT_TYPE_DICT_END] = { 1, BinElementTag_DictEnd },
+};
+
+typedef struct BinDisasmState
+{
+	DisasmState_t *m_out;
 
-	if (argc != 4)
+	size_t m_numSequences;
+	uint32_t m_litLengths[ZSTDASM_BIN_SEQUENCE_CHUNK_SIZE];
+	uint32_t m_matchLengths[ZSTDASM_BIN_SEQUENCE_CHUNK_SIZE];
+	uint8_t m_offsetTags[ZSTDASM_BIN_SEQUENCE_CHUNK_SIZE];
+	zstdhl_Vector_t m_offsetDWords;
+} BinDisasmState_t;
+
+zstdhl_ResultCode_t WriteVarUInt(DisasmState_t *dstate, uint64_t v)
+{
+	uint8_t bytes[10];
+	size_t numBytes = 0;
+
+	while (v >= 0x80u)
 	{
-		fprintf(stderr, "Usage: zstdasm <mode> <input> <output>\n");
-		fprintf(stderr, "Commands:\n");
-		fprintf(stderr, "    asm - Converts text input into Zstd stream\n");
-		fprintf(stderr, "    disasm - Converts Zstd stream into text input\n");
-		fprintf(stderr, "    gstdenc - Converts Zstd stream into Gstd stream\n");
-		return -1;
+		bytes[numBytes++] = (uint8_t)(v | 0x80u);
+		v >>= 7;
 	}
 
-	modeStr = argv[1];
+	bytes[numBytes++] = (uint8_t)v;
 
-	if (!strcmp(modeStr, "asm"))
-		asmMode = AsmMode_Asm;
-	else if (!strcmp(modeStr, "disasm"))
-		asmMode = AsmMode_Disasm;
-	else if (!strcmp(modeStr, "gstdenc"))
-		asmMode = AsmMode_GstdEnc;
-	else
+	return WriteBuffer(dstate, bytes, numBytes);
+}
+
+zstdhl_ResultCode_t WriteByte(DisasmState_t *dstate, uint8_t b)
+{
+	return WriteBuffer(dstate, &b, 1);
+}
+
+zstdhl_ResultCode_t WriteBinStreamData(DisasmState_t *dstate, size_t numBytes, const zstdhl_StreamSourceObject_t *streamSource)
+{
+	uint8_t chunkBytes[1024];
+
+	while (numBytes > 0)
 	{
-		fprintf(stderr, "Invalid mode\n");
-		return -1;
+		size_t bytesToRead = numBytes;
+
+		if (bytesToRead > sizeof(chunkBytes))
+			bytesToRead = sizeof(chunkBytes);
+
+		if (streamSource->m_readBytesFunc(streamSource->m_userdata, chunkBytes, bytesToRead) != bytesToRead)
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+		ZSTDASM_CHECKED(WriteBuffer(dstate, chunkBytes, bytesToRead));
+
+		numBytes -= bytesToRead;
 	}
 
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t FlushBinSequences(BinDisasmState_t *bstate)
+{
+	DisasmState_t *dstate = bstate->m_out;
+	const uint32_t *offsetDWords = (const uint32_t *)bstate->m_offsetDWords.m_data;
+	size_t numSequences = bstate->m_numSequences;
+	size_t i = 0;
+
+	if (numSequences == 0)
+		return ZSTDHL_RESULT_OK;
+
+	ZSTDASM_CHECKED(WriteByte(dstate, BinElementTag_Sequences));
+	ZSTDASM_CHECKED(WriteVarUInt(dstate, numSequences));
+
+	for (i = 0; i < numSequences; i++)
+		ZSTDASM_CHECKED(WriteVarUInt(dstate, bstate->m_litLengths[i]));
+
+	for (i = 0; i < numSequences; i++)
+		ZSTDASM_CHECKED(WriteVarUInt(dstate, bstate->m_matchLengths[i]));
+
+	ZSTDASM_CHECKED(WriteBuffer(dstate, bstate->m_offsetTags, numSequences));
 
-	inputF = fopen(argv[2], "rb");
+	for (i = 0; i < bstate->m_offsetDWords.m_count; i++)
+		ZSTDASM_CHECKED(WriteVarUInt(dstate, offsetDWords[i]));
 
-	if (!inputF)
+	bstate->m_numSequences = 0;
+	zstdhl_Vector_Clear(&bstate->m_offsetDWords);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t WriteBinSequence(BinDisasmState_t *bstate, const zstdhl_SequenceDesc_t *element)
+{
+	size_t numDWords = 0;
+	size_t seqIndex = bstate->m_numSequences;
+
+	if (element->m_offsetType == ZSTDHL_OFFSET_TYPE_SPECIFIED)
 	{
-		fprintf(stderr, "Couldn't open input file\n");
-		return -1;
+		numDWords = (element->m_offsetValueNumBits + 31u) / 32u;
+
+		if (numDWords > ZSTDASM_BIN_MAX_OFFSET_DWORDS)
+			return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
+
+		ZSTDASM_CHECKED(zstdhl_Vector_Append(&bstate->m_offsetDWords, element->m_offsetValueBigNum, numDWords));
 	}
 
-	outputF = fopen(argv[3], "wb");
+	// The low 3 bits are the offset type and the rest are the number of offset dwords
+	bstate->m_litLengths[seqIndex] = element->m_litLength;
+	bstate->m_matchLengths[seqIndex] = element->m_matchLength;
+	bstate->m_offsetTags[seqIndex] = (uint8_t)(element->m_offsetType | (numDWords << 3));
+	bstate->m_numSequences = seqIndex + 1;
 
-	if (!outputF)
+	if (bstate->m_numSequences == ZSTDASM_BIN_SEQUENCE_CHUNK_SIZE)
+		return FlushBinSequences(bstate);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t WriteBinFrameHeader(DisasmState_t *dstate, const zstdhl_FrameHeaderDesc_t *element)
+{
+	uint8_t flags = 0;
+
+	flags |= (element->m_haveWindowSize ? 1 : 0);
+	flags |= (element->m_haveFrameContentSize ? 2 : 0);
+	flags |= (element->m_haveDictionaryID ? 4 : 0);
+	flags |= (element->m_haveContentChecksum ? 8 : 0);
+	flags |= (element->m_isSingleSegment ? 16 : 0);
+
+	ZSTDASM_CHECKED(WriteByte(dstate, flags));
+	ZSTDASM_CHECKED(WriteVarUInt(dstate, element->m_windowSize));
+	ZSTDASM_CHECKED(WriteVarUInt(dstate, element->m_frameContentSize));
+	ZSTDASM_CHECKED(WriteVarUInt(dstate, element->m_dictionaryID));
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t WriteBinHuffmanTree(DisasmState_t *dstate, const zstdhl_HuffmanTreeDesc_t *element)
+{
+	uint8_t numWeights = element->m_partialWeightDesc.m_numSpecifiedWeights;
+	size_t i = 0;
+
+	ZSTDASM_CHECKED(WriteByte(dstate, (uint8_t)element->m_huffmanWeightFormat));
+	ZSTDASM_CHECKED(WriteByte(dstate, numWeights));
+
+	// Weights are at most 11, so they are packed two per byte
+	for (i = 0; i < numWeights; i += 2)
 	{
-		fprintf(stderr, "Couldn't open input file\n");
-		return -1;
+		uint8_t packed = element->m_partialWeightDesc.m_specifiedWeights[i];
+
+		if (i + 1 < numWeights)
+			packed |= (uint8_t)(element->m_partialWeightDesc.m_specifiedWeights[i + 1] << 4);
+
+		ZSTDASM_CHECKED(WriteByte(dstate, packed));
 	}
 
-	if (asmMode == AsmMode_Disasm)
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t WriteBinElement(BinDisasmState_t *bstate, int elementType, const void *element)
+{
+	DisasmState_t *dstate = bstate->m_out;
+
+	if (elementType < 0 || elementType >= ZSTDASM_BIN_MAX_ELEMENT_TYPES || !g_binElementTypeToTag[elementType].m_isMapped)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	ZSTDASM_CHECKED(WriteByte(dstate, g_binElementTypeToTag[elementType].m_tag));
+
+	switch (elementType)
 	{
-		DisasmState_t disasmState;
+	case ZSTDHL_ELEMENT_TYPE_FRAME_HEADER:
+		return WriteBinFrameHeader(dstate, element);
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER:
+		{
+			const zstdhl_BlockHeaderDesc_t *blockHeader = (const zstdhl_BlockHeaderDesc_t *)element;
 
-		memAllocObj.m_reallocFunc = Realloc;
-		memAllocObj.m_userdata = NULL;
+			ZSTDASM_CHECKED(WriteByte(dstate, (uint8_t)((blockHeader->m_blockType << 1) | (blockHeader->m_isLastBlock ? 1 : 0))));
+			return WriteVarUInt(dstate, blockHeader->m_blockSize);
+		}
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER:
+		{
+			const zstdhl_LiteralsSectionHeader_t *litHeader = (const zstdhl_LiteralsSectionHeader_t *)element;
 
-		disasmState.m_f = outputF;
-		disasmState.m_alloc.m_reallocFunc = memAllocObj.m_reallocFunc;
-		disasmState.m_alloc.m_userdata = memAllocObj.m_userdata;
+			ZSTDASM_CHECKED(WriteByte(dstate, (uint8_t)litHeader->m_sectionType));
+			ZSTDASM_CHECKED(WriteVarUInt(dstate, litHeader->m_regeneratedSize));
+			return WriteVarUInt(dstate, litHeader->m_compressedSize);
+		}
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION:
+		{
+			const zstdhl_LiteralsSectionDesc_t *litSection = (const zstdhl_LiteralsSectionDesc_t *)element;
 
-		zstdhl_Vector_Init(&disasmState.m_bigNumU32Vector, sizeof(uint32_t), &memAllocObj);
-		zstdhl_Vector_Init(&disasmState.m_bigNumDigitVector, sizeof(char), &memAllocObj);
+			ZSTDASM_CHECKED(WriteByte(dstate, (uint8_t)litSection->m_huffmanStreamMode));
+			ZSTDASM_CHECKED(WriteVarUInt(dstate, litSection->m_numValues));
+			return WriteBinStreamData(dstate, litSection->m_numValues, litSection->m_decompressedLiteralsStream);
+		}
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCES_SECTION:
+		{
+			const zstdhl_SequencesSectionDesc_t *seqSection = (const zstdhl_SequencesSectionDesc_t *)element;
 
-		disasmObject.m_userdata = &disasmState;
-		disasmObject.m_reportDisassembledElementFunc = DisassembleElement;
+			ZSTDASM_CHECKED(WriteByte(dstate, (uint8_t)seqSection->m_literalLengthsMode));
+			ZSTDASM_CHECKED(WriteByte(dstate, (uint8_t)seqSection->m_offsetsMode));
+			ZSTDASM_CHECKED(WriteByte(dstate, (uint8_t)seqSection->m_matchLengthsMode));
+			return WriteVarUInt(dstate, seqSection->m_numSequences);
+		}
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA:
+		{
+			const zstdhl_BlockRLEDesc_t *rleDesc = (const zstdhl_BlockRLEDesc_t *)element;
 
-		streamSourceObj.m_readBytesFunc = ReadBytes;
-		streamSourceObj.m_userdata = inputF;
+			ZSTDASM_CHECKED(WriteByte(dstate, rleDesc->m_value));
+			return WriteVarUInt(dstate, rleDesc->m_count);
+		}
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_UNCOMPRESSED_DATA:
+		{
+			const zstdhl_BlockUncompressedDesc_t *uncompressedDesc = (const zstdhl_BlockUncompressedDesc_t *)element;
 
-		memAllocObj.m_reallocFunc = Realloc;
-		memAllocObj.m_userdata = NULL;
+			ZSTDASM_CHECKED(WriteVarUInt(dstate, uncompressedDesc->m_size));
+			return WriteBuffer(dstate, uncompressedDesc->m_data, uncompressedDesc->m_size);
+		}
 
-		result = zstdhl_Disassemble(&streamSourceObj, NULL, &disasmObject, &memAllocObj);
+	case ZSTDHL_ELEMENT_TYPE_FSE_TABLE_START:
+		return WriteByte(dstate, ((const zstdhl_FSETableStartDesc_t *)element)->m_accuracyLog);
+	case ZSTDHL_ELEMENT_TYPE_FSE_PROBABILITY:
+		{
+			const zstdhl_ProbabilityDesc_t *probDesc = (const zstdhl_ProbabilityDesc_t *)element;
 
-		zstdhl_Vector_Destroy(&disasmState.m_bigNumU32Vector);
-		zstdhl_Vector_Destroy(&disasmState.m_bigNumDigitVector);
-	}
+			// Biased by 1 so that the less-than-one probability is stored as 0
+			ZSTDASM_CHECKED(WriteVarUInt(dstate, (uint32_t)(probDesc->m_prob + 1u)));
 
-	if (asmMode == AsmMode_GstdEnc)
-	{
-		gstd_EncoderState_t *encState;
-		zstdhl_EncoderOutputObject_t encOut;
-		GstdEncodeState_t encOutObject;
-		uint8_t maxOffsetCode = gstd_ComputeMaxOffsetExtraBits(128 * 1024);
+			if (probDesc->m_prob == 0)
+				return WriteVarUInt(dstate, probDesc->m_repeatCount);
 
-		memAllocObj.m_reallocFunc = Realloc;
-		memAllocObj.m_userdata = NULL;
+			return ZSTDHL_RESULT_OK;
+		}
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCE_RLE_BYTE:
+		return WriteByte(dstate, *(const uint8_t *)element);
 
-		encOutObject.m_f = outputF;
+	case ZSTDHL_ELEMENT_TYPE_WASTE_BITS:
+		{
+			const zstdhl_WasteBitsDesc_t *wasteBits = (const zstdhl_WasteBitsDesc_t *)element;
 
-		encOut.m_writeBitstreamFunc = WriteBytes;
-		encOut.m_userdata = &encOutObject;
+			ZSTDASM_CHECKED(WriteByte(dstate, wasteBits->m_numBits));
+			return WriteByte(dstate, wasteBits->m_bits);
+		}
+	case ZSTDHL_ELEMENT_TYPE_HUFFMAN_TREE:
+		return WriteBinHuffmanTree(dstate, element);
 
-		result = gstd_Encoder_Create(&encOut, 32, maxOffsetCode, 0, &memAllocObj, &encState);
-		if (result == ZSTDHL_RESULT_OK)
+	case ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM:
 		{
-			streamSourceObj.m_readBytesFunc = ReadBytes;
-			streamSourceObj.m_userdata = inputF;
+			uint32_t checksum = *(const uint32_t *)element;
+			uint8_t checksumBytes[4];
 
-			result = gstd_Encoder_Transcode(encState, &streamSourceObj, NULL, &memAllocObj);
+			checksumBytes[0] = (uint8_t)(checksum & 0xff);
+			checksumBytes[1] = (uint8_t)((checksum >> 8) & 0xff);
+			checksumBytes[2] = (uint8_t)((checksum >> 16) & 0xff);
+			checksumBytes[3] = (uint8_t)((checksum >> 24) & 0xff);
 
-			gstd_Encoder_Destroy(encState);
+			return WriteBuffer(dstate, checksumBytes, 4);
 		}
-	}
 
-	fclose(inputF);
-	fclose(outputF);
+	case ZSTDHL_ELEMENT_TYPE_DICT_START:
+		return WriteVarUInt(dstate, ((const zstdhl_DictHeaderDesc_t *)element)->m_dictID);
+	case ZSTDHL_ELEMENT_TYPE_DICT_RECENT_OFFSETS:
+		{
+			const zstdhl_DictRecentOffsets_t *recentOffsets = (const zstdhl_DictRecentOffsets_t *)element;
+
+			ZSTDASM_CHECKED(WriteVarUInt(dstate, recentOffsets->m_offset1));
+			ZSTDASM_CHECKED(WriteVarUInt(dstate, recentOffsets->m_offset2));
+			return WriteVarUInt(dstate, recentOffsets->m_offset3);
+		}
+
+	case ZSTDHL_ELEMENT_TYPE_FSE_TABLE_END:
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_END:
+	case ZSTDHL_ELEMENT_TYPE_FRAME_END:
+	case ZSTDHL_ELEMENT_TYPE_DICT_END:
+		return ZSTDHL_RESULT_OK;
+
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+}
+
+zstdhl_ResultCode_t DisassembleElementBinary(void *userdata, int elementType, const void *element)
+{
+	BinDisasmState_t *bstate = (BinDisasmState_t *)userdata;
+
+	if (elementType == ZSTDHL_ELEMENT_TYPE_SEQUENCE)
+		return WriteBinSequence(bstate, element);
+
+	ZSTDASM_CHECKED(FlushBinSequences(bstate));
+
+	return WriteBinElement(bstate, elementType, element);
+}
+
+#define ZSTDASM_INPUT_BUFFER_SIZE 65536
+#define ZSTDASM_MAX_LINE_DATA_BYTES (ZSTDASM_INPUT_BUFFER_SIZE / 2)
+
+typedef enum AsmTablePurpose
+{
+	AsmTablePurpose_None,
+	AsmTablePurpose_HuffmanWeights,
+	AsmTablePurpose_LitLength,
+	AsmTablePurpose_Offset,
+	AsmTablePurpose_MatchLength,
+} AsmTablePurpose_t;
+
+typedef struct AsmSequence
+{
+	uint32_t m_litLength;
+	uint32_t m_matchLength;
+	uint32_t m_offsetValue;
+	zstdhl_OffsetType_t m_offsetType;
+} AsmSequence_t;
+
+// Collects elements into block descriptions and assembles them
+typedef struct AssembleState
+{
+	zstdhl_AssemblerContext_t *m_context;
+	const zstdhl_EncoderOutputObject_t *m_output;
+
+	zstdhl_EncBlockDesc_t m_encBlock;
+	AsmTablePurpose_t m_tablePurpose;
+
+	zstdhl_Vector_t m_literalsVector;
+	zstdhl_MemBufferStreamSource_t m_literalsStream;
+	zstdhl_StreamSourceObject_t m_literalsStreamObj;
+
+	zstdhl_Vector_t m_seqVector;
+	size_t m_nextSequence;
+	uint32_t m_seqOffsetValue;
+
+	zstdhl_Vector_t m_litLengthProbsVector;
+	zstdhl_Vector_t m_offsetProbsVector;
+	zstdhl_Vector_t m_matchLengthProbsVector;
+
+	zstdhl_FSETableDef_t m_litLengthTable;
+	zstdhl_FSETableDef_t m_offsetTable;
+	zstdhl_FSETableDef_t m_matchLengthTable;
+
+	zstdhl_Vector_t m_blockDataVector;
+	uint8_t m_rleByte;
+} AssembleState_t;
+
+zstdhl_ResultCode_t AssembleState_GetNextSequence(void *userdata, zstdhl_SequenceDesc_t *sequence)
+{
+	AssembleState_t *state = (AssembleState_t *)userdata;
+	const AsmSequence_t *asmSequence = NULL;
+	uint32_t offsetValue = 0;
+
+	if (state->m_nextSequence == state->m_seqVector.m_count)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	asmSequence = (const AsmSequence_t *)state->m_seqVector.m_data + state->m_nextSequence;
+	state->m_nextSequence++;
+
+	sequence->m_litLength = asmSequence->m_litLength;
+	sequence->m_matchLength = asmSequence->m_matchLength;
+	sequence->m_offsetType = asmSequence->m_offsetType;
+	sequence->m_offsetValueNumBits = 0;
+
+	state->m_seqOffsetValue = asmSequence->m_offsetValue;
+	sequence->m_offsetValueBigNum = &state->m_seqOffsetValue;
+
+	offsetValue = asmSequence->m_offsetValue;
+	while (offsetValue != 0)
+	{
+		sequence->m_offsetValueNumBits++;
+		offsetValue >>= 1;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void AssembleState_Init(AssembleState_t *state, zstdhl_AssemblerContext_t *context, const zstdhl_EncoderOutputObject_t *output, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_EncBlockDesc_t *encBlock = &state->m_encBlock;
+	int i = 0;
+
+	state->m_context = context;
+	state->m_output = output;
+	state->m_tablePurpose = AsmTablePurpose_None;
+	state->m_nextSequence = 0;
+	state->m_seqOffsetValue = 0;
+	state->m_rleByte = 0;
+
+	zstdhl_Vector_Init(&state->m_literalsVector, 1, alloc);
+	zstdhl_Vector_Init(&state->m_seqVector, sizeof(AsmSequence_t), alloc);
+	zstdhl_Vector_Init(&state->m_litLengthProbsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&state->m_offsetProbsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&state->m_matchLengthProbsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&state->m_blockDataVector, 1, alloc);
+
+	zstdhl_MemBufferStreamSource_Init(&state->m_literalsStream, NULL, 0);
+	state->m_literalsStreamObj.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	state->m_literalsStreamObj.m_userdata = &state->m_literalsStream;
+
+	encBlock->m_blockHeader.m_blockType = ZSTDHL_BLOCK_TYPE_RAW;
+	encBlock->m_blockHeader.m_isLastBlock = 0;
+	encBlock->m_blockHeader.m_blockSize = 0;
+
+	encBlock->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+	encBlock->m_litSectionHeader.m_regeneratedSize = 0;
+	encBlock->m_litSectionHeader.m_compressedSize = 0;
+
+	encBlock->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+	for (i = 0; i < 4; i++)
+	{
+		encBlock->m_litSectionDesc.m_huffmanStreamSizes[i] = 0;
+		encBlock->m_autoHuffmanStreamSizesFlags[i] = 1;
+	}
+	encBlock->m_litSectionDesc.m_numValues = 0;
+	encBlock->m_litSectionDesc.m_decompressedLiteralsStream = &state->m_literalsStreamObj;
+
+	encBlock->m_seqSectionDesc.m_numSequences = 0;
+	encBlock->m_seqSectionDesc.m_literalLengthsMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+	encBlock->m_seqSectionDesc.m_offsetsMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+	encBlock->m_seqSectionDesc.m_matchLengthsMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+
+	encBlock->m_huffmanTreeDesc.m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_UNCOMPRESSED;
+	encBlock->m_huffmanTreeDesc.m_weightTable.m_accuracyLog = 0;
+	encBlock->m_huffmanTreeDesc.m_weightTable.m_numProbabilities = 0;
+	encBlock->m_huffmanTreeDesc.m_weightTable.m_probabilities = encBlock->m_huffmanTreeDesc.m_weightTableProbabilities;
+	encBlock->m_huffmanTreeDesc.m_partialWeightDesc.m_numSpecifiedWeights = 0;
+
+	encBlock->m_literalLengthsCompressionDesc.m_fseProbs = &state->m_litLengthTable;
+	encBlock->m_literalLengthsCompressionDesc.m_rleByte = 0;
+	encBlock->m_offsetsModeCompressionDesc.m_fseProbs = &state->m_offsetTable;
+	encBlock->m_offsetsModeCompressionDesc.m_rleByte = 0;
+	encBlock->m_matchLengthsCompressionDesc.m_fseProbs = &state->m_matchLengthTable;
+	encBlock->m_matchLengthsCompressionDesc.m_rleByte = 0;
+
+	encBlock->m_seqCollection.m_getNextSequence = AssembleState_GetNextSequence;
+	encBlock->m_seqCollection.m_userdata = state;
+
+	// Sizes are recomputed so that edited listings stay consistent
+	encBlock->m_autoBlockSizeFlag = 1;
+	encBlock->m_autoLitCompressedSizeFlag = 1;
+	encBlock->m_autoLitRegeneratedSizeFlag = 1;
+	encBlock->m_autoLitSectionModeFlag = 0;
+	encBlock->m_autoSeqCompressionModeFlag = 0;
+
+	encBlock->m_uncompressedOrRLEData = NULL;
+}
+
+void AssembleState_Destroy(AssembleState_t *state)
+{
+	zstdhl_Vector_Destroy(&state->m_literalsVector);
+	zstdhl_Vector_Destroy(&state->m_seqVector);
+	zstdhl_Vector_Destroy(&state->m_litLengthProbsVector);
+	zstdhl_Vector_Destroy(&state->m_offsetProbsVector);
+	zstdhl_Vector_Destroy(&state->m_matchLengthProbsVector);
+	zstdhl_Vector_Destroy(&state->m_blockDataVector);
+}
+
+static AsmTablePurpose_t SelectNextTablePurpose(const zstdhl_SequencesSectionDesc_t *seqSection, AsmTablePurpose_t prevPurpose)
+{
+	switch (prevPurpose)
+	{
+	case AsmTablePurpose_None:
+	case AsmTablePurpose_HuffmanWeights:
+		if (seqSection->m_literalLengthsMode == ZSTDHL_SEQ_COMPRESSION_MODE_RLE || seqSection->m_literalLengthsMode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+			return AsmTablePurpose_LitLength;
+
+		// Fallthrough
+	case AsmTablePurpose_LitLength:
+		if (seqSection->m_offsetsMode == ZSTDHL_SEQ_COMPRESSION_MODE_RLE || seqSection->m_offsetsMode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+			return AsmTablePurpose_Offset;
+
+		// Fallthrough
+	case AsmTablePurpose_Offset:
+		if (seqSection->m_matchLengthsMode == ZSTDHL_SEQ_COMPRESSION_MODE_RLE || seqSection->m_matchLengthsMode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+			return AsmTablePurpose_MatchLength;
+
+		// Fallthrough
+	default:
+		return AsmTablePurpose_None;
+	}
+}
+
+static zstdhl_Vector_t *AssembleState_GetProbsVector(AssembleState_t *state)
+{
+	switch (state->m_tablePurpose)
+	{
+	case AsmTablePurpose_LitLength:
+		return &state->m_litLengthProbsVector;
+	case AsmTablePurpose_Offset:
+		return &state->m_offsetProbsVector;
+	case AsmTablePurpose_MatchLength:
+		return &state->m_matchLengthProbsVector;
+	default:
+		return NULL;
+	}
+}
+
+static zstdhl_FSETableDef_t *AssembleState_GetTableDef(AssembleState_t *state)
+{
+	switch (state->m_tablePurpose)
+	{
+	case AsmTablePurpose_HuffmanWeights:
+		return &state->m_encBlock.m_huffmanTreeDesc.m_weightTable;
+	case AsmTablePurpose_LitLength:
+		return &state->m_litLengthTable;
+	case AsmTablePurpose_Offset:
+		return &state->m_offsetTable;
+	case AsmTablePurpose_MatchLength:
+		return &state->m_matchLengthTable;
+	default:
+		return NULL;
+	}
+}
+
+zstdhl_ResultCode_t AssembleFrameHeader(AssembleState_t *state, const zstdhl_FrameHeaderDesc_t *frameHeader)
+{
+	return zstdhl_AssembleFrameWithContext(state->m_context, frameHeader, state->m_output);
+}
+
+zstdhl_ResultCode_t AssembleBlockHeader(AssembleState_t *state, const zstdhl_BlockHeaderDesc_t *blockHeader)
+{
+	zstdhl_EncBlockDesc_t *encBlock = &state->m_encBlock;
+
+	encBlock->m_blockHeader.m_blockType = blockHeader->m_blockType;
+	encBlock->m_blockHeader.m_isLastBlock = blockHeader->m_isLastBlock;
+	encBlock->m_blockHeader.m_blockSize = blockHeader->m_blockSize;
+
+	encBlock->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+	encBlock->m_litSectionDesc.m_numValues = 0;
+	encBlock->m_huffmanTreeDesc.m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_UNCOMPRESSED;
+	encBlock->m_seqSectionDesc.m_numSequences = 0;
+
+	state->m_tablePurpose = AsmTablePurpose_None;
+
+	zstdhl_Vector_Clear(&state->m_literalsVector);
+	zstdhl_Vector_Clear(&state->m_seqVector);
+	zstdhl_Vector_Clear(&state->m_blockDataVector);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleLiteralsSectionHeader(AssembleState_t *state, const zstdhl_LiteralsSectionHeader_t *litHeader)
+{
+	state->m_encBlock.m_litSectionHeader.m_sectionType = litHeader->m_sectionType;
+	state->m_encBlock.m_litSectionHeader.m_regeneratedSize = litHeader->m_regeneratedSize;
+	state->m_encBlock.m_litSectionHeader.m_compressedSize = litHeader->m_compressedSize;
+
+	state->m_tablePurpose = AsmTablePurpose_HuffmanWeights;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleLiteralsSection(AssembleState_t *state, const zstdhl_LiteralsSectionDesc_t *litSection)
+{
+	zstdhl_EncBlockDesc_t *encBlock = &state->m_encBlock;
+
+	zstdhl_Vector_Clear(&state->m_literalsVector);
+
+	ZSTDASM_CHECKED(zstdhl_Vector_Append(&state->m_literalsVector, NULL, litSection->m_numValues));
+	ZSTDASM_CHECKED(zstdhl_ReadChecked(litSection->m_decompressedLiteralsStream, state->m_literalsVector.m_data, litSection->m_numValues, ZSTDHL_RESULT_INPUT_FAILED));
+
+	encBlock->m_litSectionDesc.m_numValues = litSection->m_numValues;
+	encBlock->m_litSectionDesc.m_huffmanStreamMode = litSection->m_huffmanStreamMode;
+
+	if (encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RAW)
+		encBlock->m_litSectionHeader.m_regeneratedSize = (uint32_t)litSection->m_numValues;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleSequencesSection(AssembleState_t *state, const zstdhl_SequencesSectionDesc_t *seqSection)
+{
+	state->m_encBlock.m_seqSectionDesc = *seqSection;
+	state->m_tablePurpose = SelectNextTablePurpose(seqSection, AsmTablePurpose_None);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleBlockRLEData(AssembleState_t *state, const zstdhl_BlockRLEDesc_t *rleDesc)
+{
+	if (rleDesc->m_count > 0xffffffffu)
+		return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+
+	state->m_rleByte = rleDesc->m_value;
+	state->m_encBlock.m_blockHeader.m_blockSize = (uint32_t)rleDesc->m_count;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleBlockUncompressedData(AssembleState_t *state, const zstdhl_BlockUncompressedDesc_t *uncompressedDesc)
+{
+	return zstdhl_Vector_Append(&state->m_blockDataVector, uncompressedDesc->m_data, uncompressedDesc->m_size);
+}
+
+zstdhl_ResultCode_t AssembleFSETableStart(AssembleState_t *state, const zstdhl_FSETableStartDesc_t *tableStartDesc)
+{
+	zstdhl_FSETableDef_t *tableDef = AssembleState_GetTableDef(state);
+	zstdhl_Vector_t *probsVector = AssembleState_GetProbsVector(state);
+
+	if (!tableDef)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	tableDef->m_accuracyLog = tableStartDesc->m_accuracyLog;
+	tableDef->m_numProbabilities = 0;
+
+	if (probsVector)
+		zstdhl_Vector_Clear(probsVector);
+	else
+		state->m_encBlock.m_huffmanTreeDesc.m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleFSETableProbability(AssembleState_t *state, const zstdhl_ProbabilityDesc_t *probDesc)
+{
+	zstdhl_HuffmanTreeDesc_t *treeDesc = &state->m_encBlock.m_huffmanTreeDesc;
+	zstdhl_Vector_t *probsVector = AssembleState_GetProbsVector(state);
+	size_t i = 0;
+
+	for (i = 0; i <= probDesc->m_repeatCount; i++)
+	{
+		if (probsVector)
+		{
+			ZSTDASM_CHECKED(zstdhl_Vector_Append(probsVector, &probDesc->m_prob, 1));
+		}
+		else if (state->m_tablePurpose == AsmTablePurpose_HuffmanWeights)
+		{
+			if (treeDesc->m_weightTable.m_numProbabilities == 256)
+				return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+			treeDesc->m_weightTableProbabilities[treeDesc->m_weightTable.m_numProbabilities++] = probDesc->m_prob;
+		}
+		else
+			return ZSTDHL_RESULT_INVALID_VALUE;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleFSETableEnd(AssembleState_t *state)
+{
+	zstdhl_FSETableDef_t *tableDef = AssembleState_GetTableDef(state);
+	zstdhl_Vector_t *probsVector = AssembleState_GetProbsVector(state);
+
+	if (!tableDef)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (probsVector)
+	{
+		tableDef->m_probabilities = (const uint32_t *)probsVector->m_data;
+		tableDef->m_numProbabilities = probsVector->m_count;
+		state->m_tablePurpose = SelectNextTablePurpose(&state->m_encBlock.m_seqSectionDesc, state->m_tablePurpose);
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleSequenceRLEByte(AssembleState_t *state, const uint8_t *rleByte)
+{
+	switch (state->m_tablePurpose)
+	{
+	case AsmTablePurpose_LitLength:
+		state->m_encBlock.m_literalLengthsCompressionDesc.m_rleByte = *rleByte;
+		break;
+	case AsmTablePurpose_Offset:
+		state->m_encBlock.m_offsetsModeCompressionDesc.m_rleByte = *rleByte;
+		break;
+	case AsmTablePurpose_MatchLength:
+		state->m_encBlock.m_matchLengthsCompressionDesc.m_rleByte = *rleByte;
+		break;
+	default:
+		return ZSTDHL_RESULT_INVALID_VALUE;
+	}
+
+	state->m_tablePurpose = SelectNextTablePurpose(&state->m_encBlock.m_seqSectionDesc, state->m_tablePurpose);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleHuffmanTree(AssembleState_t *state, const zstdhl_HuffmanTreeDesc_t *treeDesc)
+{
+	zstdhl_HuffmanTreeDesc_t *encTreeDesc = &state->m_encBlock.m_huffmanTreeDesc;
+	size_t i = 0;
+
+	encTreeDesc->m_partialWeightDesc.m_numSpecifiedWeights = treeDesc->m_partialWeightDesc.m_numSpecifiedWeights;
+
+	for (i = 0; i < treeDesc->m_partialWeightDesc.m_numSpecifiedWeights; i++)
+		encTreeDesc->m_partialWeightDesc.m_specifiedWeights[i] = treeDesc->m_partialWeightDesc.m_specifiedWeights[i];
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleSequence(AssembleState_t *state, const zstdhl_SequenceDesc_t *seqDesc)
+{
+	AsmSequence_t sequence;
+
+	sequence.m_litLength = seqDesc->m_litLength;
+	sequence.m_matchLength = seqDesc->m_matchLength;
+	sequence.m_offsetType = seqDesc->m_offsetType;
+	sequence.m_offsetValue = 0;
+
+	if (seqDesc->m_offsetType == ZSTDHL_OFFSET_TYPE_SPECIFIED)
+	{
+		if (seqDesc->m_offsetValueNumBits > 32)
+			return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
+
+		if (seqDesc->m_offsetValueNumBits > 0)
+			sequence.m_offsetValue = seqDesc->m_offsetValueBigNum[0];
+	}
+
+	return zstdhl_Vector_Append(&state->m_seqVector, &sequence, 1);
+}
+
+zstdhl_ResultCode_t AssembleBlockEnd(AssembleState_t *state)
+{
+	zstdhl_EncBlockDesc_t *encBlock = &state->m_encBlock;
+
+	switch (encBlock->m_blockHeader.m_blockType)
+	{
+	case ZSTDHL_BLOCK_TYPE_RAW:
+		if (state->m_blockDataVector.m_count > 0xffffffffu)
+			return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+
+		encBlock->m_uncompressedOrRLEData = state->m_blockDataVector.m_data;
+		encBlock->m_blockHeader.m_blockSize = (uint32_t)state->m_blockDataVector.m_count;
+		break;
+	case ZSTDHL_BLOCK_TYPE_RLE:
+		encBlock->m_uncompressedOrRLEData = &state->m_rleByte;
+		break;
+	case ZSTDHL_BLOCK_TYPE_COMPRESSED:
+		if (state->m_seqVector.m_count > 0xffffffffu)
+			return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+
+		encBlock->m_seqSectionDesc.m_numSequences = (uint32_t)state->m_seqVector.m_count;
+
+		// Listings written without a stream count use single-stream mode for small literals sections
+		if (encBlock->m_litSectionDesc.m_huffmanStreamMode == ZSTDHL_HUFFMAN_STREAM_MODE_NONE)
+		{
+			if (encBlock->m_litSectionDesc.m_numValues < 256)
+				encBlock->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_1_STREAM;
+			else
+				encBlock->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_4_STREAMS;
+		}
+		break;
+	default:
+		return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
+	}
+
+	zstdhl_MemBufferStreamSource_Init(&state->m_literalsStream, state->m_literalsVector.m_data, state->m_literalsVector.m_count);
+	state->m_nextSequence = 0;
+
+	return zstdhl_AssembleBlockWithContext(state->m_context, encBlock, state->m_output);
+}
+
+zstdhl_ResultCode_t AssembleElement(void *userdata, int elementType, const void *element)
+{
+	AssembleState_t *state = (AssembleState_t *)userdata;
+
+	switch (elementType)
+	{
+	case ZSTDHL_ELEMENT_TYPE_FRAME_HEADER:
+		return AssembleFrameHeader(state, element);
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER:
+		return AssembleBlockHeader(state, element);
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER:
+		return AssembleLiteralsSectionHeader(state, element);
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION:
+		return AssembleLiteralsSection(state, element);
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCES_SECTION:
+		return AssembleSequencesSection(state, element);
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA:
+		return AssembleBlockRLEData(state, element);
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_UNCOMPRESSED_DATA:
+		return AssembleBlockUncompressedData(state, element);
+
+	case ZSTDHL_ELEMENT_TYPE_FSE_TABLE_START:
+		return AssembleFSETableStart(state, element);
+	case ZSTDHL_ELEMENT_TYPE_FSE_TABLE_END:
+		return AssembleFSETableEnd(state);
+	case ZSTDHL_ELEMENT_TYPE_FSE_PROBABILITY:
+		return AssembleFSETableProbability(state, element);
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCE_RLE_BYTE:
+		return AssembleSequenceRLEByte(state, element);
+
+	case ZSTDHL_ELEMENT_TYPE_WASTE_BITS:
+		// Padding bits are always written as zero
+		return ZSTDHL_RESULT_OK;
+	case ZSTDHL_ELEMENT_TYPE_HUFFMAN_TREE:
+		return AssembleHuffmanTree(state, element);
+
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCE:
+		return AssembleSequence(state, element);
+
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_END:
+		return AssembleBlockEnd(state);
+
+	case ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM:
+		// The checksum is recomputed from the assembled content
+		return ZSTDHL_RESULT_OK;
+
+	case ZSTDHL_ELEMENT_TYPE_FRAME_END:
+		return zstdhl_AssembleFrameEndWithContext(state->m_context, state->m_output);
+
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+typedef enum AsmParseContext
+{
+	AsmParseContext_Top,
+	AsmParseContext_LiteralValues,
+	AsmParseContext_BlockData,
+	AsmParseContext_BlockRLEData,
+	AsmParseContext_FSETable,
+	AsmParseContext_HuffmanTable,
+} AsmParseContext_t;
+
+// Parses the text format written by DisassembleElement back into elements.  Lines are parsed in place
+// in the input buffer or file mapping, so nothing is allocated per line.
+typedef struct AsmParseState
+{
+	FILE *m_f;
+	const char *m_data;
+	char m_buffer[ZSTDASM_INPUT_BUFFER_SIZE];
+	size_t m_bufferStart;
+	size_t m_bufferEnd;
+	uint8_t m_isEOF;
+	size_t m_lineNumber;
+
+	const zstdhl_DisassemblyOutputObject_t *m_output;
+
+	AsmParseContext_t m_context;
+	uint8_t m_lineBytes[ZSTDASM_MAX_LINE_DATA_BYTES];
+
+	zstdhl_BlockHeaderDesc_t m_blockHeader;
+	zstdhl_LiteralsSectionHeader_t m_litSectionHeader;
+	zstdhl_LiteralsSectionDesc_t m_litSectionDesc;
+	zstdhl_Vector_t m_literalsVector;
+	uint8_t m_haveRLEData;
+
+	zstdhl_HuffmanTreeDesc_t m_huffmanTreeDesc;
+	uint8_t m_haveHuffmanTerminal;
+	uint8_t m_haveWeightTable;
+
+	// Sequence table modes in the order that their descriptions appear, and the next one expected
+	zstdhl_SequencesCompressionMode_t m_seqTableModes[3];
+	uint8_t m_nextSeqTable;
+} AsmParseState_t;
+
+typedef struct AsmToken
+{
+	const char *m_chars;
+	size_t m_length;
+} AsmToken_t;
+
+typedef struct AsmLineTokenizer
+{
+	const char *m_pos;
+	const char *m_end;
+} AsmLineTokenizer_t;
+
+// Returns 0 at the end of the line or at the start of a comment
+static int NextToken(AsmLineTokenizer_t *tokenizer, AsmToken_t *outToken)
+{
+	const char *pos = tokenizer->m_pos;
+	const char *end = tokenizer->m_end;
+	const char *tokenStart = NULL;
+
+	while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+		pos++;
+
+	if (pos == end || *pos == ';')
+	{
+		tokenizer->m_pos = pos;
+		return 0;
+	}
+
+	tokenStart = pos;
+
+	if (*pos == '\'')
+	{
+		// Quoted character, which may contain spaces or semicolons
+		pos++;
+		while (pos != end && *pos != '\'')
+		{
+			if (*pos == '\\' && pos + 1 != end)
+				pos++;
+			pos++;
+		}
+
+		if (pos != end)
+			pos++;
+	}
+	else
+	{
+		while (pos != end && *pos != ' ' && *pos != '\t' && *pos != '\r')
+			pos++;
+	}
+
+	outToken->m_chars = tokenStart;
+	outToken->m_length = (size_t)(pos - tokenStart);
+	tokenizer->m_pos = pos;
+
+	return 1;
+}
+
+static int TokenIs(const AsmToken_t *token, const char *str)
+{
+	size_t i = 0;
+
+	for (i = 0; i < token->m_length; i++)
+	{
+		if (str[i] != token->m_chars[i])
+			return 0;
+	}
+
+	return str[i] == '\0';
+}
+
+static zstdhl_ResultCode_t ExpectToken(AsmLineTokenizer_t *tokenizer, AsmToken_t *outToken)
+{
+	if (!NextToken(tokenizer, outToken))
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t ExpectKeyword(AsmLineTokenizer_t *tokenizer, const char *keyword)
+{
+	AsmToken_t token;
+
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+
+	if (!TokenIs(&token, keyword))
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t ExpectEndOfLine(AsmLineTokenizer_t *tokenizer)
+{
+	AsmToken_t token;
+
+	if (NextToken(tokenizer, &token))
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t ParseUInt(const AsmToken_t *token, uint64_t maxValue, uint64_t *outValue)
+{
+	uint64_t value = 0;
+	size_t i = 0;
+
+	if (token->m_length == 0)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	for (i = 0; i < token->m_length; i++)
+	{
+		char c = token->m_chars[i];
+		uint64_t digit = 0;
+
+		if (c < '0' || c > '9')
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		digit = (uint64_t)(c - '0');
+
+		if (value > (maxValue - digit) / 10u)
+			return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+
+		value = value * 10u + digit;
+	}
+
+	*outValue = value;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t ExpectU64(AsmLineTokenizer_t *tokenizer, uint64_t *outValue)
+{
+	AsmToken_t token;
+
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+
+	return ParseUInt(&token, 0xffffffffffffffffu, outValue);
+}
+
+static zstdhl_ResultCode_t ExpectU32(AsmLineTokenizer_t *tokenizer, uint32_t *outValue)
+{
+	AsmToken_t token;
+	uint64_t value = 0;
+
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+	ZSTDASM_CHECKED(ParseUInt(&token, 0xffffffffu, &value));
+
+	*outValue = (uint32_t)value;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static int HexDigitValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+// Parses a character in the form written by WriteChar
+static zstdhl_ResultCode_t ParseChar(const char *chars, size_t length, uint8_t *outChar)
+{
+	if (length == 1 && chars[0] != '\\')
+	{
+		*outChar = (uint8_t)chars[0];
+		return ZSTDHL_RESULT_OK;
+	}
+
+	if (length == 2 && chars[0] == '\\' && (chars[1] == '\\' || chars[1] == '\"' || chars[1] == '\''))
+	{
+		*outChar = (uint8_t)chars[1];
+		return ZSTDHL_RESULT_OK;
+	}
+
+	if (length == 4 && chars[0] == '\\' && chars[1] == 'x')
+	{
+		int highNibble = HexDigitValue(chars[2]);
+		int lowNibble = HexDigitValue(chars[3]);
+
+		if (highNibble < 0 || lowNibble < 0)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		*outChar = (uint8_t)((highNibble << 4) | lowNibble);
+		return ZSTDHL_RESULT_OK;
+	}
+
+	return ZSTDHL_RESULT_INVALID_VALUE;
+}
+
+static zstdhl_ResultCode_t ParseQuotedChar(const AsmToken_t *token, uint8_t *outChar)
+{
+	if (token->m_length < 3 || token->m_chars[0] != '\'' || token->m_chars[token->m_length - 1] != '\'')
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	return ParseChar(token->m_chars + 1, token->m_length - 2, outChar);
+}
+
+// Parses a line of hex bytes, ignoring the trailing comment
+static zstdhl_ResultCode_t ParseDataLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer, size_t *outNumBytes)
+{
+	AsmToken_t token;
+	size_t numBytes = 0;
+
+	while (NextToken(tokenizer, &token))
+	{
+		int highNibble = 0;
+		int lowNibble = 0;
+
+		if (token.m_length != 2 || numBytes == ZSTDASM_MAX_LINE_DATA_BYTES)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		highNibble = HexDigitValue(token.m_chars[0]);
+		lowNibble = HexDigitValue(token.m_chars[1]);
+
+		if (highNibble < 0 || lowNibble < 0)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		pstate->m_lineBytes[numBytes++] = (uint8_t)((highNibble << 4) | lowNibble);
+	}
+
+	*outNumBytes = numBytes;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t ReportElement(AsmParseState_t *pstate, int elementType, const void *element)
+{
+	return pstate->m_output->m_reportDisassembledElementFunc(pstate->m_output->m_userdata, elementType, element);
+}
+
+static void AdvanceSeqTable(AsmParseState_t *pstate)
+{
+	while (pstate->m_nextSeqTable < 3)
+	{
+		zstdhl_SequencesCompressionMode_t mode = pstate->m_seqTableModes[pstate->m_nextSeqTable];
+
+		if (mode == ZSTDHL_SEQ_COMPRESSION_MODE_RLE || mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+			break;
+
+		pstate->m_nextSeqTable++;
+	}
+}
+
+static zstdhl_ResultCode_t ParseSeqCompressionMode(AsmLineTokenizer_t *tokenizer, const char *keyword, zstdhl_SequencesCompressionMode_t *outMode)
+{
+	AsmToken_t token;
+
+	ZSTDASM_CHECKED(ExpectKeyword(tokenizer, keyword));
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+
+	if (TokenIs(&token, "fse"))
+		*outMode = ZSTDHL_SEQ_COMPRESSION_MODE_FSE;
+	else if (TokenIs(&token, "rle"))
+		*outMode = ZSTDHL_SEQ_COMPRESSION_MODE_RLE;
+	else if (TokenIs(&token, "predef"))
+		*outMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+	else if (TokenIs(&token, "reuse"))
+		*outMode = ZSTDHL_SEQ_COMPRESSION_MODE_REUSE;
+	else
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t ParseFrameHeaderLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	AsmToken_t token;
+
+	frameHeader.m_windowSize = 0;
+	frameHeader.m_frameContentSize = 0;
+	frameHeader.m_dictionaryID = 0;
+	frameHeader.m_haveDictionaryID = 0;
+	frameHeader.m_haveContentChecksum = 0;
+	frameHeader.m_haveFrameContentSize = 0;
+	frameHeader.m_haveWindowSize = 0;
+	frameHeader.m_isSingleSegment = 0;
+
+	while (NextToken(tokenizer, &token))
+	{
+		if (TokenIs(&token, "windowSize"))
+		{
+			ZSTDASM_CHECKED(ExpectU64(tokenizer, &frameHeader.m_windowSize));
+			frameHeader.m_haveWindowSize = 1;
+		}
+		else if (TokenIs(&token, "frameContentSize"))
+		{
+			ZSTDASM_CHECKED(ExpectU64(tokenizer, &frameHeader.m_frameContentSize));
+			frameHeader.m_haveFrameContentSize = 1;
+		}
+		else if (TokenIs(&token, "dictionaryID"))
+		{
+			ZSTDASM_CHECKED(ExpectU32(tokenizer, &frameHeader.m_dictionaryID));
+			frameHeader.m_haveDictionaryID = 1;
+		}
+		else if (TokenIs(&token, "checksum"))
+			frameHeader.m_haveContentChecksum = 1;
+		else if (TokenIs(&token, "singleSegment"))
+			frameHeader.m_isSingleSegment = 1;
+		else
+			return ZSTDHL_RESULT_INVALID_VALUE;
+	}
+
+	// The window size of a single-segment frame is the content size and isn't encoded
+	if (frameHeader.m_isSingleSegment)
+		frameHeader.m_haveWindowSize = 0;
+
+	return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_FRAME_HEADER, &frameHeader);
+}
+
+static zstdhl_ResultCode_t ParseBlockHeaderLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	zstdhl_BlockHeaderDesc_t *blockHeader = &pstate->m_blockHeader;
+	AsmToken_t token;
+
+	blockHeader->m_isLastBlock = 0;
+	blockHeader->m_blockType = ZSTDHL_BLOCK_TYPE_INVALID;
+	blockHeader->m_blockSize = 0;
+
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+
+	if (TokenIs(&token, "last"))
+	{
+		blockHeader->m_isLastBlock = 1;
+		ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+	}
+
+	if (TokenIs(&token, "raw"))
+	{
+		blockHeader->m_blockType = ZSTDHL_BLOCK_TYPE_RAW;
+		pstate->m_context = AsmParseContext_BlockData;
+	}
+	else if (TokenIs(&token, "rle"))
+	{
+		blockHeader->m_blockType = ZSTDHL_BLOCK_TYPE_RLE;
+		pstate->m_context = AsmParseContext_BlockRLEData;
+		pstate->m_haveRLEData = 0;
+	}
+	else if (TokenIs(&token, "compressed"))
+		blockHeader->m_blockType = ZSTDHL_BLOCK_TYPE_COMPRESSED;
+	else
+		return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
+
+	ZSTDASM_CHECKED(ExpectKeyword(tokenizer, "size"));
+	ZSTDASM_CHECKED(ExpectU32(tokenizer, &blockHeader->m_blockSize));
+	ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+	pstate->m_nextSeqTable = 3;
+	pstate->m_haveWeightTable = 0;
+
+	return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER, blockHeader);
+}
+
+static zstdhl_ResultCode_t ParseLiteralsHeaderLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	zstdhl_LiteralsSectionHeader_t *litHeader = &pstate->m_litSectionHeader;
+	AsmToken_t token;
+
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+
+	if (TokenIs(&token, "huffman"))
+		litHeader->m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN;
+	else if (TokenIs(&token, "huffmanReuse"))
+		litHeader->m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE;
+	else if (TokenIs(&token, "raw"))
+		litHeader->m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+	else if (TokenIs(&token, "rle"))
+		litHeader->m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RLE;
+	else
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	ZSTDASM_CHECKED(ExpectKeyword(tokenizer, "regeneratedSize"));
+	ZSTDASM_CHECKED(ExpectU32(tokenizer, &litHeader->m_regeneratedSize));
+
+	litHeader->m_compressedSize = 0;
+	if (NextToken(tokenizer, &token))
+	{
+		if (!TokenIs(&token, "compressedSize"))
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		ZSTDASM_CHECKED(ExpectU32(tokenizer, &litHeader->m_compressedSize));
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+	}
+
+	pstate->m_haveWeightTable = 0;
+
+	return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER, litHeader);
+}
+
+static zstdhl_ResultCode_t ParseLiteralValuesLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	zstdhl_LiteralsSectionDesc_t *litSection = &pstate->m_litSectionDesc;
+	AsmToken_t token;
+
+	litSection->m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+
+	if (NextToken(tokenizer, &token))
+	{
+		uint32_t numStreams = 0;
+
+		if (!TokenIs(&token, "streams"))
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		ZSTDASM_CHECKED(ExpectU32(tokenizer, &numStreams));
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		if (numStreams == 1)
+			litSection->m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_1_STREAM;
+		else if (numStreams == 4)
+			litSection->m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_4_STREAMS;
+		else
+			return ZSTDHL_RESULT_HUFFMAN_STREAM_MODE_INVALID;
+	}
+
+	zstdhl_Vector_Clear(&pstate->m_literalsVector);
+	pstate->m_context = AsmParseContext_LiteralValues;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t ParseSequencesLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	zstdhl_SequencesSectionDesc_t seqSection;
+
+	ZSTDASM_CHECKED(ParseSeqCompressionMode(tokenizer, "litLengthMode", &seqSection.m_literalLengthsMode));
+	ZSTDASM_CHECKED(ParseSeqCompressionMode(tokenizer, "matchLengthMode", &seqSection.m_matchLengthsMode));
+	ZSTDASM_CHECKED(ParseSeqCompressionMode(tokenizer, "offsetsMode", &seqSection.m_offsetsMode));
+	ZSTDASM_CHECKED(ExpectKeyword(tokenizer, "numSequences"));
+	ZSTDASM_CHECKED(ExpectU32(tokenizer, &seqSection.m_numSequences));
+	ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+	// Table descriptions are in literal length, offset, match length order
+	pstate->m_seqTableModes[0] = seqSection.m_literalLengthsMode;
+	pstate->m_seqTableModes[1] = seqSection.m_offsetsMode;
+	pstate->m_seqTableModes[2] = seqSection.m_matchLengthsMode;
+	pstate->m_nextSeqTable = 0;
+
+	AdvanceSeqTable(pstate);
+
+	return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_SEQUENCES_SECTION, &seqSection);
+}
+
+static zstdhl_ResultCode_t ParseSequenceLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	zstdhl_SequenceDesc_t seq;
+	AsmToken_t token;
+	uint32_t offsetValue = 0;
+
+	ZSTDASM_CHECKED(ExpectU32(tokenizer, &seq.m_litLength));
+	ZSTDASM_CHECKED(ExpectKeyword(tokenizer, "offs"));
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+
+	seq.m_offsetValueBigNum = &offsetValue;
+	seq.m_offsetValueNumBits = 0;
+
+	if (TokenIs(&token, "rep1"))
+		seq.m_offsetType = ZSTDHL_OFFSET_TYPE_REPEAT_1;
+	else if (TokenIs(&token, "rep1minus1"))
+		seq.m_offsetType = ZSTDHL_OFFSET_TYPE_REPEAT_1_MINUS_1;
+	else if (TokenIs(&token, "rep2"))
+		seq.m_offsetType = ZSTDHL_OFFSET_TYPE_REPEAT_2;
+	else if (TokenIs(&token, "rep3"))
+		seq.m_offsetType = ZSTDHL_OFFSET_TYPE_REPEAT_3;
+	else
+	{
+		uint64_t value = 0;
+
+		ZSTDASM_CHECKED(ParseUInt(&token, 0xffffffffu, &value));
+
+		offsetValue = (uint32_t)value;
+		seq.m_offsetType = ZSTDHL_OFFSET_TYPE_SPECIFIED;
+
+		while (value != 0)
+		{
+			seq.m_offsetValueNumBits++;
+			value >>= 1;
+		}
+	}
+
+	ZSTDASM_CHECKED(ExpectKeyword(tokenizer, "match"));
+	ZSTDASM_CHECKED(ExpectU32(tokenizer, &seq.m_matchLength));
+	ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+	return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_SEQUENCE, &seq);
+}
+
+static zstdhl_ResultCode_t ParseFSETableLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer, const AsmToken_t *firstToken)
+{
+	zstdhl_ProbabilityDesc_t probDesc;
+	uint64_t value = 0;
+	AsmToken_t token;
+
+	if (TokenIs(firstToken, "fseTableEnd"))
+	{
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		pstate->m_context = AsmParseContext_Top;
+
+		if (pstate->m_nextSeqTable < 3)
+		{
+			pstate->m_nextSeqTable++;
+			AdvanceSeqTable(pstate);
+		}
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_FSE_TABLE_END, NULL);
+	}
+
+	if (TokenIs(firstToken, "wasteBits"))
+	{
+		zstdhl_WasteBitsDesc_t wasteBits;
+		uint32_t numBits = 0;
+		uint32_t bits = 0;
+
+		ZSTDASM_CHECKED(ExpectU32(tokenizer, &numBits));
+		ZSTDASM_CHECKED(ExpectKeyword(tokenizer, "value"));
+		ZSTDASM_CHECKED(ExpectU32(tokenizer, &bits));
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		if (numBits > 8 || bits > 255)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		wasteBits.m_numBits = (uint8_t)numBits;
+		wasteBits.m_bits = (uint8_t)bits;
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_WASTE_BITS, &wasteBits);
+	}
+
+	ZSTDASM_CHECKED(ParseUInt(firstToken, 0xffffffffu, &value));
+
+	probDesc.m_prob = (uint32_t)value;
+	probDesc.m_repeatCount = 0;
+
+	if (NextToken(tokenizer, &token))
+	{
+		if (probDesc.m_prob != 0 || !TokenIs(&token, "repeat"))
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		ZSTDASM_CHECKED(ExpectU64(tokenizer, &value));
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		if (value > 0xffffu)
+			return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+		probDesc.m_repeatCount = (size_t)value;
+	}
+
+	return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_FSE_PROBABILITY, &probDesc);
+}
+
+static zstdhl_ResultCode_t ParseHuffmanTableLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer, const AsmToken_t *firstToken)
+{
+	zstdhl_HuffmanTreePartialWeightDesc_t *weightDesc = &pstate->m_huffmanTreeDesc.m_partialWeightDesc;
+	AsmToken_t token;
+	uint8_t symbol = 0;
+
+	if (TokenIs(firstToken, "huffmanTableEnd"))
+	{
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		if (!pstate->m_haveHuffmanTerminal)
+			return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+
+		pstate->m_context = AsmParseContext_Top;
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_HUFFMAN_TREE, &pstate->m_huffmanTreeDesc);
+	}
+
+	if (pstate->m_haveHuffmanTerminal)
+		return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+
+	ZSTDASM_CHECKED(ParseQuotedChar(firstToken, &symbol));
+	ZSTDASM_CHECKED(ExpectToken(tokenizer, &token));
+
+	if (TokenIs(&token, "terminal"))
+	{
+		weightDesc->m_numSpecifiedWeights = symbol;
+		pstate->m_haveHuffmanTerminal = 1;
+	}
+	else
+	{
+		uint64_t weight = 0;
+
+		ZSTDASM_CHECKED(ParseUInt(&token, ZSTDHL_MAX_HUFFMAN_WEIGHT, &weight));
+
+		if (symbol == 255)
+			return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+
+		weightDesc->m_specifiedWeights[symbol] = (uint8_t)weight;
+	}
+
+	return ExpectEndOfLine(tokenizer);
+}
+
+static zstdhl_ResultCode_t ParseDataContextLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	AsmLineTokenizer_t lookahead = *tokenizer;
+	AsmToken_t token;
+	size_t numBytes = 0;
+
+	if (!NextToken(&lookahead, &token))
+		return ZSTDHL_RESULT_OK;
+
+	if (pstate->m_context == AsmParseContext_LiteralValues && TokenIs(&token, "endLiteralValues"))
+	{
+		zstdhl_LiteralsSectionDesc_t *litSection = &pstate->m_litSectionDesc;
+		zstdhl_MemBufferStreamSource_t litStream;
+		zstdhl_StreamSourceObject_t litStreamObj;
+
+		ZSTDASM_CHECKED(ExpectEndOfLine(&lookahead));
+
+		zstdhl_MemBufferStreamSource_Init(&litStream, pstate->m_literalsVector.m_data, pstate->m_literalsVector.m_count);
+		litStreamObj.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+		litStreamObj.m_userdata = &litStream;
+
+		litSection->m_numValues = pstate->m_literalsVector.m_count;
+		litSection->m_decompressedLiteralsStream = &litStreamObj;
+
+		pstate->m_context = AsmParseContext_Top;
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION, litSection);
+	}
+
+	if (pstate->m_context != AsmParseContext_LiteralValues && TokenIs(&token, "blockEnd"))
+	{
+		ZSTDASM_CHECKED(ExpectEndOfLine(&lookahead));
+
+		if (pstate->m_context == AsmParseContext_BlockRLEData && !pstate->m_haveRLEData)
+			return ZSTDHL_RESULT_BLOCK_TRUNCATED;
+
+		pstate->m_context = AsmParseContext_Top;
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_BLOCK_END, NULL);
+	}
+
+	ZSTDASM_CHECKED(ParseDataLine(pstate, tokenizer, &numBytes));
+
+	switch (pstate->m_context)
+	{
+	case AsmParseContext_LiteralValues:
+		return zstdhl_Vector_Append(&pstate->m_literalsVector, pstate->m_lineBytes, numBytes);
+	case AsmParseContext_BlockData:
+		{
+			zstdhl_BlockUncompressedDesc_t uncompressedDesc;
+
+			uncompressedDesc.m_data = pstate->m_lineBytes;
+			uncompressedDesc.m_size = numBytes;
+
+			return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_BLOCK_UNCOMPRESSED_DATA, &uncompressedDesc);
+		}
+	case AsmParseContext_BlockRLEData:
+		{
+			zstdhl_BlockRLEDesc_t rleDesc;
+
+			if (pstate->m_haveRLEData || numBytes != 1)
+				return ZSTDHL_RESULT_INVALID_VALUE;
+
+			rleDesc.m_value = pstate->m_lineBytes[0];
+			rleDesc.m_count = pstate->m_blockHeader.m_blockSize;
+			pstate->m_haveRLEData = 1;
+
+			return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA, &rleDesc);
+		}
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+}
+
+static zstdhl_ResultCode_t ParseTopLevelLine(AsmParseState_t *pstate, AsmLineTokenizer_t *tokenizer)
+{
+	AsmToken_t token;
+
+	// Sequence RLE bytes are written unquoted, so the whole line is the character
+	if (pstate->m_nextSeqTable < 3 && pstate->m_seqTableModes[pstate->m_nextSeqTable] == ZSTDHL_SEQ_COMPRESSION_MODE_RLE)
+	{
+		const char *lineEnd = tokenizer->m_end;
+		uint8_t rleByte = 0;
+
+		if (lineEnd != tokenizer->m_pos && lineEnd[-1] == '\r')
+			lineEnd--;
+
+		ZSTDASM_CHECKED(ParseChar(tokenizer->m_pos, (size_t)(lineEnd - tokenizer->m_pos), &rleByte));
+
+		pstate->m_nextSeqTable++;
+		AdvanceSeqTable(pstate);
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_SEQUENCE_RLE_BYTE, &rleByte);
+	}
+
+	if (!NextToken(tokenizer, &token))
+		return ZSTDHL_RESULT_OK;
+
+	if (TokenIs(&token, "lit"))
+		return ParseSequenceLine(pstate, tokenizer);
+
+	if (TokenIs(&token, "blockHeader"))
+		return ParseBlockHeaderLine(pstate, tokenizer);
+
+	if (TokenIs(&token, "literals"))
+		return ParseLiteralsHeaderLine(pstate, tokenizer);
+
+	if (TokenIs(&token, "literalValues"))
+		return ParseLiteralValuesLine(pstate, tokenizer);
+
+	if (TokenIs(&token, "sequences"))
+		return ParseSequencesLine(pstate, tokenizer);
+
+	if (TokenIs(&token, "fseTableStart"))
+	{
+		zstdhl_FSETableStartDesc_t tableStart;
+		uint32_t accuracyLog = 0;
+
+		ZSTDASM_CHECKED(ExpectKeyword(tokenizer, "accuracyLog"));
+		ZSTDASM_CHECKED(ExpectU32(tokenizer, &accuracyLog));
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		if (accuracyLog > 255)
+			return ZSTDHL_RESULT_ACCURACY_LOG_TOO_LARGE;
+
+		tableStart.m_accuracyLog = (uint8_t)accuracyLog;
+
+		if (pstate->m_nextSeqTable == 3)
+			pstate->m_haveWeightTable = 1;
+
+		pstate->m_context = AsmParseContext_FSETable;
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_FSE_TABLE_START, &tableStart);
+	}
+
+	if (TokenIs(&token, "huffmanTableStart"))
+	{
+		zstdhl_HuffmanTreeDesc_t *treeDesc = &pstate->m_huffmanTreeDesc;
+		size_t i = 0;
+
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		for (i = 0; i < sizeof(treeDesc->m_partialWeightDesc.m_specifiedWeights); i++)
+			treeDesc->m_partialWeightDesc.m_specifiedWeights[i] = 0;
+
+		treeDesc->m_partialWeightDesc.m_numSpecifiedWeights = 0;
+		treeDesc->m_huffmanWeightFormat = pstate->m_haveWeightTable ? ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE : ZSTDHL_HUFFMAN_WEIGHT_ENCODING_UNCOMPRESSED;
+
+		pstate->m_haveHuffmanTerminal = 0;
+		pstate->m_context = AsmParseContext_HuffmanTable;
+
+		return ZSTDHL_RESULT_OK;
+	}
+
+	if (TokenIs(&token, "wasteBits"))
+		return ParseFSETableLine(pstate, tokenizer, &token);
+
+	if (TokenIs(&token, "blockEnd"))
+	{
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_BLOCK_END, NULL);
+	}
+
+	if (TokenIs(&token, "frameHeader"))
+		return ParseFrameHeaderLine(pstate, tokenizer);
+
+	if (TokenIs(&token, "contentChecksum"))
+	{
+		uint32_t checksum = 0;
+
+		ZSTDASM_CHECKED(ExpectU32(tokenizer, &checksum));
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM, &checksum);
+	}
+
+	if (TokenIs(&token, "frameEnd"))
+	{
+		ZSTDASM_CHECKED(ExpectEndOfLine(tokenizer));
+		return ReportElement(pstate, ZSTDHL_ELEMENT_TYPE_FRAME_END, NULL);
+	}
+
+	return ZSTDHL_RESULT_INVALID_VALUE;
+}
+
+static zstdhl_ResultCode_t ParseLine(AsmParseState_t *pstate, const char *line, size_t lineLength)
+{
+	AsmLineTokenizer_t tokenizer;
+	AsmLineTokenizer_t lookahead;
+	AsmToken_t token;
+
+	tokenizer.m_pos = line;
+	tokenizer.m_end = line + lineLength;
+
+	switch (pstate->m_context)
+	{
+	case AsmParseContext_Top:
+		return ParseTopLevelLine(pstate, &tokenizer);
+	case AsmParseContext_LiteralValues:
+	case AsmParseContext_BlockData:
+	case AsmParseContext_BlockRLEData:
+		return ParseDataContextLine(pstate, &tokenizer);
+	case AsmParseContext_FSETable:
+	case AsmParseContext_HuffmanTable:
+		lookahead = tokenizer;
+		if (!NextToken(&lookahead, &token))
+			return ZSTDHL_RESULT_OK;
+
+		if (pstate->m_context == AsmParseContext_FSETable)
+			return ParseFSETableLine(pstate, &lookahead, &token);
+		else
+			return ParseHuffmanTableLine(pstate, &lookahead, &token);
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+}
+
+// Finds the next line in the input buffer, refilling it as needed
+static zstdhl_ResultCode_t ReadLine(AsmParseState_t *pstate, const char **outLine, size_t *outLineLength, uint8_t *outEOF)
+{
+	for (;;)
+	{
+		const char *lineStart = pstate->m_data + pstate->m_bufferStart;
+		size_t available = pstate->m_bufferEnd - pstate->m_bufferStart;
+		const char *newline = (const char *)memchr(lineStart, '\n', available);
+		size_t numRead = 0;
+
+		if (newline)
+		{
+			*outLine = lineStart;
+			*outLineLength = (size_t)(newline - lineStart);
+			*outEOF = 0;
+			pstate->m_bufferStart += *outLineLength + 1;
+			return ZSTDHL_RESULT_OK;
+		}
+
+		if (pstate->m_isEOF)
+		{
+			*outLine = lineStart;
+			*outLineLength = available;
+			*outEOF = (available == 0);
+			pstate->m_bufferStart = pstate->m_bufferEnd;
+			return ZSTDHL_RESULT_OK;
+		}
+
+		if (available == sizeof(pstate->m_buffer))
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		memmove(pstate->m_buffer, lineStart, available);
+		pstate->m_bufferStart = 0;
+		pstate->m_bufferEnd = available;
+
+		numRead = fread(pstate->m_buffer + available, 1, sizeof(pstate->m_buffer) - available, pstate->m_f);
+		pstate->m_bufferEnd += numRead;
+
+		if (numRead == 0)
+		{
+			if (ferror(pstate->m_f))
+				return ZSTDHL_RESULT_INPUT_FAILED;
+
+			pstate->m_isEOF = 1;
+		}
+	}
+}
+
+zstdhl_ResultCode_t ParseAsmText(AsmParseState_t *pstate)
+{
+	for (;;)
+	{
+		const char *line = NULL;
+		size_t lineLength = 0;
+		uint8_t isEOF = 0;
+
+		ZSTDASM_CHECKED(ReadLine(pstate, &line, &lineLength, &isEOF));
+
+		if (isEOF)
+			break;
+
+		pstate->m_lineNumber++;
+
+		ZSTDASM_CHECKED(ParseLine(pstate, line, lineLength));
+	}
+
+	if (pstate->m_context != AsmParseContext_Top)
+		return ZSTDHL_RESULT_BLOCK_TRUNCATED;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t AssembleText(const InputFile_t *inputFile, const zstdhl_EncoderOutputObject_t *encOut, const zstdhl_MemoryAllocatorObject_t *alloc, size_t *outLineNumber)
+{
+	AsmParseState_t *pstate = NULL;
+	AssembleState_t asmState;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_DisassemblyOutputObject_t asmOutputObj;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	*outLineNumber = 0;
+
+	pstate = (AsmParseState_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(AsmParseState_t));
+	if (!pstate)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	result = zstdhl_CreateAssemblerContext(alloc, &context);
+	if (result != ZSTDHL_RESULT_OK)
+	{
+		alloc->m_reallocFunc(alloc->m_userdata, pstate, 0);
+		return result;
+	}
+
+	AssembleState_Init(&asmState, context, encOut, alloc);
+
+	asmOutputObj.m_reportDisassembledElementFunc = AssembleElement;
+	asmOutputObj.m_userdata = &asmState;
+
+	pstate->m_f = inputFile->m_f;
+	pstate->m_data = pstate->m_buffer;
+	pstate->m_bufferStart = 0;
+	pstate->m_bufferEnd = 0;
+	pstate->m_isEOF = 0;
+
+	if (!inputFile->m_f)
+	{
+		pstate->m_data = (const char *)inputFile->m_mappedData;
+		pstate->m_bufferEnd = inputFile->m_mappedSize;
+		pstate->m_isEOF = 1;
+	}
+	pstate->m_lineNumber = 0;
+	pstate->m_output = &asmOutputObj;
+	pstate->m_context = AsmParseContext_Top;
+	pstate->m_haveRLEData = 0;
+	pstate->m_haveHuffmanTerminal = 0;
+	pstate->m_haveWeightTable = 0;
+	pstate->m_nextSeqTable = 3;
+
+	zstdhl_Vector_Init(&pstate->m_literalsVector, 1, alloc);
+
+	result = ParseAsmText(pstate);
+
+	*outLineNumber = pstate->m_lineNumber;
+
+	zstdhl_Vector_Destroy(&pstate->m_literalsVector);
+	AssembleState_Destroy(&asmState);
+	zstdhl_DestroyAssemblerContext(context);
+	alloc->m_reallocFunc(alloc->m_userdata, pstate, 0);
+
+	return result;
+}
+
+// Reads the binary element stream and replays it into a disassembly output object
+typedef struct BinReplayState
+{
+	FILE *m_f;
+	const uint8_t *m_data;
+	uint8_t m_buffer[ZSTDASM_INPUT_BUFFER_SIZE];
+	size_t m_bufferStart;
+	size_t m_bufferEnd;
+
+	const zstdhl_DisassemblyOutputObject_t *m_output;
+
+	zstdhl_Vector_t m_dataVector;
+	zstdhl_Vector_t m_litLengthsVector;
+	zstdhl_Vector_t m_matchLengthsVector;
+	zstdhl_Vector_t m_offsetTagsVector;
+	zstdhl_Vector_t m_offsetDWordsVector;
+
+	zstdhl_HuffmanTreeDesc_t m_huffmanTreeDesc;
+} BinReplayState_t;
+
+// Ensures that at least minBytes are buffered.  Fails with ZSTDHL_RESULT_INPUT_FAILED if the stream ends first.
+static zstdhl_ResultCode_t BinReplay_FillBuffer(BinReplayState_t *rstate, size_t minBytes)
+{
+	size_t available = rstate->m_bufferEnd - rstate->m_bufferStart;
+
+	while (available < minBytes)
+	{
+		size_t numRead = 0;
+
+		if (!rstate->m_f)
+			return ZSTDHL_RESULT_INPUT_FAILED;
+
+		if (rstate->m_bufferStart > 0)
+		{
+			memmove(rstate->m_buffer, rstate->m_buffer + rstate->m_bufferStart, available);
+			rstate->m_bufferStart = 0;
+			rstate->m_bufferEnd = available;
+		}
+
+		numRead = fread(rstate->m_buffer + available, 1, sizeof(rstate->m_buffer) - available, rstate->m_f);
+		if (numRead == 0)
+			return ZSTDHL_RESULT_INPUT_FAILED;
+
+		rstate->m_bufferEnd += numRead;
+		available += numRead;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t BinReplay_ReadByte(BinReplayState_t *rstate, uint8_t *outByte)
+{
+	if (rstate->m_bufferStart == rstate->m_bufferEnd)
+		ZSTDASM_CHECKED(BinReplay_FillBuffer(rstate, 1));
+
+	*outByte = rstate->m_data[rstate->m_bufferStart++];
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t BinReplay_ReadVarUInt(BinReplayState_t *rstate, uint64_t maxValue, uint64_t *outValue)
+{
+	uint64_t value = 0;
+	uint8_t shift = 0;
+
+	for (;;)
+	{
+		uint8_t b = 0;
+
+		ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &b));
+
+		if (shift == 63 && (b & 0x7eu) != 0)
+			return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+
+		value |= ((uint64_t)(b & 0x7fu)) << shift;
+
+		if ((b & 0x80u) == 0)
+			break;
+
+		shift += 7;
+		if (shift > 63)
+			return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+	}
+
+	if (value > maxValue)
+		return ZSTDHL_RESULT_INTEGER_OVERFLOW;
+
+	*outValue = value;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t BinReplay_ReadU32(BinReplayState_t *rstate, uint32_t *outValue)
+{
+	uint64_t value = 0;
+
+	ZSTDASM_CHECKED(BinReplay_ReadVarUInt(rstate, 0xffffffffu, &value));
+
+	*outValue = (uint32_t)value;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t BinReplay_ReadSize(BinReplayState_t *rstate, size_t *outValue)
+{
+	uint64_t value = 0;
+
+	ZSTDASM_CHECKED(BinReplay_ReadVarUInt(rstate, (size_t)-1, &value));
+
+	*outValue = (size_t)value;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Reads a blob, which points into the file mapping if there is one or is copied into the data vector otherwise
+static zstdhl_ResultCode_t BinReplay_ReadData(BinReplayState_t *rstate, size_t numBytes, const uint8_t **outData)
+{
+	size_t available = rstate->m_bufferEnd - rstate->m_bufferStart;
+	uint8_t *dest = NULL;
+
+	if (!rstate->m_f)
+	{
+		if (available < numBytes)
+			return ZSTDHL_RESULT_INPUT_FAILED;
+
+		*outData = rstate->m_data + rstate->m_bufferStart;
+		rstate->m_bufferStart += numBytes;
+
+		return ZSTDHL_RESULT_OK;
+	}
+
+	zstdhl_Vector_Clear(&rstate->m_dataVector);
+	ZSTDASM_CHECKED(zstdhl_Vector_Append(&rstate->m_dataVector, NULL, numBytes));
+
+	dest = (uint8_t *)rstate->m_dataVector.m_data;
+
+	if (available > numBytes)
+		available = numBytes;
+
+	memcpy(dest, rstate->m_buffer + rstate->m_bufferStart, available);
+	rstate->m_bufferStart += available;
+
+	if (available < numBytes)
+	{
+		if (fread(dest + available, 1, numBytes - available, rstate->m_f) != numBytes - available)
+			return ZSTDHL_RESULT_INPUT_FAILED;
+	}
+
+	*outData = dest;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t BinReplay_Report(BinReplayState_t *rstate, int elementType, const void *element)
+{
+	return rstate->m_output->m_reportDisassembledElementFunc(rstate->m_output->m_userdata, elementType, element);
+}
+
+static zstdhl_ResultCode_t BinReplay_ReadSequences(BinReplayState_t *rstate)
+{
+	size_t numSequences = 0;
+	size_t numOffsetDWords = 0;
+	uint32_t *litLengths = NULL;
+	uint32_t *matchLengths = NULL;
+	uint8_t *offsetTags = NULL;
+	uint32_t *offsetDWords = NULL;
+	size_t i = 0;
+
+	ZSTDASM_CHECKED(BinReplay_ReadSize(rstate, &numSequences));
+
+	if (numSequences == 0 || numSequences > ZSTDASM_BIN_SEQUENCE_CHUNK_SIZE)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	zstdhl_Vector_Clear(&rstate->m_litLengthsVector);
+	zstdhl_Vector_Clear(&rstate->m_matchLengthsVector);
+	zstdhl_Vector_Clear(&rstate->m_offsetTagsVector);
+	zstdhl_Vector_Clear(&rstate->m_offsetDWordsVector);
+
+	ZSTDASM_CHECKED(zstdhl_Vector_Append(&rstate->m_litLengthsVector, NULL, numSequences));
+	ZSTDASM_CHECKED(zstdhl_Vector_Append(&rstate->m_matchLengthsVector, NULL, numSequences));
+	ZSTDASM_CHECKED(zstdhl_Vector_Append(&rstate->m_offsetTagsVector, NULL, numSequences));
+
+	litLengths = (uint32_t *)rstate->m_litLengthsVector.m_data;
+	matchLengths = (uint32_t *)rstate->m_matchLengthsVector.m_data;
+	offsetTags = (uint8_t *)rstate->m_offsetTagsVector.m_data;
+
+	for (i = 0; i < numSequences; i++)
+		ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, litLengths + i));
+
+	for (i = 0; i < numSequences; i++)
+		ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, matchLengths + i));
+
+	for (i = 0; i < numSequences; i++)
+	{
+		uint8_t tag = 0;
+
+		ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &tag));
+
+		if ((tag & 7) > ZSTDHL_OFFSET_TYPE_SPECIFIED || ((tag & 7) == ZSTDHL_OFFSET_TYPE_SPECIFIED) != ((tag >> 3) != 0))
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		offsetTags[i] = tag;
+		numOffsetDWords += (tag >> 3);
+	}
+
+	ZSTDASM_CHECKED(zstdhl_Vector_Append(&rstate->m_offsetDWordsVector, NULL, numOffsetDWords));
+	offsetDWords = (uint32_t *)rstate->m_offsetDWordsVector.m_data;
+
+	for (i = 0; i < numOffsetDWords; i++)
+		ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, offsetDWords + i));
+
+	for (i = 0; i < numSequences; i++)
+	{
+		zstdhl_SequenceDesc_t seq;
+		size_t numDWords = (offsetTags[i] >> 3);
+
+		seq.m_litLength = litLengths[i];
+		seq.m_matchLength = matchLengths[i];
+		seq.m_offsetType = (zstdhl_OffsetType_t)(offsetTags[i] & 7);
+		seq.m_offsetValueBigNum = offsetDWords;
+		seq.m_offsetValueNumBits = 0;
+
+		if (numDWords > 0)
+		{
+			uint32_t highDWord = offsetDWords[numDWords - 1];
+
+			seq.m_offsetValueNumBits = (numDWords - 1) * 32u;
+			while (highDWord != 0)
+			{
+				seq.m_offsetValueNumBits++;
+				highDWord >>= 1;
+			}
+		}
+
+		offsetDWords += numDWords;
+
+		ZSTDASM_CHECKED(BinReplay_Report(rstate, ZSTDHL_ELEMENT_TYPE_SEQUENCE, &seq));
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t BinReplay_ReadElement(BinReplayState_t *rstate, int elementType)
+{
+	switch (elementType)
+	{
+	case ZSTDHL_ELEMENT_TYPE_FRAME_HEADER:
+		{
+			zstdhl_FrameHeaderDesc_t frameHeader;
+			uint8_t flags = 0;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &flags));
+			ZSTDASM_CHECKED(BinReplay_ReadVarUInt(rstate, 0xffffffffffffffffu, &frameHeader.m_windowSize));
+			ZSTDASM_CHECKED(BinReplay_ReadVarUInt(rstate, 0xffffffffffffffffu, &frameHeader.m_frameContentSize));
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &frameHeader.m_dictionaryID));
+
+			frameHeader.m_haveWindowSize = (flags & 1);
+			frameHeader.m_haveFrameContentSize = ((flags >> 1) & 1);
+			frameHeader.m_haveDictionaryID = ((flags >> 2) & 1);
+			frameHeader.m_haveContentChecksum = ((flags >> 3) & 1);
+			frameHeader.m_isSingleSegment = ((flags >> 4) & 1);
+
+			return BinReplay_Report(rstate, elementType, &frameHeader);
+		}
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER:
+		{
+			zstdhl_BlockHeaderDesc_t blockHeader;
+			uint8_t flags = 0;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &flags));
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &blockHeader.m_blockSize));
+
+			if ((flags >> 1) >= ZSTDHL_BLOCK_TYPE_INVALID)
+				return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
+
+			blockHeader.m_isLastBlock = (flags & 1);
+			blockHeader.m_blockType = (zstdhl_BlockType_t)(flags >> 1);
+
+			return BinReplay_Report(rstate, elementType, &blockHeader);
+		}
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER:
+		{
+			zstdhl_LiteralsSectionHeader_t litHeader;
+			uint8_t sectionType = 0;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &sectionType));
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &litHeader.m_regeneratedSize));
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &litHeader.m_compressedSize));
+
+			if (sectionType > ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE)
+				return ZSTDHL_RESULT_INVALID_VALUE;
+
+			litHeader.m_sectionType = (zstdhl_LiteralsSectionType_t)sectionType;
+
+			return BinReplay_Report(rstate, elementType, &litHeader);
+		}
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION:
+		{
+			zstdhl_LiteralsSectionDesc_t litSection;
+			zstdhl_MemBufferStreamSource_t litStream;
+			zstdhl_StreamSourceObject_t litStreamObj;
+			const uint8_t *litData = NULL;
+			uint8_t streamMode = 0;
+			size_t i = 0;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &streamMode));
+			ZSTDASM_CHECKED(BinReplay_ReadSize(rstate, &litSection.m_numValues));
+			ZSTDASM_CHECKED(BinReplay_ReadData(rstate, litSection.m_numValues, &litData));
+
+			if (streamMode > ZSTDHL_HUFFMAN_STREAM_MODE_4_STREAMS)
+				return ZSTDHL_RESULT_HUFFMAN_STREAM_MODE_INVALID;
+
+			zstdhl_MemBufferStreamSource_Init(&litStream, litData, litSection.m_numValues);
+			litStreamObj.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+			litStreamObj.m_userdata = &litStream;
+
+			litSection.m_huffmanStreamMode = (zstdhl_HuffmanStreamMode_t)streamMode;
+			for (i = 0; i < 4; i++)
+				litSection.m_huffmanStreamSizes[i] = 0;
+			litSection.m_decompressedLiteralsStream = &litStreamObj;
+
+			return BinReplay_Report(rstate, elementType, &litSection);
+		}
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCES_SECTION:
+		{
+			zstdhl_SequencesSectionDesc_t seqSection;
+			uint8_t modes[3];
+			int i = 0;
+
+			for (i = 0; i < 3; i++)
+			{
+				ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &modes[i]));
+
+				if (modes[i] >= ZSTDHL_SEQ_COMPRESSION_MODE_INVALID)
+					return ZSTDHL_RESULT_INVALID_VALUE;
+			}
+
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &seqSection.m_numSequences));
+
+			seqSection.m_literalLengthsMode = (zstdhl_SequencesCompressionMode_t)modes[0];
+			seqSection.m_offsetsMode = (zstdhl_SequencesCompressionMode_t)modes[1];
+			seqSection.m_matchLengthsMode = (zstdhl_SequencesCompressionMode_t)modes[2];
+
+			return BinReplay_Report(rstate, elementType, &seqSection);
+		}
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA:
+		{
+			zstdhl_BlockRLEDesc_t rleDesc;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &rleDesc.m_value));
+			ZSTDASM_CHECKED(BinReplay_ReadSize(rstate, &rleDesc.m_count));
+
+			return BinReplay_Report(rstate, elementType, &rleDesc);
+		}
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_UNCOMPRESSED_DATA:
+		{
+			zstdhl_BlockUncompressedDesc_t uncompressedDesc;
+			const uint8_t *blockData = NULL;
+
+			ZSTDASM_CHECKED(BinReplay_ReadSize(rstate, &uncompressedDesc.m_size));
+			ZSTDASM_CHECKED(BinReplay_ReadData(rstate, uncompressedDesc.m_size, &blockData));
+
+			uncompressedDesc.m_data = blockData;
+
+			return BinReplay_Report(rstate, elementType, &uncompressedDesc);
+		}
+
+	case ZSTDHL_ELEMENT_TYPE_FSE_TABLE_START:
+		{
+			zstdhl_FSETableStartDesc_t tableStart;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &tableStart.m_accuracyLog));
+
+			return BinReplay_Report(rstate, elementType, &tableStart);
+		}
+	case ZSTDHL_ELEMENT_TYPE_FSE_PROBABILITY:
+		{
+			zstdhl_ProbabilityDesc_t probDesc;
+			uint32_t biasedProb = 0;
+
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &biasedProb));
+
+			probDesc.m_prob = biasedProb - 1u;
+			probDesc.m_repeatCount = 0;
+
+			if (probDesc.m_prob == 0)
+				ZSTDASM_CHECKED(BinReplay_ReadSize(rstate, &probDesc.m_repeatCount));
+
+			return BinReplay_Report(rstate, elementType, &probDesc);
+		}
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCE_RLE_BYTE:
+		{
+			uint8_t rleByte = 0;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &rleByte));
+
+			return BinReplay_Report(rstate, elementType, &rleByte);
+		}
+
+	case ZSTDHL_ELEMENT_TYPE_WASTE_BITS:
+		{
+			zstdhl_WasteBitsDesc_t wasteBits;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &wasteBits.m_numBits));
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &wasteBits.m_bits));
+
+			return BinReplay_Report(rstate, elementType, &wasteBits);
+		}
+	case ZSTDHL_ELEMENT_TYPE_HUFFMAN_TREE:
+		{
+			zstdhl_HuffmanTreeDesc_t *treeDesc = &rstate->m_huffmanTreeDesc;
+			uint8_t weightFormat = 0;
+			uint8_t numWeights = 0;
+			size_t i = 0;
+
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &weightFormat));
+			ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &numWeights));
+
+			for (i = 0; i < sizeof(treeDesc->m_partialWeightDesc.m_specifiedWeights); i++)
+				treeDesc->m_partialWeightDesc.m_specifiedWeights[i] = 0;
+
+			for (i = 0; i < numWeights; i += 2)
+			{
+				uint8_t packed = 0;
+
+				ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &packed));
+
+				treeDesc->m_partialWeightDesc.m_specifiedWeights[i] = (packed & 0xf);
+				if (i + 1 < numWeights)
+					treeDesc->m_partialWeightDesc.m_specifiedWeights[i + 1] = (packed >> 4);
+			}
+
+			treeDesc->m_huffmanWeightFormat = (zstdhl_HuffmanWeightEncoding_t)weightFormat;
+			treeDesc->m_weightTable.m_accuracyLog = 0;
+			treeDesc->m_weightTable.m_numProbabilities = 0;
+			treeDesc->m_weightTable.m_probabilities = treeDesc->m_weightTableProbabilities;
+			treeDesc->m_partialWeightDesc.m_numSpecifiedWeights = numWeights;
+
+			return BinReplay_Report(rstate, elementType, treeDesc);
+		}
+
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCE:
+		return BinReplay_ReadSequences(rstate);
+
+	case ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM:
+		{
+			uint8_t checksumBytes[4];
+			uint32_t checksum = 0;
+			int i = 0;
+
+			for (i = 0; i < 4; i++)
+				ZSTDASM_CHECKED(BinReplay_ReadByte(rstate, &checksumBytes[i]));
+
+			checksum = checksumBytes[0] | (checksumBytes[1] << 8) | (checksumBytes[2] << 16) | ((uint32_t)checksumBytes[3] << 24);
+
+			return BinReplay_Report(rstate, elementType, &checksum);
+		}
+
+	case ZSTDHL_ELEMENT_TYPE_DICT_START:
+		{
+			zstdhl_DictHeaderDesc_t dictHeader;
+
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &dictHeader.m_dictID));
+
+			return BinReplay_Report(rstate, elementType, &dictHeader);
+		}
+	case ZSTDHL_ELEMENT_TYPE_DICT_RECENT_OFFSETS:
+		{
+			zstdhl_DictRecentOffsets_t recentOffsets;
+
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &recentOffsets.m_offset1));
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &recentOffsets.m_offset2));
+			ZSTDASM_CHECKED(BinReplay_ReadU32(rstate, &recentOffsets.m_offset3));
+
+			return BinReplay_Report(rstate, elementType, &recentOffsets);
+		}
+
+	case ZSTDHL_ELEMENT_TYPE_FSE_TABLE_END:
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_END:
+	case ZSTDHL_ELEMENT_TYPE_FRAME_END:
+	case ZSTDHL_ELEMENT_TYPE_DICT_END:
+		return BinReplay_Report(rstate, elementType, NULL);
+
+	default:
+		return ZSTDHL_RESULT_INVALID_VALUE;
+	}
+}
+
+zstdhl_ResultCode_t ReplayBinary(const InputFile_t *inputFile, const zstdhl_DisassemblyOutputObject_t *output, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	BinReplayState_t *rstate = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	rstate = (BinReplayState_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(BinReplayState_t));
+	if (!rstate)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	rstate->m_f = inputFile->m_f;
+	rstate->m_data = rstate->m_buffer;
+	rstate->m_bufferStart = 0;
+	rstate->m_bufferEnd = 0;
+
+	if (!inputFile->m_f)
+	{
+		rstate->m_data = inputFile->m_mappedData;
+		rstate->m_bufferEnd = inputFile->m_mappedSize;
+	}
+	rstate->m_output = output;
+
+	zstdhl_Vector_Init(&rstate->m_dataVector, 1, alloc);
+	zstdhl_Vector_Init(&rstate->m_litLengthsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&rstate->m_matchLengthsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&rstate->m_offsetTagsVector, 1, alloc);
+	zstdhl_Vector_Init(&rstate->m_offsetDWordsVector, sizeof(uint32_t), alloc);
+
+	result = BinReplay_FillBuffer(rstate, 5);
+
+	if (result == ZSTDHL_RESULT_OK)
+	{
+		if (memcmp(rstate->m_data, ZSTDASM_BIN_MAGIC, 4) || rstate->m_data[4] != ZSTDASM_BIN_VERSION)
+			result = ZSTDHL_RESULT_MAGIC_NUMBER_MISMATCH;
+
+		rstate->m_bufferStart = 5;
+	}
+
+	while (result == ZSTDHL_RESULT_OK)
+	{
+		uint8_t tag = 0;
+
+		if (rstate->m_bufferStart == rstate->m_bufferEnd && BinReplay_FillBuffer(rstate, 1) != ZSTDHL_RESULT_OK)
+			break;
+
+		tag = rstate->m_data[rstate->m_bufferStart++];
+
+		if (tag >= BinElementTag_Count)
+		{
+			result = ZSTDHL_RESULT_INVALID_VALUE;
+			break;
+		}
+
+		result = BinReplay_ReadElement(rstate, g_binTagToElementType[tag]);
+	}
+
+	if (result == ZSTDHL_RESULT_OK && inputFile->m_f && ferror(inputFile->m_f))
+		result = ZSTDHL_RESULT_INPUT_FAILED;
+
+	zstdhl_Vector_Destroy(&rstate->m_dataVector);
+	zstdhl_Vector_Destroy(&rstate->m_litLengthsVector);
+	zstdhl_Vector_Destroy(&rstate->m_matchLengthsVector);
+	zstdhl_Vector_Destroy(&rstate->m_offsetTagsVector);
+	zstdhl_Vector_Destroy(&rstate->m_offsetDWordsVector);
+
+	alloc->m_reallocFunc(alloc->m_userdata, rstate, 0);
+
+	return result;
+}
+
+zstdhl_ResultCode_t AssembleBinary(const InputFile_t *inputFile, const zstdhl_EncoderOutputObject_t *encOut, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	AssembleState_t asmState;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_DisassemblyOutputObject_t asmOutputObj;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	ZSTDASM_CHECKED(zstdhl_CreateAssemblerContext(alloc, &context));
+
+	AssembleState_Init(&asmState, context, encOut, alloc);
+
+	asmOutputObj.m_reportDisassembledElementFunc = AssembleElement;
+	asmOutputObj.m_userdata = &asmState;
+
+	result = ReplayBinary(inputFile, &asmOutputObj, alloc);
+
+	AssembleState_Destroy(&asmState);
+	zstdhl_DestroyAssemblerContext(context);
+
+	return result;
+}
+
+static void PrintAllocStatsLine(const char *name, const zstdhl_AllocStats_t *stats)
+{
+	fprintf(stderr, "%-12s %12llu %12llu %12llu %16llu %16llu\n", name,
+		(unsigned long long)stats->m_numAllocs, (unsigned long long)stats->m_numReallocs, (unsigned long long)stats->m_numFrees,
+		(unsigned long long)stats->m_allocatedBytes, (unsigned long long)stats->m_peakBytes);
+}
+
+static void PrintAllocStats(zstdhl_AllocTracker_t *tracker)
+{
+	static const char *siteNames[ZSTDHL_ALLOC_SITE_COUNT] =
+	{
+		"other",
+		"vector",
+		"buffers",
+		"gstd_lanes",
+	};
+
+	zstdhl_AllocStats_t totalStats;
+	zstdhl_AllocStats_t siteStats[ZSTDHL_ALLOC_SITE_COUNT];
+	int i = 0;
+
+	zstdhl_AllocTracker_GetStats(tracker, &totalStats, siteStats);
+
+	fprintf(stderr, "%-12s %12s %12s %12s %16s %16s\n", "site", "allocs", "reallocs", "frees", "allocatedBytes", "peakBytes");
+
+	for (i = 0; i < ZSTDHL_ALLOC_SITE_COUNT; i++)
+		PrintAllocStatsLine(siteNames[i], &siteStats[i]);
+
+	PrintAllocStatsLine("total", &totalStats);
+}
+
+int main(int argc, const char **argv)
+{
+	const char *modeStr = NULL;
+	AsmMode_t asmMode = AsmMode_Invalid;
+	InputFile_t inputFile;
+	FILE *outputF = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	zstdhl_DisassemblyOutputObject_t disasmObject;
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSourceObj;
+	zstdhl_MemoryAllocatorObject_t memAllocObj;
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	const char *positionalArgs[3];
+	int numPositionalArgs = 0;
+	int reportStats = 0;
+	uint32_t disasmFlags = 0;
+	int i = 0;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--stats"))
+			reportStats = 1;
+		else if (!strcmp(argv[i], "--verify-checksum"))
+			disasmFlags |= ZSTDHL_DISASSEMBLE_FLAG_VERIFY_CHECKSUM;
+		else
+		{
+			if (numPositionalArgs == 3)
+			{
+				numPositionalArgs++;
+				break;
+			}
+
+			positionalArgs[numPositionalArgs++] = argv[i];
+		}
+	}
+
+	if (numPositionalArgs != 3)
+	{
+		fprintf(stderr, "Usage: zstdasm [--stats] [--verify-checksum] <mode> <input> <output>\n");
+		fprintf(stderr, "Commands:\n");
+		fprintf(stderr, "    asm - Converts text input into Zstd stream\n");
+		fprintf(stderr, "    disasm - Converts Zstd stream into text input\n");
+		fprintf(stderr, "    gstdenc - Converts Zstd stream into Gstd stream\n");
+		fprintf(stderr, "    bindisasm - Converts Zstd stream into binary element stream\n");
+		fprintf(stderr, "    binasm - Converts binary element stream into Zstd stream\n");
+		fprintf(stderr, "    bintotext - Converts binary element stream into text input\n");
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "    --stats - Reports memory allocation statistics on completion\n");
+		fprintf(stderr, "    --verify-checksum - Fails disassembly if a frame's content checksum doesn't match\n");
+		return -1;
+	}
+
+	modeStr = positionalArgs[0];
+
+	if (!strcmp(modeStr, "asm"))
+		asmMode = AsmMode_Asm;
+	else if (!strcmp(modeStr, "disasm"))
+		asmMode = AsmMode_Disasm;
+	else if (!strcmp(modeStr, "gstdenc"))
+		asmMode = AsmMode_GstdEnc;
+	else if (!strcmp(modeStr, "bindisasm"))
+		asmMode = AsmMode_BinDisasm;
+	else if (!strcmp(modeStr, "binasm"))
+		asmMode = AsmMode_BinAsm;
+	else if (!strcmp(modeStr, "bintotext"))
+		asmMode = AsmMode_BinToText;
+	else
+	{
+		fprintf(stderr, "Invalid mode\n");
+		return -1;
+	}
+
+
+	if (!OpenInputFile(&inputFile, positionalArgs[1]))
+	{
+		fprintf(stderr, "Couldn't open input file\n");
+		return -1;
+	}
+
+	outputF = fopen(positionalArgs[2], "wb");
+
+	if (!outputF)
+	{
+		fprintf(stderr, "Couldn't open input file\n");
+		return -1;
+	}
+
+	setvbuf(outputF, NULL, _IOFBF, ZSTDASM_OUTPUT_BUFFER_SIZE);
+
+	InputFile_InitStreamSource(&inputFile, &memSource, &streamSourceObj);
+
+	memAllocObj.m_reallocFunc = Realloc;
+	memAllocObj.m_userdata = NULL;
+
+	if (reportStats)
+	{
+		result = zstdhl_AllocTracker_Create(&memAllocObj, &allocTracker);
+		if (result != ZSTDHL_RESULT_OK)
+		{
+			fprintf(stderr, "Couldn't create allocation tracker\n");
+			return -1;
+		}
+
+		zstdhl_AllocTracker_GetAllocator(allocTracker, &memAllocObj);
+	}
+
+	if (asmMode == AsmMode_Asm)
+	{
+		zstdhl_EncoderOutputObject_t encOut;
+		GstdEncodeState_t encOutObject;
+		size_t lineNumber = 0;
+
+		encOutObject.m_f = outputF;
+
+		encOut.m_writeBitstreamFunc = WriteBytes;
+		encOut.m_userdata = &encOutObject;
+
+		result = AssembleText(&inputFile, &encOut, &memAllocObj, &lineNumber);
+
+		if (result != ZSTDHL_RESULT_OK)
+			fprintf(stderr, "Assembly failed on line %llu\n", (unsigned long long)lineNumber);
+	}
+
+	if (asmMode == AsmMode_BinAsm)
+	{
+		zstdhl_EncoderOutputObject_t encOut;
+		GstdEncodeState_t encOutObject;
+
+		encOutObject.m_f = outputF;
+
+		encOut.m_writeBitstreamFunc = WriteBytes;
+		encOut.m_userdata = &encOutObject;
+
+		result = AssembleBinary(&inputFile, &encOut, &memAllocObj);
+	}
+
+	if (asmMode == AsmMode_Disasm || asmMode == AsmMode_BinDisasm || asmMode == AsmMode_BinToText)
+	{
+		DisasmState_t disasmState;
+		BinDisasmState_t *binState = NULL;
+
+		disasmState.m_f = outputF;
+		disasmState.m_alloc.m_reallocFunc = memAllocObj.m_reallocFunc;
+		disasmState.m_alloc.m_userdata = memAllocObj.m_userdata;
+
+		zstdhl_Vector_Init(&disasmState.m_bigNumU32Vector, sizeof(uint32_t), &memAllocObj);
+		zstdhl_Vector_Init(&disasmState.m_bigNumDigitVector, sizeof(char), &memAllocObj);
+
+		disasmState.m_outBuffer = (char *)Realloc(NULL, NULL, ZSTDASM_OUTPUT_BUFFER_SIZE);
+		disasmState.m_outBufferUsed = 0;
+
+		disasmObject.m_userdata = &disasmState;
+		disasmObject.m_reportDisassembledElementFunc = DisassembleElement;
+
+		if (asmMode == AsmMode_BinDisasm)
+		{
+			binState = (BinDisasmState_t *)Realloc(NULL, NULL, sizeof(BinDisasmState_t));
+
+			if (binState)
+			{
+				binState->m_out = &disasmState;
+				binState->m_numSequences = 0;
+				zstdhl_Vector_Init(&binState->m_offsetDWords, sizeof(uint32_t), &memAllocObj);
+
+				disasmObject.m_userdata = binState;
+				disasmObject.m_reportDisassembledElementFunc = DisassembleElementBinary;
+			}
+		}
+
+		if (!disasmState.m_outBuffer || (asmMode == AsmMode_BinDisasm && !binState))
+			result = ZSTDHL_RESULT_OUT_OF_MEMORY;
+		else
+		{
+			if (asmMode == AsmMode_BinToText)
+				result = ReplayBinary(&inputFile, &disasmObject, &memAllocObj);
+			else if (asmMode == AsmMode_BinDisasm)
+			{
+				uint8_t binHeader[5] = { ZSTDASM_BIN_MAGIC[0], ZSTDASM_BIN_MAGIC[1], ZSTDASM_BIN_MAGIC[2], ZSTDASM_BIN_MAGIC[3], ZSTDASM_BIN_VERSION };
+
+				result = WriteBuffer(&disasmState, binHeader, sizeof(binHeader));
+
+				if (result == ZSTDHL_RESULT_OK)
+					result = zstdhl_DisassembleWithOptions(&streamSourceObj, NULL, NULL, disasmFlags, NULL, NULL, &disasmObject, &memAllocObj);
+
+				if (result == ZSTDHL_RESULT_OK)
+					result = FlushBinSequences(binState);
+			}
+			else
+				result = zstdhl_DisassembleWithOptions(&streamSourceObj, NULL, NULL, disasmFlags, NULL, NULL, &disasmObject, &memAllocObj);
+
+			if (result == ZSTDHL_RESULT_OK)
+				result = FlushOutput(&disasmState);
+			else
+				FlushOutput(&disasmState);
+		}
+
+		if (binState)
+		{
+			zstdhl_Vector_Destroy(&binState->m_offsetDWords);
+			Realloc(NULL, binState, 0);
+		}
+
+		Realloc(NULL, disasmState.m_outBuffer, 0);
+
+		zstdhl_Vector_Destroy(&disasmState.m_bigNumU32Vector);
+		zstdhl_Vector_Destroy(&disasmState.m_bigNumDigitVector);
+	}
+
+	if (asmMode == AsmMode_GstdEnc)
+	{
+		gstd_EncoderState_t *encState;
+		zstdhl_EncoderOutputObject_t encOut;
+		GstdEncodeState_t encOutObject;
+		uint8_t maxOffsetCode = gstd_ComputeMaxOffsetExtraBits(128 * 1024);
+
+		encOutObject.m_f = outputF;
+
+		encOut.m_writeBitstreamFunc = WriteBytes;
+		encOut.m_userdata = &encOutObject;
+
+		result = gstd_Encoder_Create(&encOut, 32, maxOffsetCode, 0, &memAllocObj, &encState);
+		if (result == ZSTDHL_RESULT_OK)
+		{
+			result = gstd_Encoder_Transcode(encState, &streamSourceObj, NULL, &memAllocObj);
+
+			gstd_Encoder_Destroy(encState);
+		}
+	}
+
+	CloseInputFile(&inputFile);
+	fclose(outputF);
+
+	if (allocTracker)
+	{
+		PrintAllocStats(allocTracker);
+		zstdhl_AllocTracker_Destroy(allocTracker);
+	}
 
 	if (result != ZSTDHL_RESULT_OK)
 	{
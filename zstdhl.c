@@ -9,6 +9,21 @@ the included LICENSE.txt file.
 #include "zstdhl.h"
 #include "zstdhl_util.h"
 #include "zstdhl_internal.h"
+#include "zstdhl_thread.h"
+
+#include <string.h>
+
+#ifdef ZSTDHL_ENABLE_INSTRUMENTATION
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ZSTDHL_HAVE_RDTSC
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define ZSTDHL_HAVE_RDTSC
+#else
+#include <time.h>
+#endif
+#endif
 
 #ifdef __cplusplus
 #define ZSTDHL_EXTERN extern "C"
@@ -135,6 +150,20 @@ void zstdhl_ReportErrorCode(zstdhl_ResultCode_t errorCode)
 	}
 }
 
+#ifdef ZSTDHL_ENABLE_INSTRUMENTATION
+uint64_t zstdhl_ReadTicks(void)
+{
+#ifdef ZSTDHL_HAVE_RDTSC
+	return (uint64_t)__rdtsc();
+#else
+	struct timespec ts;
+
+	timespec_get(&ts, TIME_UTC);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+#endif
+
 zstdhl_ResultCode_t zstdhl_ReadChecked(const zstdhl_StreamSourceObject_t *streamSource, void *dest, size_t numBytes, zstdhl_ResultCode_t failureResult)
 {
 	if (streamSource->m_readBytesFunc(streamSource->m_userdata, dest, numBytes) != numBytes)
@@ -188,7 +217,7 @@ zstdhl_ResultCode_t zstdhl_Buffers_Alloc(zstdhl_Buffers_t *buffers, int bufferID
 	if (buffers->m_buffers[bufferID])
 		return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-	ptr = buffers->m_alloc.m_reallocFunc(buffers->m_alloc.m_userdata, NULL, size);
+	ptr = zstdhl_ReallocAtSite(&buffers->m_alloc, NULL, size, ZSTDHL_ALLOC_SITE_BUFFERS);
 	if (!ptr)
 		return ZSTDHL_RESULT_OUT_OF_MEMORY;
 
@@ -204,7 +233,7 @@ void zstdhl_Buffers_Dealloc(zstdhl_Buffers_t *buffers, int bufferID)
 {
 	if (buffers->m_buffers[bufferID])
 	{
-		buffers->m_alloc.m_reallocFunc(buffers->m_alloc.m_userdata, buffers->m_buffers[bufferID], 0);
+		zstdhl_ReallocAtSite(&buffers->m_alloc, buffers->m_buffers[bufferID], 0, ZSTDHL_ALLOC_SITE_BUFFERS);
 		buffers->m_buffers[bufferID] = NULL;
 	}
 }
@@ -235,10 +264,26 @@ typedef struct zstdhl_FramePersistentState
 	uint32_t m_litLengthProbs[36];
 	uint32_t m_offsetProbs[29];
 	uint32_t m_matchLengthProbs[53];
+
+	int m_haveLimits;
+	zstdhl_DecodeLimits_t m_limits;
+
+	// If set, Huffman literals are decoded directly into the tracker's literals
+	struct zstdhl_ContentTracker *m_contentTracker;
+
+	const zstdhl_InstrumentationObject_t *m_instrumentation;
 } zstdhl_FramePersistentState_t;
 
 zstdhl_ResultCode_t zstdhl_FramePersistentState_Init(zstdhl_FramePersistentState_t *pstate, const zstdhl_DictDesc_t *dictDesc)
 {
+	pstate->m_haveLimits = 0;
+	pstate->m_limits.m_maxWindowSize = 0;
+	pstate->m_limits.m_maxOffsetBits = 0;
+	pstate->m_limits.m_maxSequencesPerBlock = 0;
+	pstate->m_limits.m_maxMemory = 0;
+	pstate->m_contentTracker = NULL;
+	pstate->m_instrumentation = NULL;
+
 	if (dictDesc)
 	{
 		int tabIndex = 0;
@@ -579,7 +624,6 @@ size_t zstdhl_MemBufferStreamSource_ReadBytes(void *userdata, void *dest, size_t
 	zstdhl_MemBufferStreamSource_t *streamSource = (zstdhl_MemBufferStreamSource_t *)userdata;
 	const uint8_t *srcBytes = (const uint8_t *)streamSource->m_data;
 	uint8_t *destBytes = (uint8_t *)dest;
-	size_t i = 0;
 
 	if (numBytes > streamSource->m_sizeRemaining)
 		numBytes = streamSource->m_sizeRemaining;
@@ -587,12 +631,378 @@ size_t zstdhl_MemBufferStreamSource_ReadBytes(void *userdata, void *dest, size_t
 	streamSource->m_sizeRemaining -= numBytes;
 	streamSource->m_data = srcBytes + numBytes;
 
-	for (i = 0; i < numBytes; i++)
-		destBytes[i] = srcBytes[i];
+	if (numBytes > 0)
+		memcpy(destBytes, srcBytes, numBytes);
 
 	return numBytes;
 }
 
+#define ZSTDHL_XXH64_PRIME_1 0x9e3779b185ebca87ull
+#define ZSTDHL_XXH64_PRIME_2 0xc2b2ae3d27d4eb4full
+#define ZSTDHL_XXH64_PRIME_3 0x165667b19e3779f9ull
+#define ZSTDHL_XXH64_PRIME_4 0x85ebca77c2b2ae63ull
+#define ZSTDHL_XXH64_PRIME_5 0x27d4eb2f165667c5ull
+
+static uint64_t zstdhl_RotateLeft64(uint64_t value, int amount)
+{
+	return (value << amount) | (value >> (64 - amount));
+}
+
+static uint64_t zstdhl_ReadLE64(const uint8_t *bytes)
+{
+	return ((uint64_t)bytes[0]) | (((uint64_t)bytes[1]) << 8) | (((uint64_t)bytes[2]) << 16) | (((uint64_t)bytes[3]) << 24)
+		| (((uint64_t)bytes[4]) << 32) | (((uint64_t)bytes[5]) << 40) | (((uint64_t)bytes[6]) << 48) | (((uint64_t)bytes[7]) << 56);
+}
+
+static uint32_t zstdhl_ReadLE32(const uint8_t *bytes)
+{
+	return ((uint32_t)bytes[0]) | (((uint32_t)bytes[1]) << 8) | (((uint32_t)bytes[2]) << 16) | (((uint32_t)bytes[3]) << 24);
+}
+
+static uint64_t zstdhl_XXH64_Round(uint64_t acc, uint64_t input)
+{
+	acc += input * ZSTDHL_XXH64_PRIME_2;
+	acc = zstdhl_RotateLeft64(acc, 31);
+	return acc * ZSTDHL_XXH64_PRIME_1;
+}
+
+static uint64_t zstdhl_XXH64_MergeRound(uint64_t acc, uint64_t lane)
+{
+	acc ^= zstdhl_XXH64_Round(0, lane);
+	return acc * ZSTDHL_XXH64_PRIME_1 + ZSTDHL_XXH64_PRIME_4;
+}
+
+// Consumes whole 32-byte stripes.  The 4 lanes are independent, so they are kept in locals to let the compiler
+// interleave or vectorize them.
+static const uint8_t *zstdhl_XXH64_ConsumeStripes(zstdhl_XXH64State_t *state, const uint8_t *bytes, size_t numStripes)
+{
+	uint64_t lane0 = state->m_lanes[0];
+	uint64_t lane1 = state->m_lanes[1];
+	uint64_t lane2 = state->m_lanes[2];
+	uint64_t lane3 = state->m_lanes[3];
+
+	while (numStripes > 0)
+	{
+		lane0 = zstdhl_XXH64_Round(lane0, zstdhl_ReadLE64(bytes + 0));
+		lane1 = zstdhl_XXH64_Round(lane1, zstdhl_ReadLE64(bytes + 8));
+		lane2 = zstdhl_XXH64_Round(lane2, zstdhl_ReadLE64(bytes + 16));
+		lane3 = zstdhl_XXH64_Round(lane3, zstdhl_ReadLE64(bytes + 24));
+
+		bytes += 32;
+		numStripes--;
+	}
+
+	state->m_lanes[0] = lane0;
+	state->m_lanes[1] = lane1;
+	state->m_lanes[2] = lane2;
+	state->m_lanes[3] = lane3;
+
+	return bytes;
+}
+
+void zstdhl_XXH64_Init(zstdhl_XXH64State_t *state, uint64_t seed)
+{
+	state->m_lanes[0] = seed + ZSTDHL_XXH64_PRIME_1 + ZSTDHL_XXH64_PRIME_2;
+	state->m_lanes[1] = seed + ZSTDHL_XXH64_PRIME_2;
+	state->m_lanes[2] = seed;
+	state->m_lanes[3] = seed - ZSTDHL_XXH64_PRIME_1;
+	state->m_seed = seed;
+	state->m_totalSize = 0;
+	state->m_bufferedSize = 0;
+}
+
+void zstdhl_XXH64_Update(zstdhl_XXH64State_t *state, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	size_t i = 0;
+
+	state->m_totalSize += size;
+
+	if (state->m_bufferedSize > 0)
+	{
+		size_t amountToBuffer = 32u - state->m_bufferedSize;
+
+		if (amountToBuffer > size)
+			amountToBuffer = size;
+
+		for (i = 0; i < amountToBuffer; i++)
+			state->m_buffer[state->m_bufferedSize + i] = bytes[i];
+
+		state->m_bufferedSize += (uint8_t)amountToBuffer;
+		bytes += amountToBuffer;
+		size -= amountToBuffer;
+
+		if (state->m_bufferedSize < 32)
+			return;
+
+		zstdhl_XXH64_ConsumeStripes(state, state->m_buffer, 1);
+		state->m_bufferedSize = 0;
+	}
+
+	bytes = zstdhl_XXH64_ConsumeStripes(state, bytes, size / 32u);
+	size %= 32u;
+
+	for (i = 0; i < size; i++)
+		state->m_buffer[i] = bytes[i];
+
+	state->m_bufferedSize = (uint8_t)size;
+}
+
+uint64_t zstdhl_XXH64_Digest(const zstdhl_XXH64State_t *state)
+{
+	const uint8_t *tail = state->m_buffer;
+	const uint8_t *tailEnd = state->m_buffer + state->m_bufferedSize;
+	uint64_t hash = 0;
+
+	if (state->m_totalSize >= 32)
+	{
+		hash = zstdhl_RotateLeft64(state->m_lanes[0], 1) + zstdhl_RotateLeft64(state->m_lanes[1], 7)
+			+ zstdhl_RotateLeft64(state->m_lanes[2], 12) + zstdhl_RotateLeft64(state->m_lanes[3], 18);
+
+		hash = zstdhl_XXH64_MergeRound(hash, state->m_lanes[0]);
+		hash = zstdhl_XXH64_MergeRound(hash, state->m_lanes[1]);
+		hash = zstdhl_XXH64_MergeRound(hash, state->m_lanes[2]);
+		hash = zstdhl_XXH64_MergeRound(hash, state->m_lanes[3]);
+	}
+	else
+		hash = state->m_seed + ZSTDHL_XXH64_PRIME_5;
+
+	hash += state->m_totalSize;
+
+	while (tailEnd - tail >= 8)
+	{
+		hash ^= zstdhl_XXH64_Round(0, zstdhl_ReadLE64(tail));
+		hash = zstdhl_RotateLeft64(hash, 27) * ZSTDHL_XXH64_PRIME_1 + ZSTDHL_XXH64_PRIME_4;
+		tail += 8;
+	}
+
+	if (tailEnd - tail >= 4)
+	{
+		hash ^= ((uint64_t)zstdhl_ReadLE32(tail)) * ZSTDHL_XXH64_PRIME_1;
+		hash = zstdhl_RotateLeft64(hash, 23) * ZSTDHL_XXH64_PRIME_2 + ZSTDHL_XXH64_PRIME_3;
+		tail += 4;
+	}
+
+	while (tail < tailEnd)
+	{
+		hash ^= ((uint64_t)*tail) * ZSTDHL_XXH64_PRIME_5;
+		hash = zstdhl_RotateLeft64(hash, 11) * ZSTDHL_XXH64_PRIME_1;
+		tail++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= ZSTDHL_XXH64_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= ZSTDHL_XXH64_PRIME_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+// Reconstructs frame content from literals and sequences to compute the content checksum
+typedef struct zstdhl_ContentTracker
+{
+	zstdhl_Vector_t m_historyVector;
+	zstdhl_Vector_t m_litVector;
+	size_t m_litOffset;
+	size_t m_finishedSize;
+	size_t m_windowSize;
+	uint32_t m_repeatOffsets[3];
+	zstdhl_XXH64State_t m_hashState;
+	const zstdhl_EncoderOutputObject_t *m_contentOutput;	// Receives the content of each finished block, may be NULL
+	uint8_t m_verifyChecksum;
+} zstdhl_ContentTracker_t;
+
+static void zstdhl_ContentTracker_Init(zstdhl_ContentTracker_t *tracker, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_Vector_Init(&tracker->m_historyVector, 1, alloc);
+	zstdhl_Vector_Init(&tracker->m_litVector, 1, alloc);
+	tracker->m_litOffset = 0;
+	tracker->m_finishedSize = 0;
+	tracker->m_windowSize = 0;
+	tracker->m_contentOutput = NULL;
+	tracker->m_verifyChecksum = 0;
+}
+
+static void zstdhl_ContentTracker_Reset(zstdhl_ContentTracker_t *tracker, const zstdhl_FrameHeaderDesc_t *frameHeader)
+{
+	uint64_t windowSize = frameHeader->m_haveWindowSize ? frameHeader->m_windowSize : frameHeader->m_frameContentSize;
+
+	if (windowSize > SIZE_MAX / 4u)
+		windowSize = SIZE_MAX / 4u;
+
+	zstdhl_Vector_Clear(&tracker->m_historyVector);
+	zstdhl_Vector_Clear(&tracker->m_litVector);
+	tracker->m_litOffset = 0;
+	tracker->m_finishedSize = 0;
+	tracker->m_windowSize = (size_t)windowSize;
+	tracker->m_repeatOffsets[0] = 1;
+	tracker->m_repeatOffsets[1] = 4;
+	tracker->m_repeatOffsets[2] = 8;
+
+	zstdhl_XXH64_Init(&tracker->m_hashState, 0);
+}
+
+static void zstdhl_ContentTracker_Destroy(zstdhl_ContentTracker_t *tracker)
+{
+	zstdhl_Vector_Destroy(&tracker->m_historyVector);
+	zstdhl_Vector_Destroy(&tracker->m_litVector);
+}
+
+static zstdhl_ResultCode_t zstdhl_ContentTracker_AppendRLE(zstdhl_Vector_t *vec, uint8_t value, size_t count)
+{
+	if (count == 0)
+		return ZSTDHL_RESULT_OK;
+
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(vec, NULL, count));
+
+	memset(((uint8_t *)vec->m_dataEnd) - count, value, count);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Adds literals for the current block's sequences
+static zstdhl_ResultCode_t zstdhl_ContentTracker_AddLiterals(zstdhl_ContentTracker_t *tracker, const void *data, size_t size)
+{
+	return zstdhl_Vector_Append(&tracker->m_litVector, data, size);
+}
+
+static zstdhl_ResultCode_t zstdhl_ContentTracker_AddRLELiterals(zstdhl_ContentTracker_t *tracker, uint8_t value, size_t count)
+{
+	return zstdhl_ContentTracker_AppendRLE(&tracker->m_litVector, value, count);
+}
+
+// Adds content from raw and RLE blocks
+static zstdhl_ResultCode_t zstdhl_ContentTracker_AddContent(zstdhl_ContentTracker_t *tracker, const void *data, size_t size)
+{
+	return zstdhl_Vector_Append(&tracker->m_historyVector, data, size);
+}
+
+static zstdhl_ResultCode_t zstdhl_ContentTracker_AddRLEContent(zstdhl_ContentTracker_t *tracker, uint8_t value, size_t count)
+{
+	return zstdhl_ContentTracker_AppendRLE(&tracker->m_historyVector, value, count);
+}
+
+static zstdhl_ResultCode_t zstdhl_ContentTracker_AddSequence(zstdhl_ContentTracker_t *tracker, const zstdhl_SequenceDesc_t *seq)
+{
+	uint32_t *repeatOffsets = tracker->m_repeatOffsets;
+	uint32_t offset = 0;
+	const uint8_t *lits = NULL;
+	const uint8_t *matchSrc = NULL;
+	uint8_t *dest = NULL;
+	size_t matchLength = seq->m_matchLength;
+	size_t chunkSize = 0;
+
+	if (seq->m_litLength > tracker->m_litVector.m_count - tracker->m_litOffset)
+		return ZSTDHL_RESULT_SEQUENCE_LIT_LENGTH_EXCEEDS_LITERALS;
+
+	switch (seq->m_offsetType)
+	{
+	case ZSTDHL_OFFSET_TYPE_REPEAT_1:
+		offset = repeatOffsets[0];
+		break;
+	case ZSTDHL_OFFSET_TYPE_REPEAT_2:
+		offset = repeatOffsets[1];
+		repeatOffsets[1] = repeatOffsets[0];
+		repeatOffsets[0] = offset;
+		break;
+	case ZSTDHL_OFFSET_TYPE_REPEAT_3:
+		offset = repeatOffsets[2];
+		repeatOffsets[2] = repeatOffsets[1];
+		repeatOffsets[1] = repeatOffsets[0];
+		repeatOffsets[0] = offset;
+		break;
+	case ZSTDHL_OFFSET_TYPE_REPEAT_1_MINUS_1:
+	case ZSTDHL_OFFSET_TYPE_SPECIFIED:
+		if (seq->m_offsetType == ZSTDHL_OFFSET_TYPE_SPECIFIED)
+		{
+			if (seq->m_offsetValueNumBits > 32)
+				return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
+
+			offset = (seq->m_offsetValueNumBits > 0) ? seq->m_offsetValueBigNum[0] : 0;
+		}
+		else
+			offset = repeatOffsets[0] - 1u;
+
+		repeatOffsets[2] = repeatOffsets[1];
+		repeatOffsets[1] = repeatOffsets[0];
+		repeatOffsets[0] = offset;
+		break;
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	if (offset == 0 || offset > tracker->m_historyVector.m_count + seq->m_litLength)
+		return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
+
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&tracker->m_historyVector, NULL, seq->m_litLength + matchLength));
+
+	dest = ((uint8_t *)tracker->m_historyVector.m_dataEnd) - matchLength - seq->m_litLength;
+	lits = ((const uint8_t *)tracker->m_litVector.m_data) + tracker->m_litOffset;
+	memcpy(dest, lits, seq->m_litLength);
+	tracker->m_litOffset += seq->m_litLength;
+
+	dest += seq->m_litLength;
+	matchSrc = dest - offset;
+
+	// Matches may overlap their own output.  The copied data repeats with a period of the offset, so each chunk
+	// can be copied from the start of the match source as long as it doesn't overlap the bytes copied so far.
+	chunkSize = offset;
+	while (matchLength > 0)
+	{
+		if (chunkSize > matchLength)
+			chunkSize = matchLength;
+
+		memcpy(dest, matchSrc, chunkSize);
+		dest += chunkSize;
+		matchLength -= chunkSize;
+		chunkSize = (size_t)(dest - matchSrc);
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Adds the remaining literals of a block, hashes and outputs the block content, and discards history outside of the window
+static zstdhl_ResultCode_t zstdhl_ContentTracker_FinishBlock(zstdhl_ContentTracker_t *tracker)
+{
+	uint8_t *history = NULL;
+	size_t historySize = 0;
+	size_t windowSize = tracker->m_windowSize;
+
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&tracker->m_historyVector, ((const uint8_t *)tracker->m_litVector.m_data) + tracker->m_litOffset, tracker->m_litVector.m_count - tracker->m_litOffset));
+
+	zstdhl_Vector_Clear(&tracker->m_litVector);
+	tracker->m_litOffset = 0;
+
+	history = (uint8_t *)tracker->m_historyVector.m_data;
+	historySize = tracker->m_historyVector.m_count;
+
+	zstdhl_XXH64_Update(&tracker->m_hashState, history + tracker->m_finishedSize, historySize - tracker->m_finishedSize);
+
+	if (tracker->m_contentOutput)
+	{
+		ZSTDHL_CHECKED(tracker->m_contentOutput->m_writeBitstreamFunc(tracker->m_contentOutput->m_userdata, history + tracker->m_finishedSize, historySize - tracker->m_finishedSize));
+	}
+
+	tracker->m_finishedSize = historySize;
+
+	// Compaction only happens once the history is more than twice the window size, so the ranges never overlap
+	if (historySize / 2u > windowSize)
+	{
+		memcpy(history, history + (historySize - windowSize), windowSize);
+
+		zstdhl_Vector_Shrink(&tracker->m_historyVector, windowSize);
+		tracker->m_finishedSize = windowSize;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static uint32_t zstdhl_ContentTracker_GetChecksum(const zstdhl_ContentTracker_t *tracker)
+{
+	return (uint32_t)(zstdhl_XXH64_Digest(&tracker->m_hashState) & 0xffffffffu);
+}
+
 static zstdhl_ResultCode_t zstdhl_ParseFrameHeader(const zstdhl_StreamSourceObject_t *streamSource, zstdhl_FrameHeaderDesc_t *outFrameHeader)
 {
 #ifndef ZSTDHL_ALLOW_DECL_AFTER_STATEMENT
@@ -669,7 +1079,7 @@ static zstdhl_ResultCode_t zstdhl_ParseFrameHeader(const zstdhl_StreamSourceObje
 		ZSTDHL_DECL(uint8_t) windowDescriptorMantissa = (windowDescriptor & 7);
 		ZSTDHL_DECL(uint8_t) windowDescriptorExponent = ((windowDescriptor >> 3) & 0x1f);
 
-		outFrameHeader->m_windowSize = ((uint64_t)(windowDescriptor + 8)) << (7 + windowDescriptorExponent);
+		outFrameHeader->m_windowSize = ((uint64_t)(windowDescriptorMantissa + 8)) << (7 + windowDescriptorExponent);
 	}
 
 	outFrameHeader->m_dictionaryID = 0;
@@ -688,6 +1098,9 @@ static zstdhl_ResultCode_t zstdhl_ParseFrameHeader(const zstdhl_StreamSourceObje
 		outFrameHeader->m_haveFrameContentSize = 1;
 		for (ZSTDHL_DECL(uint8_t) i = 0; i < fcsSize; i++)
 			outFrameHeader->m_frameContentSize |= ((uint64_t)frameHeader[readOffset++]) << (i * 8);
+
+		if (fcsSize == 2)
+			outFrameHeader->m_frameContentSize += 256u;
 	}
 	else
 		outFrameHeader->m_haveFrameContentSize = 0;
@@ -983,14 +1396,14 @@ static void zstdhl_SimpleProbClear(void *userdata)
 {
 }
 
-zstdhl_ResultCode_t zstdhl_DecodeFSEDescriptionSimple(zstdhl_ForwardBitstream_t *bitstream, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, uint8_t maxAccuracyLog, uint32_t *probs, size_t maxProbs, size_t *outNumProbs, int *outAccuracyLog)
+zstdhl_ResultCode_t zstdhl_DecodeFSEDescriptionSimple(zstdhl_ForwardBitstream_t *bitstream, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, uint8_t maxAccuracyLog, uint32_t *probs, size_t maxProbs, size_t *outNumProbs, int *outAccuracyLog, const zstdhl_InstrumentationObject_t *instrumentation)
 {
 	zstdhl_SimpleProbDecodeState_t simpleDecodeState;
 	uint32_t *scratchProbs = NULL;
 
 	zstdhl_SimpleProbDecodeState_Init(&simpleDecodeState, probs, maxProbs, ZSTDHL_RESULT_TOO_MANY_PROBS);
 
-	ZSTDHL_CHECKED(zstdhl_DecodeFSEDescription(bitstream, disassemblyOutput, maxAccuracyLog, zstdhl_SimpleProbRequestMoreCapacity, &simpleDecodeState, &scratchProbs, outNumProbs, outAccuracyLog));
+	ZSTDHL_CHECKED_PHASE(instrumentation, ZSTDHL_PHASE_FSE_TABLE_DECODE, 0, *outNumProbs, zstdhl_DecodeFSEDescription(bitstream, disassemblyOutput, maxAccuracyLog, zstdhl_SimpleProbRequestMoreCapacity, &simpleDecodeState, &scratchProbs, outNumProbs, outAccuracyLog));
 
 	return ZSTDHL_RESULT_OK;
 }
@@ -1129,7 +1542,7 @@ zstdhl_ResultCode_t zstdhl_ExpandHuffmanWeightTable(const zstdhl_HuffmanTreePart
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_ParseFSEHuffmanWeights(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_HuffmanTreeDesc_t *huffTreeDesc, zstdhl_Buffers_t *buffers, uint8_t weightsCompressedSize)
+zstdhl_ResultCode_t zstdhl_ParseFSEHuffmanWeights(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_HuffmanTreeDesc_t *huffTreeDesc, zstdhl_Buffers_t *buffers, uint8_t weightsCompressedSize, const zstdhl_InstrumentationObject_t *instrumentation)
 {
 	int accuracyLog = 0;
 	size_t numHuffmanProbs = 0;
@@ -1147,7 +1560,7 @@ zstdhl_ResultCode_t zstdhl_ParseFSEHuffmanWeights(const zstdhl_StreamSourceObjec
 
 	ZSTDHL_CHECKED(zstdhl_ForwardBitstream_Init(&bitstream, &sliceSourceObj));
 
-	ZSTDHL_CHECKED(zstdhl_DecodeFSEDescriptionSimple(&bitstream, disassemblyOutput, 6, huffTreeDesc->m_weightTableProbabilities, 256, &numHuffmanProbs, &accuracyLog));
+	ZSTDHL_CHECKED(zstdhl_DecodeFSEDescriptionSimple(&bitstream, disassemblyOutput, 6, huffTreeDesc->m_weightTableProbabilities, 256, &numHuffmanProbs, &accuracyLog, instrumentation));
 
 	huffTreeDesc->m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE;
 	huffTreeDesc->m_weightTable.m_accuracyLog = accuracyLog;
@@ -1222,7 +1635,7 @@ zstdhl_ResultCode_t zstdhl_ParseDirectHuffmanWeights(const zstdhl_StreamSourceOb
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_ParseHuffmanTreeDescription(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_Buffers_t *buffers, zstdhl_HuffmanTreeDesc_t *treeDesc)
+zstdhl_ResultCode_t zstdhl_ParseHuffmanTreeDescription(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_Buffers_t *buffers, zstdhl_HuffmanTreeDesc_t *treeDesc, const zstdhl_InstrumentationObject_t *instrumentation)
 {
 	uint8_t headerByte = 0;
 	uint8_t directWasteBits = 0;
@@ -1234,7 +1647,7 @@ zstdhl_ResultCode_t zstdhl_ParseHuffmanTreeDescription(const zstdhl_StreamSource
 
 	if (headerByte < 128)
 	{
-		ZSTDHL_CHECKED(zstdhl_ParseFSEHuffmanWeights(streamSource, disassemblyOutput, treeDesc, buffers, headerByte));
+		ZSTDHL_CHECKED(zstdhl_ParseFSEHuffmanWeights(streamSource, disassemblyOutput, treeDesc, buffers, headerByte, instrumentation));
 	}
 	else
 	{
@@ -1374,6 +1787,148 @@ zstdhl_ResultCode_t zstdhl_GenerateHuffmanEncodeTable(const zstdhl_HuffmanTreePa
 	return ZSTDHL_RESULT_OK;
 }
 
+// Sorts symbols by ascending count, with ties ordered by symbol
+static void zstdhl_SortSymbolsByCount(const size_t *symbolCounts, uint16_t *symbols, uint16_t *tempSymbols, size_t numSymbols)
+{
+	size_t width = 0;
+	size_t i = 0;
+
+	for (width = 1; width < numSymbols; width *= 2)
+	{
+		for (i = 0; i < numSymbols; i += width * 2)
+		{
+			size_t left = i;
+			size_t leftEnd = i + width;
+			size_t right = leftEnd;
+			size_t rightEnd = i + width * 2;
+			size_t outIndex = i;
+
+			if (leftEnd > numSymbols)
+				leftEnd = numSymbols;
+			if (rightEnd > numSymbols)
+				rightEnd = numSymbols;
+
+			while (left < leftEnd && right < rightEnd)
+			{
+				if (symbolCounts[symbols[right]] < symbolCounts[symbols[left]])
+					tempSymbols[outIndex++] = symbols[right++];
+				else
+					tempSymbols[outIndex++] = symbols[left++];
+			}
+
+			while (left < leftEnd)
+				tempSymbols[outIndex++] = symbols[left++];
+			while (right < rightEnd)
+				tempSymbols[outIndex++] = symbols[right++];
+		}
+
+		for (i = 0; i < numSymbols; i++)
+			symbols[i] = tempSymbols[i];
+	}
+}
+
+zstdhl_ResultCode_t zstdhl_ComputeHuffmanCodeLengths(const size_t *symbolCounts, size_t numSymbols, uint8_t maxCodeLength, uint8_t *outCodeLengths)
+{
+	uint16_t sortedSymbols[256];
+	uint16_t tempSymbols[256];
+	size_t itemWeights[2][512];
+	uint8_t itemIsPackage[ZSTDHL_MAX_HUFFMAN_CODE_LENGTH][512];
+	size_t numItems[ZSTDHL_MAX_HUFFMAN_CODE_LENGTH];
+	size_t numLeafs = 0;
+	size_t itemsToTake = 0;
+	size_t i = 0;
+	int level = 0;
+
+	if (numSymbols > 256 || maxCodeLength == 0 || maxCodeLength > ZSTDHL_MAX_HUFFMAN_CODE_LENGTH)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	for (i = 0; i < numSymbols; i++)
+	{
+		outCodeLengths[i] = 0;
+
+		if (symbolCounts[i] != 0)
+			sortedSymbols[numLeafs++] = (uint16_t)i;
+	}
+
+	if (numLeafs == 0)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (numLeafs == 1)
+	{
+		outCodeLengths[sortedSymbols[0]] = 1;
+		return ZSTDHL_RESULT_OK;
+	}
+
+	if (numLeafs > ((size_t)1 << maxCodeLength))
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	zstdhl_SortSymbolsByCount(symbolCounts, sortedSymbols, tempSymbols, numLeafs);
+
+	// Package-merge: Each level's list is the leafs merged with pairs packaged from the level below it
+	for (level = maxCodeLength - 1; level >= 0; level--)
+	{
+		const size_t *prevWeights = itemWeights[(level + 1) & 1];
+		size_t *weights = itemWeights[level & 1];
+		size_t numPackages = 0;
+		size_t leafIndex = 0;
+		size_t packageIndex = 0;
+		size_t outIndex = 0;
+
+		if (level != maxCodeLength - 1)
+			numPackages = numItems[level + 1] / 2u;
+
+		while (leafIndex < numLeafs || packageIndex < numPackages)
+		{
+			uint8_t takePackage = 0;
+
+			if (leafIndex == numLeafs)
+				takePackage = 1;
+			else if (packageIndex < numPackages)
+				takePackage = (prevWeights[packageIndex * 2] + prevWeights[packageIndex * 2 + 1] < symbolCounts[sortedSymbols[leafIndex]]);
+
+			if (takePackage)
+			{
+				weights[outIndex] = prevWeights[packageIndex * 2] + prevWeights[packageIndex * 2 + 1];
+				packageIndex++;
+			}
+			else
+			{
+				weights[outIndex] = symbolCounts[sortedSymbols[leafIndex]];
+				leafIndex++;
+			}
+
+			itemIsPackage[level][outIndex] = takePackage;
+			outIndex++;
+		}
+
+		numItems[level] = outIndex;
+	}
+
+	// Each leaf's code length is the number of levels where it is in the selected prefix
+	itemsToTake = numLeafs * 2u - 2u;
+
+	for (level = 0; level < maxCodeLength && itemsToTake > 0; level++)
+	{
+		size_t numPackagesTaken = 0;
+		size_t numLeafsTaken = 0;
+
+		if (itemsToTake > numItems[level])
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+		for (i = 0; i < itemsToTake; i++)
+		{
+			if (itemIsPackage[level][i])
+				numPackagesTaken++;
+			else
+				outCodeLengths[sortedSymbols[numLeafsTaken++]]++;
+		}
+
+		itemsToTake = numPackagesTaken * 2u;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
 zstdhl_ResultCode_t zstdhl_DecodeHuffmanStream1(const uint8_t *huffmanBytes, uint8_t *decodedBytes, uint32_t streamSize, uint32_t decompressedSize, const zstdhl_HuffmanTableDec_t *decTable)
 {
 	zstdhl_ReverseBitstream_t revStream;
@@ -1423,7 +1978,7 @@ zstdhl_ResultCode_t zstdhl_DecodeHuffmanStream4(const uint8_t *huffmanBytes, uin
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_DecodeHuffmanLiterals(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_Buffers_t *buffers, uint32_t streamSize, uint32_t regeneratedSize, int is4Stream, const zstdhl_HuffmanTableDec_t *decTable)
+zstdhl_ResultCode_t zstdhl_DecodeHuffmanLiterals(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_Buffers_t *buffers, uint32_t streamSize, uint32_t regeneratedSize, int is4Stream, const zstdhl_HuffmanTableDec_t *decTable, zstdhl_ContentTracker_t *contentTracker)
 {
 	void *literalsPtr = NULL;
 	void *huffmanDataPtr = NULL;
@@ -1434,7 +1989,14 @@ zstdhl_ResultCode_t zstdhl_DecodeHuffmanLiterals(const zstdhl_StreamSourceObject
 	zstdhl_MemBufferStreamSource_t litStream;
 	zstdhl_StreamSourceObject_t litStreamObj;
 
-	ZSTDHL_CHECKED(zstdhl_Buffers_Alloc(buffers, ZSTDHL_BUFFER_LITERALS, regeneratedSize, &literalsPtr));
+	if (contentTracker)
+	{
+		ZSTDHL_CHECKED(zstdhl_ContentTracker_AddLiterals(contentTracker, NULL, regeneratedSize));
+		literalsPtr = ((uint8_t *)contentTracker->m_litVector.m_dataEnd) - regeneratedSize;
+	}
+	else
+		ZSTDHL_CHECKED(zstdhl_Buffers_Alloc(buffers, ZSTDHL_BUFFER_LITERALS, regeneratedSize, &literalsPtr));
+
 	ZSTDHL_CHECKED(zstdhl_Buffers_Alloc(buffers, ZSTDHL_BUFFER_HUFFMAN_BITSTREAM, streamSize, &huffmanDataPtr));
 
 	ZSTDHL_CHECKED(zstdhl_ReadChecked(streamSource, huffmanDataPtr, streamSize, ZSTDHL_RESULT_HUFFMAN_BITSTREAM_TOO_SMALL));
@@ -1486,7 +2048,7 @@ zstdhl_ResultCode_t zstdhl_DecodeHuffmanLiterals(const zstdhl_StreamSourceObject
 		litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_1_STREAM;
 	}
 
-	zstdhl_MemBufferStreamSource_Init(&litStream, buffers->m_buffers[ZSTDHL_BUFFER_LITERALS], regeneratedSize);
+	zstdhl_MemBufferStreamSource_Init(&litStream, literalsPtr, regeneratedSize);
 
 	litStreamObj.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
 	litStreamObj.m_userdata = &litStream;
@@ -1517,15 +2079,17 @@ zstdhl_ResultCode_t zstdhl_ParseHuffmanLiteralsSection(const zstdhl_StreamSource
 	if (haveNewTree)
 	{
 		zstdhl_HuffmanTreeDesc_t treeDesc;
-		ZSTDHL_CHECKED(zstdhl_ParseHuffmanTreeDescription(&sliceSourceObj, disassemblyOutput, buffers, &treeDesc));
-		ZSTDHL_CHECKED(zstdhl_GenerateHuffmanDecodeTable(&treeDesc.m_partialWeightDesc, &pstate->m_huffmanTable));
+		ZSTDHL_CHECKED(zstdhl_ParseHuffmanTreeDescription(&sliceSourceObj, disassemblyOutput, buffers, &treeDesc, pstate->m_instrumentation));
+		ZSTDHL_CHECKED_PHASE(pstate->m_instrumentation, ZSTDHL_PHASE_HUFFMAN_TABLE_GENERATE, 0, treeDesc.m_partialWeightDesc.m_numSpecifiedWeights, zstdhl_GenerateHuffmanDecodeTable(&treeDesc.m_partialWeightDesc, &pstate->m_huffmanTable));
 		pstate->m_haveHuffmanTable = 1;
 	}
 
 	if (!pstate->m_haveHuffmanTable)
 		return ZSTDHL_RESULT_HUFFMAN_TABLE_NOT_SET;
 
-	return zstdhl_DecodeHuffmanLiterals(&sliceSourceObj, disassemblyOutput, buffers, (uint32_t)sliceSource.m_sizeRemaining, regeneratedSize, is4Stream, &pstate->m_huffmanTable);
+	ZSTDHL_CHECKED_PHASE(pstate->m_instrumentation, ZSTDHL_PHASE_HUFFMAN_STREAM_DECODE, compressedSize, regeneratedSize, zstdhl_DecodeHuffmanLiterals(&sliceSourceObj, disassemblyOutput, buffers, (uint32_t)sliceSource.m_sizeRemaining, regeneratedSize, is4Stream, &pstate->m_huffmanTable, pstate->m_contentTracker));
+
+	return ZSTDHL_RESULT_OK;
 }
 
 zstdhl_ResultCode_t zstdhl_ParseLiteralsSection(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_Buffers_t *buffers, uint32_t *inOutBlockSize, zstdhl_FramePersistentState_t *pstate)
@@ -1677,7 +2241,7 @@ static zstdhl_SubstreamCompressionStructureDef_t zstdhl_offsetCodeSDef =
 	zstdhl_OffsetCodeProbs
 };
 
-zstdhl_ResultCode_t zstdhl_ParseCompressionDef(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, uint8_t defByte, int defBitOffset, const zstdhl_SubstreamCompressionStructureDef_t *sdef, zstdhl_SequencesSubstreamCompressionDef_t *cdef, zstdhl_BufferResizeFunc_t resizeFunc, zstdhl_BufferClearFunc_t clearFunc, void *resizeUserData)
+zstdhl_ResultCode_t zstdhl_ParseCompressionDef(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, uint8_t defByte, int defBitOffset, const zstdhl_SubstreamCompressionStructureDef_t *sdef, zstdhl_SequencesSubstreamCompressionDef_t *cdef, zstdhl_BufferResizeFunc_t resizeFunc, zstdhl_BufferClearFunc_t clearFunc, void *resizeUserData, const zstdhl_InstrumentationObject_t *instrumentation)
 {
 	zstdhl_SequencesCompressionMode_t compressionMode = (zstdhl_SequencesCompressionMode_t)((defByte >> defBitOffset) & 3);
 	uint32_t i = 0;
@@ -1736,7 +2300,7 @@ zstdhl_ResultCode_t zstdhl_ParseCompressionDef(const zstdhl_StreamSourceObject_t
 
 			zstdhl_ForwardBitstream_Init(&bitstream, streamSource);
 
-			ZSTDHL_CHECKED(zstdhl_DecodeFSEDescription(&bitstream, disassemblyOutput, sdef->m_maxAccuracyLog, resizeFunc, resizeUserData, &probs, &numProbs, &accuracyLog));
+			ZSTDHL_CHECKED_PHASE(instrumentation, ZSTDHL_PHASE_FSE_TABLE_DECODE, 0, numProbs, zstdhl_DecodeFSEDescription(&bitstream, disassemblyOutput, sdef->m_maxAccuracyLog, resizeFunc, resizeUserData, &probs, &numProbs, &accuracyLog));
 
 			cdef->m_isDefined = 1;
 			cdef->m_fseTableDef.m_accuracyLog = accuracyLog;
@@ -1950,8 +2514,21 @@ typedef struct zstdhl_OffsetProbDecodeState
 	zstdhl_Buffers_t *m_buffers;
 	uint8_t m_alternator;
 	size_t m_currentCapacity;
+	size_t m_maxCapacity;
 } zstdhl_OffsetProbDecodeState_t;
 
+static void zstdhl_OffsetProbDecodeState_Init(zstdhl_OffsetProbDecodeState_t *state, zstdhl_Buffers_t *buffers, const zstdhl_DecodeLimits_t *limits)
+{
+	state->m_alternator = 0;
+	state->m_buffers = buffers;
+	state->m_currentCapacity = 0;
+	state->m_maxCapacity = SIZE_MAX;
+
+	// Offset code N has N+1 bits including the implicit 1 bit
+	if (limits->m_maxOffsetBits != 0)
+		state->m_maxCapacity = limits->m_maxOffsetBits;
+}
+
 static zstdhl_ResultCode_t zstdhl_OffsetsRequestMoreCapacity(void *userdata, uint32_t **outProbs, size_t *outNumProbs)
 {
 	zstdhl_OffsetProbDecodeState_t *state = (zstdhl_OffsetProbDecodeState_t *)userdata;
@@ -1963,6 +2540,9 @@ static zstdhl_ResultCode_t zstdhl_OffsetsRequestMoreCapacity(void *userdata, uin
 	uint32_t *newProbs = NULL;
 	void *newBufferPtr = NULL;
 
+	if (state->m_currentCapacity >= state->m_maxCapacity)
+		return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
+
 	if ((SIZE_MAX / 2u) < state->m_currentCapacity)
 		return ZSTDHL_RESULT_OUT_OF_MEMORY;
 	
@@ -1971,6 +2551,9 @@ static zstdhl_ResultCode_t zstdhl_OffsetsRequestMoreCapacity(void *userdata, uin
 	if (newCapacity < 8)
 		newCapacity = 8;
 
+	if (newCapacity > state->m_maxCapacity)
+		newCapacity = state->m_maxCapacity;
+
 	if ((SIZE_MAX / sizeof(uint32_t)) < newCapacity)
 		return ZSTDHL_RESULT_OUT_OF_MEMORY;
 	
@@ -2050,6 +2633,9 @@ zstdhl_ResultCode_t zstdhl_ParseSequencesSection(const zstdhl_StreamSourceObject
 		return ZSTDHL_RESULT_OK;
 	}
 
+	if (pstate->m_limits.m_maxSequencesPerBlock != 0 && numSequences > pstate->m_limits.m_maxSequencesPerBlock)
+		return ZSTDHL_RESULT_TOO_MANY_SEQUENCES;
+
 	ZSTDHL_CHECKED(zstdhl_ReadChecked(&sliceStream, &headerByte, 1, ZSTDHL_RESULT_SEQUENCES_HEADER_TRUNCATED));
 
 	if (headerByte & 3)
@@ -2071,16 +2657,27 @@ zstdhl_ResultCode_t zstdhl_ParseSequencesSection(const zstdhl_StreamSourceObject
 		zstdhl_SimpleProbDecodeState_t matchLenProbHandler;
 		zstdhl_OffsetProbDecodeState_t offsetProbHandler;
 
-		offsetProbHandler.m_alternator = 0;
-		offsetProbHandler.m_buffers = buffers;
-		offsetProbHandler.m_currentCapacity = 0;
+		zstdhl_OffsetProbDecodeState_Init(&offsetProbHandler, buffers, &pstate->m_limits);
 
 		zstdhl_SimpleProbDecodeState_Init(&litLenProbHandler, pstate->m_litLengthProbs, zstdhl_litLenSDef.m_numProbs, ZSTDHL_RESULT_TOO_MANY_PROBS);
 		zstdhl_SimpleProbDecodeState_Init(&matchLenProbHandler, pstate->m_matchLengthProbs, zstdhl_matchLenSDef.m_numProbs, ZSTDHL_RESULT_TOO_MANY_PROBS);
 
-		ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(&sliceStream, disassemblyOutput, headerByte, 6, &zstdhl_litLenSDef, &pstate->m_literalLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &litLenProbHandler));
-		ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(&sliceStream, disassemblyOutput, headerByte, 4, &zstdhl_offsetCodeSDef, &pstate->m_offsetsCDef, zstdhl_OffsetsRequestMoreCapacity, zstdhl_OffsetsClear, &offsetProbHandler));
-		ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(&sliceStream, disassemblyOutput, headerByte, 2, &zstdhl_matchLenSDef, &pstate->m_matchLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &matchLenProbHandler));
+		ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(&sliceStream, disassemblyOutput, headerByte, 6, &zstdhl_litLenSDef, &pstate->m_literalLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &litLenProbHandler, pstate->m_instrumentation));
+		ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(&sliceStream, disassemblyOutput, headerByte, 4, &zstdhl_offsetCodeSDef, &pstate->m_offsetsCDef, zstdhl_OffsetsRequestMoreCapacity, zstdhl_OffsetsClear, &offsetProbHandler, pstate->m_instrumentation));
+		ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(&sliceStream, disassemblyOutput, headerByte, 2, &zstdhl_matchLenSDef, &pstate->m_matchLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &matchLenProbHandler, pstate->m_instrumentation));
+	}
+
+	// Predefined and reused tables don't go through the capacity limit, so check the table that will actually be used
+	if (pstate->m_limits.m_maxOffsetBits != 0 && pstate->m_offsetsCDef.m_fseTableDef.m_numProbabilities > pstate->m_limits.m_maxOffsetBits)
+	{
+		const zstdhl_FSETableDef_t *offsetTableDef = &pstate->m_offsetsCDef.m_fseTableDef;
+		size_t numUsedProbs = offsetTableDef->m_numProbabilities;
+
+		while (numUsedProbs > 0 && offsetTableDef->m_probabilities[numUsedProbs - 1] == 0)
+			numUsedProbs--;
+
+		if (numUsedProbs > pstate->m_limits.m_maxOffsetBits)
+			return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
 	}
 
 	// Construct offset bignum
@@ -2106,7 +2703,7 @@ zstdhl_ResultCode_t zstdhl_ParseSequencesSection(const zstdhl_StreamSourceObject
 
 		ZSTDHL_CHECKED(zstdhl_ReverseBitstream_Init(&revStream, (const uint8_t *)sequencesBufferPtr, bitstreamSize));
 
-		ZSTDHL_CHECKED(zstdhl_DecodeSequences(&revStream, disassemblyOutput, buffers, &pstate->m_literalLengthsCDef.m_fseTableDef, &pstate->m_offsetsCDef.m_fseTableDef, &pstate->m_matchLengthsCDef.m_fseTableDef, numSequences));
+		ZSTDHL_CHECKED_PHASE(pstate->m_instrumentation, ZSTDHL_PHASE_SEQUENCE_DECODE, bitstreamSize, numSequences, zstdhl_DecodeSequences(&revStream, disassemblyOutput, buffers, &pstate->m_literalLengthsCDef.m_fseTableDef, &pstate->m_offsetsCDef.m_fseTableDef, &pstate->m_matchLengthsCDef.m_fseTableDef, numSequences));
 
 		zstdhl_Buffers_Dealloc(buffers, ZSTDHL_BUFFER_FSE_BITSTREAM);
 	}
@@ -2126,18 +2723,129 @@ static zstdhl_ResultCode_t zstdhl_ParseCompressedBlock(const zstdhl_StreamSource
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_DisassembleImpl(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_Buffers_t *buffers, zstdhl_FramePersistentState_t *pstate)
+// Forwards disassembled elements while feeding the regenerated content to a content tracker
+typedef struct zstdhl_ChecksumDisassemblyOutput
 {
-	zstdhl_FrameHeaderDesc_t frameHeader;
-	int disassembledBlockCount = 0;
-
-	ZSTDHL_CHECKED(zstdhl_ParseFrameHeader(streamSource, &frameHeader));
+	const zstdhl_DisassemblyOutputObject_t *m_output;
+	zstdhl_ContentTracker_t *m_tracker;
+	zstdhl_LiteralsSectionHeader_t m_litSectionHeader;
+} zstdhl_ChecksumDisassemblyOutput_t;
 
-	disassemblyOutput->m_reportDisassembledElementFunc(disassemblyOutput->m_userdata, ZSTDHL_ELEMENT_TYPE_FRAME_HEADER, &frameHeader);
+static zstdhl_ResultCode_t zstdhl_ChecksumDisassemblyOutput_ReportElement(void *userdata, int elementType, const void *element)
+{
+	zstdhl_ChecksumDisassemblyOutput_t *checksumOutput = (zstdhl_ChecksumDisassemblyOutput_t *)userdata;
+	zstdhl_ContentTracker_t *tracker = checksumOutput->m_tracker;
+	const zstdhl_DisassemblyOutputObject_t *output = checksumOutput->m_output;
 
-	for (;;)
+	switch (elementType)
 	{
-		uint8_t blockHeaderBytes[3];
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER:
+		checksumOutput->m_litSectionHeader = *(const zstdhl_LiteralsSectionHeader_t *)element;
+		break;
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION:
+		if (checksumOutput->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN || checksumOutput->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE)
+			break;	// Already decoded into the tracker
+		else
+		{
+			// Capture the literals and forward them from the captured copy
+			zstdhl_LiteralsSectionDesc_t litSectionDesc = *(const zstdhl_LiteralsSectionDesc_t *)element;
+			zstdhl_MemBufferStreamSource_t litStream;
+			zstdhl_StreamSourceObject_t litStreamObj;
+			size_t numValues = litSectionDesc.m_numValues;
+			size_t regeneratedSize = checksumOutput->m_litSectionHeader.m_regeneratedSize;
+			uint8_t *lits = NULL;
+
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddLiterals(tracker, NULL, numValues));
+
+			lits = ((uint8_t *)tracker->m_litVector.m_dataEnd) - numValues;
+			ZSTDHL_CHECKED(zstdhl_ReadChecked(litSectionDesc.m_decompressedLiteralsStream, lits, numValues, ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED));
+
+			if (checksumOutput->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE && numValues == 1 && regeneratedSize > 1)
+			{
+				ZSTDHL_CHECKED(zstdhl_ContentTracker_AddRLELiterals(tracker, lits[0], regeneratedSize - 1u));
+				lits = ((uint8_t *)tracker->m_litVector.m_dataEnd) - regeneratedSize;
+			}
+
+			zstdhl_MemBufferStreamSource_Init(&litStream, lits, numValues);
+
+			litStreamObj.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+			litStreamObj.m_userdata = &litStream;
+
+			litSectionDesc.m_decompressedLiteralsStream = &litStreamObj;
+
+			return output->m_reportDisassembledElementFunc(output->m_userdata, elementType, &litSectionDesc);
+		}
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCE:
+		ZSTDHL_CHECKED(zstdhl_ContentTracker_AddSequence(tracker, (const zstdhl_SequenceDesc_t *)element));
+		break;
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA:
+		{
+			const zstdhl_BlockRLEDesc_t *rleDesc = (const zstdhl_BlockRLEDesc_t *)element;
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddRLEContent(tracker, rleDesc->m_value, rleDesc->m_count));
+		}
+		break;
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_UNCOMPRESSED_DATA:
+		{
+			const zstdhl_BlockUncompressedDesc_t *uncompressedDesc = (const zstdhl_BlockUncompressedDesc_t *)element;
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddContent(tracker, uncompressedDesc->m_data, uncompressedDesc->m_size));
+		}
+		break;
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_END:
+		ZSTDHL_CHECKED(zstdhl_ContentTracker_FinishBlock(tracker));
+		break;
+	default:
+		break;
+	}
+
+	return output->m_reportDisassembledElementFunc(output->m_userdata, elementType, element);
+}
+
+zstdhl_ResultCode_t zstdhl_DisassembleImpl(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, zstdhl_Buffers_t *buffers, zstdhl_FramePersistentState_t *pstate, zstdhl_ContentTracker_t *contentTracker)
+{
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_ChecksumDisassemblyOutput_t checksumOutput;
+	zstdhl_DisassemblyOutputObject_t checksumOutputObj;
+	int disassembledBlockCount = 0;
+	uint32_t maxBlockSize = 0x1fffff;
+
+	ZSTDHL_CHECKED_PHASE(pstate->m_instrumentation, ZSTDHL_PHASE_FRAME_HEADER_PARSE, 0, 0, zstdhl_ParseFrameHeader(streamSource, &frameHeader));
+
+	disassemblyOutput->m_reportDisassembledElementFunc(disassemblyOutput->m_userdata, ZSTDHL_ELEMENT_TYPE_FRAME_HEADER, &frameHeader);
+
+	if (pstate->m_limits.m_maxWindowSize != 0 && frameHeader.m_windowSize > pstate->m_limits.m_maxWindowSize)
+		return ZSTDHL_RESULT_WINDOW_TOO_LARGE;
+
+	if (pstate->m_haveLimits)
+	{
+		maxBlockSize = ZSTDHL_MAX_BLOCK_SIZE;
+		if (frameHeader.m_windowSize < maxBlockSize)
+			maxBlockSize = (uint32_t)frameHeader.m_windowSize;
+	}
+
+	if (contentTracker && !frameHeader.m_haveContentChecksum && !contentTracker->m_contentOutput)
+		contentTracker = NULL;
+
+	pstate->m_contentTracker = contentTracker;
+
+	if (contentTracker)
+	{
+		zstdhl_ContentTracker_Reset(contentTracker, &frameHeader);
+
+		checksumOutput.m_output = disassemblyOutput;
+		checksumOutput.m_tracker = contentTracker;
+		checksumOutput.m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+		checksumOutput.m_litSectionHeader.m_regeneratedSize = 0;
+		checksumOutput.m_litSectionHeader.m_compressedSize = 0;
+
+		checksumOutputObj.m_reportDisassembledElementFunc = zstdhl_ChecksumDisassemblyOutput_ReportElement;
+		checksumOutputObj.m_userdata = &checksumOutput;
+
+		disassemblyOutput = &checksumOutputObj;
+	}
+
+	for (;;)
+	{
+		uint8_t blockHeaderBytes[3];
 		zstdhl_BlockHeaderDesc_t blockHeader;
 
 		ZSTDHL_CHECKED(zstdhl_ReadChecked(streamSource, blockHeaderBytes, 3, ZSTDHL_RESULT_BLOCK_HEADER_TRUNCATED));
@@ -2151,6 +2859,9 @@ zstdhl_ResultCode_t zstdhl_DisassembleImpl(const zstdhl_StreamSourceObject_t *st
 		if (blockHeader.m_blockType == ZSTDHL_BLOCK_TYPE_INVALID)
 			return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
 
+		if (blockHeader.m_blockSize > maxBlockSize)
+			return ZSTDHL_RESULT_BLOCK_SIZE_INVALID;
+
 		disassemblyOutput->m_reportDisassembledElementFunc(disassemblyOutput->m_userdata, ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER, &blockHeader);
 
 		switch (blockHeader.m_blockType)
@@ -2177,6 +2888,21 @@ zstdhl_ResultCode_t zstdhl_DisassembleImpl(const zstdhl_StreamSourceObject_t *st
 			break;
 	}
 
+	if (frameHeader.m_haveContentChecksum)
+	{
+		uint8_t checksumBytes[4];
+		uint32_t checksum = 0;
+
+		ZSTDHL_CHECKED(zstdhl_ReadChecked(streamSource, checksumBytes, 4, ZSTDHL_RESULT_CONTENT_CHECKSUM_TRUNCATED));
+
+		checksum = zstdhl_ReadLE32(checksumBytes);
+
+		ZSTDHL_CHECKED(disassemblyOutput->m_reportDisassembledElementFunc(disassemblyOutput->m_userdata, ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM, &checksum));
+
+		if (contentTracker && contentTracker->m_verifyChecksum && checksum != zstdhl_ContentTracker_GetChecksum(contentTracker))
+			return ZSTDHL_RESULT_CONTENT_CHECKSUM_MISMATCH;
+	}
+
 	ZSTDHL_CHECKED(disassemblyOutput->m_reportDisassembledElementFunc(disassemblyOutput->m_userdata, ZSTDHL_ELEMENT_TYPE_FRAME_END, NULL));
 
 	return ZSTDHL_RESULT_OK;
@@ -2196,6 +2922,8 @@ zstdhl_ResultCode_t zstdhl_BuildFSEDistributionTable_ZStd(zstdhl_FSETable_t *fse
 	uint32_t cellMask = numCells - 1;
 
 	uint32_t insertPos = 0;
+	uint64_t totalProb = 0;
+	uint8_t spreadSymbols[1 << ZSTDHL_MAX_LIT_LENGTH_ACCURACY_LOG];
 
 	fseTable->m_numCells = numCells;
 	fseTable->m_accuracyLog = accuracyLog;
@@ -2225,23 +2953,51 @@ zstdhl_ResultCode_t zstdhl_BuildFSEDistributionTable_ZStd(zstdhl_FSETable_t *fse
 			numNotLowProbCells--;
 			cells[numNotLowProbCells].m_sym = i;
 		}
+		else
+			totalProb += probs[i];
 	}
 
-	for (i = 0; i < numProbs; i++)
+	if (numNotLowProbCells == numCells && totalProb == numCells && numCells <= sizeof(spreadSymbols) && numProbs <= 256)
 	{
-		uint32_t prob = probs[i];
+		// No cells need to be skipped, so lay out each symbol's repetitions in order and then spread them in one pass
+		uint32_t spreadPos = 0;
+		uint32_t cellIndex = 0;
 
-		if (prob != ZSTDHL_LESS_THAN_ONE_VALUE && prob > 0)
+		for (i = 0; i < numProbs; i++)
 		{
+			uint32_t prob = probs[i];
+
 			while (prob > 0)
 			{
-				while (insertPos >= numNotLowProbCells)
-					insertPos = ((insertPos + advanceStep) & cellMask);
-
-				cells[insertPos].m_sym = i;
+				spreadSymbols[spreadPos++] = (uint8_t)i;
 				prob--;
+			}
+		}
 
-				insertPos = ((insertPos + advanceStep) & cellMask);
+		for (cellIndex = 0; cellIndex < numCells; cellIndex++)
+		{
+			cells[insertPos].m_sym = spreadSymbols[cellIndex];
+			insertPos = ((insertPos + advanceStep) & cellMask);
+		}
+	}
+	else
+	{
+		for (i = 0; i < numProbs; i++)
+		{
+			uint32_t prob = probs[i];
+
+			if (prob != ZSTDHL_LESS_THAN_ONE_VALUE && prob > 0)
+			{
+				while (prob > 0)
+				{
+					while (insertPos >= numNotLowProbCells)
+						insertPos = ((insertPos + advanceStep) & cellMask);
+
+					cells[insertPos].m_sym = i;
+					prob--;
+
+					insertPos = ((insertPos + advanceStep) & cellMask);
+				}
 			}
 		}
 	}
@@ -2277,24 +3033,70 @@ zstdhl_ResultCode_t zstdhl_BuildFSEDistributionTable_ZStd(zstdhl_FSETable_t *fse
 void zstdhl_BuildFSEEncodeTable(zstdhl_FSETableEnc_t *encTable, const zstdhl_FSETable_t *table, size_t numSymbols)
 {
 	size_t sym = 0;
-	size_t addlBits = 0;
 	size_t cellIndex = 0;
-	size_t numProbs = 0;
-	size_t numEncCells = numSymbols << table->m_accuracyLog;
+	int32_t cumulativeCells = 0;
+	uint8_t accuracyLog = table->m_accuracyLog;
+
+	for (sym = 0; sym < numSymbols; sym++)
+		encTable->m_symbolTransforms[sym].m_numCells = 0;
+
+	for (cellIndex = 0; cellIndex < table->m_numCells; cellIndex++)
+	{
+		sym = table->m_cells[cellIndex].m_sym;
+		if (sym < numSymbols)
+			encTable->m_symbolTransforms[sym].m_numCells++;
+	}
+
+	// The Nth cell of a symbol with C cells is entered from the states that shift down to C+N
+	for (sym = 0; sym < numSymbols; sym++)
+	{
+		zstdhl_FSESymbolEncTransform_t *transform = encTable->m_symbolTransforms + sym;
+		uint32_t numCells = transform->m_numCells;
+		uint8_t maxBitsOut = accuracyLog;
+
+		if (numCells > 1)
+			maxBitsOut = (uint8_t)(accuracyLog - zstdhl_Log2_32(numCells - 1));
 
-	for (cellIndex = 0; cellIndex < numEncCells; cellIndex++)
-		encTable->m_nextStates[cellIndex] = 0xffff;
+		transform->m_deltaNumBits = ((uint32_t)maxBitsOut << 16) - (numCells << maxBitsOut);
+		transform->m_deltaFindState = cumulativeCells;
+
+		cumulativeCells += (int32_t)numCells;
+	}
 
 	for (cellIndex = 0; cellIndex < table->m_numCells; cellIndex++)
 	{
-		const zstdhl_FSETableCell_t *tableCell = table->m_cells + cellIndex;
-		size_t numAddlBitStates = ((size_t)1 << tableCell->m_numBits);
+		sym = table->m_cells[cellIndex].m_sym;
+		if (sym < numSymbols)
+			encTable->m_stateTable[encTable->m_symbolTransforms[sym].m_deltaFindState++] = (uint16_t)cellIndex;
+	}
+
+	// m_deltaFindState is now past the end of the symbol's states
+	for (sym = 0; sym < numSymbols; sym++)
+	{
+		zstdhl_FSESymbolEncTransform_t *transform = encTable->m_symbolTransforms + sym;
 
-		for (addlBits = 0; addlBits < numAddlBitStates; addlBits++)
-			encTable->m_nextStates[(tableCell->m_sym << table->m_accuracyLog) + tableCell->m_baseline + addlBits] = (uint16_t)cellIndex;
+		transform->m_deltaFindState -= (int32_t)(transform->m_numCells * 2);
 	}
 }
 
+static zstdhl_ResultCode_t zstdhl_FSEEncodeTransition(const zstdhl_FSETableEnc_t *encTable, uint8_t accuracyLog, uint16_t sym, uint16_t *inOutState, uint32_t *outBits, uint8_t *outNumBits)
+{
+	const zstdhl_FSESymbolEncTransform_t *transform = encTable->m_symbolTransforms + sym;
+	uint32_t value = (uint32_t)(*inOutState) + ((uint32_t)1 << accuracyLog);
+	uint8_t numBits = 0;
+
+	if (transform->m_numCells == 0)
+		return ZSTDHL_RESULT_FSE_TABLE_MISSING_SYMBOL;
+
+	numBits = (uint8_t)((value + transform->m_deltaNumBits) >> 16);
+
+	*outBits = value & (((uint32_t)1 << numBits) - 1u);
+	*outNumBits = numBits;
+	*inOutState = encTable->m_stateTable[(int32_t)(value >> numBits) + transform->m_deltaFindState];
+
+	return ZSTDHL_RESULT_OK;
+}
+
 zstdhl_ResultCode_t zstdhl_FindInitialFSEState(const zstdhl_FSETable_t *table, uint16_t symbol, uint16_t *outInitialState)
 {
 	size_t i = 0;
@@ -2325,6 +3127,8 @@ zstdhl_ResultCode_t zstdhl_EncodeFSEValue(zstdhl_FSEEncStack_t *stack, const zst
 	uint16_t state = 0;
 	uint16_t stateMask = (1 << table->m_accuracyLog) - 1;
 	uint16_t nextState = 0;
+	uint32_t bits = 0;
+	uint8_t numBits = 0;
 
 	if (stack->m_statesStackVector.m_count == 0)
 	{
@@ -2338,10 +3142,9 @@ zstdhl_ResultCode_t zstdhl_EncodeFSEValue(zstdhl_FSEEncStack_t *stack, const zst
 
 	state = ((const uint16_t *)stack->m_statesStackVector.m_data)[stack->m_statesStackVector.m_count - 1];
 
-	nextState = encTable->m_nextStates[(value << table->m_accuracyLog) + (state & stateMask)];
+	nextState = (state & stateMask);
 
-	if (nextState == 0xffff)
-		return ZSTDHL_RESULT_FSE_TABLE_MISSING_SYMBOL;
+	ZSTDHL_CHECKED(zstdhl_FSEEncodeTransition(encTable, table->m_accuracyLog, value, &nextState, &bits, &numBits));
 
 	nextState += (state - (state & stateMask));
 
@@ -2536,20 +3339,69 @@ zstdhl_ResultCode_t zstdhl_ResolveOffsetCode32(zstdhl_OffsetType_t offsetType, u
 }
 
 ZSTDHL_EXTERN zstdhl_ResultCode_t zstdhl_Disassemble(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DictDesc_t *dictDesc, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return zstdhl_DisassembleWithLimits(streamSource, dictDesc, NULL, disassemblyOutput, alloc);
+}
+
+ZSTDHL_EXTERN zstdhl_ResultCode_t zstdhl_DisassembleWithLimits(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DictDesc_t *dictDesc, const zstdhl_DecodeLimits_t *limits, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return zstdhl_DisassembleWithOptions(streamSource, dictDesc, limits, 0, NULL, NULL, disassemblyOutput, alloc);
+}
+
+ZSTDHL_EXTERN zstdhl_ResultCode_t zstdhl_DisassembleWithOptions(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DictDesc_t *dictDesc, const zstdhl_DecodeLimits_t *limits, uint32_t flags, const zstdhl_InstrumentationObject_t *instrumentation, const zstdhl_EncoderOutputObject_t *contentOutput, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc)
 {
 	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
 	zstdhl_Buffers_t buffers;
 	zstdhl_FramePersistentState_t pstate;
+	zstdhl_ContentTracker_t contentTracker;
+	zstdhl_ContentTracker_t *activeTracker = NULL;
+	zstdhl_AllocTracker_t *limitTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t limitedAlloc;
+
+	// Dictionary content isn't available, so content can't be regenerated
+	if (contentOutput && dictDesc)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (limits && limits->m_maxMemory != 0)
+	{
+		ZSTDHL_CHECKED(zstdhl_AllocTracker_Create(alloc, &limitTracker));
+		zstdhl_AllocTracker_SetLimit(limitTracker, limits->m_maxMemory);
+		zstdhl_AllocTracker_GetAllocator(limitTracker, &limitedAlloc);
+		alloc = &limitedAlloc;
+	}
 
 	zstdhl_Buffers_Init(&buffers, alloc);
+	zstdhl_ContentTracker_Init(&contentTracker, alloc);
+
 	if (result == ZSTDHL_RESULT_OK)
 		result = zstdhl_FramePersistentState_Init(&pstate, dictDesc);
 
+	if (result == ZSTDHL_RESULT_OK && limits)
+	{
+		pstate.m_haveLimits = 1;
+		pstate.m_limits = *limits;
+	}
+
+	pstate.m_instrumentation = instrumentation;
+
 	if (result == ZSTDHL_RESULT_OK)
-		result = zstdhl_DisassembleImpl(streamSource, disassemblyOutput, &buffers, &pstate);
+	{
+		// Dictionary content isn't available, so frames using a dictionary can't be verified
+		contentTracker.m_verifyChecksum = ((flags & ZSTDHL_DISASSEMBLE_FLAG_VERIFY_CHECKSUM) && !dictDesc);
+		contentTracker.m_contentOutput = contentOutput;
+
+		if (contentTracker.m_verifyChecksum || contentOutput)
+			activeTracker = &contentTracker;
 
+		result = zstdhl_DisassembleImpl(streamSource, disassemblyOutput, &buffers, &pstate, activeTracker);
+	}
+
+	zstdhl_ContentTracker_Destroy(&contentTracker);
 	zstdhl_Buffers_DeallocAll(&buffers);
 
+	if (limitTracker)
+		zstdhl_AllocTracker_Destroy(limitTracker);
+
 	return result;
 }
 
@@ -2575,7 +3427,7 @@ zstdhl_ResultCode_t zstdhl_DisassembleDictImpl(const zstdhl_StreamSourceObject_t
 	// Decode entropy tables
 	{
 		zstdhl_HuffmanTreeDesc_t treeDesc;
-		ZSTDHL_CHECKED(zstdhl_ParseHuffmanTreeDescription(streamSource, disassemblyOutput, buffers, &treeDesc));
+		ZSTDHL_CHECKED(zstdhl_ParseHuffmanTreeDescription(streamSource, disassemblyOutput, buffers, &treeDesc, pstate->m_instrumentation));
 		ZSTDHL_CHECKED(zstdhl_GenerateHuffmanDecodeTable(&treeDesc.m_partialWeightDesc, &pstate->m_huffmanTable));
 		pstate->m_haveHuffmanTable = 1;
 
@@ -2585,17 +3437,15 @@ zstdhl_ResultCode_t zstdhl_DisassembleDictImpl(const zstdhl_StreamSourceObject_t
 			zstdhl_OffsetProbDecodeState_t offsetProbHandler;
 			uint8_t headerByte = 0xa8;
 
-			offsetProbHandler.m_alternator = 0;
-			offsetProbHandler.m_buffers = buffers;
-			offsetProbHandler.m_currentCapacity = 0;
+			zstdhl_OffsetProbDecodeState_Init(&offsetProbHandler, buffers, &pstate->m_limits);
 
 			zstdhl_SimpleProbDecodeState_Init(&litLenProbHandler, pstate->m_litLengthProbs, zstdhl_litLenSDef.m_numProbs, ZSTDHL_RESULT_TOO_MANY_PROBS);
 			zstdhl_SimpleProbDecodeState_Init(&matchLenProbHandler, pstate->m_matchLengthProbs, zstdhl_matchLenSDef.m_numProbs, ZSTDHL_RESULT_TOO_MANY_PROBS);
 
 			// Not the same order as sequences
-			ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(streamSource, disassemblyOutput, headerByte, 4, &zstdhl_offsetCodeSDef, &pstate->m_offsetsCDef, zstdhl_OffsetsRequestMoreCapacity, zstdhl_OffsetsClear, &offsetProbHandler));
-			ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(streamSource, disassemblyOutput, headerByte, 2, &zstdhl_matchLenSDef, &pstate->m_matchLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &matchLenProbHandler));
-			ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(streamSource, disassemblyOutput, headerByte, 6, &zstdhl_litLenSDef, &pstate->m_literalLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &litLenProbHandler));
+			ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(streamSource, disassemblyOutput, headerByte, 4, &zstdhl_offsetCodeSDef, &pstate->m_offsetsCDef, zstdhl_OffsetsRequestMoreCapacity, zstdhl_OffsetsClear, &offsetProbHandler, pstate->m_instrumentation));
+			ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(streamSource, disassemblyOutput, headerByte, 2, &zstdhl_matchLenSDef, &pstate->m_matchLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &matchLenProbHandler, pstate->m_instrumentation));
+			ZSTDHL_CHECKED(zstdhl_ParseCompressionDef(streamSource, disassemblyOutput, headerByte, 6, &zstdhl_litLenSDef, &pstate->m_literalLengthsCDef, zstdhl_SimpleProbRequestMoreCapacity, zstdhl_SimpleProbClear, &litLenProbHandler, pstate->m_instrumentation));
 		}
 	}
 
@@ -2651,6 +3501,21 @@ void zstdhl_Vector_Init(zstdhl_Vector_t *vec, size_t elementSize, const zstdhl_M
 	vec->m_count = 0;
 	vec->m_elementSize = elementSize;
 	vec->m_maxCapacity = SIZE_MAX / elementSize;
+	vec->m_allocSite = ZSTDHL_ALLOC_SITE_VECTOR;
+}
+
+void zstdhl_Vector_InitFixed(zstdhl_Vector_t *vec, size_t elementSize, void *buffer, size_t capacity)
+{
+	vec->m_alloc.m_reallocFunc = NULL;
+	vec->m_alloc.m_userdata = NULL;
+	vec->m_capacity = capacity;
+	vec->m_capacityBytes = capacity * elementSize;
+	vec->m_data = buffer;
+	vec->m_dataEnd = buffer;
+	vec->m_count = 0;
+	vec->m_elementSize = elementSize;
+	vec->m_maxCapacity = capacity;
+	vec->m_allocSite = ZSTDHL_ALLOC_SITE_VECTOR;
 }
 
 zstdhl_ResultCode_t zstdhl_Vector_Append(zstdhl_Vector_t *vec, const void *data, size_t count)
@@ -2658,7 +3523,6 @@ zstdhl_ResultCode_t zstdhl_Vector_Append(zstdhl_Vector_t *vec, const void *data,
 	size_t numericallyAvailable = vec->m_maxCapacity - vec->m_count;
 	size_t requiredCapacity = 0;
 	uint8_t *destBytes = NULL;
-	size_t i = 0;
 	size_t bytesToCopy = 0;
 	int wasResized = 0;
 
@@ -2666,7 +3530,7 @@ zstdhl_ResultCode_t zstdhl_Vector_Append(zstdhl_Vector_t *vec, const void *data,
 		return ZSTDHL_RESULT_OK;
 
 	if (numericallyAvailable < count)
-		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+		return vec->m_alloc.m_reallocFunc ? ZSTDHL_RESULT_OUT_OF_MEMORY : ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL;
 
 	requiredCapacity = vec->m_count + count;
 
@@ -2686,7 +3550,7 @@ zstdhl_ResultCode_t zstdhl_Vector_Append(zstdhl_Vector_t *vec, const void *data,
 			newCapacityTarget *= 2u;
 		}
 
-		newPtr = vec->m_alloc.m_reallocFunc(vec->m_alloc.m_userdata, vec->m_data, newCapacityTarget * vec->m_elementSize);
+		newPtr = zstdhl_ReallocAtSite(&vec->m_alloc, vec->m_data, newCapacityTarget * vec->m_elementSize, vec->m_allocSite);
 		if (!newPtr)
 			return ZSTDHL_RESULT_OUT_OF_MEMORY;
 
@@ -2699,15 +3563,10 @@ zstdhl_ResultCode_t zstdhl_Vector_Append(zstdhl_Vector_t *vec, const void *data,
 	}
 
 	destBytes = (uint8_t *)vec->m_dataEnd;
+	bytesToCopy = count * vec->m_elementSize;
 
 	if (data)
-	{
-		const uint8_t *srcBytes = (const uint8_t *)data;
-		bytesToCopy = count * vec->m_elementSize;
-
-		for (i = 0; i < bytesToCopy; i++)
-			destBytes[i] = srcBytes[i];
-	}
+		memcpy(destBytes, data, bytesToCopy);
 
 	vec->m_dataEnd = destBytes + bytesToCopy;
 	vec->m_count += count;
@@ -2729,9 +3588,9 @@ void zstdhl_Vector_Shrink(zstdhl_Vector_t *vec, size_t newCount)
 
 void zstdhl_Vector_Reset(zstdhl_Vector_t *vec)
 {
-	if (vec->m_data)
+	if (vec->m_data && vec->m_alloc.m_reallocFunc)
 	{
-		vec->m_alloc.m_reallocFunc(vec->m_alloc.m_userdata, vec->m_data, 0);
+		zstdhl_ReallocAtSite(&vec->m_alloc, vec->m_data, 0, vec->m_allocSite);
 		vec->m_data = NULL;
 		vec->m_dataEnd = NULL;
 		vec->m_capacity = 0;
@@ -2764,9 +3623,37 @@ zstdhl_ResultCode_t zstdhl_InitAssemblerState(zstdhl_AssemblerPersistentState_t
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_AssembleFrame(const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncoderOutputObject_t *assemblyOutput, uint64_t optFrameContentSize)
+static void zstdhl_CopyAsmPersistentTableState(zstdhl_AsmPersistentTableState_t *dest, const zstdhl_AsmPersistentTableState_t *src, zstdhl_FSETableCell_t *destCells)
+{
+	uint32_t i = 0;
+
+	dest->m_isAssigned = src->m_isAssigned;
+	dest->m_isRLE = src->m_isRLE;
+	dest->m_rleByte = src->m_rleByte;
+	dest->m_table.m_cells = destCells;
+	dest->m_table.m_numCells = src->m_table.m_numCells;
+	dest->m_table.m_accuracyLog = src->m_table.m_accuracyLog;
+
+	// Only the cells of an assigned FSE table are valid
+	if (!src->m_isAssigned || src->m_isRLE)
+		return;
+
+	for (i = 0; i < src->m_table.m_numCells; i++)
+		destCells[i] = src->m_table.m_cells[i];
+}
+
+void zstdhl_CopyAssemblerState(zstdhl_AssemblerPersistentState_t *dest, const zstdhl_AssemblerPersistentState_t *src)
+{
+	dest->m_huffmanTree = src->m_huffmanTree;
+	dest->m_haveHuffmanTree = src->m_haveHuffmanTree;
+
+	zstdhl_CopyAsmPersistentTableState(&dest->m_litLengthTable, &src->m_litLengthTable, dest->m_litLengthCells);
+	zstdhl_CopyAsmPersistentTableState(&dest->m_matchLengthTable, &src->m_matchLengthTable, dest->m_matchLengthCells);
+	zstdhl_CopyAsmPersistentTableState(&dest->m_offsetTable, &src->m_offsetTable, dest->m_offsetCells);
+}
+
+static zstdhl_ResultCode_t zstdhl_EncodeFrameHeader(const zstdhl_FrameHeaderDesc_t *encFrame, uint8_t *headerData, uint8_t *outHeaderSize)
 {
-	uint8_t headerData[18];
 	uint8_t writeOffset = 0;
 	uint8_t frameHeaderDescriptor = 0;
 	uint8_t dictIDSize = 0;
@@ -2816,14 +3703,16 @@ zstdhl_ResultCode_t zstdhl_AssembleFrame(const zstdhl_FrameHeaderDesc_t *encFram
 			fcsSize = 8;
 			frameHeaderDescriptor |= (3 << 6);
 		}
-		else if (encFrame->m_frameContentSize > 0xffffu)
+		else if (encFrame->m_frameContentSize > 0xffffu + 256u || (encFrame->m_frameContentSize < 256u && !encFrame->m_isSingleSegment))
 		{
 			fcsSize = 4;
 			frameHeaderDescriptor |= (2 << 6);
 		}
-		else if (encFrame->m_frameContentSize > 0xffu || !encFrame->m_isSingleSegment)
+		else if (encFrame->m_frameContentSize >= 256u)
 		{
+			// 2-byte sizes are stored with an offset of 256
 			fcsSize = 2;
+			fcs -= 256u;
 			frameHeaderDescriptor |= (1 << 6);
 		}
 		else
@@ -2880,61 +3769,185 @@ zstdhl_ResultCode_t zstdhl_AssembleFrame(const zstdhl_FrameHeaderDesc_t *encFram
 		fcsSize--;
 	}
 
-	ZSTDHL_CHECKED(assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, headerData, writeOffset));
+	*outHeaderSize = writeOffset;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t zstdhl_AssembleFrame(const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncoderOutputObject_t *assemblyOutput, uint64_t optFrameContentSize)
+{
+	uint8_t headerData[ZSTDHL_MAX_FRAME_HEADER_SIZE];
+	uint8_t headerSize = 0;
+
+	ZSTDHL_CHECKED(zstdhl_EncodeFrameHeader(encFrame, headerData, &headerSize));
+	ZSTDHL_CHECKED(assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, headerData, headerSize));
 
 	return ZSTDHL_RESULT_OK;
 }
 
-typedef struct zstdhl_SequenceEncStackItem
+typedef struct zstdhl_LE64BitWriter
 {
-	size_t m_dcmp;	// TODO: Remove
-	uint8_t m_litLengthCode;
-	uint8_t m_matchLengthCode;
-	uint8_t m_offsetCode;
-	uint8_t m_numOffsetExtraBits;
-	uint8_t m_numLitLengthExtraBits;
-	uint8_t m_numMatchLengthExtraBits;
+	uint64_t m_bits;
+	uint8_t m_numBits;
+	uint8_t *m_out;
+} zstdhl_LE64BitWriter_t;
+
+// Writes all complete bytes.  Always stores 8 bytes, so the output must have 8 bytes of slack.
+static void zstdhl_LE64BitWriter_Flush(zstdhl_LE64BitWriter_t *writer)
+{
+	uint8_t *out = writer->m_out;
+	uint64_t bits = writer->m_bits;
+	uint8_t numBytes = writer->m_numBits / 8u;
+
+	out[0] = (uint8_t)(bits >> 0);
+	out[1] = (uint8_t)(bits >> 8);
+	out[2] = (uint8_t)(bits >> 16);
+	out[3] = (uint8_t)(bits >> 24);
+	out[4] = (uint8_t)(bits >> 32);
+	out[5] = (uint8_t)(bits >> 40);
+	out[6] = (uint8_t)(bits >> 48);
+	out[7] = (uint8_t)(bits >> 56);
+
+	writer->m_out += numBytes;
+	writer->m_bits = (numBytes == 8) ? 0 : (bits >> (numBytes * 8u));
+	writer->m_numBits -= numBytes * 8u;
+}
+
+// numBits must be 32 or less
+static void zstdhl_LE64BitWriter_Write(zstdhl_LE64BitWriter_t *writer, uint32_t bits, uint8_t numBits)
+{
+	if (writer->m_numBits + numBits > 63u)
+		zstdhl_LE64BitWriter_Flush(writer);
 
-	uint64_t m_offsetExtraBits;
-	uint32_t m_matchLengthExtraBits;
-	uint32_t m_litLengthExtraBits;
-} zstdhl_SequenceEncStackItem_t;
+	writer->m_bits |= ((uint64_t)bits) << writer->m_numBits;
+	writer->m_numBits += numBits;
+}
 
 #define ZSTDHL_ASM_MAX_OFFSET_CODE 31
+#define ZSTDHL_MAX_PREDEFINED_ACCURACY_LOG 6
+
+// Tables for the predefined distributions, built once and then shared read-only
+typedef struct zstdhl_PredefinedFSETable
+{
+	zstdhl_FSETable_t m_table;
+	zstdhl_FSETableEnc_t m_encTable;
+
+	zstdhl_FSETableCell_t m_cells[1 << ZSTDHL_MAX_PREDEFINED_ACCURACY_LOG];
+	zstdhl_FSESymbolEncTransform_t m_symbolTransforms[ZSTDHL_MAX_MATCH_LENGTH_CODE + 1];
+	uint16_t m_stateTable[1 << ZSTDHL_MAX_PREDEFINED_ACCURACY_LOG];
+} zstdhl_PredefinedFSETable_t;
+
+static zstdhl_PredefinedFSETable_t zstdhl_predefinedLitLengthTable;
+static zstdhl_PredefinedFSETable_t zstdhl_predefinedMatchLengthTable;
+static zstdhl_PredefinedFSETable_t zstdhl_predefinedOffsetTable;
+static zstdhl_Once_t zstdhl_predefinedTablesOnce = ZSTDHL_ONCE_INIT;
+
+static void zstdhl_BuildPredefinedFSETable(zstdhl_PredefinedFSETable_t *predefined, const zstdhl_SubstreamCompressionStructureDef_t *sdef, uint16_t numSymbols)
+{
+	zstdhl_FSETableDef_t tableDef;
+	zstdhl_FSESymbolTemp_t symbolTemps[64];
+
+	tableDef.m_accuracyLog = sdef->m_defaultAccuracyLog;
+	tableDef.m_numProbabilities = sdef->m_numProbs;
+	tableDef.m_probabilities = sdef->m_defaultProbs;
+
+	predefined->m_table.m_cells = predefined->m_cells;
+	predefined->m_encTable.m_symbolTransforms = predefined->m_symbolTransforms;
+	predefined->m_encTable.m_stateTable = predefined->m_stateTable;
+
+	// The predefined distributions are always valid
+	zstdhl_BuildFSEDistributionTable_ZStd(&predefined->m_table, &tableDef, symbolTemps);
+	zstdhl_BuildFSEEncodeTable(&predefined->m_encTable, &predefined->m_table, numSymbols);
+}
+
+static void zstdhl_BuildPredefinedFSETables(void)
+{
+	zstdhl_BuildPredefinedFSETable(&zstdhl_predefinedLitLengthTable, zstdhl_GetDefaultLitLengthFSEProperties(), ZSTDHL_MAX_LIT_LENGTH_CODE + 1);
+	zstdhl_BuildPredefinedFSETable(&zstdhl_predefinedMatchLengthTable, zstdhl_GetDefaultMatchLengthFSEProperties(), ZSTDHL_MAX_MATCH_LENGTH_CODE + 1);
+	zstdhl_BuildPredefinedFSETable(&zstdhl_predefinedOffsetTable, zstdhl_GetDefaultOffsetFSEProperties(), ZSTDHL_ASM_MAX_OFFSET_CODE + 1);
+}
+
+static void zstdhl_InitPredefinedFSETables(void)
+{
+	zstdhl_Once_Call(&zstdhl_predefinedTablesOnce, zstdhl_BuildPredefinedFSETables);
+}
+
+static void zstdhl_AssignPredefinedFSETable(zstdhl_AsmPersistentTableState_t *tableState, const zstdhl_PredefinedFSETable_t *predefined)
+{
+	uint32_t i = 0;
+
+	tableState->m_isAssigned = 1;
+	tableState->m_isRLE = 0;
+	tableState->m_table.m_numCells = predefined->m_table.m_numCells;
+	tableState->m_table.m_accuracyLog = predefined->m_table.m_accuracyLog;
+
+	for (i = 0; i < predefined->m_table.m_numCells; i++)
+		tableState->m_table.m_cells[i] = predefined->m_cells[i];
+}
 
 typedef struct zstdhl_AsmTableState
 {
 	uint8_t m_maxAccuracyLog;
 	uint16_t m_maxSymbols;
 	zstdhl_FSETableEnc_t m_encTable;
+	const zstdhl_FSETableEnc_t *m_activeEncTable;	// m_encTable or the predefined encode table
 	const zstdhl_SubstreamCompressionStructureDef_t *m_sdef;
+	const zstdhl_PredefinedFSETable_t *m_predefined;
 	zstdhl_AsmPersistentTableState_t *m_pstate;
+
+	uint8_t m_encTableValid;			// m_activeEncTable matches m_pstate->m_table
+	uint8_t m_encTableIsPredefined;		// m_pstate->m_table was built from the predefined distribution
 } zstdhl_AsmTableState_t;
 
-void zstdhl_AsmTableState_Init(zstdhl_AsmTableState_t *tableState, uint16_t *nextStates, uint8_t maxAccuracyLog, uint16_t maxSymbol, zstdhl_AsmPersistentTableState_t *pstate, const zstdhl_SubstreamCompressionStructureDef_t *sdef)
+void zstdhl_AsmTableState_Init(zstdhl_AsmTableState_t *tableState, zstdhl_FSESymbolEncTransform_t *symbolTransforms, uint16_t *stateTable, uint8_t maxAccuracyLog, uint16_t maxSymbol, zstdhl_AsmPersistentTableState_t *pstate, const zstdhl_SubstreamCompressionStructureDef_t *sdef, const zstdhl_PredefinedFSETable_t *predefined)
 {
 	tableState->m_maxAccuracyLog = maxAccuracyLog;
 	tableState->m_maxSymbols = maxSymbol + 1;
 	tableState->m_sdef = sdef;
+	tableState->m_predefined = predefined;
 	tableState->m_pstate = pstate;
 
-	tableState->m_encTable.m_nextStates = nextStates;
+	tableState->m_encTable.m_symbolTransforms = symbolTransforms;
+	tableState->m_encTable.m_stateTable = stateTable;
+	tableState->m_activeEncTable = &tableState->m_encTable;
+	tableState->m_encTableValid = 0;
+	tableState->m_encTableIsPredefined = 0;
 }
 
 typedef struct zstdhl_AsmState
 {
 	zstdhl_Vector_t m_dataBlockVector;
 	zstdhl_Vector_t m_litDataVector;
+	zstdhl_Vector_t m_autoLitDataVector;
 	zstdhl_Vector_t m_huffmanTreeDescVector;
 	zstdhl_Vector_t m_huffmanStreamVectors[4];
 
-	zstdhl_Vector_t m_encStackItemVector;
+	// Per-sequence FSE codes and extra bits, in structure-of-arrays form
+	zstdhl_Vector_t m_litLengthCodeVector;
+	zstdhl_Vector_t m_matchLengthCodeVector;
+	zstdhl_Vector_t m_offsetCodeVector;
+	zstdhl_Vector_t m_lengthExtraBitCountVector;
+	zstdhl_Vector_t m_lengthExtraBitsVector;	// Lit length extra bits, then match length extra bits
+	zstdhl_Vector_t m_offsetExtraBitsVector;
+
+	// Candidate tables for automatic sequence compression mode selection
+	zstdhl_Vector_t m_autoSeqProbsVectors[3];
+	zstdhl_Vector_t m_autoSeqTempProbsVector;
 
 	zstdhl_AssemblerPersistentState_t *m_persistentState;
 
-	uint16_t m_offsetNextStates[(ZSTDHL_ASM_MAX_OFFSET_CODE + 1) << ZSTDHL_MAX_OFFSET_ACCURACY_LOG];
-	uint16_t m_matchLengthNextStates[(ZSTDHL_MAX_MATCH_LENGTH_CODE + 1) << ZSTDHL_MAX_MATCH_LENGTH_ACCURACY_LOG];
-	uint16_t m_litLengthNextStates[(ZSTDHL_MAX_LIT_LENGTH_CODE + 1) << ZSTDHL_MAX_LIT_LENGTH_ACCURACY_LOG];
+	// If set, block content is reconstructed for the content checksum
+	zstdhl_ContentTracker_t *m_contentTracker;
+
+	const zstdhl_InstrumentationObject_t *m_instrumentation;
+
+	zstdhl_FSESymbolEncTransform_t m_offsetSymbolTransforms[ZSTDHL_ASM_MAX_OFFSET_CODE + 1];
+	zstdhl_FSESymbolEncTransform_t m_matchLengthSymbolTransforms[ZSTDHL_MAX_MATCH_LENGTH_CODE + 1];
+	zstdhl_FSESymbolEncTransform_t m_litLengthSymbolTransforms[ZSTDHL_MAX_LIT_LENGTH_CODE + 1];
+
+	uint16_t m_offsetStateTable[1 << ZSTDHL_MAX_OFFSET_ACCURACY_LOG];
+	uint16_t m_matchLengthStateTable[1 << ZSTDHL_MAX_MATCH_LENGTH_ACCURACY_LOG];
+	uint16_t m_litLengthStateTable[1 << ZSTDHL_MAX_LIT_LENGTH_ACCURACY_LOG];
 
 	zstdhl_AsmTableState_t m_litLengthEncTable;
 	zstdhl_AsmTableState_t m_matchLengthEncTable;
@@ -2947,17 +3960,54 @@ static void zstdhl_AsmState_Init(zstdhl_AsmState_t *asmState, zstdhl_AssemblerPe
 
 	zstdhl_Vector_Init(&asmState->m_dataBlockVector, 1, alloc);
 	zstdhl_Vector_Init(&asmState->m_litDataVector, 1, alloc);
+	zstdhl_Vector_Init(&asmState->m_autoLitDataVector, 1, alloc);
 	zstdhl_Vector_Init(&asmState->m_huffmanTreeDescVector, 1, alloc);
-	zstdhl_Vector_Init(&asmState->m_encStackItemVector, sizeof(zstdhl_SequenceEncStackItem_t), alloc);
+	zstdhl_Vector_Init(&asmState->m_litLengthCodeVector, 1, alloc);
+	zstdhl_Vector_Init(&asmState->m_matchLengthCodeVector, 1, alloc);
+	zstdhl_Vector_Init(&asmState->m_offsetCodeVector, 1, alloc);
+	zstdhl_Vector_Init(&asmState->m_lengthExtraBitCountVector, 1, alloc);
+	zstdhl_Vector_Init(&asmState->m_lengthExtraBitsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&asmState->m_offsetExtraBitsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&asmState->m_autoSeqTempProbsVector, sizeof(uint32_t), alloc);
 
 	for (i = 0; i < 4; i++)
 		zstdhl_Vector_Init(&asmState->m_huffmanStreamVectors[i], 1, alloc);
 
-	zstdhl_AsmTableState_Init(&asmState->m_litLengthEncTable, asmState->m_litLengthNextStates, ZSTDHL_MAX_LIT_LENGTH_ACCURACY_LOG, ZSTDHL_MAX_LIT_LENGTH_CODE, &persistentState->m_litLengthTable, zstdhl_GetDefaultLitLengthFSEProperties());
-	zstdhl_AsmTableState_Init(&asmState->m_matchLengthEncTable, asmState->m_matchLengthNextStates, ZSTDHL_MAX_MATCH_LENGTH_ACCURACY_LOG, ZSTDHL_MAX_MATCH_LENGTH_CODE, &persistentState->m_matchLengthTable, zstdhl_GetDefaultMatchLengthFSEProperties());
-	zstdhl_AsmTableState_Init(&asmState->m_offsetEncTable, asmState->m_offsetNextStates, ZSTDHL_MAX_OFFSET_ACCURACY_LOG, ZSTDHL_ASM_MAX_OFFSET_CODE, &persistentState->m_offsetTable, zstdhl_GetDefaultOffsetFSEProperties());
+	for (i = 0; i < 3; i++)
+		zstdhl_Vector_Init(&asmState->m_autoSeqProbsVectors[i], sizeof(uint32_t), alloc);
+
+	zstdhl_InitPredefinedFSETables();
+
+	zstdhl_AsmTableState_Init(&asmState->m_litLengthEncTable, asmState->m_litLengthSymbolTransforms, asmState->m_litLengthStateTable, ZSTDHL_MAX_LIT_LENGTH_ACCURACY_LOG, ZSTDHL_MAX_LIT_LENGTH_CODE, &persistentState->m_litLengthTable, zstdhl_GetDefaultLitLengthFSEProperties(), &zstdhl_predefinedLitLengthTable);
+	zstdhl_AsmTableState_Init(&asmState->m_matchLengthEncTable, asmState->m_matchLengthSymbolTransforms, asmState->m_matchLengthStateTable, ZSTDHL_MAX_MATCH_LENGTH_ACCURACY_LOG, ZSTDHL_MAX_MATCH_LENGTH_CODE, &persistentState->m_matchLengthTable, zstdhl_GetDefaultMatchLengthFSEProperties(), &zstdhl_predefinedMatchLengthTable);
+	zstdhl_AsmTableState_Init(&asmState->m_offsetEncTable, asmState->m_offsetSymbolTransforms, asmState->m_offsetStateTable, ZSTDHL_MAX_OFFSET_ACCURACY_LOG, ZSTDHL_ASM_MAX_OFFSET_CODE, &persistentState->m_offsetTable, zstdhl_GetDefaultOffsetFSEProperties(), &zstdhl_predefinedOffsetTable);
 
 	asmState->m_persistentState = persistentState;
+	asmState->m_contentTracker = NULL;
+	asmState->m_instrumentation = NULL;
+}
+
+static void zstdhl_AsmState_Clear(zstdhl_AsmState_t *asmState)
+{
+	int i = 0;
+
+	zstdhl_Vector_Clear(&asmState->m_dataBlockVector);
+	zstdhl_Vector_Clear(&asmState->m_litDataVector);
+	zstdhl_Vector_Clear(&asmState->m_autoLitDataVector);
+	zstdhl_Vector_Clear(&asmState->m_huffmanTreeDescVector);
+	zstdhl_Vector_Clear(&asmState->m_litLengthCodeVector);
+	zstdhl_Vector_Clear(&asmState->m_matchLengthCodeVector);
+	zstdhl_Vector_Clear(&asmState->m_offsetCodeVector);
+	zstdhl_Vector_Clear(&asmState->m_lengthExtraBitCountVector);
+	zstdhl_Vector_Clear(&asmState->m_lengthExtraBitsVector);
+	zstdhl_Vector_Clear(&asmState->m_offsetExtraBitsVector);
+	zstdhl_Vector_Clear(&asmState->m_autoSeqTempProbsVector);
+
+	for (i = 0; i < 4; i++)
+		zstdhl_Vector_Clear(&asmState->m_huffmanStreamVectors[i]);
+
+	for (i = 0; i < 3; i++)
+		zstdhl_Vector_Clear(&asmState->m_autoSeqProbsVectors[i]);
 }
 
 static void zstdhl_AsmState_Destroy(zstdhl_AsmState_t *asmState)
@@ -2966,11 +4016,21 @@ static void zstdhl_AsmState_Destroy(zstdhl_AsmState_t *asmState)
 
 	zstdhl_Vector_Destroy(&asmState->m_dataBlockVector);
 	zstdhl_Vector_Destroy(&asmState->m_litDataVector);
+	zstdhl_Vector_Destroy(&asmState->m_autoLitDataVector);
 	zstdhl_Vector_Destroy(&asmState->m_huffmanTreeDescVector);
-	zstdhl_Vector_Destroy(&asmState->m_encStackItemVector);
+	zstdhl_Vector_Destroy(&asmState->m_litLengthCodeVector);
+	zstdhl_Vector_Destroy(&asmState->m_matchLengthCodeVector);
+	zstdhl_Vector_Destroy(&asmState->m_offsetCodeVector);
+	zstdhl_Vector_Destroy(&asmState->m_lengthExtraBitCountVector);
+	zstdhl_Vector_Destroy(&asmState->m_lengthExtraBitsVector);
+	zstdhl_Vector_Destroy(&asmState->m_offsetExtraBitsVector);
+	zstdhl_Vector_Destroy(&asmState->m_autoSeqTempProbsVector);
 
 	for (i = 0; i < 4; i++)
 		zstdhl_Vector_Destroy(&asmState->m_huffmanStreamVectors[i]);
+
+	for (i = 0; i < 3; i++)
+		zstdhl_Vector_Destroy(&asmState->m_autoSeqProbsVectors[i]);
 }
 
 static zstdhl_ResultCode_t zstdhl_WriteLiteralsSectionHeader(zstdhl_AsmState_t *asmState, uint64_t litSectionHeader, uint8_t litSectionHeaderSize)
@@ -2993,68 +4053,109 @@ static zstdhl_ResultCode_t zstdhl_WriteLiteralsSectionHeader(zstdhl_AsmState_t *
 	return ZSTDHL_RESULT_OK;
 }
 
-typedef struct zstdhl_HuffmanEncBitstreamState
+size_t zstdhl_HuffmanStreamBound(size_t numLiterals)
 {
-	uint32_t m_bits;
-	uint8_t m_bitsAvailable;
-	zstdhl_Vector_t *m_outVector;
-} zstdhl_HuffmanEncBitstreamState_t;
+	return (numLiterals * ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 8u) / 8u + 8u;
+}
 
-static zstdhl_ResultCode_t zstdhl_HuffmanEncBitstreamState_Init(zstdhl_HuffmanEncBitstreamState_t *state, zstdhl_Vector_t *vector)
+// Returns 1 if the symbol is missing from the table
+static uint8_t zstdhl_PutHuffmanSymbol(zstdhl_LE64BitWriter_t *writer, const zstdhl_HuffmanTableEnc_t *encTable, uint8_t symbol)
 {
-	state->m_outVector = vector;
-	state->m_bits = 0;
-	state->m_bitsAvailable = 32;
+	const zstdhl_HuffmanTableEncEntry_t *entry = &encTable->m_entries[symbol];
 
-	return ZSTDHL_RESULT_OK;
+	writer->m_bits |= ((uint64_t)entry->m_bits) << writer->m_numBits;
+	writer->m_numBits += entry->m_numBits;
+
+	return (entry->m_numBits == 0);
 }
 
-static zstdhl_ResultCode_t zstdhl_FlushHuffmanStream(zstdhl_HuffmanEncBitstreamState_t *encStream, uint8_t numBytesToFlush)
+zstdhl_ResultCode_t zstdhl_EncodeHuffmanStreams(const zstdhl_HuffmanTableEnc_t *encTable, const uint8_t *literals, const size_t *streamSizes, uint8_t numStreams, uint8_t *const *outStreams, size_t *outStreamSizes)
 {
-	uint32_t bits = encStream->m_bits;
-	uint8_t bitsAvailable = encStream->m_bitsAvailable;
-	uint8_t bytesToWrite[4];
-	int i = 0;
+	zstdhl_LE64BitWriter_t writers[4];
+	const uint8_t *streamEnds[4];
+	size_t interleavedLength = 0;
+	size_t t = 0;
+	uint8_t missingSymbol = 0;
+	uint8_t s = 0;
 
-	for (i = 0; i < numBytesToFlush; i++)
+	if (numStreams == 0 || numStreams > 4)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	interleavedLength = streamSizes[0];
+
+	for (s = 0; s < numStreams; s++)
 	{
-		if (bitsAvailable > 24)
-			return ZSTDHL_RESULT_INTERNAL_ERROR;
+		writers[s].m_bits = 0;
+		writers[s].m_numBits = 0;
+		writers[s].m_out = outStreams[s];
 
-		bytesToWrite[i] = (uint8_t)((bits >> 24) & 0xff);
-		bitsAvailable += 8;
-		bits = (bits & 0x00ffffffu) << 8;
+		literals += streamSizes[s];
+		streamEnds[s] = literals;
+
+		if (streamSizes[s] < interleavedLength)
+			interleavedLength = streamSizes[s];
 	}
 
-	ZSTDHL_CHECKED(zstdhl_Vector_Append(encStream->m_outVector, bytesToWrite, numBytesToFlush));
+	interleavedLength -= interleavedLength % 4u;
 
-	encStream->m_bits = bits;
-	encStream->m_bitsAvailable = bitsAvailable;
+	// Symbols are written last to first.  4 symbols of up to 11 bits each fit after a flush.
+	if (numStreams == 4)
+	{
+		for (t = 0; t < interleavedLength; t += 4)
+		{
+			size_t u = 0;
 
-	return ZSTDHL_RESULT_OK;
-}
+			for (u = 1; u <= 4; u++)
+			{
+				missingSymbol |= zstdhl_PutHuffmanSymbol(&writers[0], encTable, streamEnds[0][0 - t - u]);
+				missingSymbol |= zstdhl_PutHuffmanSymbol(&writers[1], encTable, streamEnds[1][0 - t - u]);
+				missingSymbol |= zstdhl_PutHuffmanSymbol(&writers[2], encTable, streamEnds[2][0 - t - u]);
+				missingSymbol |= zstdhl_PutHuffmanSymbol(&writers[3], encTable, streamEnds[3][0 - t - u]);
+			}
 
-static zstdhl_ResultCode_t zstdhl_WriteHuffmanBits(zstdhl_HuffmanEncBitstreamState_t *encStream, uint32_t bits, uint8_t numBits)
-{
-	if (encStream->m_bitsAvailable < numBits)
+			zstdhl_LE64BitWriter_Flush(&writers[0]);
+			zstdhl_LE64BitWriter_Flush(&writers[1]);
+			zstdhl_LE64BitWriter_Flush(&writers[2]);
+			zstdhl_LE64BitWriter_Flush(&writers[3]);
+		}
+	}
+	else
+		interleavedLength = 0;
+
+	for (s = 0; s < numStreams; s++)
 	{
-		uint8_t bytesToFlush = (32u - encStream->m_bitsAvailable) / 8u;
+		zstdhl_LE64BitWriter_t *writer = &writers[s];
+		const uint8_t *streamStart = streamEnds[s] - streamSizes[s];
+		const uint8_t *literal = streamEnds[s] - interleavedLength;
 
-		ZSTDHL_CHECKED(zstdhl_FlushHuffmanStream(encStream, bytesToFlush));
-	}
+		while (literal - streamStart >= 4)
+		{
+			missingSymbol |= zstdhl_PutHuffmanSymbol(writer, encTable, literal[-1]);
+			missingSymbol |= zstdhl_PutHuffmanSymbol(writer, encTable, literal[-2]);
+			missingSymbol |= zstdhl_PutHuffmanSymbol(writer, encTable, literal[-3]);
+			missingSymbol |= zstdhl_PutHuffmanSymbol(writer, encTable, literal[-4]);
+			zstdhl_LE64BitWriter_Flush(writer);
 
-	encStream->m_bitsAvailable -= numBits;
-	encStream->m_bits |= bits << encStream->m_bitsAvailable;
+			literal -= 4;
+		}
 
-	return ZSTDHL_RESULT_OK;
-}
+		while (literal != streamStart)
+		{
+			literal--;
+			missingSymbol |= zstdhl_PutHuffmanSymbol(writer, encTable, *literal);
+		}
 
-static zstdhl_ResultCode_t zstdhl_WriteHuffmanValue(zstdhl_HuffmanEncBitstreamState_t *encStream, const zstdhl_HuffmanTableEnc_t *encTable, uint8_t symbol)
-{
-	if (encTable->m_entries[symbol].m_numBits == 0)
+		zstdhl_LE64BitWriter_Write(writer, 1, 1);
+		writer->m_numBits = (uint8_t)((writer->m_numBits + 7u) & ~7u);
+		zstdhl_LE64BitWriter_Flush(writer);
+
+		outStreamSizes[s] = (size_t)(writer->m_out - outStreams[s]);
+	}
+
+	if (missingSymbol)
 		return ZSTDHL_RESULT_HUFFMAN_TREE_MISSING_VALUE;
 
-	return zstdhl_WriteHuffmanBits(encStream, encTable->m_entries[symbol].m_bits, encTable->m_entries[symbol].m_numBits);
+	return ZSTDHL_RESULT_OK;
 }
 
 static zstdhl_ResultCode_t zstdhl_AssembleHuffmanLiterals(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_HuffmanTreePartialWeightDesc_t *partialWeightDesc, uint8_t is4Stream)
@@ -3062,15 +4163,21 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanLiterals(zstdhl_AsmState_t *asm
 	zstdhl_HuffmanTableEnc_t encTable;
 	uint8_t numStreams = is4Stream ? 4 : 1;
 	size_t i = 0;
-	zstdhl_HuffmanEncBitstreamState_t bitstreams[4];
 	const zstdhl_LiteralsSectionDesc_t *litsDesc = &encBlock->m_litSectionDesc;
 	size_t streamSizes[4];
+	size_t encodedSizes[4];
+	uint8_t *outStreams[4];
 
 	streamSizes[0] = litsDesc->m_numValues;
 
 	if (is4Stream)
 	{
 		streamSizes[0] = (streamSizes[0] + 3u) / 4u;
+
+		// 1, 2 and 5 literals can't be split into 4 streams because the last stream would have a negative size
+		if (streamSizes[0] * 3u > litsDesc->m_numValues)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
 		streamSizes[1] = streamSizes[0];
 		streamSizes[2] = streamSizes[1];
 		streamSizes[3] = litsDesc->m_numValues - streamSizes[0] * 3u;
@@ -3078,96 +4185,35 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanLiterals(zstdhl_AsmState_t *asm
 	else
 		streamSizes[1] = streamSizes[2] = streamSizes[3] = 0;
 
+	ZSTDHL_CHECKED(zstdhl_GenerateHuffmanEncodeTable(partialWeightDesc, &encTable));
+
+	zstdhl_Vector_Clear(&asmState->m_litDataVector);
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_litDataVector, NULL, litsDesc->m_numValues));
+	ZSTDHL_CHECKED(zstdhl_ReadChecked(litsDesc->m_decompressedLiteralsStream, asmState->m_litDataVector.m_data, litsDesc->m_numValues, ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED));
+
 	for (i = 0; i < numStreams; i++)
 	{
-		ZSTDHL_CHECKED(zstdhl_HuffmanEncBitstreamState_Init(&bitstreams[i], &asmState->m_huffmanStreamVectors[i]));
+		zstdhl_Vector_t *streamVector = &asmState->m_huffmanStreamVectors[i];
 
-		ZSTDHL_CHECKED(zstdhl_WriteHuffmanBits(&bitstreams[i], 1, 1));
+		zstdhl_Vector_Clear(streamVector);
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(streamVector, NULL, zstdhl_HuffmanStreamBound(streamSizes[i])));
+		outStreams[i] = (uint8_t *)streamVector->m_data;
 	}
 
-	ZSTDHL_CHECKED(zstdhl_GenerateHuffmanEncodeTable(partialWeightDesc, &encTable));
+	ZSTDHL_CHECKED_PHASE(asmState->m_instrumentation, ZSTDHL_PHASE_ASSEMBLE_HUFFMAN_STREAMS, 0, litsDesc->m_numValues, zstdhl_EncodeHuffmanStreams(&encTable, (const uint8_t *)asmState->m_litDataVector.m_data, streamSizes, numStreams, outStreams, encodedSizes));
 
 	for (i = 0; i < numStreams; i++)
-	{
-		size_t streamSize = streamSizes[i];
-		uint8_t buffer[1024];
-		size_t sizeRemaining = streamSize;
-		zstdhl_HuffmanEncBitstreamState_t *bitstream = &bitstreams[i];
-		uint8_t numPaddingBits = 0;
+		zstdhl_Vector_Shrink(&asmState->m_huffmanStreamVectors[i], encodedSizes[i]);
 
-		while (sizeRemaining > 0)
-		{
-			size_t amountToRead = sizeof(buffer);
-			size_t amountRead = 0;
-			size_t j = 0;
-
-			if (amountToRead > sizeRemaining)
-				amountToRead = sizeRemaining;
+	return ZSTDHL_RESULT_OK;
+}
 
-			amountRead = encBlock->m_litSectionDesc.m_decompressedLiteralsStream->m_readBytesFunc(encBlock->m_litSectionDesc.m_decompressedLiteralsStream->m_userdata, buffer, amountToRead);
-			if (amountRead != amountToRead)
-				return ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED;
-
-			for (j = 0; j < amountRead; j++)
-			{
-				ZSTDHL_CHECKED(zstdhl_WriteHuffmanValue(bitstream, &encTable, buffer[j]));
-			}
-			sizeRemaining -= amountRead;
-		}
-
-		numPaddingBits = (bitstream->m_bitsAvailable % 8u);
-		if (numPaddingBits != 0)
-		{
-			ZSTDHL_CHECKED(zstdhl_WriteHuffmanBits(bitstream, 0, numPaddingBits));
-		}
-
-		ZSTDHL_CHECKED(zstdhl_FlushHuffmanStream(bitstream, (32u - bitstream->m_bitsAvailable) / 8u));
-
-		{
-			// Flip the bitstream byte order
-			size_t bitstreamSize = bitstream->m_outVector->m_count;
-			uint8_t *bitstreamBytes = (uint8_t *)bitstream->m_outVector->m_data;
-			size_t j = 0;
-
-			for (j = 0; j < bitstreamSize / 2u; j++)
-			{
-				uint8_t *swapTargetA = bitstreamBytes + j;
-				uint8_t *swapTargetB = bitstreamBytes + bitstreamSize - 1u - j;
-
-				uint8_t temp = *swapTargetA;
-				*swapTargetA = *swapTargetB;
-				*swapTargetB = temp;
-			}
-
-			// Shift padding out padding
-			if (numPaddingBits > 0)
-			{
-				uint8_t invPaddingBits = 8 - numPaddingBits;
-
-				for (j = 1; j < bitstreamSize; j++)
-				{
-					uint8_t lowByte = bitstreamBytes[j - 1];
-					uint8_t highByte = bitstreamBytes[j];
-
-					bitstreamBytes[j - 1] = (uint8_t)((((highByte << 8) | lowByte) >> numPaddingBits) & 0xff);
-				}
-
-				bitstreamBytes[bitstreamSize - 1] >>= numPaddingBits;
-			}
-		}
-
-		i += 0;
-	}
-
-	return ZSTDHL_RESULT_OK;
-}
-
-typedef struct zstdhl_EncLittleEndianBitstreamState
-{
-	uint32_t m_bits;
-	uint8_t m_numBits;
-	zstdhl_Vector_t *m_outVector;
-} zstdhl_EncLittleEndianBitstreamState_t;
+typedef struct zstdhl_EncLittleEndianBitstreamState
+{
+	uint32_t m_bits;
+	uint8_t m_numBits;
+	zstdhl_Vector_t *m_outVector;
+} zstdhl_EncLittleEndianBitstreamState_t;
 
 static zstdhl_ResultCode_t zstdhl_EncLittleEndianBitstreamState_Init(zstdhl_EncLittleEndianBitstreamState_t *state, zstdhl_Vector_t *vector)
 {
@@ -3203,6 +4249,10 @@ static zstdhl_ResultCode_t zstdhl_WriteLEStreamBits(zstdhl_EncLittleEndianBitstr
 {
 	uint32_t bitsAvailable = 32 - state->m_numBits;
 
+	// The bit buffer may be full, so this can't shift when there's nothing to write
+	if (numBits == 0)
+		return ZSTDHL_RESULT_OK;
+
 	if (bitsAvailable < numBits)
 	{
 		uint8_t bytesToFlush = state->m_numBits / 8u;
@@ -3336,7 +4386,8 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanDesc(zstdhl_AsmState_t *asmStat
 		zstdhl_FSETableEnc_t encTable;
 		zstdhl_FSETable_t fseTable;
 		zstdhl_FSETableCell_t huffWeightCells[1 << ZSTDHL_MAX_HUFFMAN_WEIGHT_ACCURACY_LOG];
-		uint16_t huffWeightNextStates[(ZSTDHL_MAX_HUFFMAN_WEIGHT + 1) << ZSTDHL_MAX_HUFFMAN_WEIGHT_ACCURACY_LOG];
+		zstdhl_FSESymbolEncTransform_t huffWeightTransforms[ZSTDHL_MAX_HUFFMAN_WEIGHT + 1];
+		uint16_t huffWeightStateTable[1 << ZSTDHL_MAX_HUFFMAN_WEIGHT_ACCURACY_LOG];
 		zstdhl_FSESymbolTemp_t symTemps[256];
 		uint8_t accuracyLog = desc->m_weightTable.m_accuracyLog;
 		uint16_t states[2] = { 0, 0 };
@@ -3354,7 +4405,8 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanDesc(zstdhl_AsmState_t *asmStat
 
 		ZSTDHL_CHECKED(zstdhl_BuildFSEDistributionTable_ZStd(&fseTable, &desc->m_weightTable, symTemps));
 
-		encTable.m_nextStates = huffWeightNextStates;
+		encTable.m_symbolTransforms = huffWeightTransforms;
+		encTable.m_stateTable = huffWeightStateTable;
 
 		zstdhl_BuildFSEEncodeTable(&encTable, &fseTable, ZSTDHL_MAX_HUFFMAN_WEIGHT + 1);
 
@@ -3368,6 +4420,9 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanDesc(zstdhl_AsmState_t *asmStat
 			uint16_t *statePtr = states + (ri & 1);
 			uint8_t weight = desc->m_partialWeightDesc.m_specifiedWeights[ri];
 
+			if (weight > ZSTDHL_MAX_HUFFMAN_WEIGHT)
+				return ZSTDHL_RESULT_FSE_TABLE_MISSING_SYMBOL;
+
 			if (i < 2)
 			{
 				size_t j = 0;
@@ -3376,16 +4431,11 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanDesc(zstdhl_AsmState_t *asmStat
 			}
 			else
 			{
-				uint16_t oldState = *statePtr;
-				uint16_t newState = encTable.m_nextStates[(weight << accuracyLog) + oldState];
-				const zstdhl_FSETableCell_t *cell = fseTable.m_cells + newState;
-
-				if (oldState < cell->m_baseline || oldState - cell->m_baseline >= (1 << cell->m_numBits) || cell->m_sym != weight)
-					return ZSTDHL_RESULT_INTERNAL_ERROR;
-
-				*statePtr = newState;
+				uint32_t bits = 0;
+				uint8_t numBits = 0;
 
-				ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, oldState - cell->m_baseline, cell->m_numBits));
+				ZSTDHL_CHECKED(zstdhl_FSEEncodeTransition(&encTable, accuracyLog, weight, statePtr, &bits, &numBits));
+				ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, bits, numBits));
 			}
 		}
 
@@ -3440,7 +4490,7 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanLiteralsSection(zstdhl_AsmState
 
 		asmState->m_persistentState->m_haveHuffmanTree = 1;
 
-		ZSTDHL_CHECKED(zstdhl_AssembleHuffmanDesc(asmState, &encBlock->m_huffmanTreeDesc));
+		ZSTDHL_CHECKED_PHASE(asmState->m_instrumentation, ZSTDHL_PHASE_ASSEMBLE_HUFFMAN_TREE, 0, treeDesc->m_numSpecifiedWeights, zstdhl_AssembleHuffmanDesc(asmState, &encBlock->m_huffmanTreeDesc));
 	}
 
 	ZSTDHL_CHECKED(zstdhl_AssembleHuffmanLiterals(asmState, encBlock, treeDesc, is4Stream));
@@ -3528,400 +4578,2438 @@ static zstdhl_ResultCode_t zstdhl_AssembleHuffmanLiteralsSection(zstdhl_AsmState
 	for (i = 0; i < 4; i++)
 	{
 		ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_dataBlockVector, asmState->m_huffmanStreamVectors[i].m_data, asmState->m_huffmanStreamVectors[i].m_count));
-		zstdhl_Vector_Reset(&asmState->m_huffmanStreamVectors[i]);
+		zstdhl_Vector_Clear(&asmState->m_huffmanStreamVectors[i]);
 	}
 
 	return ZSTDHL_RESULT_OK;
 }
 
-static zstdhl_ResultCode_t zstdhl_AssembleLiteralsSection(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock)
+static const int kLog2Shift = 27;
+
+static const uint32_t kLog2Table[513] =
+{
+	0, 0, 134217728, 212730065, 268435456, 311643913, 346947793, 376796799,
+	402653184, 425460131, 445861641, 464317052, 481165521, 496664611, 511014527, 524373979,
+	536870912, 548609975, 559677859, 570147179, 580079369, 589526865, 598534780, 607142208,
+	615383249, 623287826, 630882339, 638190197, 645232255, 652027171, 658591707, 664940972,
+	671088640, 677047117, 682827703, 688440712, 693895587, 699200994, 704364907, 709394677,
+	714297097, 719078457, 723744593, 728300926, 732752508, 737104045, 741359936, 745524295,
+	749600977, 753593598, 757505554, 761340041, 765100067, 768788469, 772407925, 775960965,
+	779449983, 782877245, 786244899, 789554984, 792809435, 796010090, 799158700, 802256930,
+	805306368, 808308525, 811264845, 814176708, 817045431, 819872274, 822658440, 825405086,
+	828113315, 830784189, 833418722, 836017892, 838582635, 841113851, 843612405, 846079129,
+	848514825, 850920263, 853296185, 855643308, 857962321, 860253889, 862518654, 864757237,
+	866970236, 869158228, 871321773, 873461410, 875577664, 877671038, 879742023, 881791093,
+	883818705, 885825306, 887811326, 889777183, 891723282, 893650017, 895557769, 897446909,
+	899317795, 901170778, 903006197, 904824382, 906625653, 908410322, 910178693, 911931060,
+	913667711, 915388924, 917094973, 918786121, 920462627, 922124743, 923772712, 925406775,
+	927027163, 928634104, 930227818, 931808523, 933376428, 934931740, 936474658, 938005380,
+	939524096, 941030992, 942526253, 944010055, 945482573, 946943978, 948394436, 949834110,
+	951263159, 952681739, 954090002, 955488096, 956876168, 958254361, 959622814, 960981663,
+	962331043, 963671085, 965001917, 966323664, 967636450, 968940396, 970235620, 971522238,
+	972800363, 974070107, 975331579, 976584886, 977830133, 979067423, 980296857, 981518535,
+	982732553, 983939007, 985137991, 986329596, 987513913, 988691031, 989861036, 991024014,
+	992180049, 993329223, 994471617, 995607311, 996736382, 997858909, 998974965, 1000084626,
+	1001187964, 1002285050, 1003375956, 1004460750, 1005539501, 1006612275, 1007679138, 1008740156,
+	1009795392, 1010844908, 1011888766, 1012927027, 1013959751, 1014986996, 1016008821, 1017025281,
+	1018036433, 1019042333, 1020043034, 1021038590, 1022029054, 1023014477, 1023994911, 1024970406,
+	1025941010, 1026906774, 1027867745, 1028823971, 1029775497, 1030722371, 1031664637, 1032602339,
+	1033535523, 1034464231, 1035388506, 1036308390, 1037223925, 1038135151, 1039042110, 1039944840,
+	1040843381, 1041737772, 1042628050, 1043514254, 1044396421, 1045274587, 1046148788, 1047019060,
+	1047885439, 1048747958, 1049606652, 1050461556, 1051312701, 1052160121, 1053003849, 1053843917,
+	1054680355, 1055513196, 1056342471, 1057168209, 1057990440, 1058809195, 1059624503, 1060436392,
+	1061244891, 1062050028, 1062851832, 1063650329, 1064445546, 1065237512, 1066026251, 1066811791,
+	1067594156, 1068373374, 1069149468, 1069922464, 1070692386, 1071459260, 1072223108, 1072983955,
+	1073741824, 1074496738, 1075248720, 1075997794, 1076743981, 1077487303, 1078227783, 1078965442,
+	1079700301, 1080432383, 1081161706, 1081888294, 1082612164, 1083333339, 1084051838, 1084767681,
+	1085480887, 1086191476, 1086899467, 1087604878, 1088307730, 1089008039, 1089705824, 1090401104,
+	1091093896, 1091784219, 1092472089, 1093157524, 1093840542, 1094521158, 1095199391, 1095875257,
+	1096548771, 1097219951, 1097888813, 1098555372, 1099219645, 1099881646, 1100541392, 1101198898,
+	1101854178, 1102507249, 1103158124, 1103806819, 1104453348, 1105097726, 1105739966, 1106380083,
+	1107018091, 1107654004, 1108287835, 1108919598, 1109549307, 1110176974, 1110802614, 1111426238,
+	1112047861, 1112667494, 1113285151, 1113900844, 1114514585, 1115126388, 1115736263, 1116344223,
+	1116950281, 1117554448, 1118156735, 1118757155, 1119355719, 1119952438, 1120547324, 1121140388,
+	1121731641, 1122321094, 1122908759, 1123494645, 1124078764, 1124661126, 1125241742, 1125820622,
+	1126397777, 1126973216, 1127546951, 1128118990, 1128689345, 1129258024, 1129825039, 1130390397,
+	1130954110, 1131516187, 1132076637, 1132635469, 1133192693, 1133748318, 1134302354, 1134854809,
+	1135405692, 1135955012, 1136502778, 1137048999, 1137593684, 1138136840, 1138678478, 1139218604,
+	1139757229, 1140294359, 1140830003, 1141364169, 1141896866, 1142428102, 1142957884, 1143486221,
+	1144013120, 1144538589, 1145062636, 1145585268, 1146106494, 1146626321, 1147144755, 1147661806,
+	1148177479, 1148691783, 1149204724, 1149716310, 1150226549, 1150735446, 1151243009, 1151749245,
+	1152254161, 1152757764, 1153260061, 1153761058, 1154260762, 1154759180, 1155256318, 1155752184,
+	1156246782, 1156740121, 1157232205, 1157723043, 1158212639, 1158701001, 1159188134, 1159674044,
+	1160158738, 1160642222, 1161124502, 1161605584, 1162085473, 1162564176, 1163041699, 1163518046,
+	1163993225, 1164467241, 1164940099, 1165411805, 1165882365, 1166351784, 1166820067, 1167287221,
+	1167753251, 1168218162, 1168681959, 1169144648, 1169606234, 1170066722, 1170526118, 1170984427,
+	1171441653, 1171897802, 1172352879, 1172806890, 1173259838, 1173711729, 1174162568, 1174612360,
+	1175061109, 1175508821, 1175955500, 1176401151, 1176845778, 1177289387, 1177731982, 1178173568,
+	1178614149, 1179053730, 1179492315, 1179929909, 1180366516, 1180802141, 1181236788, 1181670462,
+	1182103167, 1182534907, 1182965686, 1183395509, 1183824380, 1184252304, 1184679284, 1185105324,
+	1185530429, 1185954603, 1186377849, 1186800173, 1187221577, 1187642066, 1188061645, 1188480316,
+	1188898083, 1189314952, 1189730924, 1190146005, 1190560199, 1190973508, 1191385937, 1191797489,
+	1192208168, 1192617978, 1193026923, 1193435006, 1193842231, 1194248601, 1194654120, 1195058791,
+	1195462619, 1195865606, 1196267756, 1196669073, 1197069560, 1197469220, 1197868057, 1198266074,
+	1198663274, 1199059662, 1199455240, 1199850011, 1200243979, 1200637147, 1201029519, 1201421097,
+	1201811884, 1202201885, 1202591102, 1202979538, 1203367196, 1203754080, 1204140192, 1204525536,
+	1204910114, 1205293931, 1205676988, 1206059288, 1206440836, 1206821633, 1207201683, 1207580988,
+	1207959552
+};
+
+// Returns log2(value) with kLog2Shift fractional bits
+static uint32_t zstdhl_FixedLog2(size_t value)
 {
+	uint32_t shift = 0;
+
+	while (value > 512)
 	{
-		uint32_t litSectionHeader = encBlock->m_litSectionHeader.m_sectionType;
-		uint8_t litSectionHeaderSize = 0;
-		size_t numLitsExpected = 0;
+		value >>= 1;
+		shift++;
+	}
 
-		switch (encBlock->m_litSectionHeader.m_sectionType)
-		{
-		case ZSTDHL_LITERALS_SECTION_TYPE_RAW:
-		case ZSTDHL_LITERALS_SECTION_TYPE_RLE:
-			// TODO: Allow the size of regenerated size field to be specified
-			if (encBlock->m_litSectionHeader.m_regeneratedSize >= 1048576)
-				return ZSTDHL_RESULT_LITERALS_SECTION_REGENERATED_SIZE_INVALID;
-			else if (encBlock->m_litSectionHeader.m_regeneratedSize >= 4096)
-			{
-				litSectionHeader |= (3 << 2);
-				litSectionHeader |= (encBlock->m_litSectionHeader.m_regeneratedSize << 4);
-				litSectionHeaderSize = 3;
-			}
-			else if (encBlock->m_litSectionHeader.m_regeneratedSize >= 32)
-			{
-				litSectionHeader |= (1 << 2);
-				litSectionHeader |= (encBlock->m_litSectionHeader.m_regeneratedSize << 4);
-				litSectionHeaderSize = 2;
-			}
-			else
-			{
-				litSectionHeader |= (encBlock->m_litSectionHeader.m_regeneratedSize << 3);
-				litSectionHeaderSize = 1;
-			}
+	return kLog2Table[value] + (shift << kLog2Shift);
+}
 
-			if (encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE)
-				numLitsExpected = 1;
-			else
-				numLitsExpected = encBlock->m_litSectionHeader.m_regeneratedSize;
+uint64_t zstdhl_EstimateEntropyBits(const size_t *stats, size_t numStats)
+{
+	size_t numNonZeroStats = 0;
+	size_t statsTotal = 0;
+	uint32_t totalLog2 = 0;
+	uint64_t numBits = 0;
+	size_t i = 0;
 
-			if (numLitsExpected != encBlock->m_litSectionDesc.m_numValues)
-				return ZSTDHL_RESULT_LITERALS_SECTION_VALUE_COUNT_MISMATCH;
+	for (i = 0; i < numStats; i++)
+	{
+		if (stats[i] != 0)
+		{
+			numNonZeroStats++;
+			statsTotal += stats[i];
+		}
+	}
 
-			ZSTDHL_CHECKED(zstdhl_WriteLiteralsSectionHeader(asmState, litSectionHeader, litSectionHeaderSize));
+	if (numNonZeroStats < 2)
+		return 0;
 
-			{
-				// Write literals data
-				uint8_t buffer[1024];
-				size_t litsRemaining = numLitsExpected;
-				while (litsRemaining > 0)
-				{
-					size_t amountToRead = sizeof(buffer);
-					size_t amountRead = 0;
+	totalLog2 = zstdhl_FixedLog2(statsTotal);
 
-					if (amountToRead > litsRemaining)
-						amountToRead = litsRemaining;
+	for (i = 0; i < numStats; i++)
+	{
+		if (stats[i] != 0)
+			numBits += (uint64_t)stats[i] * (uint64_t)(totalLog2 - zstdhl_FixedLog2(stats[i]));
+	}
 
-					amountRead = encBlock->m_litSectionDesc.m_decompressedLiteralsStream->m_readBytesFunc(encBlock->m_litSectionDesc.m_decompressedLiteralsStream->m_userdata, buffer, amountToRead);
+	return numBits >> kLog2Shift;
+}
 
-					if (amountToRead != amountRead)
-						return ZSTDHL_RESULT_INPUT_FAILED;
+static void zstdhl_ComputeFSETableUsage(uint32_t fseProb, uint8_t accuracyLog, uint16_t *outNumLargeShares, uint8_t *outLargeShareSize, uint16_t *outNumSmallShares, uint8_t *outSmallShareSize, uint8_t *outShareTotalBits)
+{
+	uint16_t numLargeShares = 0;
+	uint16_t numSmallShares = 0;
+	uint8_t largeShareSize = 0;
+	uint8_t smallShareSize = 0;
+	uint8_t shareTotalBits = 0;
+	int log2Prob = zstdhl_Log2_32(fseProb);
 
-					ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_dataBlockVector, buffer, amountRead));
-					litsRemaining -= amountRead;
-				}
-			}
+	if (fseProb == (uint32_t)(1 << log2Prob))
+	{
+		smallShareSize = accuracyLog - (uint8_t)log2Prob;
+		numSmallShares = fseProb;
+	}
+	else
+	{
+		log2Prob++;	// For 5, log2prob == 3
 
-			break;
-		case ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN:
-		case ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE:
-			ZSTDHL_CHECKED(zstdhl_AssembleHuffmanLiteralsSection(asmState, encBlock, encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE));
-			break;
-		}
+		smallShareSize = accuracyLog - log2Prob;
+		largeShareSize = smallShareSize + 1;
+
+		numLargeShares = (uint32_t)(1 << log2Prob) - fseProb;
+		numSmallShares = fseProb - numLargeShares;
 	}
 
-	return ZSTDHL_RESULT_OK;
+	*outNumLargeShares = numLargeShares;
+	*outNumSmallShares = numSmallShares;
+	*outLargeShareSize = largeShareSize;
+	*outSmallShareSize = smallShareSize;
+	*outShareTotalBits = (uint8_t)log2Prob;
 }
 
-static zstdhl_ResultCode_t zstdhl_AssembleSequencesSectionTableDef(zstdhl_AsmState_t *asmState, zstdhl_AsmTableState_t *tableState, zstdhl_EncLittleEndianBitstreamState_t *bitstream, zstdhl_SequencesCompressionMode_t compMode, const zstdhl_EncSeqCompressionDesc_t *desc)
+static zstdhl_ResultCode_t zstdhl_CreateFSEProbsFromStats(const size_t *stats, size_t numStats, uint32_t *outProbs, uint8_t accuracyLog, uint8_t *outProbsFit)
 {
-	switch (compMode)
-	{
-	case ZSTDHL_SEQ_COMPRESSION_MODE_FSE:
-		{
-			zstdhl_FSESymbolTemp_t symbolTemps[64];
+	size_t targetProbTotal = (size_t)1 << accuracyLog;
+	size_t numNonZeroStats = 0;
+	size_t i = 0;
+	size_t probsRemaining = targetProbTotal;
+	uint64_t score = 0;
+	size_t statsTotal = 0;
 
-			if (desc->m_fseProbs->m_accuracyLog > tableState->m_maxAccuracyLog)
-				return ZSTDHL_RESULT_ACCURACY_LOG_TOO_LARGE;
+	for (i = 0; i < numStats; i++)
+	{
+		if (stats[i])
+			numNonZeroStats++;
 
-			if (desc->m_fseProbs->m_accuracyLog < ZSTDHL_MIN_ACCURACY_LOG)
-				return ZSTDHL_RESULT_ACCURACY_LOG_TOO_SMALL;
+		statsTotal += stats[i];
+	}
 
-			if (desc->m_fseProbs->m_numProbabilities > tableState->m_maxSymbols)
-				return ZSTDHL_RESULT_TOO_MANY_PROBS;
+	if (numNonZeroStats > targetProbTotal || numNonZeroStats == 0)
+	{
+		*outProbsFit = 0;
+		return ZSTDHL_RESULT_OK;
+	}
 
-			tableState->m_pstate->m_isAssigned = 1;
-			tableState->m_pstate->m_isRLE = 0;
-			ZSTDHL_CHECKED(zstdhl_BuildFSEDistributionTable_ZStd(&tableState->m_pstate->m_table, desc->m_fseProbs, symbolTemps));
-			zstdhl_BuildFSEEncodeTable(&tableState->m_encTable, &tableState->m_pstate->m_table, tableState->m_maxSymbols);
+	for (i = 0; i < numStats; i++)
+		outProbs[i] = 0;
 
-			ZSTDHL_CHECKED(zstdhl_WriteFSETableDesc(bitstream, desc->m_fseProbs));
-		}
-		break;
-	case ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED:
+	// Detect RLE-like table
+	if (numNonZeroStats == 1)
+	{
+		for (i = 0; i < numStats; i++)
 		{
-			zstdhl_FSETableDef_t tableDef;
-			zstdhl_FSESymbolTemp_t symbolTemps[64];
-
-			tableDef.m_accuracyLog = tableState->m_sdef->m_defaultAccuracyLog;
-			tableDef.m_numProbabilities = tableState->m_sdef->m_numProbs;
-			tableDef.m_probabilities = tableState->m_sdef->m_defaultProbs;
-
-			tableState->m_pstate->m_isAssigned = 1;
-			tableState->m_pstate->m_isRLE = 0;
-			ZSTDHL_CHECKED(zstdhl_BuildFSEDistributionTable_ZStd(&tableState->m_pstate->m_table, &tableDef, symbolTemps));
-			zstdhl_BuildFSEEncodeTable(&tableState->m_encTable, &tableState->m_pstate->m_table, tableState->m_maxSymbols);
+			if (stats[i])
+			{
+				outProbs[i] = 1 << accuracyLog;
+				break;
+			}
 		}
-		break;
-	case ZSTDHL_SEQ_COMPRESSION_MODE_REUSE:
-		if (!tableState->m_pstate->m_isAssigned)
-			return ZSTDHL_RESULT_REUSED_TABLE_WITHOUT_EXISTING_TABLE;
 
-		if (!tableState->m_pstate->m_isRLE)
-			zstdhl_BuildFSEEncodeTable(&tableState->m_encTable, &tableState->m_pstate->m_table, tableState->m_maxSymbols);
-		break;
-	case ZSTDHL_SEQ_COMPRESSION_MODE_RLE:
-		tableState->m_pstate->m_isRLE = 1;
-		tableState->m_pstate->m_rleByte = desc->m_rleByte;
-		tableState->m_pstate->m_isAssigned = 1;
-		ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(bitstream, desc->m_rleByte, 8));
-		break;
-	default:
-		return ZSTDHL_RESULT_INTERNAL_ERROR;
+		*outProbsFit = 1;
+		return ZSTDHL_RESULT_OK;
 	}
 
-	return ZSTDHL_RESULT_OK;
-}
+	// Give every symbol 1 point, then distribute most of the rest proportionally so that the greedy
+	// pass only has to place the remainder
+	probsRemaining -= numNonZeroStats;
 
-static zstdhl_ResultCode_t zstdhl_AssembleSequenceStateUpdate(size_t index, zstdhl_EncLittleEndianBitstreamState_t *bitstream, const zstdhl_AsmTableState_t *tableState, uint16_t sym, uint16_t *state)
-{
-	if (tableState->m_pstate->m_isRLE)
 	{
-		if (tableState->m_pstate->m_rleByte != sym)
-			return ZSTDHL_RESULT_SYMBOL_DOES_NOT_MATCH_RLE;
+		size_t proportionalTotal = probsRemaining;
+		size_t probsAssigned = 0;
+
+		for (i = 0; i < numStats; i++)
+		{
+			if (stats[i])
+			{
+				size_t extraProbs = (size_t)(((uint64_t)stats[i] * (uint64_t)proportionalTotal) / (uint64_t)statsTotal);
+
+				outProbs[i] = (uint32_t)(1 + extraProbs);
+				probsAssigned += extraProbs;
+			}
+		}
+
+		probsRemaining -= probsAssigned;
 	}
-	else
+
+	while (probsRemaining > 0)
 	{
-		if (index == 0)
+		uint64_t bestScore = 0;
+		size_t bestIndex = numStats;
+
+		for (i = 0; i < numStats; i++)
 		{
-			ZSTDHL_CHECKED(zstdhl_FindInitialFSEState(&tableState->m_pstate->m_table, sym, state));
+			uint32_t prob = outProbs[i];
+			if (prob)
+			{
+				uint64_t score = (uint64_t)stats[i] * (uint64_t)(kLog2Table[prob + 1] - kLog2Table[prob]);
+				if (bestIndex == numStats || score > bestScore)
+				{
+					bestScore = score;
+					bestIndex = i;
+				}
+			}
 		}
-		else
-		{
-			uint16_t oldState = *state;
-			uint16_t newState = tableState->m_encTable.m_nextStates[(sym << tableState->m_pstate->m_table.m_accuracyLog) + (*state)];
-			const zstdhl_FSETableCell_t *cell = NULL;
 
-			if (newState == 0xffff)
-				return ZSTDHL_RESULT_FSE_TABLE_MISSING_SYMBOL;
-			
-			cell = tableState->m_pstate->m_table.m_cells + newState;
+		if (bestIndex == numStats)
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(bitstream, oldState - cell->m_baseline, cell->m_numBits));
+		outProbs[bestIndex]++;
 
-			*state = newState;
-		}
+		probsRemaining--;
 	}
 
+	for (i = 0; i < numStats; i++)
+	{
+		// if ((stats[i] / statsTotal) < (1 / (1 << accuracyLog)))
+		if (outProbs[i] == 1 && (stats[i] << accuracyLog) < statsTotal)
+			outProbs[i] = zstdhl_GetLessThanOneConstant();
+	}
+
+	*outProbsFit = 1;
 	return ZSTDHL_RESULT_OK;
 }
 
-static zstdhl_ResultCode_t zstdhl_AssembleSequencesSection(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock)
+static uint64_t zstdhl_ScoreFSETable(const size_t *stats, size_t numStats, const zstdhl_FSETableDef_t *tableDef, uint8_t needEncodeTable, uint8_t *outIsValid)
 {
-	const zstdhl_SequencesSectionDesc_t *seqDesc = &encBlock->m_seqSectionDesc;
-	const zstdhl_SequenceCollectionObject_t *seqCollection = &encBlock->m_seqCollection;
-	uint32_t numSequences = seqDesc->m_numSequences;
+	uint8_t accuracyLog = tableDef->m_accuracyLog;
+	uint64_t score = 0;
 	size_t i = 0;
-	size_t amountDecompressed = 0;
 
-	for (i = 0; i < numSequences; i++)
+	*outIsValid = 0;
+
+	for (i = 0; i < numStats; i++)
 	{
-		uint32_t litLengthFSEValue = 0;
-		uint32_t litLengthExtraValue = 0;
-		uint8_t litLengthExtraBits = 0;
-		uint32_t matchLengthFSEValue = 0;
-		uint32_t matchLengthExtraValue = 0;
-		uint8_t matchLengthExtraBits = 0;
-		uint32_t offsetCode = 0;
-		uint32_t offsetCodeFSEValue = 0;
-		uint32_t offsetCodeExtraValue = 0;
-		uint8_t offsetCodeExtraBits = 0;
-		zstdhl_SequenceDesc_t seq;
-		zstdhl_SequenceEncStackItem_t encStackItem;
+		size_t count = stats[i];
 
-		ZSTDHL_CHECKED(seqCollection->m_getNextSequence(seqCollection->m_userdata, &seq));
+		if (count != 0)
+		{
+			uint32_t effectiveProb = 0;
+			if (i >= tableDef->m_numProbabilities || tableDef->m_probabilities[i] == 0)
+				return 0;
 
-		ZSTDHL_CHECKED(zstdhl_EncodeLitLength(seq.m_litLength, &litLengthFSEValue, &litLengthExtraValue, &litLengthExtraBits));
-		ZSTDHL_CHECKED(zstdhl_EncodeMatchLength(seq.m_matchLength, &matchLengthFSEValue, &matchLengthExtraValue, &matchLengthExtraBits));
+			effectiveProb = tableDef->m_probabilities[i];
+			if (effectiveProb == zstdhl_GetLessThanOneConstant())
+				effectiveProb = 1;
 
-		// TODO: Support more bits
-		if (seq.m_offsetValueNumBits > 32)
-			return ZSTDHL_RESULT_NOT_YET_IMPLEMENTED;
+			score += ((uint64_t)count) * (uint64_t)((9 << kLog2Shift) - kLog2Table[effectiveProb << (9 - accuracyLog)]);
+		}
+	}
 
-		ZSTDHL_CHECKED(zstdhl_ResolveOffsetCode32(seq.m_offsetType, seq.m_litLength, (seq.m_offsetValueNumBits > 0) ? seq.m_offsetValueBigNum[0] : 0, &offsetCode));
+	score += ((uint64_t)1) << kLog2Shift;
+	score--;
+	score >>= kLog2Shift;
 
-		ZSTDHL_CHECKED(zstdhl_EncodeOffsetCode(offsetCode, &offsetCodeFSEValue, &offsetCodeExtraValue, &offsetCodeExtraBits));
+	if (needEncodeTable)
+	{
+		uint32_t remainingProbPoints = (uint32_t)(1 << tableDef->m_accuracyLog);
+		uint32_t probIndex = 0;
 
-		encStackItem.m_dcmp = amountDecompressed;
-		encStackItem.m_litLengthCode = litLengthFSEValue;
-		encStackItem.m_matchLengthCode = matchLengthFSEValue;
-		encStackItem.m_offsetCode = offsetCodeFSEValue;
-		encStackItem.m_numOffsetExtraBits = offsetCodeExtraBits;
-		encStackItem.m_numLitLengthExtraBits = litLengthExtraBits;
-		encStackItem.m_numMatchLengthExtraBits = matchLengthExtraBits;
-		encStackItem.m_offsetExtraBits = offsetCodeExtraValue;
-		encStackItem.m_matchLengthExtraBits = matchLengthExtraValue;
-		encStackItem.m_litLengthExtraBits = litLengthExtraValue;
+		score += 4;	// Accuracy log desc
 
-		ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_encStackItemVector, &encStackItem, 1));
+		while (remainingProbPoints > 0)
+		{
+			uint32_t maxEncodableValue = remainingProbPoints + 1;
+			int maxBitsRequired = zstdhl_Log2_32(maxEncodableValue) + 1;
+			uint32_t smallValueCutoff = (uint32_t)((1 << maxBitsRequired) - 1) - maxEncodableValue;
+			uint32_t prob = tableDef->m_probabilities[probIndex];
+			uint32_t codedProbValue = prob + 1;
+
+			if (prob == zstdhl_GetLessThanOneConstant())
+			{
+				codedProbValue = 0;
+				prob = 1;
+			}
+
+			remainingProbPoints -= prob;
+
+			score += (uint32_t)maxBitsRequired;
+			if (codedProbValue < smallValueCutoff)
+				score--;
+
+			probIndex++;
+			if (prob == 0)
+			{
+				uint32_t repeatCount = 0;
+				while (tableDef->m_probabilities[probIndex] == 0)
+				{
+					repeatCount++;
+					probIndex++;
+				}
 
-		amountDecompressed += seq.m_litLength + seq.m_matchLength;
+				score += ((repeatCount / 3u) + 1u) * 2u;
+			}
+		}
 	}
 
+	*outIsValid = 1;
+	return score;
+}
+
+static zstdhl_ResultCode_t zstdhl_TryFSETable(const size_t *stats, size_t numStats, zstdhl_Vector_t *probsVector, const zstdhl_FSETableDef_t *candidateTableDef, zstdhl_FSETableDef_t *outTableDef, uint8_t *outHaveScore, uint64_t *inOutBestScore, zstdhl_SequencesCompressionMode_t *outBestMode, zstdhl_SequencesCompressionMode_t newMode, uint8_t needEncodeTable, uint8_t numExtraBits, uint64_t *outScore)
+{
+	uint8_t isValid = 0;
+	uint64_t score = zstdhl_ScoreFSETable(stats, numStats, candidateTableDef, needEncodeTable, &isValid) + numExtraBits;
+
+	if (outScore)
+		*outScore = (isValid ? score : ~(uint64_t)0);
+
+	if (isValid && (((*outHaveScore) == 0) || score < (*inOutBestScore)))
 	{
-		zstdhl_EncLittleEndianBitstreamState_t bitstream;
+		*outBestMode = newMode;
+		*inOutBestScore = score;
+		*outHaveScore = 1;
 
-		ZSTDHL_CHECKED(zstdhl_EncLittleEndianBitstreamState_Init(&bitstream, &asmState->m_dataBlockVector));
+		outTableDef->m_accuracyLog = candidateTableDef->m_accuracyLog;
+		outTableDef->m_numProbabilities = candidateTableDef->m_numProbabilities;
 
-		// Write sequences section header
-		// TODO: Make sized
-		if (numSequences < 128)
+		if (candidateTableDef->m_probabilities != probsVector->m_data)
 		{
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, numSequences, 8));
-		}
+			size_t i = 0;
+			const uint32_t *probs = candidateTableDef->m_probabilities;
+			size_t numProbs = candidateTableDef->m_numProbabilities;
+
+			zstdhl_Vector_Clear(probsVector);
+
+			ZSTDHL_CHECKED(zstdhl_Vector_Append(probsVector, probs, numProbs));
+		}
+
+		outTableDef->m_probabilities = (const uint32_t *)probsVector->m_data;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t zstdhl_SelectOptimalFSETable(const size_t *stats, size_t numStats, zstdhl_Vector_t *probsVector, zstdhl_Vector_t *tempVectorU32, zstdhl_FSETableDef_t *table, zstdhl_SequencesCompressionMode_t *outMode, const zstdhl_SubstreamCompressionStructureDef_t *sdef, uint8_t isFirstCompressedBlock)
+{
+	uint8_t haveScore = 0;
+	uint64_t bestScore = 0;
+	size_t accuracyLog = 0;
+	size_t numNonZeroStats = 0;
+	size_t rleSym = 0;
+	uint64_t entropyBound = 0;
+	size_t i = 0;
+
+	for (i = 0; i < numStats; i++)
+	{
+		if (stats[i] != 0)
+		{
+			numNonZeroStats++;
+			rleSym = i;
+		}
+	}
+
+	// Lower bound on the encoded size in bits of any table
+	entropyBound = zstdhl_EstimateEntropyBits(stats, numStats);
+
+	// Try reuse
+	if (!isFirstCompressedBlock)
+	{
+		ZSTDHL_CHECKED(zstdhl_TryFSETable(stats, numStats, probsVector, table, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_REUSE, 0, 0, NULL));
+	}
+
+	// Try predefined
+	{
+		zstdhl_FSETableDef_t tableDef;
+		tableDef.m_accuracyLog = sdef->m_defaultAccuracyLog;
+		tableDef.m_numProbabilities = sdef->m_numProbs;
+		tableDef.m_probabilities = sdef->m_defaultProbs;
+
+		ZSTDHL_CHECKED(zstdhl_TryFSETable(stats, numStats, probsVector, &tableDef, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED, 0, 0, NULL));
+	}
+
+	// Try RLE
+	if (numNonZeroStats == 1)
+	{
+		zstdhl_FSETableDef_t rleTableDef;
+		uint32_t *probs = NULL;
+
+		zstdhl_Vector_Clear(tempVectorU32);
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(tempVectorU32, NULL, rleSym + 1));
+
+		probs = (uint32_t *)tempVectorU32->m_data;
+		for (i = 0; i < rleSym; i++)
+			probs[i] = 0;
+		probs[rleSym] = 1 << ZSTDHL_MIN_ACCURACY_LOG;
+
+		rleTableDef.m_accuracyLog = ZSTDHL_MIN_ACCURACY_LOG;
+		rleTableDef.m_numProbabilities = rleSym + 1;
+		rleTableDef.m_probabilities = probs;
+
+		ZSTDHL_CHECKED(zstdhl_TryFSETable(stats, numStats, probsVector, &rleTableDef, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_RLE, 0, 8, NULL));
+
+		zstdhl_Vector_Clear(tempVectorU32);
+	}
+
+	// Try FSE, unless the best table so far is already within the table description size of the entropy bound
+	if (numStats >= 2 && numNonZeroStats >= 2 && (!haveScore || bestScore > entropyBound + 4u + numNonZeroStats))
+	{
+		uint64_t prevScore = 0;
+		uint8_t havePrevScore = 0;
+		size_t minAccuracyLog = zstdhl_Log2_32((uint32_t)(numNonZeroStats - 1)) + 1;
+
+		if (minAccuracyLog < ZSTDHL_MIN_ACCURACY_LOG)
+			minAccuracyLog = ZSTDHL_MIN_ACCURACY_LOG;
+
+		zstdhl_Vector_Clear(tempVectorU32);
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(tempVectorU32, NULL, numStats));
+
+		for (accuracyLog = minAccuracyLog; accuracyLog <= sdef->m_maxAccuracyLog; accuracyLog++)
+		{
+			zstdhl_FSETableDef_t fseTableDef;
+			uint32_t *probs = (uint32_t *)tempVectorU32->m_data;
+			uint8_t probsFit = 0;
+			uint64_t score = 0;
+
+			ZSTDHL_CHECKED(zstdhl_CreateFSEProbsFromStats(stats, numStats, probs, (uint8_t)accuracyLog, &probsFit));
+
+			if (!probsFit)
+				continue;
+
+			fseTableDef.m_numProbabilities = numStats;
+			fseTableDef.m_probabilities = probs;
+			fseTableDef.m_accuracyLog = (uint8_t)accuracyLog;
+
+			ZSTDHL_CHECKED(zstdhl_TryFSETable(stats, numStats, probsVector, &fseTableDef, table, &haveScore, &bestScore, outMode, ZSTDHL_SEQ_COMPRESSION_MODE_FSE, 1, 0, &score));
+
+			// Larger tables only pay off while the data savings exceed the description cost
+			if (havePrevScore && score >= prevScore)
+				break;
+
+			prevScore = score;
+			havePrevScore = 1;
+		}
+
+		zstdhl_Vector_Clear(tempVectorU32);
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t zstdhl_CreateFSEDefFromSymbolCounts(const size_t *symbolCounts, size_t numSymbolCounts, zstdhl_Vector_t *probsVector, uint8_t maxAccuracyLog, zstdhl_FSETableDef_t *outTableDef)
+{
+	size_t numNonZeroStats = 0;
+	size_t statsTotal = 0;
+	size_t accuracyLog = ZSTDHL_MIN_ACCURACY_LOG;
+	uint8_t probsFit = 0;
+	size_t i = 0;
+
+	for (i = 0; i < numSymbolCounts; i++)
+	{
+		if (symbolCounts[i] != 0)
+		{
+			numNonZeroStats++;
+			statsTotal += symbolCounts[i];
+		}
+	}
+
+	if (numNonZeroStats == 0)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	// Use the smallest table that is at least as large as the number of values, within the accuracy limits
+	while (accuracyLog < maxAccuracyLog && (((size_t)1 << accuracyLog) < statsTotal || ((size_t)1 << accuracyLog) < numNonZeroStats))
+		accuracyLog++;
+
+	zstdhl_Vector_Clear(probsVector);
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(probsVector, NULL, numSymbolCounts));
+
+	ZSTDHL_CHECKED(zstdhl_CreateFSEProbsFromStats(symbolCounts, numSymbolCounts, (uint32_t *)probsVector->m_data, (uint8_t)accuracyLog, &probsFit));
+
+	if (!probsFit)
+		return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+	outTableDef->m_accuracyLog = (uint8_t)accuracyLog;
+	outTableDef->m_numProbabilities = numSymbolCounts;
+	outTableDef->m_probabilities = (const uint32_t *)probsVector->m_data;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t zstdhl_CreateHuffmanDescFromSymbolCounts(const size_t *stats, size_t numStats, zstdhl_HuffmanTreeDesc_t *tree)
+{
+	uint8_t codeLengths[256];
+	size_t i = 0;
+	size_t largestDepth = 0;
+	size_t numSpecifiedWeights = 0;
+	size_t weightStats[ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1];
+	uint32_t weightProbs[2][ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1];
+	uint8_t weightProbsFit[3];
+	uint64_t scores[3];
+	uint8_t haveValidScore = 0;
+	uint64_t bestScoreIndex = 0;
+
+	if (numStats < 2 || numStats > 256)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	ZSTDHL_CHECKED(zstdhl_ComputeHuffmanCodeLengths(stats, numStats, ZSTDHL_MAX_HUFFMAN_CODE_LENGTH, codeLengths));
+
+	for (i = 0; i < numStats; i++)
+	{
+		if (codeLengths[i] > largestDepth)
+			largestDepth = codeLengths[i];
+	}
+
+	tree->m_partialWeightDesc.m_numSpecifiedWeights = 0;
+	for (i = 0; i < 256; i++)
+		tree->m_weightTableProbabilities[i] = 0;
+
+	for (i = 0; i < 255; i++)
+		tree->m_partialWeightDesc.m_specifiedWeights[i] = 0;
+
+	for (i = 0; i < (ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1); i++)
+	{
+		weightStats[i] = 0;
+		weightProbs[0][i] = 0;
+		weightProbs[1][i] = 0;
+	}
+
+	for (i = 0; i < numStats; i++)
+	{
+		uint8_t symbol = (uint8_t)i;
+		uint8_t weight = 0;
+
+		if (codeLengths[i] == 0)
+			continue;
+
+		weight = (uint8_t)(largestDepth + 1 - codeLengths[i]);
+
+		if (symbol < 255)
+			tree->m_partialWeightDesc.m_specifiedWeights[symbol] = weight;
+
+		if (symbol > numSpecifiedWeights)
+			numSpecifiedWeights = symbol;
+
+		if (weight > ZSTDHL_MAX_HUFFMAN_WEIGHT)
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	tree->m_partialWeightDesc.m_numSpecifiedWeights = (uint8_t)numSpecifiedWeights;
+
+	if (numSpecifiedWeights < 1)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	for (i = 0; i < numSpecifiedWeights; i++)
+		weightStats[tree->m_partialWeightDesc.m_specifiedWeights[i]]++;
+
+	if (numSpecifiedWeights < 2)
+	{
+		weightProbsFit[0] = 0;
+		weightProbsFit[1] = 0;
+	}
+	else
+	{
+		for (i = 0; i < 2; i++)
+		{
+			uint8_t accuracyLog = (uint8_t)(i + ZSTDHL_MIN_ACCURACY_LOG);
+			uint8_t probsFit = 0;
+
+			ZSTDHL_CHECKED(zstdhl_CreateFSEProbsFromStats(weightStats, ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1, weightProbs[i], accuracyLog, &weightProbsFit[i]));
+
+			if (weightProbsFit[i])
+			{
+				zstdhl_FSETableDef_t tableDef;
+				size_t weight = 0;
+
+				// If every weight is the same, the table would have no states that consume bits,
+				// so reserve a state for an unused weight
+				for (weight = 0; weight <= ZSTDHL_MAX_HUFFMAN_CODE_LENGTH; weight++)
+				{
+					if (weightProbs[i][weight] == ((uint32_t)1 << accuracyLog))
+					{
+						weightProbs[i][weight]--;
+						weightProbs[i][(weight == 0) ? 1 : 0] = 1;
+						break;
+					}
+				}
+
+				tableDef.m_accuracyLog = accuracyLog;
+				tableDef.m_numProbabilities = ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1;
+				tableDef.m_probabilities = weightProbs[i];
+
+				scores[i] = zstdhl_ScoreFSETable(weightStats, ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1, &tableDef, 1, &weightProbsFit[i]);
+			}
+		}
+	}
+
+	if (numSpecifiedWeights <= 128)
+	{
+		size_t numBytes = (numSpecifiedWeights + 1) / 2;
+
+		weightProbsFit[2] = 1;
+		scores[2] = numBytes * 8u;
+	}
+	else
+		weightProbsFit[2] = 0;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (weightProbsFit[i])
+		{
+			if (haveValidScore == 0 || scores[i] < scores[bestScoreIndex])
+			{
+				bestScoreIndex = i;
+				haveValidScore = 1;
+			}
+		}
+	}
+
+	if (!haveValidScore)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	if (bestScoreIndex == 0 || bestScoreIndex == 1)
+	{
+		tree->m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE;
+		tree->m_weightTable.m_probabilities = tree->m_weightTableProbabilities;
+		tree->m_weightTable.m_accuracyLog = (uint8_t)(bestScoreIndex + ZSTDHL_MIN_ACCURACY_LOG);
+
+		for (i = 0; i <= ZSTDHL_MAX_HUFFMAN_CODE_LENGTH; i++)
+		{
+			uint32_t prob = weightProbs[bestScoreIndex][i];
+			if (prob != 0)
+				tree->m_weightTable.m_numProbabilities = i + 1;
+
+			tree->m_weightTableProbabilities[i] = prob;
+		}
+	}
+	else
+		tree->m_huffmanWeightFormat = ZSTDHL_HUFFMAN_WEIGHT_ENCODING_UNCOMPRESSED;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t zstdhl_ScoreHuffmanTree(const zstdhl_HuffmanTreeDesc_t *tree, const size_t *stats, size_t numStats, uint8_t encodeTree, uint64_t *outScore, uint8_t *outIsValid)
+{
+	uint32_t runningTotal = 0;
+	size_t i = 0;
+	uint8_t maxBits = 0;
+	uint32_t nextPO2 = 0;
+	uint8_t lastWeight = 0;
+	uint8_t codeLengths[256];
+	size_t weightStats[ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1];
+	uint64_t score = 0;
+	
+	for (i = 0; i < (ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1); i++)
+		weightStats[i] = 0;
+
+	for (i = 0; i < tree->m_partialWeightDesc.m_numSpecifiedWeights; i++)
+	{
+		uint8_t weight = tree->m_partialWeightDesc.m_specifiedWeights[i];
+		if (weight != 0)
+			runningTotal += (uint32_t)1 << (weight - 1);
+
+		weightStats[weight]++;
+	}
+
+	for (i = 0; i < 256; i++)
+		codeLengths[i] = 0;
+
+	maxBits = zstdhl_Log2_32(runningTotal) + 1;
+	nextPO2 = (uint32_t)1 << maxBits;
+
+	lastWeight = zstdhl_Log2_32(nextPO2 - runningTotal) + 1;
+
+	for (i = 0; i < tree->m_partialWeightDesc.m_numSpecifiedWeights; i++)
+	{
+		uint8_t weight = tree->m_partialWeightDesc.m_specifiedWeights[i];
+		if (weight != 0)
+			codeLengths[i] = maxBits + 1 - weight;
+	}
+
+	codeLengths[tree->m_partialWeightDesc.m_numSpecifiedWeights] = maxBits + 1 - lastWeight;
+
+	for (i = 0; i < numStats; i++)
+	{
+		if (stats[i])
+		{
+			score += (uint64_t)codeLengths[i] * stats[i];
+			if (codeLengths[i] == 0)
+			{
+				*outIsValid = 0;
+				return ZSTDHL_RESULT_OK;
+			}
+		}
+	}
+
+	if (encodeTree)
+	{
+		if (tree->m_huffmanWeightFormat == ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE)
+		{
+			uint64_t fseTabScore;
+			uint8_t isValid = 0;
+
+			score += 4;	// For accuracy log
+
+			fseTabScore = zstdhl_ScoreFSETable(weightStats, ZSTDHL_MAX_HUFFMAN_CODE_LENGTH + 1, &tree->m_weightTable, 1, &isValid);
+
+			if (!isValid)
+			{
+				*outIsValid = 0;
+				return ZSTDHL_RESULT_OK;
+			}
+			score += fseTabScore;
+		}
+		else if (tree->m_huffmanWeightFormat == ZSTDHL_HUFFMAN_WEIGHT_ENCODING_UNCOMPRESSED)
+		{
+			uint16_t numWeightBytes = (((uint16_t)tree->m_partialWeightDesc.m_numSpecifiedWeights) + 1u) / 2u;
+			score += numWeightBytes * 8u;
+		}
+		else
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	*outIsValid = 1;
+	*outScore = score;
+	return ZSTDHL_RESULT_OK;
+}
+
+static uint8_t zstdhl_RawLiteralsSectionHeaderSize(size_t regeneratedSize)
+{
+	if (regeneratedSize >= 4096)
+		return 3;
+	else if (regeneratedSize >= 32)
+		return 2;
+	else
+		return 1;
+}
+
+static uint8_t zstdhl_CompressedLiteralsSectionHeaderSize(size_t regeneratedSize, size_t compressedSize, uint8_t is4Stream)
+{
+	if (!is4Stream)
+		return 3;
+
+	if (regeneratedSize >= 16384 || compressedSize >= 16384)
+		return 5;
+	else if (regeneratedSize >= 1024 || compressedSize >= 1024)
+		return 4;
+	else
+		return 3;
+}
+
+// Scores a Huffman literals section in bytes using whichever of the 1-stream and 4-stream layouts is smaller.
+// segmentCounts are the symbol counts of each 4-stream segment.
+static zstdhl_ResultCode_t zstdhl_ScoreHuffmanLiteralsSection(const zstdhl_HuffmanTreeDesc_t *tree, uint8_t encodeTree, const size_t *counts, size_t segmentCounts[4][256], size_t numCountedSymbols, size_t numLits, uint8_t canUse4Streams, uint64_t *outScore, uint8_t *outIs4Stream, uint8_t *outIsValid)
+{
+	uint64_t numBits = 0;
+	uint64_t treeSize = 0;
+	uint64_t compressedSize = 0;
+	uint64_t score = 0;
+	uint8_t isValid = 0;
+	size_t i = 0;
+
+	*outIsValid = 0;
+
+	ZSTDHL_CHECKED(zstdhl_ScoreHuffmanTree(tree, counts, numCountedSymbols, 0, &numBits, &isValid));
+	if (!isValid)
+		return ZSTDHL_RESULT_OK;
+
+	if (encodeTree)
+	{
+		uint64_t numBitsWithTree = 0;
+
+		ZSTDHL_CHECKED(zstdhl_ScoreHuffmanTree(tree, counts, numCountedSymbols, 1, &numBitsWithTree, &isValid));
+		if (!isValid)
+			return ZSTDHL_RESULT_OK;
+
+		// Tree description header byte plus the weights
+		treeSize = 1u + (numBitsWithTree - numBits + 7u) / 8u;
+	}
+
+	// Each stream ends with a padding bit, so it always takes numBits / 8 + 1 bytes
+	if (numLits < 1024)
+	{
+		compressedSize = treeSize + numBits / 8u + 1u;
+		if (compressedSize < 1024)
+		{
+			*outScore = compressedSize + zstdhl_CompressedLiteralsSectionHeaderSize(numLits, (size_t)compressedSize, 0);
+			*outIs4Stream = 0;
+			*outIsValid = 1;
+		}
+	}
+
+	if (canUse4Streams)
+	{
+		// Jump table
+		compressedSize = treeSize + 6u;
+
+		for (i = 0; i < 4; i++)
+		{
+			ZSTDHL_CHECKED(zstdhl_ScoreHuffmanTree(tree, segmentCounts[i], numCountedSymbols, 0, &numBits, &isValid));
+			if (!isValid)
+				return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+			compressedSize += numBits / 8u + 1u;
+		}
+
+		score = compressedSize + zstdhl_CompressedLiteralsSectionHeaderSize(numLits, (size_t)compressedSize, 1);
+		if (!*outIsValid || score < *outScore)
+		{
+			*outScore = score;
+			*outIs4Stream = 1;
+			*outIsValid = 1;
+		}
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t zstdhl_SelectLiteralsSection(const uint8_t *lits, size_t numLits, const zstdhl_HuffmanTreeDesc_t *prevTree, zstdhl_HuffmanTreeDesc_t *outNewTree, zstdhl_LiteralsSectionType_t *outSectionType, zstdhl_HuffmanStreamMode_t *outStreamMode)
+{
+	size_t segmentCounts[4][256];
+	size_t counts[256];
+	size_t segmentSize = (numLits + 3u) / 4u;
+	size_t lastSegmentSize = 0;
+	size_t numDistinct = 0;
+	size_t numCountedSymbols = 0;
+	uint64_t bestScore = 0;
+	uint8_t bestIs4Stream = 0;
+	uint8_t canUse4Streams = 0;
+	zstdhl_LiteralsSectionType_t bestType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+	size_t i = 0;
+
+	// 1, 2 and 5 literals can't be split into 4 streams, see zstdhl_AssembleHuffmanLiterals
+	canUse4Streams = (numLits > 0 && segmentSize * 3u <= numLits);
+
+	for (i = 0; i < 256; i++)
+	{
+		segmentCounts[0][i] = 0;
+		segmentCounts[1][i] = 0;
+		segmentCounts[2][i] = 0;
+		segmentCounts[3][i] = 0;
+	}
+
+	// Count each 4-stream segment into its own table so that the 4-stream layout can be scored per stream.
+	// Counting the segments in the same loop also avoids store-to-load stalls on runs of the same value.
+	if (canUse4Streams)
+	{
+		const uint8_t *segment0 = lits;
+		const uint8_t *segment1 = lits + segmentSize;
+		const uint8_t *segment2 = lits + segmentSize * 2u;
+		const uint8_t *segment3 = lits + segmentSize * 3u;
+
+		lastSegmentSize = numLits - segmentSize * 3u;
+
+		for (i = 0; i < lastSegmentSize; i++)
+		{
+			segmentCounts[0][segment0[i]]++;
+			segmentCounts[1][segment1[i]]++;
+			segmentCounts[2][segment2[i]]++;
+			segmentCounts[3][segment3[i]]++;
+		}
+
+		for (; i < segmentSize; i++)
+		{
+			segmentCounts[0][segment0[i]]++;
+			segmentCounts[1][segment1[i]]++;
+			segmentCounts[2][segment2[i]]++;
+		}
+	}
+	else
+	{
+		for (i = 0; i < numLits; i++)
+			segmentCounts[0][lits[i]]++;
+	}
+
+	for (i = 0; i < 256; i++)
+	{
+		counts[i] = segmentCounts[0][i] + segmentCounts[1][i] + segmentCounts[2][i] + segmentCounts[3][i];
+		if (counts[i] != 0)
+		{
+			numDistinct++;
+			numCountedSymbols = i + 1;
+		}
+	}
+
+	bestScore = (uint64_t)zstdhl_RawLiteralsSectionHeaderSize(numLits) + numLits;
+
+	if (numDistinct == 1 && numLits > 1)
+	{
+		bestType = ZSTDHL_LITERALS_SECTION_TYPE_RLE;
+		bestScore = (uint64_t)zstdhl_RawLiteralsSectionHeaderSize(numLits) + 1u;
+	}
+	else if (numDistinct >= 2)
+	{
+		uint64_t score = 0;
+		uint8_t is4Stream = 0;
+		uint8_t isValid = 0;
+
+		if (prevTree != NULL)
+		{
+			ZSTDHL_CHECKED(zstdhl_ScoreHuffmanLiteralsSection(prevTree, 0, counts, segmentCounts, numCountedSymbols, numLits, canUse4Streams, &score, &is4Stream, &isValid));
+
+			if (isValid && score < bestScore)
+			{
+				bestType = ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE;
+				bestScore = score;
+				bestIs4Stream = is4Stream;
+			}
+		}
+
+		ZSTDHL_CHECKED(zstdhl_CreateHuffmanDescFromSymbolCounts(counts, numCountedSymbols, outNewTree));
+		ZSTDHL_CHECKED(zstdhl_ScoreHuffmanLiteralsSection(outNewTree, 1, counts, segmentCounts, numCountedSymbols, numLits, canUse4Streams, &score, &is4Stream, &isValid));
+
+		if (isValid && score < bestScore)
+		{
+			bestType = ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN;
+			bestScore = score;
+			bestIs4Stream = is4Stream;
+		}
+	}
+
+	*outSectionType = bestType;
+
+	if (bestType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN || bestType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE)
+		*outStreamMode = bestIs4Stream ? ZSTDHL_HUFFMAN_STREAM_MODE_4_STREAMS : ZSTDHL_HUFFMAN_STREAM_MODE_1_STREAM;
+	else
+		*outStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Reads the block's literals and fills outBlock with the cheapest literals section encoding for them
+static zstdhl_ResultCode_t zstdhl_SelectLiteralsSectionMode(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock, zstdhl_EncBlockDesc_t *outBlock, zstdhl_MemBufferStreamSource_t *litStream, zstdhl_StreamSourceObject_t *litStreamObj)
+{
+	zstdhl_HuffmanTreeDesc_t prevTree;
+	size_t numLits = encBlock->m_litSectionDesc.m_numValues;
+	const uint8_t *lits = NULL;
+	zstdhl_LiteralsSectionType_t sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+	zstdhl_HuffmanStreamMode_t streamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+	size_t i = 0;
+
+	*outBlock = *encBlock;
+
+	zstdhl_Vector_Clear(&asmState->m_autoLitDataVector);
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_autoLitDataVector, NULL, numLits));
+	ZSTDHL_CHECKED(zstdhl_ReadChecked(encBlock->m_litSectionDesc.m_decompressedLiteralsStream, asmState->m_autoLitDataVector.m_data, numLits, ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED));
+
+	lits = (const uint8_t *)asmState->m_autoLitDataVector.m_data;
+
+	if (asmState->m_persistentState->m_haveHuffmanTree)
+	{
+		const zstdhl_HuffmanTreePartialWeightDesc_t *prevWeights = &asmState->m_persistentState->m_huffmanTree;
+
+		for (i = 0; i < sizeof(zstdhl_HuffmanTreePartialWeightDesc_t); i++)
+			((uint8_t *)&prevTree.m_partialWeightDesc)[i] = ((const uint8_t *)prevWeights)[i];
+	}
+
+	ZSTDHL_CHECKED(zstdhl_SelectLiteralsSection(lits, numLits, asmState->m_persistentState->m_haveHuffmanTree ? &prevTree : NULL, &outBlock->m_huffmanTreeDesc, &sectionType, &streamMode));
+
+	zstdhl_MemBufferStreamSource_Init(litStream, lits, numLits);
+	litStreamObj->m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	litStreamObj->m_userdata = litStream;
+
+	outBlock->m_litSectionHeader.m_sectionType = sectionType;
+	outBlock->m_litSectionHeader.m_regeneratedSize = (uint32_t)numLits;
+	outBlock->m_litSectionHeader.m_compressedSize = 0;
+	outBlock->m_litSectionDesc.m_huffmanStreamMode = streamMode;
+	outBlock->m_litSectionDesc.m_numValues = (sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE) ? 1 : numLits;
+	outBlock->m_litSectionDesc.m_decompressedLiteralsStream = litStreamObj;
+	outBlock->m_autoLitRegeneratedSizeFlag = 1;
+	outBlock->m_autoLitCompressedSizeFlag = 1;
+	outBlock->m_autoLitSectionModeFlag = 0;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_AssembleLiteralsSection(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock)
+{
+	zstdhl_EncBlockDesc_t autoBlock;
+	zstdhl_MemBufferStreamSource_t autoLitStream;
+	zstdhl_StreamSourceObject_t autoLitStreamObj;
+
+	if (encBlock->m_autoLitSectionModeFlag)
+	{
+		ZSTDHL_CHECKED(zstdhl_SelectLiteralsSectionMode(asmState, encBlock, &autoBlock, &autoLitStream, &autoLitStreamObj));
+		encBlock = &autoBlock;
+	}
+
+	{
+		uint32_t litSectionHeader = encBlock->m_litSectionHeader.m_sectionType;
+		uint8_t litSectionHeaderSize = 0;
+		size_t numLitsExpected = 0;
+
+		switch (encBlock->m_litSectionHeader.m_sectionType)
+		{
+		case ZSTDHL_LITERALS_SECTION_TYPE_RAW:
+		case ZSTDHL_LITERALS_SECTION_TYPE_RLE:
+			// TODO: Allow the size of regenerated size field to be specified
+			if (encBlock->m_litSectionHeader.m_regeneratedSize >= 1048576)
+				return ZSTDHL_RESULT_LITERALS_SECTION_REGENERATED_SIZE_INVALID;
+			else if (encBlock->m_litSectionHeader.m_regeneratedSize >= 4096)
+			{
+				litSectionHeader |= (3 << 2);
+				litSectionHeader |= (encBlock->m_litSectionHeader.m_regeneratedSize << 4);
+				litSectionHeaderSize = 3;
+			}
+			else if (encBlock->m_litSectionHeader.m_regeneratedSize >= 32)
+			{
+				litSectionHeader |= (1 << 2);
+				litSectionHeader |= (encBlock->m_litSectionHeader.m_regeneratedSize << 4);
+				litSectionHeaderSize = 2;
+			}
+			else
+			{
+				litSectionHeader |= (encBlock->m_litSectionHeader.m_regeneratedSize << 3);
+				litSectionHeaderSize = 1;
+			}
+
+			if (encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE)
+				numLitsExpected = 1;
+			else
+				numLitsExpected = encBlock->m_litSectionHeader.m_regeneratedSize;
+
+			if (numLitsExpected != encBlock->m_litSectionDesc.m_numValues)
+				return ZSTDHL_RESULT_LITERALS_SECTION_VALUE_COUNT_MISMATCH;
+
+			ZSTDHL_CHECKED(zstdhl_WriteLiteralsSectionHeader(asmState, litSectionHeader, litSectionHeaderSize));
+
+			{
+				// Write literals data
+				uint8_t buffer[1024];
+				size_t litsRemaining = numLitsExpected;
+				while (litsRemaining > 0)
+				{
+					size_t amountToRead = sizeof(buffer);
+					size_t amountRead = 0;
+
+					if (amountToRead > litsRemaining)
+						amountToRead = litsRemaining;
+
+					amountRead = encBlock->m_litSectionDesc.m_decompressedLiteralsStream->m_readBytesFunc(encBlock->m_litSectionDesc.m_decompressedLiteralsStream->m_userdata, buffer, amountToRead);
+
+					if (amountToRead != amountRead)
+						return ZSTDHL_RESULT_INPUT_FAILED;
+
+					ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_dataBlockVector, buffer, amountRead));
+					litsRemaining -= amountRead;
+				}
+			}
+
+			break;
+		case ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN:
+		case ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE:
+			ZSTDHL_CHECKED(zstdhl_AssembleHuffmanLiteralsSection(asmState, encBlock, encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE));
+			break;
+		}
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_AssembleSequencesSectionTableDef(zstdhl_AsmState_t *asmState, zstdhl_AsmTableState_t *tableState, zstdhl_EncLittleEndianBitstreamState_t *bitstream, zstdhl_SequencesCompressionMode_t compMode, const zstdhl_EncSeqCompressionDesc_t *desc)
+{
+	switch (compMode)
+	{
+	case ZSTDHL_SEQ_COMPRESSION_MODE_FSE:
+		{
+			zstdhl_FSESymbolTemp_t symbolTemps[64];
+
+			if (desc->m_fseProbs->m_accuracyLog > tableState->m_maxAccuracyLog)
+				return ZSTDHL_RESULT_ACCURACY_LOG_TOO_LARGE;
+
+			if (desc->m_fseProbs->m_accuracyLog < ZSTDHL_MIN_ACCURACY_LOG)
+				return ZSTDHL_RESULT_ACCURACY_LOG_TOO_SMALL;
+
+			if (desc->m_fseProbs->m_numProbabilities > tableState->m_maxSymbols)
+				return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+			tableState->m_pstate->m_isAssigned = 1;
+			tableState->m_pstate->m_isRLE = 0;
+			tableState->m_encTableValid = 0;
+			tableState->m_encTableIsPredefined = 0;
+			ZSTDHL_CHECKED(zstdhl_BuildFSEDistributionTable_ZStd(&tableState->m_pstate->m_table, desc->m_fseProbs, symbolTemps));
+			zstdhl_BuildFSEEncodeTable(&tableState->m_encTable, &tableState->m_pstate->m_table, tableState->m_maxSymbols);
+			tableState->m_activeEncTable = &tableState->m_encTable;
+			tableState->m_encTableValid = 1;
+
+			ZSTDHL_CHECKED(zstdhl_WriteFSETableDesc(bitstream, desc->m_fseProbs));
+		}
+		break;
+	case ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED:
+		tableState->m_pstate->m_isAssigned = 1;
+		tableState->m_pstate->m_isRLE = 0;
+
+		if (!tableState->m_encTableValid || !tableState->m_encTableIsPredefined)
+		{
+			zstdhl_AssignPredefinedFSETable(tableState->m_pstate, tableState->m_predefined);
+			tableState->m_activeEncTable = &tableState->m_predefined->m_encTable;
+			tableState->m_encTableValid = 1;
+			tableState->m_encTableIsPredefined = 1;
+		}
+		break;
+	case ZSTDHL_SEQ_COMPRESSION_MODE_REUSE:
+		if (!tableState->m_pstate->m_isAssigned)
+			return ZSTDHL_RESULT_REUSED_TABLE_WITHOUT_EXISTING_TABLE;
+
+		if (!tableState->m_pstate->m_isRLE && !tableState->m_encTableValid)
+		{
+			zstdhl_BuildFSEEncodeTable(&tableState->m_encTable, &tableState->m_pstate->m_table, tableState->m_maxSymbols);
+			tableState->m_activeEncTable = &tableState->m_encTable;
+			tableState->m_encTableValid = 1;
+		}
+		break;
+	case ZSTDHL_SEQ_COMPRESSION_MODE_RLE:
+		tableState->m_pstate->m_isRLE = 1;
+		tableState->m_pstate->m_rleByte = desc->m_rleByte;
+		tableState->m_pstate->m_isAssigned = 1;
+		ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(bitstream, desc->m_rleByte, 8));
+		break;
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_AssembleSequenceStateUpdate(size_t index, zstdhl_LE64BitWriter_t *writer, const zstdhl_AsmTableState_t *tableState, uint16_t sym, uint16_t *state)
+{
+	if (tableState->m_pstate->m_isRLE)
+	{
+		if (tableState->m_pstate->m_rleByte != sym)
+			return ZSTDHL_RESULT_SYMBOL_DOES_NOT_MATCH_RLE;
+	}
+	else
+	{
+		if (index == 0)
+		{
+			ZSTDHL_CHECKED(zstdhl_FindInitialFSEState(&tableState->m_pstate->m_table, sym, state));
+		}
+		else
+		{
+			uint32_t bits = 0;
+			uint8_t numBits = 0;
+
+			if (sym >= tableState->m_maxSymbols)
+				return ZSTDHL_RESULT_FSE_TABLE_MISSING_SYMBOL;
+
+			ZSTDHL_CHECKED(zstdhl_FSEEncodeTransition(tableState->m_activeEncTable, tableState->m_pstate->m_table.m_accuracyLog, sym, state, &bits, &numBits));
+
+			zstdhl_LE64BitWriter_Write(writer, bits, numBits);
+		}
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Selects a compression mode for one sequence code stream, with the table in the persistent state as the reuse candidate
+static zstdhl_ResultCode_t zstdhl_SelectSequenceCompressionMode(zstdhl_AsmState_t *asmState, const zstdhl_AsmTableState_t *tableState, const uint8_t *codes, size_t numSequences, zstdhl_Vector_t *probsVector, zstdhl_FSETableDef_t *outTableDef, zstdhl_SequencesCompressionMode_t *outMode, zstdhl_EncSeqCompressionDesc_t *outDesc)
+{
+	const zstdhl_AsmPersistentTableState_t *pstate = tableState->m_pstate;
+	size_t counts[64];
+	size_t numCounts = 0;
+	uint32_t *probs = NULL;
+	size_t i = 0;
+
+	for (i = 0; i < 64; i++)
+		counts[i] = 0;
+
+	for (i = 0; i < numSequences; i++)
+		counts[codes[i] & 63]++;
+
+	for (i = 0; i < 64; i++)
+	{
+		if (counts[i] != 0)
+			numCounts = i + 1;
+	}
+
+	// Rebuild the previous table's probabilities from its cells so it can be scored for reuse
+	zstdhl_Vector_Clear(probsVector);
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(probsVector, NULL, tableState->m_maxSymbols));
+
+	probs = (uint32_t *)probsVector->m_data;
+	for (i = 0; i < tableState->m_maxSymbols; i++)
+		probs[i] = 0;
+
+	outTableDef->m_accuracyLog = ZSTDHL_MIN_ACCURACY_LOG;
+	outTableDef->m_numProbabilities = tableState->m_maxSymbols;
+	outTableDef->m_probabilities = probs;
+
+	if (pstate->m_isAssigned)
+	{
+		if (pstate->m_isRLE)
+		{
+			if (pstate->m_rleByte < tableState->m_maxSymbols)
+				probs[pstate->m_rleByte] = 1 << ZSTDHL_MIN_ACCURACY_LOG;
+		}
+		else
+		{
+			for (i = 0; i < pstate->m_table.m_numCells; i++)
+				probs[pstate->m_table.m_cells[i].m_sym]++;
+
+			outTableDef->m_accuracyLog = pstate->m_table.m_accuracyLog;
+		}
+	}
+
+	ZSTDHL_CHECKED(zstdhl_SelectOptimalFSETable(counts, numCounts, probsVector, &asmState->m_autoSeqTempProbsVector, outTableDef, outMode, tableState->m_sdef, !pstate->m_isAssigned));
+
+	outDesc->m_fseProbs = outTableDef;
+	outDesc->m_rleByte = 0;
+
+	if (*outMode == ZSTDHL_SEQ_COMPRESSION_MODE_RLE)
+	{
+		for (i = 0; i < outTableDef->m_numProbabilities; i++)
+		{
+			if (outTableDef->m_probabilities[i] != 0)
+				outDesc->m_rleByte = (uint8_t)i;
+		}
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_AssembleSequencesSection(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock)
+{
+	const zstdhl_SequencesSectionDesc_t *seqDesc = &encBlock->m_seqSectionDesc;
+	const zstdhl_SequenceCollectionObject_t *seqCollection = &encBlock->m_seqCollection;
+	uint32_t numSequences = seqDesc->m_numSequences;
+	size_t i = 0;
+	uint8_t *litLengthCodes = NULL;
+	uint8_t *matchLengthCodes = NULL;
+	uint8_t *offsetCodes = NULL;
+	uint8_t *lengthExtraBitCounts = NULL;
+	uint32_t *lengthExtraBits = NULL;
+	uint32_t *offsetExtraBits = NULL;
+	zstdhl_SequencesCompressionMode_t litLengthsMode = seqDesc->m_literalLengthsMode;
+	zstdhl_SequencesCompressionMode_t offsetsMode = seqDesc->m_offsetsMode;
+	zstdhl_SequencesCompressionMode_t matchLengthsMode = seqDesc->m_matchLengthsMode;
+	const zstdhl_EncSeqCompressionDesc_t *litLengthsCompDesc = &encBlock->m_literalLengthsCompressionDesc;
+	const zstdhl_EncSeqCompressionDesc_t *offsetsCompDesc = &encBlock->m_offsetsModeCompressionDesc;
+	const zstdhl_EncSeqCompressionDesc_t *matchLengthsCompDesc = &encBlock->m_matchLengthsCompressionDesc;
+	zstdhl_EncSeqCompressionDesc_t autoCompDescs[3];
+	zstdhl_FSETableDef_t autoTableDefs[3];
+
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_litLengthCodeVector, NULL, numSequences));
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_matchLengthCodeVector, NULL, numSequences));
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_offsetCodeVector, NULL, numSequences));
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_lengthExtraBitCountVector, NULL, numSequences));
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_lengthExtraBitsVector, NULL, numSequences));
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_offsetExtraBitsVector, NULL, numSequences));
+
+	litLengthCodes = (uint8_t *)asmState->m_litLengthCodeVector.m_data;
+	matchLengthCodes = (uint8_t *)asmState->m_matchLengthCodeVector.m_data;
+	offsetCodes = (uint8_t *)asmState->m_offsetCodeVector.m_data;
+	lengthExtraBitCounts = (uint8_t *)asmState->m_lengthExtraBitCountVector.m_data;
+	lengthExtraBits = (uint32_t *)asmState->m_lengthExtraBitsVector.m_data;
+	offsetExtraBits = (uint32_t *)asmState->m_offsetExtraBitsVector.m_data;
+
+	for (i = 0; i < numSequences; i++)
+	{
+		uint32_t litLengthFSEValue = 0;
+		uint32_t litLengthExtraValue = 0;
+		uint8_t litLengthExtraBits = 0;
+		uint32_t matchLengthFSEValue = 0;
+		uint32_t matchLengthExtraValue = 0;
+		uint8_t matchLengthExtraBits = 0;
+		uint32_t offsetCode = 0;
+		uint32_t offsetCodeFSEValue = 0;
+		uint32_t offsetCodeExtraValue = 0;
+		uint8_t offsetCodeExtraBits = 0;
+		zstdhl_SequenceDesc_t seq;
+
+		ZSTDHL_CHECKED(seqCollection->m_getNextSequence(seqCollection->m_userdata, &seq));
+
+		ZSTDHL_CHECKED(zstdhl_EncodeLitLength(seq.m_litLength, &litLengthFSEValue, &litLengthExtraValue, &litLengthExtraBits));
+		ZSTDHL_CHECKED(zstdhl_EncodeMatchLength(seq.m_matchLength, &matchLengthFSEValue, &matchLengthExtraValue, &matchLengthExtraBits));
+
+		// TODO: Support more bits
+		if (seq.m_offsetValueNumBits > 32)
+			return ZSTDHL_RESULT_NOT_YET_IMPLEMENTED;
+
+		ZSTDHL_CHECKED(zstdhl_ResolveOffsetCode32(seq.m_offsetType, seq.m_litLength, (seq.m_offsetValueNumBits > 0) ? seq.m_offsetValueBigNum[0] : 0, &offsetCode));
+
+		ZSTDHL_CHECKED(zstdhl_EncodeOffsetCode(offsetCode, &offsetCodeFSEValue, &offsetCodeExtraValue, &offsetCodeExtraBits));
+
+		if (litLengthExtraBits + matchLengthExtraBits > 32 || offsetCodeExtraBits > 32)
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+		litLengthCodes[i] = (uint8_t)litLengthFSEValue;
+		matchLengthCodes[i] = (uint8_t)matchLengthFSEValue;
+		offsetCodes[i] = (uint8_t)offsetCodeFSEValue;
+		lengthExtraBitCounts[i] = (uint8_t)(litLengthExtraBits + matchLengthExtraBits);
+		lengthExtraBits[i] = litLengthExtraValue | (uint32_t)(((uint64_t)matchLengthExtraValue) << litLengthExtraBits);
+		offsetExtraBits[i] = offsetCodeExtraValue;
+	}
+
+	if (encBlock->m_autoSeqCompressionModeFlag && numSequences > 0)
+	{
+		ZSTDHL_CHECKED(zstdhl_SelectSequenceCompressionMode(asmState, &asmState->m_litLengthEncTable, litLengthCodes, numSequences, &asmState->m_autoSeqProbsVectors[0], &autoTableDefs[0], &litLengthsMode, &autoCompDescs[0]));
+		ZSTDHL_CHECKED(zstdhl_SelectSequenceCompressionMode(asmState, &asmState->m_offsetEncTable, offsetCodes, numSequences, &asmState->m_autoSeqProbsVectors[1], &autoTableDefs[1], &offsetsMode, &autoCompDescs[1]));
+		ZSTDHL_CHECKED(zstdhl_SelectSequenceCompressionMode(asmState, &asmState->m_matchLengthEncTable, matchLengthCodes, numSequences, &asmState->m_autoSeqProbsVectors[2], &autoTableDefs[2], &matchLengthsMode, &autoCompDescs[2]));
+
+		litLengthsCompDesc = &autoCompDescs[0];
+		offsetsCompDesc = &autoCompDescs[1];
+		matchLengthsCompDesc = &autoCompDescs[2];
+	}
+
+	{
+		zstdhl_EncLittleEndianBitstreamState_t bitstream;
+
+		ZSTDHL_CHECKED(zstdhl_EncLittleEndianBitstreamState_Init(&bitstream, &asmState->m_dataBlockVector));
+
+		// Write sequences section header
+		// TODO: Make sized
+		if (numSequences < 128)
+		{
+			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, numSequences, 8));
+		}
 		else if (numSequences < 0x7f00)
 		{
-			uint32_t sequencesHeader = 0;
-			sequencesHeader |= (numSequences >> 8) + 0x80;
-			sequencesHeader |= ((numSequences & 0xff) << 8);
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, sequencesHeader, 16));
+			uint32_t sequencesHeader = 0;
+			sequencesHeader |= (numSequences >> 8) + 0x80;
+			sequencesHeader |= ((numSequences & 0xff) << 8);
+			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, sequencesHeader, 16));
+		}
+		else if (numSequences < 0x17F00)
+		{
+			uint32_t sequencesHeader = (numSequences << 8) - 0x7EFF01;
+			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, sequencesHeader, 24));
+		}
+
+		if (numSequences > 0)
+		{
+			// Write compression modes
+			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, 0, 2));
+			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, matchLengthsMode, 2));
+			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, offsetsMode, 2));
+			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, litLengthsMode, 2));
+
+			// Write lit length table
+			ZSTDHL_CHECKED(zstdhl_AssembleSequencesSectionTableDef(asmState, &asmState->m_litLengthEncTable, &bitstream, litLengthsMode, litLengthsCompDesc));
+
+			// Write offset table
+			ZSTDHL_CHECKED(zstdhl_AssembleSequencesSectionTableDef(asmState, &asmState->m_offsetEncTable, &bitstream, offsetsMode, offsetsCompDesc));
+
+			// Write match length table
+			ZSTDHL_CHECKED(zstdhl_AssembleSequencesSectionTableDef(asmState, &asmState->m_matchLengthEncTable, &bitstream, matchLengthsMode, matchLengthsCompDesc));
+		}
+
+		// Table descriptions are padded, so this leaves the stream byte-aligned
+		ZSTDHL_CHECKED(zstdhl_FlushLEStreamBytes(&bitstream, bitstream.m_numBits / 8u));
+
+		if (bitstream.m_numBits != 0)
+			return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	if (numSequences > 0)
+	{
+		// Each sequence is at most 27 bits of state updates and 64 extra bits
+		size_t startOffset = asmState->m_dataBlockVector.m_count;
+		size_t maxSize = (size_t)numSequences * 12u + 16u;
+		uint8_t *outStart = NULL;
+		zstdhl_LE64BitWriter_t writer;
+		uint16_t litLengthState = 0;
+		uint16_t matchLengthState = 0;
+		uint16_t offsetState = 0;
+
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(&asmState->m_dataBlockVector, NULL, maxSize));
+
+		outStart = (uint8_t *)asmState->m_dataBlockVector.m_data + startOffset;
+
+		writer.m_bits = 0;
+		writer.m_numBits = 0;
+		writer.m_out = outStart;
+
+		for (i = 0; i < numSequences; i++)
+		{
+			size_t ri = numSequences - 1 - i;
+
+			ZSTDHL_CHECKED(zstdhl_AssembleSequenceStateUpdate(i, &writer, &asmState->m_offsetEncTable, offsetCodes[ri], &offsetState));
+			ZSTDHL_CHECKED(zstdhl_AssembleSequenceStateUpdate(i, &writer, &asmState->m_matchLengthEncTable, matchLengthCodes[ri], &matchLengthState));
+			ZSTDHL_CHECKED(zstdhl_AssembleSequenceStateUpdate(i, &writer, &asmState->m_litLengthEncTable, litLengthCodes[ri], &litLengthState));
+
+			// Encode bits
+			zstdhl_LE64BitWriter_Write(&writer, lengthExtraBits[ri], lengthExtraBitCounts[ri]);
+			zstdhl_LE64BitWriter_Write(&writer, offsetExtraBits[ri], offsetCodes[ri]);
+		}
+
+		if (!asmState->m_matchLengthEncTable.m_pstate->m_isRLE)
+			zstdhl_LE64BitWriter_Write(&writer, matchLengthState, asmState->m_matchLengthEncTable.m_pstate->m_table.m_accuracyLog);
+
+		if (!asmState->m_offsetEncTable.m_pstate->m_isRLE)
+			zstdhl_LE64BitWriter_Write(&writer, offsetState, asmState->m_offsetEncTable.m_pstate->m_table.m_accuracyLog);
+
+		if (!asmState->m_litLengthEncTable.m_pstate->m_isRLE)
+			zstdhl_LE64BitWriter_Write(&writer, litLengthState, asmState->m_litLengthEncTable.m_pstate->m_table.m_accuracyLog);
+
+		// Terminate stream and pad to a byte boundary
+		zstdhl_LE64BitWriter_Write(&writer, 1, 1);
+		writer.m_numBits = (uint8_t)((writer.m_numBits + 7u) & ~7u);
+		zstdhl_LE64BitWriter_Flush(&writer);
+
+		zstdhl_Vector_Shrink(&asmState->m_dataBlockVector, startOffset + (size_t)(writer.m_out - outStart));
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_AssembleBlockImpl(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock)
+{
+	ZSTDHL_CHECKED_PHASE(asmState->m_instrumentation, ZSTDHL_PHASE_ASSEMBLE_LITERALS_SECTION, 0, encBlock->m_litSectionDesc.m_numValues, zstdhl_AssembleLiteralsSection(asmState, encBlock));
+	ZSTDHL_CHECKED_PHASE(asmState->m_instrumentation, ZSTDHL_PHASE_ASSEMBLE_SEQUENCES_SECTION, 0, encBlock->m_seqSectionDesc.m_numSequences, zstdhl_AssembleSequencesSection(asmState, encBlock));
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Passes a compressed block's literals and sequences through to the assembler while adding them to a content tracker
+typedef struct zstdhl_ContentTrackerTap
+{
+	zstdhl_ContentTracker_t *m_tracker;
+	const zstdhl_StreamSourceObject_t *m_litStream;
+	const zstdhl_SequenceCollectionObject_t *m_seqCollection;
+	size_t m_rleLitCount;
+} zstdhl_ContentTrackerTap_t;
+
+static size_t zstdhl_ContentTrackerTap_ReadLiterals(void *userdata, void *dest, size_t numBytes)
+{
+	zstdhl_ContentTrackerTap_t *tap = (zstdhl_ContentTrackerTap_t *)userdata;
+	size_t numBytesRead = tap->m_litStream->m_readBytesFunc(tap->m_litStream->m_userdata, dest, numBytes);
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	if (tap->m_rleLitCount > 0 && numBytesRead > 0)
+		result = zstdhl_ContentTracker_AddRLELiterals(tap->m_tracker, ((const uint8_t *)dest)[0], tap->m_rleLitCount);
+	else
+		result = zstdhl_ContentTracker_AddLiterals(tap->m_tracker, dest, numBytesRead);
+
+	if (result != ZSTDHL_RESULT_OK)
+		return 0;
+
+	return numBytesRead;
+}
+
+static zstdhl_ResultCode_t zstdhl_ContentTrackerTap_GetNextSequence(void *userdata, zstdhl_SequenceDesc_t *sequence)
+{
+	zstdhl_ContentTrackerTap_t *tap = (zstdhl_ContentTrackerTap_t *)userdata;
+
+	ZSTDHL_CHECKED(tap->m_seqCollection->m_getNextSequence(tap->m_seqCollection->m_userdata, sequence));
+
+	return zstdhl_ContentTracker_AddSequence(tap->m_tracker, sequence);
+}
+
+static zstdhl_ResultCode_t zstdhl_AssembleTrackedBlockImpl(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock)
+{
+	zstdhl_EncBlockDesc_t trackedBlock = *encBlock;
+	zstdhl_ContentTrackerTap_t tap;
+	zstdhl_StreamSourceObject_t tapLitStream;
+
+	tap.m_tracker = asmState->m_contentTracker;
+	tap.m_litStream = encBlock->m_litSectionDesc.m_decompressedLiteralsStream;
+	tap.m_seqCollection = &encBlock->m_seqCollection;
+	tap.m_rleLitCount = 0;
+
+	if (!encBlock->m_autoLitSectionModeFlag && encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE)
+		tap.m_rleLitCount = encBlock->m_litSectionHeader.m_regeneratedSize;
+
+	tapLitStream.m_readBytesFunc = zstdhl_ContentTrackerTap_ReadLiterals;
+	tapLitStream.m_userdata = &tap;
+
+	trackedBlock.m_litSectionDesc.m_decompressedLiteralsStream = &tapLitStream;
+	trackedBlock.m_seqCollection.m_getNextSequence = zstdhl_ContentTrackerTap_GetNextSequence;
+	trackedBlock.m_seqCollection.m_userdata = &tap;
+
+	ZSTDHL_CHECKED(zstdhl_AssembleBlockImpl(asmState, &trackedBlock));
+
+	return zstdhl_ContentTracker_FinishBlock(asmState->m_contentTracker);
+}
+
+// Assembles a block into the data block vector, or points to the caller's data for raw and RLE blocks
+static zstdhl_ResultCode_t zstdhl_AssembleBlockContent(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock, uint8_t *blockHeaderBytes, const void **outBlockContentData, size_t *outBlockContentSize)
+{
+	uint32_t blockHeader = 0;
+	size_t blockSize = 0;
+	const void *blockContentData = NULL;
+	size_t blockContentSize = 0;
+
+	switch (encBlock->m_blockHeader.m_blockType)
+	{
+	case ZSTDHL_BLOCK_TYPE_RLE:
+		blockSize = encBlock->m_blockHeader.m_blockSize;
+		blockContentData = encBlock->m_uncompressedOrRLEData;
+		blockContentSize = 1;
+
+		if (asmState->m_contentTracker)
+		{
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddRLEContent(asmState->m_contentTracker, ((const uint8_t *)blockContentData)[0], blockSize));
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_FinishBlock(asmState->m_contentTracker));
 		}
-		else if (numSequences < 0x17F00)
+		break;
+	case ZSTDHL_BLOCK_TYPE_RAW:
+		blockSize = encBlock->m_blockHeader.m_blockSize;
+		blockContentData = encBlock->m_uncompressedOrRLEData;
+		blockContentSize = blockSize;
+
+		if (asmState->m_contentTracker)
 		{
-			uint32_t sequencesHeader = (numSequences << 8) - 0x7EFF01;
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, sequencesHeader, 24));
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddContent(asmState->m_contentTracker, blockContentData, blockSize));
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_FinishBlock(asmState->m_contentTracker));
+		}
+		break;
+	case ZSTDHL_BLOCK_TYPE_COMPRESSED:
+		if (asmState->m_contentTracker)
+			ZSTDHL_CHECKED(zstdhl_AssembleTrackedBlockImpl(asmState, encBlock));
+		else
+			ZSTDHL_CHECKED(zstdhl_AssembleBlockImpl(asmState, encBlock));
+		blockSize = encBlock->m_blockHeader.m_blockSize;
+		blockContentData = asmState->m_dataBlockVector.m_data;
+		blockContentSize = asmState->m_dataBlockVector.m_count;
+
+		if (encBlock->m_autoBlockSizeFlag)
+			blockSize = blockContentSize;
+
+		break;
+	default:
+		return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
+	}
+
+	if (encBlock->m_blockHeader.m_isLastBlock)
+		blockHeader |= 1;
+
+	blockHeader |= (encBlock->m_blockHeader.m_blockType << 1);
+
+	if (blockSize >= (1 << 20))
+		return ZSTDHL_RESULT_BLOCK_SIZE_INVALID;
+
+	blockHeader |= ((uint32_t)(blockSize << 3));
+
+	blockHeaderBytes[0] = (uint8_t)((blockHeader >> 0) & 0xff);
+	blockHeaderBytes[1] = (uint8_t)((blockHeader >> 8) & 0xff);
+	blockHeaderBytes[2] = (uint8_t)((blockHeader >> 16) & 0xff);
+
+	*outBlockContentData = blockContentData;
+	*outBlockContentSize = blockContentSize;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_AssembleAndWriteBlock(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_EncoderOutputObject_t *assemblyOutput)
+{
+	uint8_t blockHeaderBytes[3];
+	const void *blockContentData = NULL;
+	size_t blockContentSize = 0;
+
+	ZSTDHL_CHECKED(zstdhl_AssembleBlockContent(asmState, encBlock, blockHeaderBytes, &blockContentData, &blockContentSize));
+
+	ZSTDHL_CHECKED(assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, blockHeaderBytes, 3));
+	ZSTDHL_CHECKED(assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, blockContentData, blockContentSize));
+
+	return ZSTDHL_RESULT_OK;
+}
+
+struct zstdhl_AssemblerContext
+{
+	zstdhl_MemoryAllocatorObject_t m_alloc;
+	zstdhl_AssemblerPersistentState_t m_persistentState;
+	zstdhl_AsmState_t m_asmState;
+	zstdhl_ContentTracker_t m_contentTracker;
+};
+
+zstdhl_ResultCode_t zstdhl_CreateAssemblerContext(const zstdhl_MemoryAllocatorObject_t *alloc, zstdhl_AssemblerContext_t **outContext)
+{
+	zstdhl_AssemblerContext_t *context = (zstdhl_AssemblerContext_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_AssemblerContext_t));
+	if (!context)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	context->m_alloc.m_reallocFunc = alloc->m_reallocFunc;
+	context->m_alloc.m_userdata = alloc->m_userdata;
+
+	zstdhl_InitAssemblerState(&context->m_persistentState);
+	zstdhl_AsmState_Init(&context->m_asmState, &context->m_persistentState, alloc);
+	zstdhl_ContentTracker_Init(&context->m_contentTracker, alloc);
+
+	*outContext = context;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_ResetAssemblerContext(zstdhl_AssemblerContext_t *context)
+{
+	zstdhl_InitAssemblerState(&context->m_persistentState);
+
+	context->m_asmState.m_litLengthEncTable.m_encTableValid = 0;
+	context->m_asmState.m_matchLengthEncTable.m_encTableValid = 0;
+	context->m_asmState.m_offsetEncTable.m_encTableValid = 0;
+	context->m_asmState.m_contentTracker = NULL;
+}
+
+void zstdhl_SetAssemblerContextInstrumentation(zstdhl_AssemblerContext_t *context, const zstdhl_InstrumentationObject_t *instrumentation)
+{
+	context->m_asmState.m_instrumentation = instrumentation;
+}
+
+void zstdhl_DestroyAssemblerContext(zstdhl_AssemblerContext_t *context)
+{
+	zstdhl_AsmState_Destroy(&context->m_asmState);
+	zstdhl_ContentTracker_Destroy(&context->m_contentTracker);
+	context->m_alloc.m_reallocFunc(context->m_alloc.m_userdata, context, 0);
+}
+
+zstdhl_ResultCode_t zstdhl_AssembleBlockWithContext(zstdhl_AssemblerContext_t *context, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_EncoderOutputObject_t *assemblyOutput)
+{
+	zstdhl_AsmState_Clear(&context->m_asmState);
+
+	return zstdhl_AssembleAndWriteBlock(&context->m_asmState, encBlock, assemblyOutput);
+}
+
+static void zstdhl_BeginContextFrame(zstdhl_AssemblerContext_t *context, const zstdhl_FrameHeaderDesc_t *encFrame)
+{
+	zstdhl_ResetAssemblerContext(context);
+
+	if (encFrame->m_haveContentChecksum)
+	{
+		zstdhl_ContentTracker_Reset(&context->m_contentTracker, encFrame);
+		context->m_asmState.m_contentTracker = &context->m_contentTracker;
+	}
+}
+
+zstdhl_ResultCode_t zstdhl_AssembleFrameWithContext(zstdhl_AssemblerContext_t *context, const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncoderOutputObject_t *assemblyOutput)
+{
+	ZSTDHL_CHECKED(zstdhl_AssembleFrame(encFrame, assemblyOutput, 0));
+
+	zstdhl_BeginContextFrame(context, encFrame);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static void zstdhl_EncodeContentChecksum(const zstdhl_ContentTracker_t *contentTracker, uint8_t *checksumBytes)
+{
+	uint32_t checksum = zstdhl_ContentTracker_GetChecksum(contentTracker);
+
+	checksumBytes[0] = (uint8_t)((checksum >> 0) & 0xff);
+	checksumBytes[1] = (uint8_t)((checksum >> 8) & 0xff);
+	checksumBytes[2] = (uint8_t)((checksum >> 16) & 0xff);
+	checksumBytes[3] = (uint8_t)((checksum >> 24) & 0xff);
+}
+
+zstdhl_ResultCode_t zstdhl_AssembleFrameEndWithContext(zstdhl_AssemblerContext_t *context, const zstdhl_EncoderOutputObject_t *assemblyOutput)
+{
+	uint8_t checksumBytes[4];
+
+	if (!context->m_asmState.m_contentTracker)
+		return ZSTDHL_RESULT_OK;
+
+	zstdhl_EncodeContentChecksum(&context->m_contentTracker, checksumBytes);
+
+	return assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, checksumBytes, 4);
+}
+
+zstdhl_ResultCode_t zstdhl_AssembleBlock(zstdhl_AssemblerPersistentState_t *persistentState, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_EncoderOutputObject_t *assemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
+	zstdhl_AsmState_t asmState;
+
+	zstdhl_AsmState_Init(&asmState, persistentState, alloc);
+
+	resultCode = zstdhl_AssembleAndWriteBlock(&asmState, encBlock, assemblyOutput);
+
+	zstdhl_AsmState_Destroy(&asmState);
+
+	return resultCode;
+}
+
+size_t zstdhl_FrameBound(uint64_t contentSize, uint64_t numBlocks)
+{
+	// Block header, literals section header, maximum-size Huffman tree description, jump table, stream padding,
+	// sequences section header, 3 FSE table descriptions, and final FSE states.  Each sequence decodes to at least
+	// 3 bytes and encodes to at most 12, and each literal encodes to at most 11 bits, so content grows at most 4x.
+	const uint64_t blockOverhead = 3u + 5u + 129u + 6u + 4u + 4u + 3u * 96u + 16u;
+	const uint64_t maxBound = (uint64_t)SIZE_MAX;
+	uint64_t bound = ZSTDHL_MAX_FRAME_HEADER_SIZE + 4u;
+
+	if (numBlocks > (maxBound - bound) / blockOverhead)
+		return SIZE_MAX;
+
+	bound += numBlocks * blockOverhead;
+
+	if (contentSize > (maxBound - bound) / 4u)
+		return SIZE_MAX;
+
+	bound += contentSize * 4u;
+
+	return (size_t)bound;
+}
+
+zstdhl_ResultCode_t zstdhl_AssembleFrameToBuffer(zstdhl_AssemblerContext_t *context, const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncBlockSourceObject_t *blockSource, void *outBuffer, size_t outCapacity, size_t *outSize)
+{
+	zstdhl_AsmState_t *asmState = &context->m_asmState;
+	zstdhl_Vector_t ownedDataBlockVector;
+	uint8_t *outBytes = (uint8_t *)outBuffer;
+	uint8_t headerData[ZSTDHL_MAX_FRAME_HEADER_SIZE];
+	uint8_t headerSize = 0;
+	size_t writeOffset = 0;
+	size_t i = 0;
+
+	*outSize = 0;
+
+	ZSTDHL_CHECKED(zstdhl_EncodeFrameHeader(encFrame, headerData, &headerSize));
+
+	if (outCapacity < headerSize)
+		return ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL;
+
+	for (i = 0; i < headerSize; i++)
+		outBytes[i] = headerData[i];
+
+	writeOffset = headerSize;
+
+	zstdhl_BeginContextFrame(context, encFrame);
+
+	for (;;)
+	{
+		zstdhl_EncBlockDesc_t encBlock;
+		zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+		uint8_t *blockStart = NULL;
+		const void *blockContentData = NULL;
+		size_t blockContentSize = 0;
+		uint8_t eofFlag = 0;
+
+		ZSTDHL_CHECKED(blockSource->m_getNextBlockFunc(blockSource->m_userdata, &eofFlag, &encBlock));
+
+		if (eofFlag)
+			break;
+
+		if (outCapacity - writeOffset < 3)
+			return ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL;
+
+		blockStart = outBytes + writeOffset;
+
+		// Assemble compressed blocks in place after the block header, which is patched in afterward
+		zstdhl_AsmState_Clear(asmState);
+
+		ownedDataBlockVector = asmState->m_dataBlockVector;
+		zstdhl_Vector_InitFixed(&asmState->m_dataBlockVector, 1, blockStart + 3, outCapacity - writeOffset - 3);
+
+		result = zstdhl_AssembleBlockContent(asmState, &encBlock, blockStart, &blockContentData, &blockContentSize);
+
+		asmState->m_dataBlockVector = ownedDataBlockVector;
+
+		if (result != ZSTDHL_RESULT_OK)
+			return result;
+
+		if (outCapacity - writeOffset - 3 < blockContentSize)
+			return ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL;
+
+		if (blockContentData != blockStart + 3)
+		{
+			const uint8_t *contentBytes = (const uint8_t *)blockContentData;
+
+			for (i = 0; i < blockContentSize; i++)
+				blockStart[3 + i] = contentBytes[i];
 		}
 
-		if (numSequences > 0)
-		{
-			// Write compression modes
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, 0, 2));
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, encBlock->m_seqSectionDesc.m_matchLengthsMode, 2));
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, encBlock->m_seqSectionDesc.m_offsetsMode, 2));
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, encBlock->m_seqSectionDesc.m_literalLengthsMode, 2));
+		writeOffset += 3 + blockContentSize;
+	}
+
+	if (asmState->m_contentTracker)
+	{
+		if (outCapacity - writeOffset < 4)
+			return ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL;
+
+		zstdhl_EncodeContentChecksum(&context->m_contentTracker, outBytes + writeOffset);
+		writeOffset += 4;
+	}
+
+	*outSize = writeOffset;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_AdvanceAsmPersistentTableState(zstdhl_AsmPersistentTableState_t *tableState, zstdhl_SequencesCompressionMode_t compMode, const zstdhl_EncSeqCompressionDesc_t *desc, const zstdhl_SubstreamCompressionStructureDef_t *sdef, const zstdhl_PredefinedFSETable_t *predefined, uint16_t maxSymbols)
+{
+	zstdhl_FSESymbolTemp_t symbolTemps[64];
+
+	switch (compMode)
+	{
+	case ZSTDHL_SEQ_COMPRESSION_MODE_FSE:
+		if (desc->m_fseProbs->m_accuracyLog > sdef->m_maxAccuracyLog)
+			return ZSTDHL_RESULT_ACCURACY_LOG_TOO_LARGE;
+
+		if (desc->m_fseProbs->m_accuracyLog < ZSTDHL_MIN_ACCURACY_LOG)
+			return ZSTDHL_RESULT_ACCURACY_LOG_TOO_SMALL;
+
+		if (desc->m_fseProbs->m_numProbabilities > maxSymbols)
+			return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+		tableState->m_isAssigned = 1;
+		tableState->m_isRLE = 0;
+		ZSTDHL_CHECKED(zstdhl_BuildFSEDistributionTable_ZStd(&tableState->m_table, desc->m_fseProbs, symbolTemps));
+		break;
+	case ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED:
+		zstdhl_AssignPredefinedFSETable(tableState, predefined);
+		break;
+	case ZSTDHL_SEQ_COMPRESSION_MODE_REUSE:
+		if (!tableState->m_isAssigned)
+			return ZSTDHL_RESULT_REUSED_TABLE_WITHOUT_EXISTING_TABLE;
+		break;
+	case ZSTDHL_SEQ_COMPRESSION_MODE_RLE:
+		tableState->m_isRLE = 1;
+		tableState->m_rleByte = desc->m_rleByte;
+		tableState->m_isAssigned = 1;
+		break;
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Updates a persistent state to what it would be after assembling a block, without assembling it
+static zstdhl_ResultCode_t zstdhl_AdvanceAssemblerState(zstdhl_AssemblerPersistentState_t *persistentState, const zstdhl_EncBlockDesc_t *encBlock)
+{
+	const zstdhl_SequencesSectionDesc_t *seqDesc = &encBlock->m_seqSectionDesc;
+
+	if (encBlock->m_blockHeader.m_blockType != ZSTDHL_BLOCK_TYPE_COMPRESSED)
+		return ZSTDHL_RESULT_OK;
+
+	if (encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN)
+	{
+		persistentState->m_huffmanTree = encBlock->m_huffmanTreeDesc.m_partialWeightDesc;
+		persistentState->m_haveHuffmanTree = 1;
+	}
+
+	if (seqDesc->m_numSequences > 0)
+	{
+		ZSTDHL_CHECKED(zstdhl_AdvanceAsmPersistentTableState(&persistentState->m_litLengthTable, seqDesc->m_literalLengthsMode, &encBlock->m_literalLengthsCompressionDesc, zstdhl_GetDefaultLitLengthFSEProperties(), &zstdhl_predefinedLitLengthTable, ZSTDHL_MAX_LIT_LENGTH_CODE + 1));
+		ZSTDHL_CHECKED(zstdhl_AdvanceAsmPersistentTableState(&persistentState->m_offsetTable, seqDesc->m_offsetsMode, &encBlock->m_offsetsModeCompressionDesc, zstdhl_GetDefaultOffsetFSEProperties(), &zstdhl_predefinedOffsetTable, ZSTDHL_ASM_MAX_OFFSET_CODE + 1));
+		ZSTDHL_CHECKED(zstdhl_AdvanceAsmPersistentTableState(&persistentState->m_matchLengthTable, seqDesc->m_matchLengthsMode, &encBlock->m_matchLengthsCompressionDesc, zstdhl_GetDefaultMatchLengthFSEProperties(), &zstdhl_predefinedMatchLengthTable, ZSTDHL_MAX_MATCH_LENGTH_CODE + 1));
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+typedef enum zstdhl_ParallelAsm_BatchStatus
+{
+	ZSTDHL_PARALLELASM_BATCH_STATUS_FREE,
+	ZSTDHL_PARALLELASM_BATCH_STATUS_CAPTURED,
+	ZSTDHL_PARALLELASM_BATCH_STATUS_ASSEMBLING,
+	ZSTDHL_PARALLELASM_BATCH_STATUS_ASSEMBLED,
+} zstdhl_ParallelAsm_BatchStatus_t;
+
+// A block copied out of the block source, with everything it points to owned by the batch
+typedef struct zstdhl_ParallelAsm_Batch
+{
+	zstdhl_EncBlockDesc_t m_encBlock;
+
+	// Persistent state from before the block, so that reused tables can be resolved out of order
+	zstdhl_AssemblerPersistentState_t m_persistentState;
+
+	zstdhl_FSETableDef_t m_fseTableDefs[3];
+	uint32_t m_fseProbs[3][64];
+
+	zstdhl_Vector_t m_literalsVector;
+	zstdhl_Vector_t m_sequencesVector;
+	zstdhl_Vector_t m_offsetsVector;
+	zstdhl_Vector_t m_outputVector;
+
+	zstdhl_MemBufferStreamSource_t m_litStream;
+	zstdhl_StreamSourceObject_t m_litStreamObj;
+	size_t m_nextSequence;
+
+	zstdhl_ParallelAsm_BatchStatus_t m_status;
+	zstdhl_ResultCode_t m_resultCode;
+} zstdhl_ParallelAsm_Batch_t;
+
+struct zstdhl_ParallelAsm_Pipeline;
+
+typedef struct zstdhl_ParallelAsm_Worker
+{
+	struct zstdhl_ParallelAsm_Pipeline *m_pipeline;
+	zstdhl_AssemblerContext_t *m_asmContext;
+	zstdhl_Thread_t m_thread;
+	uint8_t m_threadStarted;
+} zstdhl_ParallelAsm_Worker_t;
 
-			// Write lit length table
-			ZSTDHL_CHECKED(zstdhl_AssembleSequencesSectionTableDef(asmState, &asmState->m_litLengthEncTable, &bitstream, encBlock->m_seqSectionDesc.m_literalLengthsMode, &encBlock->m_literalLengthsCompressionDesc));
+typedef struct zstdhl_ParallelAsm_Pipeline
+{
+	zstdhl_MemoryAllocatorObject_t m_alloc;
 
-			// Write offset table
-			ZSTDHL_CHECKED(zstdhl_AssembleSequencesSectionTableDef(asmState, &asmState->m_offsetEncTable, &bitstream, encBlock->m_seqSectionDesc.m_offsetsMode, &encBlock->m_offsetsModeCompressionDesc));
+	zstdhl_Mutex_t m_mutex;
+	zstdhl_CondVar_t m_workAvailableCV;
+	zstdhl_CondVar_t m_workFinishedCV;
+	uint8_t m_haveMutex;
+	uint8_t m_haveWorkAvailableCV;
+	uint8_t m_haveWorkFinishedCV;
 
-			// Write match length table
-			ZSTDHL_CHECKED(zstdhl_AssembleSequencesSectionTableDef(asmState, &asmState->m_matchLengthEncTable, &bitstream, encBlock->m_seqSectionDesc.m_matchLengthsMode, &encBlock->m_matchLengthsCompressionDesc));
+	zstdhl_ParallelAsm_Batch_t *m_batches;
+	size_t m_numBatches;
 
-			// Resolve coded sequence values
-			{
-				uint16_t litLengthState = 0;
-				uint16_t matchLengthState = 0;
-				uint16_t offsetState = 0;
+	zstdhl_ParallelAsm_Worker_t *m_workers;
+	size_t m_numWorkers;
 
-				for (i = 0; i < numSequences; i++)
-				{
-					size_t ri = numSequences - 1 - i;
-					const zstdhl_SequenceEncStackItem_t *stackItem = ((const zstdhl_SequenceEncStackItem_t *)asmState->m_encStackItemVector.m_data) + ri;
+	// Running block counts, batch for block N is N % m_numBatches
+	size_t m_numCaptured;
+	size_t m_numDispatched;
+	size_t m_numWritten;
 
-					ZSTDHL_CHECKED(zstdhl_AssembleSequenceStateUpdate(i, &bitstream, &asmState->m_offsetEncTable, stackItem->m_offsetCode, &offsetState));
-					ZSTDHL_CHECKED(zstdhl_AssembleSequenceStateUpdate(i, &bitstream, &asmState->m_matchLengthEncTable, stackItem->m_matchLengthCode, &matchLengthState));
-					ZSTDHL_CHECKED(zstdhl_AssembleSequenceStateUpdate(i, &bitstream, &asmState->m_litLengthEncTable, stackItem->m_litLengthCode, &litLengthState));
+	uint8_t m_shutdown;
 
-					// Encode bits
-					ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, stackItem->m_litLengthExtraBits, stackItem->m_numLitLengthExtraBits));
-					ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, stackItem->m_matchLengthExtraBits, stackItem->m_numMatchLengthExtraBits));
-					ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, (uint32_t)stackItem->m_offsetExtraBits, stackItem->m_numOffsetExtraBits));
-				}
+	// Persistent state after the last captured block
+	zstdhl_AssemblerPersistentState_t m_persistentState;
 
-				if (!asmState->m_matchLengthEncTable.m_pstate->m_isRLE)
-				{
-					ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, matchLengthState, asmState->m_matchLengthEncTable.m_pstate->m_table.m_accuracyLog));
-				}
+	// If set, captured block content is hashed for the content checksum
+	zstdhl_ContentTracker_t *m_contentTracker;
+	zstdhl_ContentTracker_t m_contentTrackerStorage;
+} zstdhl_ParallelAsm_Pipeline_t;
 
-				if (!asmState->m_offsetEncTable.m_pstate->m_isRLE)
-				{
-					ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, offsetState, asmState->m_offsetEncTable.m_pstate->m_table.m_accuracyLog));
-				}
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_WriteToVector(void *userdata, const void *data, size_t size)
+{
+	return zstdhl_Vector_Append((zstdhl_Vector_t *)userdata, data, size);
+}
 
-				if (!asmState->m_litLengthEncTable.m_pstate->m_isRLE)
-				{
-					ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, litLengthState, asmState->m_litLengthEncTable.m_pstate->m_table.m_accuracyLog));
-				}
-			}
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_GetNextSequence(void *userdata, zstdhl_SequenceDesc_t *sequence)
+{
+	zstdhl_ParallelAsm_Batch_t *batch = (zstdhl_ParallelAsm_Batch_t *)userdata;
 
-			// Flush padding and terminate stream
-			ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, 1, 1));
-			{
-				uint8_t numPaddingBits = 8u - (bitstream.m_numBits % 8u);
+	if (batch->m_nextSequence == batch->m_sequencesVector.m_count)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
 
-				if (numPaddingBits != 8u)
-				{
-					ZSTDHL_CHECKED(zstdhl_WriteLEStreamBits(&bitstream, 0, numPaddingBits));
-				}
-			}
-		} // if (numSequences > 0)
+	*sequence = ((const zstdhl_SequenceDesc_t *)batch->m_sequencesVector.m_data)[batch->m_nextSequence++];
 
-		ZSTDHL_CHECKED(zstdhl_FlushLEStreamBytes(&bitstream, bitstream.m_numBits / 8u));
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_CaptureSeqCompressionDesc(zstdhl_ParallelAsm_Batch_t *batch, int tableIndex, zstdhl_SequencesCompressionMode_t compMode, zstdhl_EncSeqCompressionDesc_t *desc)
+{
+	zstdhl_FSETableDef_t *tableDef = batch->m_fseTableDefs + tableIndex;
+	uint32_t *probs = batch->m_fseProbs[tableIndex];
+	size_t i = 0;
+
+	if (compMode != ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+	{
+		desc->m_fseProbs = NULL;
+		return ZSTDHL_RESULT_OK;
 	}
 
+	if (desc->m_fseProbs->m_numProbabilities > 64)
+		return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+	for (i = 0; i < desc->m_fseProbs->m_numProbabilities; i++)
+		probs[i] = desc->m_fseProbs->m_probabilities[i];
+
+	tableDef->m_accuracyLog = desc->m_fseProbs->m_accuracyLog;
+	tableDef->m_numProbabilities = desc->m_fseProbs->m_numProbabilities;
+	tableDef->m_probabilities = probs;
+
+	desc->m_fseProbs = tableDef;
+
 	return ZSTDHL_RESULT_OK;
 }
 
-static zstdhl_ResultCode_t zstdhl_AssembleBlockImpl(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock)
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_CaptureCompressedBlock(zstdhl_ParallelAsm_Batch_t *batch, zstdhl_ContentTracker_t *contentTracker)
 {
-	ZSTDHL_CHECKED(zstdhl_AssembleLiteralsSection(asmState, encBlock));
-	ZSTDHL_CHECKED(zstdhl_AssembleSequencesSection(asmState, encBlock));
+	zstdhl_EncBlockDesc_t *encBlock = &batch->m_encBlock;
+	zstdhl_HuffmanTreeDesc_t *treeDesc = &encBlock->m_huffmanTreeDesc;
+	const zstdhl_StreamSourceObject_t *litStream = encBlock->m_litSectionDesc.m_decompressedLiteralsStream;
+	size_t numLits = encBlock->m_litSectionDesc.m_numValues;
+	uint32_t numSequences = encBlock->m_seqSectionDesc.m_numSequences;
+	const uint8_t *lits = NULL;
+	zstdhl_SequenceDesc_t *sequences = NULL;
+	uint32_t *offsets = NULL;
+	size_t i = 0;
+
+	if (encBlock->m_autoLitSectionModeFlag || encBlock->m_autoSeqCompressionModeFlag)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN && treeDesc->m_huffmanWeightFormat == ZSTDHL_HUFFMAN_WEIGHT_ENCODING_FSE)
+	{
+		const uint32_t *weightProbs = treeDesc->m_weightTable.m_probabilities;
+
+		if (treeDesc->m_weightTable.m_numProbabilities > 256)
+			return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+		if (weightProbs != treeDesc->m_weightTableProbabilities)
+		{
+			for (i = 0; i < treeDesc->m_weightTable.m_numProbabilities; i++)
+				treeDesc->m_weightTableProbabilities[i] = weightProbs[i];
+		}
+
+		treeDesc->m_weightTable.m_probabilities = treeDesc->m_weightTableProbabilities;
+	}
+
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&batch->m_literalsVector, NULL, numLits));
+
+	if (numLits > 0 && litStream->m_readBytesFunc(litStream->m_userdata, batch->m_literalsVector.m_data, numLits) != numLits)
+		return ZSTDHL_RESULT_INPUT_FAILED;
+
+	lits = (const uint8_t *)batch->m_literalsVector.m_data;
+
+	if (contentTracker)
+	{
+		if (encBlock->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE && numLits > 0)
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddRLELiterals(contentTracker, lits[0], encBlock->m_litSectionHeader.m_regeneratedSize));
+		else
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddLiterals(contentTracker, lits, numLits));
+	}
+
+	zstdhl_MemBufferStreamSource_Init(&batch->m_litStream, lits, numLits);
+	batch->m_litStreamObj.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	batch->m_litStreamObj.m_userdata = &batch->m_litStream;
+	encBlock->m_litSectionDesc.m_decompressedLiteralsStream = &batch->m_litStreamObj;
+
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&batch->m_sequencesVector, NULL, numSequences));
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&batch->m_offsetsVector, NULL, numSequences));
+
+	sequences = (zstdhl_SequenceDesc_t *)batch->m_sequencesVector.m_data;
+	offsets = (uint32_t *)batch->m_offsetsVector.m_data;
+
+	for (i = 0; i < numSequences; i++)
+	{
+		zstdhl_SequenceDesc_t *seq = sequences + i;
+
+		ZSTDHL_CHECKED(encBlock->m_seqCollection.m_getNextSequence(encBlock->m_seqCollection.m_userdata, seq));
+
+		// TODO: Support more bits
+		if (seq->m_offsetValueNumBits > 32)
+			return ZSTDHL_RESULT_NOT_YET_IMPLEMENTED;
+
+		if (contentTracker)
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddSequence(contentTracker, seq));
+
+		offsets[i] = (seq->m_offsetValueNumBits > 0) ? seq->m_offsetValueBigNum[0] : 0;
+		seq->m_offsetValueBigNum = offsets + i;
+	}
+
+	if (contentTracker)
+		ZSTDHL_CHECKED(zstdhl_ContentTracker_FinishBlock(contentTracker));
+
+	batch->m_nextSequence = 0;
+	encBlock->m_seqCollection.m_getNextSequence = zstdhl_ParallelAsm_GetNextSequence;
+	encBlock->m_seqCollection.m_userdata = batch;
+
+	if (numSequences > 0)
+	{
+		ZSTDHL_CHECKED(zstdhl_ParallelAsm_CaptureSeqCompressionDesc(batch, 0, encBlock->m_seqSectionDesc.m_literalLengthsMode, &encBlock->m_literalLengthsCompressionDesc));
+		ZSTDHL_CHECKED(zstdhl_ParallelAsm_CaptureSeqCompressionDesc(batch, 1, encBlock->m_seqSectionDesc.m_offsetsMode, &encBlock->m_offsetsModeCompressionDesc));
+		ZSTDHL_CHECKED(zstdhl_ParallelAsm_CaptureSeqCompressionDesc(batch, 2, encBlock->m_seqSectionDesc.m_matchLengthsMode, &encBlock->m_matchLengthsCompressionDesc));
+	}
 
 	return ZSTDHL_RESULT_OK;
 }
 
-static zstdhl_ResultCode_t zstdhl_AssembleAndWriteBlock(zstdhl_AsmState_t *asmState, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_EncoderOutputObject_t *assemblyOutput)
+// Copies a block from the block source into a batch and advances the pipeline's persistent state past it
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_CaptureBlock(zstdhl_ParallelAsm_Pipeline_t *pipeline, zstdhl_ParallelAsm_Batch_t *batch, const zstdhl_EncBlockDesc_t *encBlock)
 {
-	uint8_t blockHeaderBytes[3];
-	uint32_t blockHeader = 0;
-	size_t blockSize = 0;
-	const void *blockContentData = NULL;
-	size_t blockContentSize = 0;
+	zstdhl_ContentTracker_t *contentTracker = pipeline->m_contentTracker;
+	const uint8_t *blockData = (const uint8_t *)encBlock->m_uncompressedOrRLEData;
+
+	batch->m_encBlock = *encBlock;
+
+	zstdhl_Vector_Clear(&batch->m_literalsVector);
+	zstdhl_Vector_Clear(&batch->m_sequencesVector);
+	zstdhl_Vector_Clear(&batch->m_offsetsVector);
+
+	zstdhl_CopyAssemblerState(&batch->m_persistentState, &pipeline->m_persistentState);
 
 	switch (encBlock->m_blockHeader.m_blockType)
 	{
 	case ZSTDHL_BLOCK_TYPE_RLE:
-		blockSize = encBlock->m_blockHeader.m_blockSize;
-		blockContentData = encBlock->m_uncompressedOrRLEData;
-		blockContentSize = 1;
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(&batch->m_literalsVector, blockData, 1));
+
+		if (contentTracker)
+		{
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddRLEContent(contentTracker, blockData[0], encBlock->m_blockHeader.m_blockSize));
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_FinishBlock(contentTracker));
+		}
 		break;
 	case ZSTDHL_BLOCK_TYPE_RAW:
-		blockSize = encBlock->m_blockHeader.m_blockSize;
-		blockContentData = encBlock->m_uncompressedOrRLEData;
-		blockContentSize = blockSize;
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(&batch->m_literalsVector, blockData, encBlock->m_blockHeader.m_blockSize));
+
+		if (contentTracker)
+		{
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_AddContent(contentTracker, blockData, encBlock->m_blockHeader.m_blockSize));
+			ZSTDHL_CHECKED(zstdhl_ContentTracker_FinishBlock(contentTracker));
+		}
 		break;
 	case ZSTDHL_BLOCK_TYPE_COMPRESSED:
-		ZSTDHL_CHECKED(zstdhl_AssembleBlockImpl(asmState, encBlock));
-		blockSize = encBlock->m_blockHeader.m_blockSize;
-		blockContentData = asmState->m_dataBlockVector.m_data;
-		blockContentSize = asmState->m_dataBlockVector.m_count;
-
-		if (encBlock->m_autoBlockSizeFlag)
-			blockSize = blockContentSize;
-
+		ZSTDHL_CHECKED(zstdhl_ParallelAsm_CaptureCompressedBlock(batch, contentTracker));
 		break;
 	default:
 		return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
 	}
 
-	if (encBlock->m_blockHeader.m_isLastBlock)
-		blockHeader |= 1;
+	batch->m_encBlock.m_uncompressedOrRLEData = batch->m_literalsVector.m_data;
 
-	blockHeader |= (encBlock->m_blockHeader.m_blockType << 1);
+	return zstdhl_AdvanceAssemblerState(&pipeline->m_persistentState, &batch->m_encBlock);
+}
 
-	if (blockSize >= (1 << 20))
-		return ZSTDHL_RESULT_BLOCK_SIZE_INVALID;
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_AssembleBatch(zstdhl_ParallelAsm_Worker_t *worker, zstdhl_ParallelAsm_Batch_t *batch)
+{
+	zstdhl_AssemblerContext_t *context = worker->m_asmContext;
+	zstdhl_EncoderOutputObject_t output;
 
-	blockHeader |= ((uint32_t)(blockSize << 3));
+	zstdhl_Vector_Clear(&batch->m_outputVector);
 
-	blockHeaderBytes[0] = (uint8_t)((blockHeader >> 0) & 0xff);
-	blockHeaderBytes[1] = (uint8_t)((blockHeader >> 8) & 0xff);
-	blockHeaderBytes[2] = (uint8_t)((blockHeader >> 16) & 0xff);
+	output.m_writeBitstreamFunc = zstdhl_ParallelAsm_WriteToVector;
+	output.m_userdata = &batch->m_outputVector;
 
-	ZSTDHL_CHECKED(assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, blockHeaderBytes, 3));
-	ZSTDHL_CHECKED(assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, blockContentData, blockContentSize));
+	zstdhl_ResetAssemblerContext(context);
+	zstdhl_CopyAssemblerState(&context->m_persistentState, &batch->m_persistentState);
+
+	return zstdhl_AssembleBlockWithContext(context, &batch->m_encBlock, &output);
+}
+
+static void zstdhl_ParallelAsm_WorkerThreadFunc(void *userdata)
+{
+	zstdhl_ParallelAsm_Worker_t *worker = (zstdhl_ParallelAsm_Worker_t *)userdata;
+	zstdhl_ParallelAsm_Pipeline_t *pipeline = worker->m_pipeline;
+
+	zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+	for (;;)
+	{
+		zstdhl_ParallelAsm_Batch_t *batch = NULL;
+		zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
+
+		while (!pipeline->m_shutdown && pipeline->m_numDispatched == pipeline->m_numCaptured)
+			zstdhl_CondVar_Wait(&pipeline->m_workAvailableCV, &pipeline->m_mutex);
+
+		if (pipeline->m_shutdown)
+			break;
+
+		batch = pipeline->m_batches + (pipeline->m_numDispatched % pipeline->m_numBatches);
+		batch->m_status = ZSTDHL_PARALLELASM_BATCH_STATUS_ASSEMBLING;
+		pipeline->m_numDispatched++;
+
+		zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+		resultCode = zstdhl_ParallelAsm_AssembleBatch(worker, batch);
+
+		zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+		batch->m_resultCode = resultCode;
+		batch->m_status = ZSTDHL_PARALLELASM_BATCH_STATUS_ASSEMBLED;
+
+		zstdhl_CondVar_Signal(&pipeline->m_workFinishedCV);
+	}
+
+	zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+}
+
+static void zstdhl_ParallelAsm_Pipeline_Destroy(zstdhl_ParallelAsm_Pipeline_t *pipeline)
+{
+	size_t i = 0;
+
+	if (pipeline->m_workers)
+	{
+		if (pipeline->m_haveMutex)
+		{
+			zstdhl_Mutex_Lock(&pipeline->m_mutex);
+			pipeline->m_shutdown = 1;
+			if (pipeline->m_haveWorkAvailableCV)
+				zstdhl_CondVar_Broadcast(&pipeline->m_workAvailableCV);
+			zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+		}
+
+		for (i = 0; i < pipeline->m_numWorkers; i++)
+		{
+			zstdhl_ParallelAsm_Worker_t *worker = pipeline->m_workers + i;
+
+			if (worker->m_threadStarted)
+				zstdhl_Thread_Join(&worker->m_thread);
+
+			if (worker->m_asmContext)
+				zstdhl_DestroyAssemblerContext(worker->m_asmContext);
+		}
+
+		pipeline->m_alloc.m_reallocFunc(pipeline->m_alloc.m_userdata, pipeline->m_workers, 0);
+	}
+
+	if (pipeline->m_batches)
+	{
+		for (i = 0; i < pipeline->m_numBatches; i++)
+		{
+			zstdhl_ParallelAsm_Batch_t *batch = pipeline->m_batches + i;
+
+			zstdhl_Vector_Destroy(&batch->m_literalsVector);
+			zstdhl_Vector_Destroy(&batch->m_sequencesVector);
+			zstdhl_Vector_Destroy(&batch->m_offsetsVector);
+			zstdhl_Vector_Destroy(&batch->m_outputVector);
+		}
+
+		pipeline->m_alloc.m_reallocFunc(pipeline->m_alloc.m_userdata, pipeline->m_batches, 0);
+	}
+
+	zstdhl_ContentTracker_Destroy(&pipeline->m_contentTrackerStorage);
+
+	if (pipeline->m_haveWorkFinishedCV)
+		zstdhl_CondVar_Destroy(&pipeline->m_workFinishedCV);
+	if (pipeline->m_haveWorkAvailableCV)
+		zstdhl_CondVar_Destroy(&pipeline->m_workAvailableCV);
+	if (pipeline->m_haveMutex)
+		zstdhl_Mutex_Destroy(&pipeline->m_mutex);
+}
+
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_Pipeline_Init(zstdhl_ParallelAsm_Pipeline_t *pipeline, const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_FrameHeaderDesc_t *encFrame, size_t numWorkerThreads, size_t maxBlocksInFlight)
+{
+	size_t i = 0;
+	size_t numWorkers = numWorkerThreads;
+
+	if (numWorkers == 0)
+		numWorkers = 1;
+
+	if (maxBlocksInFlight < numWorkerThreads + 1)
+		maxBlocksInFlight = numWorkerThreads * 2 + 1;
+
+	pipeline->m_alloc.m_reallocFunc = alloc->m_reallocFunc;
+	pipeline->m_alloc.m_userdata = alloc->m_userdata;
+	pipeline->m_haveMutex = 0;
+	pipeline->m_haveWorkAvailableCV = 0;
+	pipeline->m_haveWorkFinishedCV = 0;
+	pipeline->m_batches = NULL;
+	pipeline->m_numBatches = 0;
+	pipeline->m_workers = NULL;
+	pipeline->m_numWorkers = 0;
+	pipeline->m_numCaptured = 0;
+	pipeline->m_numDispatched = 0;
+	pipeline->m_numWritten = 0;
+	pipeline->m_shutdown = 0;
+	pipeline->m_contentTracker = NULL;
+
+	zstdhl_InitPredefinedFSETables();
+	zstdhl_InitAssemblerState(&pipeline->m_persistentState);
+	zstdhl_ContentTracker_Init(&pipeline->m_contentTrackerStorage, alloc);
+
+	if (encFrame->m_haveContentChecksum)
+	{
+		zstdhl_ContentTracker_Reset(&pipeline->m_contentTrackerStorage, encFrame);
+		pipeline->m_contentTracker = &pipeline->m_contentTrackerStorage;
+	}
+
+	ZSTDHL_CHECKED(zstdhl_Mutex_Init(&pipeline->m_mutex));
+	pipeline->m_haveMutex = 1;
+
+	ZSTDHL_CHECKED(zstdhl_CondVar_Init(&pipeline->m_workAvailableCV));
+	pipeline->m_haveWorkAvailableCV = 1;
+
+	ZSTDHL_CHECKED(zstdhl_CondVar_Init(&pipeline->m_workFinishedCV));
+	pipeline->m_haveWorkFinishedCV = 1;
+
+	pipeline->m_batches = (zstdhl_ParallelAsm_Batch_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_ParallelAsm_Batch_t) * maxBlocksInFlight);
+	if (!pipeline->m_batches)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	pipeline->m_numBatches = maxBlocksInFlight;
+
+	for (i = 0; i < maxBlocksInFlight; i++)
+	{
+		zstdhl_ParallelAsm_Batch_t *batch = pipeline->m_batches + i;
+
+		zstdhl_InitAssemblerState(&batch->m_persistentState);
+
+		zstdhl_Vector_Init(&batch->m_literalsVector, 1, alloc);
+		zstdhl_Vector_Init(&batch->m_sequencesVector, sizeof(zstdhl_SequenceDesc_t), alloc);
+		zstdhl_Vector_Init(&batch->m_offsetsVector, sizeof(uint32_t), alloc);
+		zstdhl_Vector_Init(&batch->m_outputVector, 1, alloc);
+
+		batch->m_nextSequence = 0;
+		batch->m_status = ZSTDHL_PARALLELASM_BATCH_STATUS_FREE;
+		batch->m_resultCode = ZSTDHL_RESULT_OK;
+	}
+
+	pipeline->m_workers = (zstdhl_ParallelAsm_Worker_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_ParallelAsm_Worker_t) * numWorkers);
+	if (!pipeline->m_workers)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	pipeline->m_numWorkers = numWorkers;
+
+	for (i = 0; i < numWorkers; i++)
+	{
+		zstdhl_ParallelAsm_Worker_t *worker = pipeline->m_workers + i;
+
+		worker->m_pipeline = pipeline;
+		worker->m_asmContext = NULL;
+		worker->m_threadStarted = 0;
+	}
+
+	for (i = 0; i < numWorkers; i++)
+	{
+		ZSTDHL_CHECKED(zstdhl_CreateAssemblerContext(alloc, &pipeline->m_workers[i].m_asmContext));
+	}
+
+	for (i = 0; i < numWorkerThreads; i++)
+	{
+		zstdhl_ParallelAsm_Worker_t *worker = pipeline->m_workers + i;
+
+		ZSTDHL_CHECKED(zstdhl_Thread_Create(&worker->m_thread, zstdhl_ParallelAsm_WorkerThreadFunc, worker));
+		worker->m_threadStarted = 1;
+	}
 
 	return ZSTDHL_RESULT_OK;
 }
 
-zstdhl_ResultCode_t zstdhl_AssembleBlock(zstdhl_AssemblerPersistentState_t *persistentState, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_EncoderOutputObject_t *assemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc)
+static zstdhl_ResultCode_t zstdhl_ParallelAsm_Pipeline_Run(zstdhl_ParallelAsm_Pipeline_t *pipeline, const zstdhl_EncBlockSourceObject_t *blockSource, const zstdhl_EncoderOutputObject_t *assemblyOutput, uint8_t isThreaded)
 {
 	zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
-	zstdhl_AsmState_t asmState;
+	uint8_t eof = 0;
 
-	zstdhl_AsmState_Init(&asmState, persistentState, alloc);
+	zstdhl_Mutex_Lock(&pipeline->m_mutex);
 
-	resultCode = zstdhl_AssembleAndWriteBlock(&asmState, encBlock, assemblyOutput);
+	for (;;)
+	{
+		zstdhl_ParallelAsm_Batch_t *batch = NULL;
 
-	zstdhl_AsmState_Destroy(&asmState);
+		// Write out assembled blocks in order
+		while (pipeline->m_numWritten < pipeline->m_numCaptured)
+		{
+			batch = pipeline->m_batches + (pipeline->m_numWritten % pipeline->m_numBatches);
+			if (batch->m_status != ZSTDHL_PARALLELASM_BATCH_STATUS_ASSEMBLED)
+				break;
+
+			zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+			resultCode = batch->m_resultCode;
+			if (resultCode == ZSTDHL_RESULT_OK)
+				resultCode = assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, batch->m_outputVector.m_data, batch->m_outputVector.m_count);
+
+			zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+			batch->m_status = ZSTDHL_PARALLELASM_BATCH_STATUS_FREE;
+			pipeline->m_numWritten++;
+
+			if (resultCode != ZSTDHL_RESULT_OK)
+				break;
+		}
+
+		if (resultCode != ZSTDHL_RESULT_OK || (eof && pipeline->m_numWritten == pipeline->m_numCaptured))
+			break;
+
+		// Capture the next block if there is a free batch
+		if (!eof && pipeline->m_numCaptured - pipeline->m_numWritten < pipeline->m_numBatches)
+		{
+			zstdhl_EncBlockDesc_t encBlock;
+
+			batch = pipeline->m_batches + (pipeline->m_numCaptured % pipeline->m_numBatches);
+
+			zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+			resultCode = blockSource->m_getNextBlockFunc(blockSource->m_userdata, &eof, &encBlock);
+
+			if (resultCode == ZSTDHL_RESULT_OK && !eof)
+			{
+				resultCode = zstdhl_ParallelAsm_CaptureBlock(pipeline, batch, &encBlock);
+
+				if (resultCode == ZSTDHL_RESULT_OK)
+				{
+					batch->m_status = ZSTDHL_PARALLELASM_BATCH_STATUS_CAPTURED;
+
+					if (!isThreaded)
+					{
+						batch->m_resultCode = zstdhl_ParallelAsm_AssembleBatch(pipeline->m_workers, batch);
+						batch->m_status = ZSTDHL_PARALLELASM_BATCH_STATUS_ASSEMBLED;
+						pipeline->m_numDispatched++;
+					}
+				}
+			}
+
+			zstdhl_Mutex_Lock(&pipeline->m_mutex);
+
+			if (resultCode != ZSTDHL_RESULT_OK)
+				break;
+
+			if (!eof)
+			{
+				pipeline->m_numCaptured++;
+				zstdhl_CondVar_Signal(&pipeline->m_workAvailableCV);
+			}
+
+			continue;
+		}
+
+		zstdhl_CondVar_Wait(&pipeline->m_workFinishedCV, &pipeline->m_mutex);
+	}
+
+	zstdhl_Mutex_Unlock(&pipeline->m_mutex);
+
+	return resultCode;
+}
+
+zstdhl_ResultCode_t zstdhl_AssembleFrameParallel(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncBlockSourceObject_t *blockSource, const zstdhl_EncoderOutputObject_t *assemblyOutput, size_t numWorkerThreads, size_t maxBlocksInFlight)
+{
+	zstdhl_ParallelAsm_Pipeline_t *pipeline = NULL;
+	zstdhl_ResultCode_t resultCode = ZSTDHL_RESULT_OK;
+
+	ZSTDHL_CHECKED(zstdhl_AssembleFrame(encFrame, assemblyOutput, 0));
+
+	// The pipeline holds a full persistent state, so it is too large for the stack
+	pipeline = (zstdhl_ParallelAsm_Pipeline_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_ParallelAsm_Pipeline_t));
+	if (!pipeline)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	resultCode = zstdhl_ParallelAsm_Pipeline_Init(pipeline, alloc, encFrame, numWorkerThreads, maxBlocksInFlight);
+
+	if (resultCode == ZSTDHL_RESULT_OK)
+		resultCode = zstdhl_ParallelAsm_Pipeline_Run(pipeline, blockSource, assemblyOutput, numWorkerThreads > 0);
+
+	if (resultCode == ZSTDHL_RESULT_OK && pipeline->m_contentTracker)
+	{
+		uint8_t checksumBytes[4];
+
+		zstdhl_EncodeContentChecksum(pipeline->m_contentTracker, checksumBytes);
+		resultCode = assemblyOutput->m_writeBitstreamFunc(assemblyOutput->m_userdata, checksumBytes, 4);
+	}
+
+	zstdhl_ParallelAsm_Pipeline_Destroy(pipeline);
+	alloc->m_reallocFunc(alloc->m_userdata, pipeline, 0);
 
 	return resultCode;
 }
@@ -27,6 +27,9 @@ enum zstdhl_Constants
 	ZSTDHL_MAX_LIT_LENGTH_CODE = 35,
 	ZSTDHL_MAX_HUFFMAN_WEIGHT = 11,
 	ZSTDHL_MAX_HUFFMAN_CODE_LENGTH = 11,
+
+	ZSTDHL_MAX_BLOCK_SIZE = 131072,
+	ZSTDHL_MAX_FRAME_HEADER_SIZE = 18,
 };
 
 typedef enum zstdhl_BlockType
@@ -118,6 +121,9 @@ typedef enum zstdhl_ResultCode
 	ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED,
 	ZSTDHL_RESULT_FSE_TABLE_INVALID,
 	ZSTDHL_RESULT_FSE_TABLE_MISSING_SYMBOL,
+	ZSTDHL_RESULT_SEQUENCE_LIT_LENGTH_EXCEEDS_LITERALS,
+	ZSTDHL_RESULT_CONTENT_CHECKSUM_TRUNCATED,
+	ZSTDHL_RESULT_CONTENT_CHECKSUM_MISMATCH,
 
 	// Assembly errors
 	ZSTDHL_RESULT_LITERALS_SECTION_REGENERATED_SIZE_INVALID,
@@ -141,12 +147,15 @@ typedef enum zstdhl_ResultCode
 	ZSTDHL_RESULT_OUT_OF_MEMORY,
 	ZSTDHL_RESULT_INTEGER_OVERFLOW,
 	ZSTDHL_RESULT_OFFSET_TOO_LARGE,
+	ZSTDHL_RESULT_WINDOW_TOO_LARGE,
+	ZSTDHL_RESULT_TOO_MANY_SEQUENCES,
 
 	ZSTDHL_RESULT_NOT_ENOUGH_BITS,
 
 	ZSTDHL_RESULT_FAIL,
 
 	ZSTDHL_RESULT_OUTPUT_FAILED,
+	ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL,
 	ZSTDHL_RESULT_INPUT_FAILED,
 	ZSTDHL_RESULT_INVALID_VALUE,
 
@@ -213,9 +222,17 @@ typedef struct zstdhl_FSETable
 	uint8_t m_accuracyLog;
 } zstdhl_FSETable_t;
 
+typedef struct zstdhl_FSESymbolEncTransform
+{
+	uint32_t m_deltaNumBits;	// Number of bits to write is (state + tableSize + m_deltaNumBits) >> 16
+	int32_t m_deltaFindState;	// Offset of the symbol's states in the state table, minus its cell count
+	uint32_t m_numCells;
+} zstdhl_FSESymbolEncTransform_t;
+
 typedef struct zstdhl_FSETableEnc
 {
-	uint16_t *m_nextStates;	// [(nextSymbol << accuracyLog) + prevState]
+	zstdhl_FSESymbolEncTransform_t *m_symbolTransforms;	// [symbol]
+	uint16_t *m_stateTable;		// [1 << accuracyLog], cells of each symbol in order, grouped by symbol
 } zstdhl_FSETableEnc_t;
 
 typedef struct zstdhl_FSESymbolTemp
@@ -407,6 +424,8 @@ typedef enum zstdhl_ElementType
 	ZSTDHL_ELEMENT_TYPE_DICT_START,					// zstdhl_DictHeaderDesc_t
 	ZSTDHL_ELEMENT_TYPE_DICT_RECENT_OFFSETS,		// zstdhl_DictRecentOffsets_t
 	ZSTDHL_ELEMENT_TYPE_DICT_END,					// Nothing
+
+	ZSTDHL_ELEMENT_TYPE_CONTENT_CHECKSUM,			// uint32_t, reported before ZSTDHL_ELEMENT_TYPE_FRAME_END
 } zstdhl_ElementType_t;
 
 typedef struct zstdhl_DisassemblyOutputObject
@@ -421,6 +440,74 @@ typedef struct zstdhl_MemoryAllocatorObject
 	void *m_userdata;
 } zstdhl_MemoryAllocatorObject_t;
 
+// Limits for disassembling untrusted input.  Fields set to 0 are unlimited.
+// When limits are used, blocks are always limited to the smaller of the window size and ZSTDHL_MAX_BLOCK_SIZE.
+typedef struct zstdhl_DecodeLimits
+{
+	uint64_t m_maxWindowSize;
+	uint32_t m_maxOffsetBits;			// Limits offset codes, which size the offset table and bignum buffers
+	uint32_t m_maxSequencesPerBlock;
+	size_t m_maxMemory;					// Maximum bytes allocated at once
+} zstdhl_DecodeLimits_t;
+
+typedef enum zstdhl_DisassembleFlags
+{
+	ZSTDHL_DISASSEMBLE_FLAG_VERIFY_CHECKSUM = 1,	// Reconstructs frame content to verify content checksums
+} zstdhl_DisassembleFlags_t;
+
+typedef enum zstdhl_InstrumentationPhase
+{
+	ZSTDHL_PHASE_FRAME_HEADER_PARSE,
+	ZSTDHL_PHASE_FSE_TABLE_DECODE,			// Symbols: Number of probabilities
+	ZSTDHL_PHASE_HUFFMAN_TABLE_GENERATE,	// Symbols: Number of specified weights
+	ZSTDHL_PHASE_HUFFMAN_STREAM_DECODE,		// Bytes: Compressed size, Symbols: Regenerated size
+	ZSTDHL_PHASE_SEQUENCE_DECODE,			// Bytes: Bitstream size, Symbols: Number of sequences
+
+	ZSTDHL_PHASE_ASSEMBLE_LITERALS_SECTION,	// Symbols: Number of literals
+	ZSTDHL_PHASE_ASSEMBLE_HUFFMAN_TREE,		// Symbols: Number of specified weights
+	ZSTDHL_PHASE_ASSEMBLE_HUFFMAN_STREAMS,	// Symbols: Number of literals
+	ZSTDHL_PHASE_ASSEMBLE_SEQUENCES_SECTION,	// Symbols: Number of sequences
+
+	ZSTDHL_PHASE_GSTD_QUEUE_SEQUENCES,		// Symbols: Number of sequences
+	ZSTDHL_PHASE_GSTD_RESOLVE_STATES,		// Symbols: Number of sequences
+	ZSTDHL_PHASE_GSTD_LITERALS_SECTION,		// Symbols: Number of literals
+	ZSTDHL_PHASE_GSTD_SEQUENCES_SECTION,	// Symbols: Number of sequences
+	ZSTDHL_PHASE_GSTD_FINISH,				// Bytes: Output size
+
+	ZSTDHL_PHASE_COUNT,
+} zstdhl_InstrumentationPhase_t;
+
+// Phase reports are only generated if the library is compiled with ZSTDHL_ENABLE_INSTRUMENTATION.
+// Ticks are CPU cycles where a cycle counter is available, otherwise nanoseconds.
+// Reports are made on the thread making the instrumented call.
+typedef struct zstdhl_InstrumentationObject
+{
+	void (*m_reportPhaseFunc)(void *userdata, zstdhl_InstrumentationPhase_t phase, uint64_t ticks, uint64_t numBytes, uint64_t numSymbols);
+	void *m_userdata;
+} zstdhl_InstrumentationObject_t;
+
+typedef enum zstdhl_AllocSite
+{
+	ZSTDHL_ALLOC_SITE_OTHER,		// Decoder, encoder, and pipeline states
+	ZSTDHL_ALLOC_SITE_VECTOR,		// zstdhl_Vector_t growth
+	ZSTDHL_ALLOC_SITE_BUFFERS,		// Disassembler per-block buffers
+	ZSTDHL_ALLOC_SITE_GSTD_LANES,	// gstd encoder lane states
+
+	ZSTDHL_ALLOC_SITE_COUNT,
+} zstdhl_AllocSite_t;
+
+typedef struct zstdhl_AllocStats
+{
+	uint64_t m_numAllocs;
+	uint64_t m_numReallocs;
+	uint64_t m_numFrees;
+	uint64_t m_allocatedBytes;
+	uint64_t m_currentBytes;
+	uint64_t m_peakBytes;
+} zstdhl_AllocStats_t;
+
+typedef struct zstdhl_AllocTracker zstdhl_AllocTracker_t;
+
 typedef struct zstdhl_Vector
 {
 	zstdhl_MemoryAllocatorObject_t m_alloc;
@@ -431,6 +518,7 @@ typedef struct zstdhl_Vector
 	size_t m_elementSize;
 	size_t m_maxCapacity;
 	size_t m_capacityBytes;
+	zstdhl_AllocSite_t m_allocSite;
 } zstdhl_Vector_t;
 
 typedef struct zstdhl_FSEEncStack
@@ -438,6 +526,15 @@ typedef struct zstdhl_FSEEncStack
 	zstdhl_Vector_t m_statesStackVector;
 } zstdhl_FSEEncStack_t;
 
+typedef struct zstdhl_XXH64State
+{
+	uint64_t m_lanes[4];
+	uint64_t m_seed;
+	uint64_t m_totalSize;
+	uint8_t m_buffer[32];
+	uint8_t m_bufferedSize;
+} zstdhl_XXH64State_t;
+
 typedef struct zstdhl_MemBufferStreamSource
 {
 	const void *m_data;
@@ -476,6 +573,15 @@ typedef struct zstdhl_EncBlockDesc
 	uint8_t m_autoLitRegeneratedSizeFlag;
 	uint8_t m_autoHuffmanStreamSizesFlags[4];
 
+	// If set, the literals section type, Huffman stream mode, and Huffman tree are selected by the assembler
+	// and m_litSectionHeader, m_huffmanStreamMode, and m_huffmanTreeDesc are ignored.  m_numValues must be
+	// the full number of literals, even if they are all the same value.
+	uint8_t m_autoLitSectionModeFlag;
+
+	// If set, the compression modes and tables for the sequences section are selected by the assembler from the
+	// sequence codes, and the modes in m_seqSectionDesc and the sequence compression descs are ignored.
+	uint8_t m_autoSeqCompressionModeFlag;
+
 	const void *m_uncompressedOrRLEData;
 } zstdhl_EncBlockDesc_t;
 
@@ -515,19 +621,130 @@ typedef struct zstdhl_SubstreamCompressionStructureDef
 	const uint32_t *m_defaultProbs;
 } zstdhl_SubstreamCompressionStructureDef_t;
 
+typedef struct zstdhl_EncBlockSourceObject
+{
+	// Sets outEOFFlag and returns without a block once all blocks have been produced
+	zstdhl_ResultCode_t (*m_getNextBlockFunc)(void *userdata, uint8_t *outEOFFlag, zstdhl_EncBlockDesc_t *outBlock);
+	void *m_userdata;
+} zstdhl_EncBlockSourceObject_t;
+
+typedef struct zstdhl_AssemblerContext zstdhl_AssemblerContext_t;
 typedef struct zstdhl_DeflateConv_State zstdhl_DeflateConv_State_t;
 
+typedef struct zstdhl_DeflateConv_ReparseOptions
+{
+	uint32_t m_windowSize;			// Power of 2, at least 32KB and no larger than the frame window size
+	uint8_t m_hashLog;				// 8 to 24
+	uint32_t m_maxChainLength;
+} zstdhl_DeflateConv_ReparseOptions_t;
+
+typedef struct zstdhl_Synth_State zstdhl_Synth_State_t;
+
+typedef enum zstdhl_Synth_LiteralsMode
+{
+	ZSTDHL_SYNTH_LITERALS_MODE_AUTO,
+	ZSTDHL_SYNTH_LITERALS_MODE_RAW,
+	ZSTDHL_SYNTH_LITERALS_MODE_RLE,
+	ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_1_STREAM,
+	ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_4_STREAMS,
+} zstdhl_Synth_LiteralsMode_t;
+
+typedef enum zstdhl_Synth_SeqMode
+{
+	ZSTDHL_SYNTH_SEQ_MODE_AUTO,
+	ZSTDHL_SYNTH_SEQ_MODE_PREDEFINED,
+	ZSTDHL_SYNTH_SEQ_MODE_RLE,
+	ZSTDHL_SYNTH_SEQ_MODE_FSE,
+	ZSTDHL_SYNTH_SEQ_MODE_REUSE,
+} zstdhl_Synth_SeqMode_t;
+
+typedef struct zstdhl_Synth_Params
+{
+	uint64_t m_seed;
+	uint64_t m_contentSize;
+	uint32_t m_blockSize;				// Maximum decompressed size of each block, 1 to ZSTDHL_MAX_BLOCK_SIZE
+	uint16_t m_literalAlphabetSize;		// Literals are uniform over this many byte values, 1 to 256
+	uint32_t m_sequencesPerBlock;
+	uint32_t m_maxLitLength;
+	uint32_t m_minMatchLength;			// At least 3
+	uint32_t m_maxMatchLength;
+	uint32_t m_maxOffset;				// Offsets are log-uniform up to this value, at most 1 << 28
+	uint8_t m_repeatOffsetPercent;
+	zstdhl_Synth_LiteralsMode_t m_literalsMode;
+	zstdhl_Synth_SeqMode_t m_seqMode;
+} zstdhl_Synth_Params_t;
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+// Tracking allocator.  Wraps another allocator and counts allocations overall and by call site.  The tracker
+// may be shared between threads.  Memory allocated through the tracker must be freed before it is destroyed.
+zstdhl_ResultCode_t zstdhl_AllocTracker_Create(const zstdhl_MemoryAllocatorObject_t *baseAlloc, zstdhl_AllocTracker_t **outTracker);
+void zstdhl_AllocTracker_GetAllocator(zstdhl_AllocTracker_t *tracker, zstdhl_MemoryAllocatorObject_t *outAlloc);
+
+// Allocations that would raise the current byte count above maxBytes fail.  0 removes the limit.
+void zstdhl_AllocTracker_SetLimit(zstdhl_AllocTracker_t *tracker, size_t maxBytes);
+
+// outSiteStats must have room for ZSTDHL_ALLOC_SITE_COUNT entries.  Either output may be NULL.
+void zstdhl_AllocTracker_GetStats(zstdhl_AllocTracker_t *tracker, zstdhl_AllocStats_t *outTotalStats, zstdhl_AllocStats_t *outSiteStats);
+void zstdhl_AllocTracker_Destroy(zstdhl_AllocTracker_t *tracker);
+
 zstdhl_ResultCode_t zstdhl_DisassembleDict(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc);
+
+// Content checksums are reported but not verified, so corrupted frames can still be disassembled.
 zstdhl_ResultCode_t zstdhl_Disassemble(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DictDesc_t *dictDesc, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc);
+
+// Same as zstdhl_Disassemble, but rejects frames that exceed the limits as soon as the exceeding value is parsed.
+// Exceeding the memory limit fails with ZSTDHL_RESULT_OUT_OF_MEMORY.
+zstdhl_ResultCode_t zstdhl_DisassembleWithLimits(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DictDesc_t *dictDesc, const zstdhl_DecodeLimits_t *limits, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc);
+
+// Same as zstdhl_DisassembleWithLimits with zstdhl_DisassembleFlags_t flags.  limits and instrumentation may be NULL.  With
+// ZSTDHL_DISASSEMBLE_FLAG_VERIFY_CHECKSUM, a mismatched checksum fails with ZSTDHL_RESULT_CONTENT_CHECKSUM_MISMATCH after
+// it is reported.  Checksums aren't verified if a dictionary is used, since dictionary content is not available.
+// If contentOutput isn't NULL, the regenerated content of each block is written to it before the block's
+// ZSTDHL_ELEMENT_TYPE_BLOCK_END element is reported.  contentOutput can't be used with a dictionary.
+zstdhl_ResultCode_t zstdhl_DisassembleWithOptions(const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_DictDesc_t *dictDesc, const zstdhl_DecodeLimits_t *limits, uint32_t flags, const zstdhl_InstrumentationObject_t *instrumentation, const zstdhl_EncoderOutputObject_t *contentOutput, const zstdhl_DisassemblyOutputObject_t *disassemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc);
+
 zstdhl_ResultCode_t zstdhl_InitAssemblerState(zstdhl_AssemblerPersistentState_t *persistentState);
+
+// Persistent states point into themselves, so they must be copied with this instead of by assignment
+void zstdhl_CopyAssemblerState(zstdhl_AssemblerPersistentState_t *dest, const zstdhl_AssemblerPersistentState_t *src);
 zstdhl_ResultCode_t zstdhl_AssembleFrame(const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncoderOutputObject_t *assemblyOutput, uint64_t optFrameContentSize);
 zstdhl_ResultCode_t zstdhl_AssembleBlock(zstdhl_AssemblerPersistentState_t *persistentState, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_EncoderOutputObject_t *assemblyOutput, const zstdhl_MemoryAllocatorObject_t *alloc);
 
+// Assembler contexts keep working memory and encode tables between blocks.  The context owns its own persistent
+// state, which must be reset with zstdhl_ResetAssemblerContext at the start of each frame.
+zstdhl_ResultCode_t zstdhl_CreateAssemblerContext(const zstdhl_MemoryAllocatorObject_t *alloc, zstdhl_AssemblerContext_t **outContext);
+void zstdhl_ResetAssemblerContext(zstdhl_AssemblerContext_t *context);
+void zstdhl_DestroyAssemblerContext(zstdhl_AssemblerContext_t *context);
+
+// Reports phases of blocks assembled with the context to instrumentation, or stops reporting if it is NULL.
+// The instrumentation object must remain valid while it is set.
+void zstdhl_SetAssemblerContextInstrumentation(zstdhl_AssemblerContext_t *context, const zstdhl_InstrumentationObject_t *instrumentation);
+zstdhl_ResultCode_t zstdhl_AssembleBlockWithContext(zstdhl_AssemblerContext_t *context, const zstdhl_EncBlockDesc_t *encBlock, const zstdhl_EncoderOutputObject_t *assemblyOutput);
+
+// Writes a frame header and resets the context for the frame.  If the frame has a content checksum, the content of each
+// block assembled with the context is hashed, and zstdhl_AssembleFrameEndWithContext writes the checksum.
+zstdhl_ResultCode_t zstdhl_AssembleFrameWithContext(zstdhl_AssemblerContext_t *context, const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncoderOutputObject_t *assemblyOutput);
+zstdhl_ResultCode_t zstdhl_AssembleFrameEndWithContext(zstdhl_AssemblerContext_t *context, const zstdhl_EncoderOutputObject_t *assemblyOutput);
+
+// Returns the largest possible size of a frame assembled by zstdhl_AssembleFrameToBuffer whose blocks decode to
+// contentSize bytes in total.  numBlocks is the number of blocks in the frame, or an upper bound on it.  Frames
+// of full-size blocks have (contentSize + ZSTDHL_MAX_BLOCK_SIZE - 1) / ZSTDHL_MAX_BLOCK_SIZE blocks.
+size_t zstdhl_FrameBound(uint64_t contentSize, uint64_t numBlocks);
+
+// Assembles a frame header and all blocks from blockSource directly into outBuffer, without using output callbacks.
+// The context is reset first.  Fails with ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL if the frame does not fit.
+zstdhl_ResultCode_t zstdhl_AssembleFrameToBuffer(zstdhl_AssemblerContext_t *context, const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncBlockSourceObject_t *blockSource, void *outBuffer, size_t outCapacity, size_t *outSize);
+
+// Assembles a frame header and all blocks from blockSource, assembling up to maxBlocksInFlight blocks at once on
+// numWorkerThreads worker threads.  Blocks are written in order.  If numWorkerThreads is 0, blocks are assembled on
+// the calling thread.  Blocks must use explicit literals section and sequence compression modes, automatic mode
+// selection flags are rejected with ZSTDHL_RESULT_INVALID_VALUE.
+zstdhl_ResultCode_t zstdhl_AssembleFrameParallel(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_FrameHeaderDesc_t *encFrame, const zstdhl_EncBlockSourceObject_t *blockSource, const zstdhl_EncoderOutputObject_t *assemblyOutput, size_t numWorkerThreads, size_t maxBlocksInFlight);
+
 uint32_t zstdhl_GetLessThanOneConstant(void);
 zstdhl_ResultCode_t zstdhl_BuildFSEDistributionTable_ZStd(zstdhl_FSETable_t *fseTable, const zstdhl_FSETableDef_t *fseTableDef, zstdhl_FSESymbolTemp_t *symbolTemps);
 void zstdhl_BuildFSEEncodeTable(zstdhl_FSETableEnc_t *encTable, const zstdhl_FSETable_t *table, size_t numSymbols);
@@ -548,11 +765,27 @@ zstdhl_ResultCode_t zstdhl_ResolveOffsetCode32(zstdhl_OffsetType_t offsetType, u
 
 zstdhl_ResultCode_t zstdhl_GenerateHuffmanDecodeTable(const zstdhl_HuffmanTreePartialWeightDesc_t *partialWeightDesc, zstdhl_HuffmanTableDec_t *decTable);
 zstdhl_ResultCode_t zstdhl_GenerateHuffmanEncodeTable(const zstdhl_HuffmanTreePartialWeightDesc_t *partialWeightDesc, zstdhl_HuffmanTableEnc_t *encTable);
+// Returns the output buffer size required to encode a Huffman stream of numLiterals literals with zstdhl_EncodeHuffmanStreams
+size_t zstdhl_HuffmanStreamBound(size_t numLiterals);
+
+// Encodes 1 or 4 Huffman streams from a contiguous literals span, with stream sizes given by streamSizes.  Each of
+// outStreams must have zstdhl_HuffmanStreamBound bytes available for its stream.  Encoded sizes are written to outStreamSizes.
+zstdhl_ResultCode_t zstdhl_EncodeHuffmanStreams(const zstdhl_HuffmanTableEnc_t *encTable, const uint8_t *literals, const size_t *streamSizes, uint8_t numStreams, uint8_t *const *outStreams, size_t *outStreamSizes);
+
 zstdhl_ResultCode_t zstdhl_ExpandHuffmanWeightTable(const zstdhl_HuffmanTreePartialWeightDesc_t *partialDesc, zstdhl_HuffmanTreeWeightDesc_t *fullDesc);
 
+// Computes optimal code lengths no longer than maxCodeLength for up to 256 symbols.  Symbols with a count of 0 get a length of 0.
+zstdhl_ResultCode_t zstdhl_ComputeHuffmanCodeLengths(const size_t *symbolCounts, size_t numSymbols, uint8_t maxCodeLength, uint8_t *outCodeLengths);
+
+void zstdhl_XXH64_Init(zstdhl_XXH64State_t *state, uint64_t seed);
+void zstdhl_XXH64_Update(zstdhl_XXH64State_t *state, const void *data, size_t size);
+uint64_t zstdhl_XXH64_Digest(const zstdhl_XXH64State_t *state);
+
 zstdhl_ResultCode_t zstdhl_ReadChecked(const zstdhl_StreamSourceObject_t *streamSource, void *dest, size_t numBytes, zstdhl_ResultCode_t failureResult);
 
 void zstdhl_Vector_Init(zstdhl_Vector_t *vec, size_t elementSize, const zstdhl_MemoryAllocatorObject_t *alloc);
+// Initializes a vector over a caller-owned buffer.  Appending past the capacity fails with ZSTDHL_RESULT_OUTPUT_BUFFER_TOO_SMALL.
+void zstdhl_Vector_InitFixed(zstdhl_Vector_t *vec, size_t elementSize, void *buffer, size_t capacity);
 zstdhl_ResultCode_t zstdhl_Vector_Append(zstdhl_Vector_t *vec, const void *data, size_t count);
 void zstdhl_Vector_Clear(zstdhl_Vector_t *vec);
 void zstdhl_Vector_Shrink(zstdhl_Vector_t *vec, size_t newCount);
@@ -563,10 +796,51 @@ void zstdhl_MemBufferStreamSource_Init(zstdhl_MemBufferStreamSource_t *streamSou
 size_t zstdhl_MemBufferStreamSource_ReadBytes(void *userdata, void *dest, size_t numBytes);
 
 zstdhl_ResultCode_t zstdhl_DeflateConv_CreateState(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_StreamSourceObject_t *streamSource, zstdhl_DeflateConv_State_t **outState);
+// Resets a converter state to convert a new deflate stream, keeping allocated memory and re-parse settings
+void zstdhl_DeflateConv_ResetState(zstdhl_DeflateConv_State_t *state, const zstdhl_StreamSourceObject_t *streamSource);
 void zstdhl_DeflateConv_DestroyState(zstdhl_DeflateConv_State_t *state);
+// Converts the next zstd block.  Deflate blocks larger than the maximum block size of a 32KB window, or of the
+// re-parse window if re-parsing is enabled, are split across multiple zstd blocks.
 zstdhl_ResultCode_t zstdhl_DeflateConv_Convert(zstdhl_DeflateConv_State_t *state, uint8_t *outEOFFlag, zstdhl_EncBlockDesc_t *outTempBlockDesc);
 
+// Enables re-parsing of decoded deflate blocks, including stored blocks, using a hash chain over the zstd window,
+// so matches can use longer distances and repeat offsets.  A block keeps its original parse if the re-parse isn't
+// estimated to be smaller.  Must be called before the first block is converted.
+zstdhl_ResultCode_t zstdhl_DeflateConv_EnableReparse(zstdhl_DeflateConv_State_t *state, const zstdhl_DeflateConv_ReparseOptions_t *options);
+
+// Converts an entire deflate stream and writes the zstd blocks to assemblyOutput.  Deflate is parsed on the
+// calling thread while table selection and block assembly run on numWorkerThreads worker threads, or on the
+// calling thread if numWorkerThreads is 0.  Blocks are converted independently, so Huffman and FSE tables are
+// never reused across blocks.  If numWorkerThreads is nonzero, the allocator must be thread-safe.
+// reparseOptions may be NULL to disable re-parsing.
+zstdhl_ResultCode_t zstdhl_DeflateConv_ConvertParallel(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_StreamSourceObject_t *streamSource, const zstdhl_EncoderOutputObject_t *assemblyOutput, size_t numWorkerThreads, size_t maxBlocksInFlight, const zstdhl_DeflateConv_ReparseOptions_t *reparseOptions);
+
+// Synthetic frame generator.  Produces blocks with randomized sequences and literals from a seeded generator,
+// using explicit literals and sequence modes so that specific decode paths can be exercised.  Generated blocks
+// only refer to data within the frame, so the frames decode with any conforming decoder.  Huffman modes fall
+// back to RLE or raw literals for blocks with fewer than 2 distinct literals, and 4-stream mode falls back to
+// 1 stream for small literal sections.  FSE and reuse modes use RLE for code streams with only 1 distinct code.
+// RLE sequence mode disables repeat offsets.
+void zstdhl_Synth_InitDefaultParams(zstdhl_Synth_Params_t *params);
+zstdhl_ResultCode_t zstdhl_Synth_CreateState(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_Synth_Params_t *params, zstdhl_Synth_State_t **outState);
+void zstdhl_Synth_GetFrameHeader(const zstdhl_Synth_State_t *state, zstdhl_FrameHeaderDesc_t *outFrameHeader);
+zstdhl_ResultCode_t zstdhl_Synth_GenerateBlock(zstdhl_Synth_State_t *state, uint8_t *outEOFFlag, zstdhl_EncBlockDesc_t *outTempBlockDesc);
+void zstdhl_Synth_DestroyState(zstdhl_Synth_State_t *state);
+
+// Generates a complete frame with zstdhl_AssembleBlock
+zstdhl_ResultCode_t zstdhl_Synth_GenerateFrame(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_Synth_Params_t *params, const zstdhl_EncoderOutputObject_t *assemblyOutput);
+
 zstdhl_ResultCode_t zstdhl_CreateHuffmanDescFromSymbolCounts(const size_t *symbolCounts, size_t numSymbolCounts, zstdhl_HuffmanTreeDesc_t *outTreeDesc);
+
+// Estimates the size in bits of literals with the given symbol counts when encoded with a Huffman tree, including the
+// tree description if encodeTree is set.  outIsValid is set to 0 if a used symbol is missing from the tree.
+zstdhl_ResultCode_t zstdhl_ScoreHuffmanTree(const zstdhl_HuffmanTreeDesc_t *tree, const size_t *stats, size_t numStats, uint8_t encodeTree, uint64_t *outScore, uint8_t *outIsValid);
+
+// Selects the cheapest compression mode for a sequence code stream with the given symbol counts.  table is the previous
+// table, which may be reused unless isFirstCompressedBlock is set, and receives the selected table, with probabilities
+// stored in probsVector.  tempVectorU32 is used as scratch space.
+zstdhl_ResultCode_t zstdhl_SelectOptimalFSETable(const size_t *stats, size_t numStats, zstdhl_Vector_t *probsVector, zstdhl_Vector_t *tempVectorU32, zstdhl_FSETableDef_t *table, zstdhl_SequencesCompressionMode_t *outMode, const zstdhl_SubstreamCompressionStructureDef_t *sdef, uint8_t isFirstCompressedBlock);
+
 zstdhl_ResultCode_t zstdhl_CreateFSEDefFromSymbolCounts(const size_t *symbolCounts, size_t numSymbolCounts, zstdhl_Vector_t *probsVector, uint8_t maxAccuracyLog, zstdhl_FSETableDef_t *outTableDef);
 
 #ifdef __cplusplus
@@ -0,0 +1,227 @@
+/*
+Copyright (c) 2023 Eric Lasota
+
+This software is available under the terms of the MIT license
+or the Apache License, Version 2.0.  For more information, see
+the included LICENSE.txt file.
+*/
+#include "zstdhl.h"
+#include "zstdhl_util.h"
+#include "zstdhl_internal.h"
+#include "zstdhl_thread.h"
+
+typedef union zstdhl_AllocTrackerHeader
+{
+	struct
+	{
+		size_t m_size;
+		zstdhl_AllocSite_t m_site;
+	} m_info;
+
+	// Keeps the returned pointer aligned like the base allocation
+	union
+	{
+		long double m_ld;
+		void *m_ptr;
+		uint64_t m_u64;
+	} m_align;
+} zstdhl_AllocTrackerHeader_t;
+
+struct zstdhl_AllocTracker
+{
+	zstdhl_MemoryAllocatorObject_t m_baseAlloc;
+	zstdhl_Mutex_t m_mutex;
+	size_t m_maxBytes;
+	size_t m_reservedBytes;
+
+	zstdhl_AllocStats_t m_totalStats;
+	zstdhl_AllocStats_t m_siteStats[ZSTDHL_ALLOC_SITE_COUNT];
+};
+
+static void zstdhl_AllocStats_Init(zstdhl_AllocStats_t *stats)
+{
+	stats->m_numAllocs = 0;
+	stats->m_numReallocs = 0;
+	stats->m_numFrees = 0;
+	stats->m_allocatedBytes = 0;
+	stats->m_currentBytes = 0;
+	stats->m_peakBytes = 0;
+}
+
+static void zstdhl_AllocStats_Update(zstdhl_AllocStats_t *stats, size_t oldSize, size_t newSize)
+{
+	if (oldSize == 0)
+		stats->m_numAllocs++;
+	else if (newSize == 0)
+		stats->m_numFrees++;
+	else
+		stats->m_numReallocs++;
+
+	if (newSize > oldSize)
+		stats->m_allocatedBytes += newSize - oldSize;
+
+	stats->m_currentBytes = stats->m_currentBytes - oldSize + newSize;
+
+	if (stats->m_currentBytes > stats->m_peakBytes)
+		stats->m_peakBytes = stats->m_currentBytes;
+}
+
+static void *zstdhl_AllocTracker_Realloc(void *userdata, void *ptr, size_t newSize)
+{
+	return zstdhl_AllocTracker_ReallocAtSite((zstdhl_AllocTracker_t *)userdata, ptr, newSize, ZSTDHL_ALLOC_SITE_OTHER);
+}
+
+void *zstdhl_AllocTracker_ReallocAtSite(zstdhl_AllocTracker_t *tracker, void *ptr, size_t newSize, zstdhl_AllocSite_t site)
+{
+	zstdhl_AllocTrackerHeader_t *header = NULL;
+	zstdhl_AllocTrackerHeader_t *newHeader = NULL;
+	size_t oldSize = 0;
+	size_t growth = 0;
+	size_t usedBytes = 0;
+
+	if (ptr == NULL && newSize == 0)
+		return NULL;
+
+	if (newSize > SIZE_MAX - sizeof(zstdhl_AllocTrackerHeader_t))
+		return NULL;
+
+	if (ptr != NULL)
+	{
+		header = ((zstdhl_AllocTrackerHeader_t *)ptr) - 1;
+		oldSize = header->m_info.m_size;
+		site = header->m_info.m_site;
+	}
+
+	if (newSize > oldSize)
+		growth = newSize - oldSize;
+
+	// Growth is reserved against the limit before the allocation so that concurrent allocations can't exceed it together
+	if (growth > 0)
+	{
+		zstdhl_Mutex_Lock(&tracker->m_mutex);
+
+		if (tracker->m_maxBytes != 0)
+		{
+			usedBytes = tracker->m_totalStats.m_currentBytes + tracker->m_reservedBytes;
+			if (usedBytes >= tracker->m_maxBytes || growth > tracker->m_maxBytes - usedBytes)
+			{
+				zstdhl_Mutex_Unlock(&tracker->m_mutex);
+				return NULL;
+			}
+		}
+
+		tracker->m_reservedBytes += growth;
+		zstdhl_Mutex_Unlock(&tracker->m_mutex);
+	}
+
+	if (newSize == 0)
+	{
+		tracker->m_baseAlloc.m_reallocFunc(tracker->m_baseAlloc.m_userdata, header, 0);
+		newHeader = NULL;
+	}
+	else
+	{
+		newHeader = (zstdhl_AllocTrackerHeader_t *)tracker->m_baseAlloc.m_reallocFunc(tracker->m_baseAlloc.m_userdata, header, newSize + sizeof(zstdhl_AllocTrackerHeader_t));
+		if (newHeader)
+		{
+			newHeader->m_info.m_size = newSize;
+			newHeader->m_info.m_site = site;
+		}
+	}
+
+	zstdhl_Mutex_Lock(&tracker->m_mutex);
+	tracker->m_reservedBytes -= growth;
+
+	if (newSize != 0 && !newHeader)
+	{
+		zstdhl_Mutex_Unlock(&tracker->m_mutex);
+		return NULL;
+	}
+
+	zstdhl_AllocStats_Update(&tracker->m_totalStats, oldSize, newSize);
+	zstdhl_AllocStats_Update(&tracker->m_siteStats[site], oldSize, newSize);
+	zstdhl_Mutex_Unlock(&tracker->m_mutex);
+
+	if (!newHeader)
+		return NULL;
+
+	return newHeader + 1;
+}
+
+void *zstdhl_ReallocAtSite(const zstdhl_MemoryAllocatorObject_t *alloc, void *ptr, size_t newSize, zstdhl_AllocSite_t site)
+{
+	if (alloc->m_reallocFunc == zstdhl_AllocTracker_Realloc)
+		return zstdhl_AllocTracker_ReallocAtSite((zstdhl_AllocTracker_t *)alloc->m_userdata, ptr, newSize, site);
+
+	return alloc->m_reallocFunc(alloc->m_userdata, ptr, newSize);
+}
+
+zstdhl_ResultCode_t zstdhl_AllocTracker_Create(const zstdhl_MemoryAllocatorObject_t *baseAlloc, zstdhl_AllocTracker_t **outTracker)
+{
+	zstdhl_AllocTracker_t *tracker = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	int i = 0;
+
+	tracker = (zstdhl_AllocTracker_t *)baseAlloc->m_reallocFunc(baseAlloc->m_userdata, NULL, sizeof(zstdhl_AllocTracker_t));
+	if (!tracker)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	result = zstdhl_Mutex_Init(&tracker->m_mutex);
+	if (result != ZSTDHL_RESULT_OK)
+	{
+		baseAlloc->m_reallocFunc(baseAlloc->m_userdata, tracker, 0);
+		return result;
+	}
+
+	tracker->m_baseAlloc.m_reallocFunc = baseAlloc->m_reallocFunc;
+	tracker->m_baseAlloc.m_userdata = baseAlloc->m_userdata;
+	tracker->m_maxBytes = 0;
+	tracker->m_reservedBytes = 0;
+
+	zstdhl_AllocStats_Init(&tracker->m_totalStats);
+	for (i = 0; i < ZSTDHL_ALLOC_SITE_COUNT; i++)
+		zstdhl_AllocStats_Init(&tracker->m_siteStats[i]);
+
+	*outTracker = tracker;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_AllocTracker_GetAllocator(zstdhl_AllocTracker_t *tracker, zstdhl_MemoryAllocatorObject_t *outAlloc)
+{
+	outAlloc->m_reallocFunc = zstdhl_AllocTracker_Realloc;
+	outAlloc->m_userdata = tracker;
+}
+
+void zstdhl_AllocTracker_SetLimit(zstdhl_AllocTracker_t *tracker, size_t maxBytes)
+{
+	zstdhl_Mutex_Lock(&tracker->m_mutex);
+	tracker->m_maxBytes = maxBytes;
+	zstdhl_Mutex_Unlock(&tracker->m_mutex);
+}
+
+void zstdhl_AllocTracker_GetStats(zstdhl_AllocTracker_t *tracker, zstdhl_AllocStats_t *outTotalStats, zstdhl_AllocStats_t *outSiteStats)
+{
+	int i = 0;
+
+	zstdhl_Mutex_Lock(&tracker->m_mutex);
+
+	if (outTotalStats)
+		*outTotalStats = tracker->m_totalStats;
+
+	if (outSiteStats)
+	{
+		for (i = 0; i < ZSTDHL_ALLOC_SITE_COUNT; i++)
+			outSiteStats[i] = tracker->m_siteStats[i];
+	}
+
+	zstdhl_Mutex_Unlock(&tracker->m_mutex);
+}
+
+void zstdhl_AllocTracker_Destroy(zstdhl_AllocTracker_t *tracker)
+{
+	zstdhl_MemoryAllocatorObject_t baseAlloc = tracker->m_baseAlloc;
+
+	zstdhl_Mutex_Destroy(&tracker->m_mutex);
+	baseAlloc.m_reallocFunc(baseAlloc.m_userdata, tracker, 0);
+}
@@ -0,0 +1,1325 @@
+/*
+Copyright (c) 2023 Eric Lasota
+
+This software is available under the terms of the MIT license
+or the Apache License, Version 2.0.  For more information, see
+the included LICENSE.txt file.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "zstdhl.h"
+#include "gstdenc.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_CORPUS_SIZE (8 * 1024 * 1024)
+#define BENCH_DEFAULT_MIN_TIME_MS 500
+#define BENCH_MIN_ITERATIONS 3
+#define BENCH_CORPUS_CHUNK_SIZE (32 * 1024)
+#define BENCH_NUM_WORDS 1024
+#define BENCH_MAX_WORD_LENGTH 16
+#define BENCH_WINDOW_SIZE (1024 * 1024)
+#define BENCH_HASH_BITS 17
+#define BENCH_MIN_MATCH 4
+#define BENCH_DEFLATE_WINDOW_SIZE 32768
+#define BENCH_DEFLATE_MAX_MATCH 258
+#define BENCH_DEFLATE_BLOCK_SIZE 65536
+#define BENCH_DEFLATE_REPARSE_MAX_CHAIN_LENGTH 16
+#define BENCH_DEFLATE_RESET_PASSES 4
+#define BENCH_DRAIN_BUFFER_SIZE 4096
+
+#define BENCH_CHECKED(n)	\
+	do\
+	{\
+		zstdhl_ResultCode_t result = (n);\
+		if (result != ZSTDHL_RESULT_OK)\
+			return result;\
+	} while(0)
+
+typedef enum BenchFrameKind
+{
+	BenchFrameKind_Mixed,
+	BenchFrameKind_LiteralsOnly,
+	BenchFrameKind_RawLiterals,
+} BenchFrameKind_t;
+
+typedef enum BenchSynthKind
+{
+	BenchSynthKind_PredefinedRaw,
+	BenchSynthKind_RLE,
+	BenchSynthKind_FSEHuffman1,
+	BenchSynthKind_FSEHuffman4,
+	BenchSynthKind_ReuseHuffman4,
+	BenchSynthKind_RepeatOffsets,
+
+	BenchSynthKind_Count,
+} BenchSynthKind_t;
+
+typedef struct BenchSequence
+{
+	uint32_t m_litLength;
+	uint32_t m_matchLength;
+	uint32_t m_offset;
+} BenchSequence_t;
+
+typedef struct BenchBlockRange
+{
+	size_t m_contentStart;
+	size_t m_contentSize;
+	size_t m_firstSeq;
+	size_t m_numSeqs;
+	size_t m_firstLiteral;
+	size_t m_numLiterals;
+} BenchBlockRange_t;
+
+typedef struct BenchParse
+{
+	BenchSequence_t *m_seqs;
+	size_t m_numSeqs;
+	uint8_t *m_literals;
+	size_t m_numLiterals;
+	BenchBlockRange_t *m_blocks;
+	size_t m_numBlocks;
+} BenchParse_t;
+
+typedef struct BenchCorpus
+{
+	uint8_t *m_data;
+	size_t m_size;
+
+	BenchParse_t m_parse;
+
+	zstdhl_Vector_t m_mixedFrame;
+	zstdhl_Vector_t m_literalsFrame;
+	zstdhl_Vector_t m_rawLiteralsFrame;
+	zstdhl_Vector_t m_synthFrames[BenchSynthKind_Count];
+
+	uint8_t *m_deflateData;
+	size_t m_deflateSize;
+} BenchCorpus_t;
+
+typedef struct BenchSeqCollectionState
+{
+	const BenchSequence_t *m_seqs;
+	size_t m_numRemaining;
+	uint32_t m_offsetDWord;
+} BenchSeqCollectionState_t;
+
+typedef struct BenchDisasmCounter
+{
+	size_t m_numElements;
+	uint64_t m_numLiterals;
+	uint8_t m_drainBuffer[BENCH_DRAIN_BUFFER_SIZE];
+} BenchDisasmCounter_t;
+
+typedef struct BenchDeflateWriter
+{
+	uint8_t *m_data;
+	size_t m_size;
+	size_t m_capacity;
+	uint64_t m_bits;
+	uint8_t m_numBits;
+} BenchDeflateWriter_t;
+
+typedef zstdhl_ResultCode_t (*BenchFunc_t)(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc);
+
+typedef struct BenchDef
+{
+	const char *m_name;
+	BenchFunc_t m_func;
+} BenchDef_t;
+
+typedef struct BenchResult
+{
+	uint64_t m_inputBytes;
+	uint64_t m_contentBytes;
+	size_t m_iterations;
+	double m_totalSeconds;
+	double m_bestSeconds;
+	zstdhl_AllocStats_t m_allocStats;
+} BenchResult_t;
+
+static const uint16_t g_deflateLengthBase[29] =
+{
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t g_deflateLengthExtraBits[29] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t g_deflateDistBase[30] =
+{
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t g_deflateDistExtraBits[30] =
+{
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static void *BenchRealloc(void *userdata, void *ptr, size_t newSize)
+{
+	(void)userdata;
+
+	if (newSize == 0)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	return realloc(ptr, newSize);
+}
+
+static double GetTimeSeconds(void)
+{
+	struct timespec ts;
+
+	timespec_get(&ts, TIME_UTC);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t NextRandom(uint64_t *state)
+{
+	*state = (*state) * 6364136223846793005ull + 1442695040888963407ull;
+	return (uint32_t)((*state) >> 33);
+}
+
+static void GenerateTextChunk(uint8_t *out, size_t size, char (*words)[BENCH_MAX_WORD_LENGTH], uint64_t *rng)
+{
+	size_t pos = 0;
+
+	while (pos < size)
+	{
+		char scratch[BENCH_MAX_WORD_LENGTH + 16];
+		size_t scratchLen = 0;
+		uint32_t r = NextRandom(rng);
+
+		if ((r & 63) == 0)
+			scratchLen = (size_t)sprintf(scratch, "%u", (unsigned int)(NextRandom(rng) % 100000u));
+		else
+		{
+			uint32_t wordIndex = ((NextRandom(rng) % BENCH_NUM_WORDS) * (NextRandom(rng) % BENCH_NUM_WORDS)) / BENCH_NUM_WORDS;
+
+			scratchLen = strlen(words[wordIndex]);
+			memcpy(scratch, words[wordIndex], scratchLen);
+		}
+
+		r = NextRandom(rng) % 64;
+		if (r < 3)
+		{
+			scratch[scratchLen++] = '.';
+			scratch[scratchLen++] = ' ';
+		}
+		else if (r < 6)
+		{
+			scratch[scratchLen++] = ',';
+			scratch[scratchLen++] = ' ';
+		}
+		else if (r < 7)
+			scratch[scratchLen++] = '\n';
+		else
+			scratch[scratchLen++] = ' ';
+
+		if (scratchLen > size - pos)
+			scratchLen = size - pos;
+
+		memcpy(out + pos, scratch, scratchLen);
+		pos += scratchLen;
+	}
+}
+
+static void GenerateRecordChunk(uint8_t *out, size_t size, uint32_t *recordID, uint32_t *timestamp, uint64_t *rng)
+{
+	size_t pos = 0;
+
+	while (pos < size)
+	{
+		uint8_t record[16];
+		uint32_t value = 1000 + (NextRandom(rng) % 512);
+		uint16_t type = (uint16_t)(NextRandom(rng) % 8);
+		uint16_t flags = (uint16_t)(1 << (NextRandom(rng) % 4));
+		size_t copySize = 16;
+		int i = 0;
+
+		(*recordID)++;
+		(*timestamp) += 1 + (NextRandom(rng) % 16);
+
+		for (i = 0; i < 4; i++)
+		{
+			record[i] = (uint8_t)((*recordID) >> (i * 8));
+			record[4 + i] = (uint8_t)((*timestamp) >> (i * 8));
+			record[12 + i] = (uint8_t)(value >> (i * 8));
+		}
+
+		record[8] = (uint8_t)type;
+		record[9] = (uint8_t)(type >> 8);
+		record[10] = (uint8_t)flags;
+		record[11] = (uint8_t)(flags >> 8);
+
+		if (copySize > size - pos)
+			copySize = size - pos;
+
+		memcpy(out + pos, record, copySize);
+		pos += copySize;
+	}
+}
+
+static void GenerateCorpus(uint8_t *out, size_t size, uint64_t seed)
+{
+	static const char *syllables[] = { "ka", "to", "re", "mi", "sun", "lo", "ven", "tra", "di", "po", "ser", "an", "el", "qui", "mo", "ta" };
+	char words[BENCH_NUM_WORDS][BENCH_MAX_WORD_LENGTH];
+	uint64_t rng = seed;
+	uint32_t recordID = 0;
+	uint32_t timestamp = 0;
+	size_t pos = 0;
+	size_t chunkIndex = 0;
+	size_t i = 0;
+
+	for (i = 0; i < BENCH_NUM_WORDS; i++)
+	{
+		size_t numSyllables = 1 + (NextRandom(&rng) % 4);
+		size_t j = 0;
+
+		words[i][0] = '\0';
+		for (j = 0; j < numSyllables; j++)
+			strcat(words[i], syllables[NextRandom(&rng) % (sizeof(syllables) / sizeof(syllables[0]))]);
+	}
+
+	while (pos < size)
+	{
+		size_t chunkSize = size - pos;
+
+		if (chunkSize > BENCH_CORPUS_CHUNK_SIZE)
+			chunkSize = BENCH_CORPUS_CHUNK_SIZE;
+
+		if ((chunkIndex % 4) == 3)
+			GenerateRecordChunk(out + pos, chunkSize, &recordID, &timestamp, &rng);
+		else
+			GenerateTextChunk(out + pos, chunkSize, words, &rng);
+
+		pos += chunkSize;
+		chunkIndex++;
+	}
+}
+
+static uint32_t HashPosition(const uint8_t *data)
+{
+	uint32_t v = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+
+	return (v * 2654435761u) >> (32 - BENCH_HASH_BITS);
+}
+
+// Greedy single-probe hash matcher, only used to produce benchmark input
+static int ParseCorpus(const uint8_t *data, size_t size, size_t blockSize, uint32_t maxOffset, uint32_t maxMatch, BenchParse_t *parse)
+{
+	uint32_t *hashTable = NULL;
+	size_t maxBlocks = (size + blockSize - 1) / blockSize;
+	size_t blockStart = 0;
+
+	parse->m_seqs = (BenchSequence_t *)malloc(sizeof(BenchSequence_t) * (size / BENCH_MIN_MATCH + 1));
+	parse->m_literals = (uint8_t *)malloc(size + 1);
+	parse->m_blocks = (BenchBlockRange_t *)malloc(sizeof(BenchBlockRange_t) * (maxBlocks + 1));
+	parse->m_numSeqs = 0;
+	parse->m_numLiterals = 0;
+	parse->m_numBlocks = 0;
+
+	hashTable = (uint32_t *)calloc((size_t)1 << BENCH_HASH_BITS, sizeof(uint32_t));
+
+	if (!parse->m_seqs || !parse->m_literals || !parse->m_blocks || !hashTable)
+	{
+		free(hashTable);
+		return 0;
+	}
+
+	while (blockStart < size)
+	{
+		BenchBlockRange_t *block = parse->m_blocks + parse->m_numBlocks;
+		size_t blockEnd = blockStart + blockSize;
+		size_t pos = blockStart;
+		size_t litStart = blockStart;
+
+		if (blockEnd > size)
+			blockEnd = size;
+
+		block->m_contentStart = blockStart;
+		block->m_contentSize = blockEnd - blockStart;
+		block->m_firstSeq = parse->m_numSeqs;
+		block->m_firstLiteral = parse->m_numLiterals;
+
+		while (pos + BENCH_MIN_MATCH <= blockEnd)
+		{
+			uint32_t hash = HashPosition(data + pos);
+			size_t candidate = hashTable[hash];
+			size_t matchLength = 0;
+
+			hashTable[hash] = (uint32_t)(pos + 1);
+
+			if (candidate != 0)
+			{
+				candidate--;
+				if (pos - candidate <= maxOffset && !memcmp(data + candidate, data + pos, BENCH_MIN_MATCH))
+				{
+					size_t maxLength = blockEnd - pos;
+
+					if (maxLength > maxMatch)
+						maxLength = maxMatch;
+
+					matchLength = BENCH_MIN_MATCH;
+					while (matchLength < maxLength && data[candidate + matchLength] == data[pos + matchLength])
+						matchLength++;
+				}
+			}
+
+			if (matchLength == 0)
+			{
+				pos++;
+				continue;
+			}
+			else
+			{
+				BenchSequence_t *seq = parse->m_seqs + parse->m_numSeqs;
+				size_t matchEnd = pos + matchLength;
+
+				seq->m_litLength = (uint32_t)(pos - litStart);
+				seq->m_matchLength = (uint32_t)matchLength;
+				seq->m_offset = (uint32_t)(pos - candidate);
+				parse->m_numSeqs++;
+
+				memcpy(parse->m_literals + parse->m_numLiterals, data + litStart, pos - litStart);
+				parse->m_numLiterals += pos - litStart;
+
+				for (pos = pos + 1; pos < matchEnd && pos + BENCH_MIN_MATCH <= blockEnd; pos++)
+					hashTable[HashPosition(data + pos)] = (uint32_t)(pos + 1);
+
+				pos = matchEnd;
+				litStart = pos;
+			}
+		}
+
+		memcpy(parse->m_literals + parse->m_numLiterals, data + litStart, blockEnd - litStart);
+		parse->m_numLiterals += blockEnd - litStart;
+
+		block->m_numSeqs = parse->m_numSeqs - block->m_firstSeq;
+		block->m_numLiterals = parse->m_numLiterals - block->m_firstLiteral;
+
+		parse->m_numBlocks++;
+		blockStart = blockEnd;
+	}
+
+	free(hashTable);
+	return 1;
+}
+
+static void DestroyParse(BenchParse_t *parse)
+{
+	free(parse->m_seqs);
+	free(parse->m_literals);
+	free(parse->m_blocks);
+}
+
+static int DeflateWriter_Flush(BenchDeflateWriter_t *writer)
+{
+	while (writer->m_numBits >= 8)
+	{
+		if (writer->m_size == writer->m_capacity)
+		{
+			size_t newCapacity = writer->m_capacity * 2 + 4096;
+			uint8_t *newData = (uint8_t *)realloc(writer->m_data, newCapacity);
+
+			if (newData == NULL)
+				return 0;
+
+			writer->m_data = newData;
+			writer->m_capacity = newCapacity;
+		}
+
+		writer->m_data[writer->m_size++] = (uint8_t)writer->m_bits;
+		writer->m_bits >>= 8;
+		writer->m_numBits -= 8;
+	}
+
+	return 1;
+}
+
+static int DeflateWriter_PutBits(BenchDeflateWriter_t *writer, uint32_t bits, uint8_t numBits)
+{
+	writer->m_bits |= (uint64_t)bits << writer->m_numBits;
+	writer->m_numBits += numBits;
+
+	if (writer->m_numBits >= 32)
+		return DeflateWriter_Flush(writer);
+
+	return 1;
+}
+
+static int DeflateWriter_PutCode(BenchDeflateWriter_t *writer, uint32_t code, uint8_t numBits)
+{
+	uint32_t reversed = 0;
+	uint8_t i = 0;
+
+	for (i = 0; i < numBits; i++)
+		reversed |= ((code >> i) & 1) << (numBits - 1 - i);
+
+	return DeflateWriter_PutBits(writer, reversed, numBits);
+}
+
+static int DeflateWriter_PutLitLengthSymbol(BenchDeflateWriter_t *writer, uint32_t sym)
+{
+	if (sym < 144)
+		return DeflateWriter_PutCode(writer, 0x30 + sym, 8);
+	if (sym < 256)
+		return DeflateWriter_PutCode(writer, 0x190 + (sym - 144), 9);
+	if (sym < 280)
+		return DeflateWriter_PutCode(writer, sym - 256, 7);
+	return DeflateWriter_PutCode(writer, 0xc0 + (sym - 280), 8);
+}
+
+// Encodes a parse as fixed-Huffman deflate blocks, one per parse block
+static int EncodeDeflate(const BenchParse_t *parse, uint8_t **outData, size_t *outSize)
+{
+	BenchDeflateWriter_t writer;
+	size_t blockIndex = 0;
+
+	memset(&writer, 0, sizeof(writer));
+
+	for (blockIndex = 0; blockIndex < parse->m_numBlocks; blockIndex++)
+	{
+		const BenchBlockRange_t *block = parse->m_blocks + blockIndex;
+		const uint8_t *literals = parse->m_literals + block->m_firstLiteral;
+		size_t litRemaining = block->m_numLiterals;
+		size_t seqIndex = 0;
+
+		if (!DeflateWriter_PutBits(&writer, (blockIndex == parse->m_numBlocks - 1) ? 3 : 2, 3))
+			return 0;
+
+		for (seqIndex = 0; seqIndex < block->m_numSeqs; seqIndex++)
+		{
+			const BenchSequence_t *seq = parse->m_seqs + block->m_firstSeq + seqIndex;
+			uint32_t lengthCode = 28;
+			uint32_t distCode = 29;
+			uint32_t i = 0;
+
+			for (i = 0; i < seq->m_litLength; i++)
+			{
+				if (!DeflateWriter_PutLitLengthSymbol(&writer, literals[i]))
+					return 0;
+			}
+
+			literals += seq->m_litLength;
+			litRemaining -= seq->m_litLength;
+
+			while (g_deflateLengthBase[lengthCode] > seq->m_matchLength)
+				lengthCode--;
+			while (g_deflateDistBase[distCode] > seq->m_offset)
+				distCode--;
+
+			if (!DeflateWriter_PutLitLengthSymbol(&writer, 257 + lengthCode)
+				|| !DeflateWriter_PutBits(&writer, seq->m_matchLength - g_deflateLengthBase[lengthCode], g_deflateLengthExtraBits[lengthCode])
+				|| !DeflateWriter_PutCode(&writer, distCode, 5)
+				|| !DeflateWriter_PutBits(&writer, seq->m_offset - g_deflateDistBase[distCode], g_deflateDistExtraBits[distCode]))
+				return 0;
+		}
+
+		while (litRemaining > 0)
+		{
+			if (!DeflateWriter_PutLitLengthSymbol(&writer, *literals))
+				return 0;
+
+			literals++;
+			litRemaining--;
+		}
+
+		if (!DeflateWriter_PutLitLengthSymbol(&writer, 256))
+			return 0;
+	}
+
+	writer.m_numBits = (uint8_t)((writer.m_numBits + 7) & ~7);
+	if (!DeflateWriter_Flush(&writer))
+		return 0;
+
+	*outData = writer.m_data;
+	*outSize = writer.m_size;
+	return 1;
+}
+
+static zstdhl_ResultCode_t CountingOutput_WriteBitstream(void *userdata, const void *data, size_t size)
+{
+	(void)data;
+	*((uint64_t *)userdata) += size;
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t VectorOutput_WriteBitstream(void *userdata, const void *data, size_t size)
+{
+	return zstdhl_Vector_Append((zstdhl_Vector_t *)userdata, data, size);
+}
+
+static zstdhl_ResultCode_t BenchSeqCollection_GetNextSequence(void *userdata, zstdhl_SequenceDesc_t *sequence)
+{
+	BenchSeqCollectionState_t *state = (BenchSeqCollectionState_t *)userdata;
+	const BenchSequence_t *seq = state->m_seqs;
+	uint32_t offset = 0;
+	size_t numBits = 0;
+
+	if (state->m_numRemaining == 0)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	for (offset = seq->m_offset; offset != 0; offset >>= 1)
+		numBits++;
+
+	state->m_offsetDWord = seq->m_offset;
+
+	sequence->m_litLength = seq->m_litLength;
+	sequence->m_matchLength = seq->m_matchLength;
+	sequence->m_offsetType = ZSTDHL_OFFSET_TYPE_SPECIFIED;
+	sequence->m_offsetValueBigNum = &state->m_offsetDWord;
+	sequence->m_offsetValueNumBits = numBits;
+
+	state->m_seqs++;
+	state->m_numRemaining--;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t AssembleParsedFrame(const BenchCorpus_t *corpus, BenchFrameKind_t frameKind, const zstdhl_EncoderOutputObject_t *output, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	const BenchParse_t *parse = &corpus->m_parse;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_EncBlockDesc_t blockDesc;
+	zstdhl_MemBufferStreamSource_t litMemSource;
+	zstdhl_StreamSourceObject_t litStream;
+	BenchSeqCollectionState_t seqState;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	size_t blockIndex = 0;
+
+	memset(&frameHeader, 0, sizeof(frameHeader));
+	frameHeader.m_windowSize = BENCH_WINDOW_SIZE;
+	frameHeader.m_haveWindowSize = 1;
+	frameHeader.m_frameContentSize = corpus->m_size;
+	frameHeader.m_haveFrameContentSize = 1;
+
+	litStream.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	litStream.m_userdata = &litMemSource;
+
+	BENCH_CHECKED(zstdhl_CreateAssemblerContext(alloc, &context));
+
+	result = zstdhl_AssembleFrameWithContext(context, &frameHeader, output);
+
+	for (blockIndex = 0; result == ZSTDHL_RESULT_OK && blockIndex < parse->m_numBlocks; blockIndex++)
+	{
+		const BenchBlockRange_t *block = parse->m_blocks + blockIndex;
+		int i = 0;
+
+		memset(&blockDesc, 0, sizeof(blockDesc));
+		blockDesc.m_blockHeader.m_blockType = ZSTDHL_BLOCK_TYPE_COMPRESSED;
+		blockDesc.m_blockHeader.m_isLastBlock = (blockIndex == parse->m_numBlocks - 1);
+		blockDesc.m_autoBlockSizeFlag = 1;
+		blockDesc.m_autoLitCompressedSizeFlag = 1;
+		blockDesc.m_autoLitRegeneratedSizeFlag = 1;
+		for (i = 0; i < 4; i++)
+			blockDesc.m_autoHuffmanStreamSizesFlags[i] = 1;
+		blockDesc.m_autoSeqCompressionModeFlag = 1;
+
+		if (frameKind == BenchFrameKind_LiteralsOnly)
+		{
+			zstdhl_MemBufferStreamSource_Init(&litMemSource, corpus->m_data + block->m_contentStart, block->m_contentSize);
+			blockDesc.m_litSectionDesc.m_numValues = block->m_contentSize;
+			seqState.m_seqs = NULL;
+			seqState.m_numRemaining = 0;
+		}
+		else
+		{
+			zstdhl_MemBufferStreamSource_Init(&litMemSource, parse->m_literals + block->m_firstLiteral, block->m_numLiterals);
+			blockDesc.m_litSectionDesc.m_numValues = block->m_numLiterals;
+			seqState.m_seqs = parse->m_seqs + block->m_firstSeq;
+			seqState.m_numRemaining = block->m_numSeqs;
+		}
+
+		if (frameKind == BenchFrameKind_RawLiterals)
+		{
+			blockDesc.m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+			blockDesc.m_litSectionHeader.m_regeneratedSize = (uint32_t)blockDesc.m_litSectionDesc.m_numValues;
+			blockDesc.m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+		}
+		else
+			blockDesc.m_autoLitSectionModeFlag = 1;
+
+		blockDesc.m_litSectionDesc.m_decompressedLiteralsStream = &litStream;
+		blockDesc.m_seqSectionDesc.m_numSequences = (uint32_t)seqState.m_numRemaining;
+		blockDesc.m_seqCollection.m_getNextSequence = BenchSeqCollection_GetNextSequence;
+		blockDesc.m_seqCollection.m_userdata = &seqState;
+
+		result = zstdhl_AssembleBlockWithContext(context, &blockDesc, output);
+	}
+
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_AssembleFrameEndWithContext(context, output);
+
+	zstdhl_DestroyAssemblerContext(context);
+
+	return result;
+}
+
+static zstdhl_ResultCode_t DisasmCounter_ReportElement(void *userdata, int elementType, const void *elementData)
+{
+	BenchDisasmCounter_t *counter = (BenchDisasmCounter_t *)userdata;
+
+	counter->m_numElements++;
+
+	if (elementType == ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION)
+	{
+		const zstdhl_LiteralsSectionDesc_t *litDesc = (const zstdhl_LiteralsSectionDesc_t *)elementData;
+		const zstdhl_StreamSourceObject_t *stream = litDesc->m_decompressedLiteralsStream;
+		size_t remaining = litDesc->m_numValues;
+
+		while (remaining > 0)
+		{
+			size_t chunkSize = (remaining < BENCH_DRAIN_BUFFER_SIZE) ? remaining : BENCH_DRAIN_BUFFER_SIZE;
+
+			if (stream->m_readBytesFunc(stream->m_userdata, counter->m_drainBuffer, chunkSize) != chunkSize)
+				return ZSTDHL_RESULT_INPUT_FAILED;
+
+			remaining -= chunkSize;
+		}
+
+		counter->m_numLiterals += litDesc->m_numValues;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t DisassembleBuffer(const zstdhl_Vector_t *frame, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	BenchDisasmCounter_t counter;
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	zstdhl_DisassemblyOutputObject_t disasmOutput;
+
+	counter.m_numElements = 0;
+	counter.m_numLiterals = 0;
+
+	zstdhl_MemBufferStreamSource_Init(&memSource, frame->m_data, frame->m_count);
+	streamSource.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	streamSource.m_userdata = &memSource;
+
+	disasmOutput.m_reportDisassembledElementFunc = DisasmCounter_ReportElement;
+	disasmOutput.m_userdata = &counter;
+
+	return zstdhl_Disassemble(&streamSource, NULL, &disasmOutput, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_Assemble(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	uint64_t outSize = 0;
+	zstdhl_EncoderOutputObject_t output;
+
+	output.m_writeBitstreamFunc = CountingOutput_WriteBitstream;
+	output.m_userdata = &outSize;
+
+	return AssembleParsedFrame(corpus, BenchFrameKind_Mixed, &output, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_Disassemble(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_mixedFrame, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_HuffmanDecode(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_literalsFrame, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_SequenceDecode(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_rawLiteralsFrame, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_SynthPredefinedRaw(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_synthFrames[BenchSynthKind_PredefinedRaw], alloc);
+}
+
+static zstdhl_ResultCode_t Bench_SynthRLE(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_synthFrames[BenchSynthKind_RLE], alloc);
+}
+
+static zstdhl_ResultCode_t Bench_SynthFSEHuffman1(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_synthFrames[BenchSynthKind_FSEHuffman1], alloc);
+}
+
+static zstdhl_ResultCode_t Bench_SynthFSEHuffman4(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_synthFrames[BenchSynthKind_FSEHuffman4], alloc);
+}
+
+static zstdhl_ResultCode_t Bench_SynthReuseHuffman4(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_synthFrames[BenchSynthKind_ReuseHuffman4], alloc);
+}
+
+static zstdhl_ResultCode_t Bench_SynthRepeatOffsets(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return DisassembleBuffer(&corpus->m_synthFrames[BenchSynthKind_RepeatOffsets], alloc);
+}
+
+static void Bench_InitDeflateStreamSource(const BenchCorpus_t *corpus, zstdhl_MemBufferStreamSource_t *memSource, zstdhl_StreamSourceObject_t *streamSource)
+{
+	zstdhl_MemBufferStreamSource_Init(memSource, corpus->m_deflateData, corpus->m_deflateSize);
+	streamSource->m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	streamSource->m_userdata = memSource;
+}
+
+static void Bench_GetDeflateReparseOptions(zstdhl_DeflateConv_ReparseOptions_t *options)
+{
+	options->m_windowSize = BENCH_WINDOW_SIZE;
+	options->m_hashLog = BENCH_HASH_BITS;
+	options->m_maxChainLength = BENCH_DEFLATE_REPARSE_MAX_CHAIN_LENGTH;
+}
+
+static zstdhl_ResultCode_t Bench_ConvertDeflateSerial(zstdhl_DeflateConv_State_t *convState, zstdhl_AssemblerContext_t *context, uint32_t windowSize)
+{
+	uint64_t outSize = 0;
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_EncBlockDesc_t blockDesc;
+	uint8_t eofFlag = 0;
+
+	output.m_writeBitstreamFunc = CountingOutput_WriteBitstream;
+	output.m_userdata = &outSize;
+
+	memset(&frameHeader, 0, sizeof(frameHeader));
+	frameHeader.m_windowSize = windowSize;
+	frameHeader.m_haveWindowSize = 1;
+
+	BENCH_CHECKED(zstdhl_AssembleFrameWithContext(context, &frameHeader, &output));
+
+	for (;;)
+	{
+		memset(&blockDesc, 0, sizeof(blockDesc));
+
+		BENCH_CHECKED(zstdhl_DeflateConv_Convert(convState, &eofFlag, &blockDesc));
+		if (eofFlag)
+			break;
+
+		BENCH_CHECKED(zstdhl_AssembleBlockWithContext(context, &blockDesc, &output));
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvertWithOptions(const BenchCorpus_t *corpus, const zstdhl_DeflateConv_ReparseOptions_t *reparseOptions, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	zstdhl_DeflateConv_State_t *convState = NULL;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	Bench_InitDeflateStreamSource(corpus, &memSource, &streamSource);
+
+	BENCH_CHECKED(zstdhl_DeflateConv_CreateState(alloc, &streamSource, &convState));
+
+	if (reparseOptions != NULL)
+		result = zstdhl_DeflateConv_EnableReparse(convState, reparseOptions);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_CreateAssemblerContext(alloc, &context);
+	if (result == ZSTDHL_RESULT_OK)
+		result = Bench_ConvertDeflateSerial(convState, context, (reparseOptions != NULL) ? reparseOptions->m_windowSize : BENCH_DEFLATE_WINDOW_SIZE);
+
+	if (context != NULL)
+		zstdhl_DestroyAssemblerContext(context);
+
+	zstdhl_DeflateConv_DestroyState(convState);
+
+	return result;
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvert(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return Bench_DeflateConvertWithOptions(corpus, NULL, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvertReparse(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_DeflateConv_ReparseOptions_t reparseOptions;
+
+	Bench_GetDeflateReparseOptions(&reparseOptions);
+
+	return Bench_DeflateConvertWithOptions(corpus, &reparseOptions, alloc);
+}
+
+// Converts the stream several times with one converter and assembler context, resetting the converter between passes
+static zstdhl_ResultCode_t Bench_DeflateConvertReset(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	zstdhl_DeflateConv_State_t *convState = NULL;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	unsigned int pass = 0;
+
+	Bench_InitDeflateStreamSource(corpus, &memSource, &streamSource);
+
+	BENCH_CHECKED(zstdhl_DeflateConv_CreateState(alloc, &streamSource, &convState));
+
+	result = zstdhl_CreateAssemblerContext(alloc, &context);
+
+	for (pass = 0; pass < BENCH_DEFLATE_RESET_PASSES && result == ZSTDHL_RESULT_OK; pass++)
+	{
+		if (pass > 0)
+		{
+			Bench_InitDeflateStreamSource(corpus, &memSource, &streamSource);
+			zstdhl_DeflateConv_ResetState(convState, &streamSource);
+		}
+
+		result = Bench_ConvertDeflateSerial(convState, context, BENCH_DEFLATE_WINDOW_SIZE);
+	}
+
+	if (context != NULL)
+		zstdhl_DestroyAssemblerContext(context);
+
+	zstdhl_DeflateConv_DestroyState(convState);
+
+	return result;
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvertParallelWithOptions(const BenchCorpus_t *corpus, size_t numWorkerThreads, const zstdhl_DeflateConv_ReparseOptions_t *reparseOptions, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	uint64_t outSize = 0;
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	output.m_writeBitstreamFunc = CountingOutput_WriteBitstream;
+	output.m_userdata = &outSize;
+
+	Bench_InitDeflateStreamSource(corpus, &memSource, &streamSource);
+
+	memset(&frameHeader, 0, sizeof(frameHeader));
+	frameHeader.m_windowSize = (reparseOptions != NULL) ? reparseOptions->m_windowSize : BENCH_DEFLATE_WINDOW_SIZE;
+	frameHeader.m_haveWindowSize = 1;
+
+	BENCH_CHECKED(zstdhl_CreateAssemblerContext(alloc, &context));
+
+	result = zstdhl_AssembleFrameWithContext(context, &frameHeader, &output);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_DeflateConv_ConvertParallel(alloc, &streamSource, &output, numWorkerThreads, 0, reparseOptions);
+
+	zstdhl_DestroyAssemblerContext(context);
+
+	return result;
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvertParallel0(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return Bench_DeflateConvertParallelWithOptions(corpus, 0, NULL, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvertParallel1(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return Bench_DeflateConvertParallelWithOptions(corpus, 1, NULL, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvertParallel4(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	return Bench_DeflateConvertParallelWithOptions(corpus, 4, NULL, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_DeflateConvertParallel4Reparse(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_DeflateConv_ReparseOptions_t reparseOptions;
+
+	Bench_GetDeflateReparseOptions(&reparseOptions);
+
+	return Bench_DeflateConvertParallelWithOptions(corpus, 4, &reparseOptions, alloc);
+}
+
+static zstdhl_ResultCode_t Bench_GstdEncode(const BenchCorpus_t *corpus, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	uint64_t outSize = 0;
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	gstd_EncoderState_t *encState = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	output.m_writeBitstreamFunc = CountingOutput_WriteBitstream;
+	output.m_userdata = &outSize;
+
+	zstdhl_MemBufferStreamSource_Init(&memSource, corpus->m_mixedFrame.m_data, corpus->m_mixedFrame.m_count);
+	streamSource.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	streamSource.m_userdata = &memSource;
+
+	BENCH_CHECKED(gstd_Encoder_Create(&output, 32, gstd_ComputeMaxOffsetExtraBits(BENCH_WINDOW_SIZE), 0, alloc, &encState));
+
+	result = gstd_Encoder_Transcode(encState, &streamSource, NULL, alloc);
+
+	gstd_Encoder_Destroy(encState);
+
+	return result;
+}
+
+static zstdhl_ResultCode_t BuildFrame(BenchCorpus_t *corpus, BenchFrameKind_t frameKind, zstdhl_Vector_t *frameVector, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_EncoderOutputObject_t output;
+
+	zstdhl_Vector_Init(frameVector, 1, alloc);
+
+	output.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	output.m_userdata = frameVector;
+
+	return AssembleParsedFrame(corpus, frameKind, &output, alloc);
+}
+
+static zstdhl_ResultCode_t BuildSynthFrame(BenchCorpus_t *corpus, BenchSynthKind_t synthKind, uint64_t seed, zstdhl_Vector_t *frameVector, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_Synth_Params_t params;
+
+	zstdhl_Vector_Init(frameVector, 1, alloc);
+
+	output.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	output.m_userdata = frameVector;
+
+	zstdhl_Synth_InitDefaultParams(&params);
+	params.m_seed = seed;
+	params.m_contentSize = corpus->m_size;
+
+	switch (synthKind)
+	{
+	case BenchSynthKind_PredefinedRaw:
+		params.m_literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_RAW;
+		params.m_seqMode = ZSTDHL_SYNTH_SEQ_MODE_PREDEFINED;
+		break;
+	case BenchSynthKind_RLE:
+		params.m_literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_RLE;
+		params.m_seqMode = ZSTDHL_SYNTH_SEQ_MODE_RLE;
+		break;
+	case BenchSynthKind_FSEHuffman1:
+		params.m_literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_1_STREAM;
+		params.m_seqMode = ZSTDHL_SYNTH_SEQ_MODE_FSE;
+		break;
+	case BenchSynthKind_FSEHuffman4:
+		params.m_literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_4_STREAMS;
+		params.m_seqMode = ZSTDHL_SYNTH_SEQ_MODE_FSE;
+		break;
+	case BenchSynthKind_ReuseHuffman4:
+		params.m_literalAlphabetSize = 256;
+		params.m_literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_4_STREAMS;
+		params.m_seqMode = ZSTDHL_SYNTH_SEQ_MODE_REUSE;
+		break;
+	case BenchSynthKind_RepeatOffsets:
+		params.m_repeatOffsetPercent = 80;
+		params.m_seqMode = ZSTDHL_SYNTH_SEQ_MODE_FSE;
+		break;
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	return zstdhl_Synth_GenerateFrame(alloc, &params, &output);
+}
+
+static zstdhl_ResultCode_t InitCorpus(BenchCorpus_t *corpus, size_t size, uint64_t seed, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	BenchParse_t deflateParse;
+	int synthKind = 0;
+
+	memset(corpus, 0, sizeof(*corpus));
+
+	corpus->m_data = (uint8_t *)malloc(size);
+	corpus->m_size = size;
+	if (corpus->m_data == NULL)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	GenerateCorpus(corpus->m_data, size, seed);
+
+	if (!ParseCorpus(corpus->m_data, size, ZSTDHL_MAX_BLOCK_SIZE, BENCH_WINDOW_SIZE, 0xffffffffu, &corpus->m_parse))
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	BENCH_CHECKED(BuildFrame(corpus, BenchFrameKind_Mixed, &corpus->m_mixedFrame, alloc));
+	BENCH_CHECKED(BuildFrame(corpus, BenchFrameKind_LiteralsOnly, &corpus->m_literalsFrame, alloc));
+	BENCH_CHECKED(BuildFrame(corpus, BenchFrameKind_RawLiterals, &corpus->m_rawLiteralsFrame, alloc));
+
+	for (synthKind = 0; synthKind < BenchSynthKind_Count; synthKind++)
+		BENCH_CHECKED(BuildSynthFrame(corpus, (BenchSynthKind_t)synthKind, seed, &corpus->m_synthFrames[synthKind], alloc));
+
+	if (!ParseCorpus(corpus->m_data, size, BENCH_DEFLATE_BLOCK_SIZE, BENCH_DEFLATE_WINDOW_SIZE, BENCH_DEFLATE_MAX_MATCH, &deflateParse))
+	{
+		DestroyParse(&deflateParse);
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+	}
+
+	if (!EncodeDeflate(&deflateParse, &corpus->m_deflateData, &corpus->m_deflateSize))
+	{
+		DestroyParse(&deflateParse);
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+	}
+
+	DestroyParse(&deflateParse);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static void DestroyCorpus(BenchCorpus_t *corpus)
+{
+	int synthKind = 0;
+
+	for (synthKind = 0; synthKind < BenchSynthKind_Count; synthKind++)
+		zstdhl_Vector_Destroy(&corpus->m_synthFrames[synthKind]);
+
+	zstdhl_Vector_Destroy(&corpus->m_mixedFrame);
+	zstdhl_Vector_Destroy(&corpus->m_literalsFrame);
+	zstdhl_Vector_Destroy(&corpus->m_rawLiteralsFrame);
+	DestroyParse(&corpus->m_parse);
+	free(corpus->m_deflateData);
+	free(corpus->m_data);
+}
+
+static zstdhl_ResultCode_t RunBenchmark(const BenchDef_t *def, const BenchCorpus_t *corpus, double minTime, BenchResult_t *outResult)
+{
+	zstdhl_MemoryAllocatorObject_t baseAlloc;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	zstdhl_AllocTracker_t *tracker = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	baseAlloc.m_reallocFunc = BenchRealloc;
+	baseAlloc.m_userdata = NULL;
+
+	outResult->m_iterations = 0;
+	outResult->m_totalSeconds = 0.0;
+	outResult->m_bestSeconds = 0.0;
+
+	while (outResult->m_iterations < BENCH_MIN_ITERATIONS || outResult->m_totalSeconds < minTime)
+	{
+		double startTime = 0.0;
+		double elapsed = 0.0;
+
+		// Each iteration gets a new tracker so that the reported stats are for a single run
+		BENCH_CHECKED(zstdhl_AllocTracker_Create(&baseAlloc, &tracker));
+		zstdhl_AllocTracker_GetAllocator(tracker, &alloc);
+
+		startTime = GetTimeSeconds();
+		result = def->m_func(corpus, &alloc);
+		elapsed = GetTimeSeconds() - startTime;
+
+		zstdhl_AllocTracker_GetStats(tracker, &outResult->m_allocStats, NULL);
+		zstdhl_AllocTracker_Destroy(tracker);
+
+		if (result != ZSTDHL_RESULT_OK)
+			return result;
+
+		if (outResult->m_iterations == 0 || elapsed < outResult->m_bestSeconds)
+			outResult->m_bestSeconds = elapsed;
+
+		outResult->m_totalSeconds += elapsed;
+		outResult->m_iterations++;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static double ComputeMBPerSec(uint64_t bytes, double seconds)
+{
+	if (seconds <= 0.0)
+		return 0.0;
+
+	return (double)bytes / seconds / (1024.0 * 1024.0);
+}
+
+static void WriteResultJSON(FILE *f, const char *name, const BenchResult_t *result, int isFirst)
+{
+	fprintf(f, "%s\n\t\t{\n", isFirst ? "" : ",");
+	fprintf(f, "\t\t\t\"name\": \"%s\",\n", name);
+	fprintf(f, "\t\t\t\"inputBytes\": %llu,\n", (unsigned long long)result->m_inputBytes);
+	fprintf(f, "\t\t\t\"contentBytes\": %llu,\n", (unsigned long long)result->m_contentBytes);
+	fprintf(f, "\t\t\t\"iterations\": %u,\n", (unsigned int)result->m_iterations);
+	fprintf(f, "\t\t\t\"totalSeconds\": %.6f,\n", result->m_totalSeconds);
+	fprintf(f, "\t\t\t\"bestMBPerSec\": %.3f,\n", ComputeMBPerSec(result->m_contentBytes, result->m_bestSeconds));
+	fprintf(f, "\t\t\t\"meanMBPerSec\": %.3f,\n", ComputeMBPerSec(result->m_contentBytes * result->m_iterations, result->m_totalSeconds));
+	fprintf(f, "\t\t\t\"allocations\": %llu,\n", (unsigned long long)result->m_allocStats.m_numAllocs);
+	fprintf(f, "\t\t\t\"reallocations\": %llu,\n", (unsigned long long)result->m_allocStats.m_numReallocs);
+	fprintf(f, "\t\t\t\"frees\": %llu,\n", (unsigned long long)result->m_allocStats.m_numFrees);
+	fprintf(f, "\t\t\t\"allocatedBytes\": %llu,\n", (unsigned long long)result->m_allocStats.m_allocatedBytes);
+	fprintf(f, "\t\t\t\"peakBytes\": %llu\n", (unsigned long long)result->m_allocStats.m_peakBytes);
+	fprintf(f, "\t\t}");
+}
+
+static uint64_t GetBenchInputBytes(const BenchDef_t *def, const BenchCorpus_t *corpus)
+{
+	if (def->m_func == Bench_Disassemble || def->m_func == Bench_GstdEncode)
+		return corpus->m_mixedFrame.m_count;
+	if (def->m_func == Bench_HuffmanDecode)
+		return corpus->m_literalsFrame.m_count;
+	if (def->m_func == Bench_SequenceDecode)
+		return corpus->m_rawLiteralsFrame.m_count;
+	if (def->m_func == Bench_DeflateConvertReset)
+		return corpus->m_deflateSize * BENCH_DEFLATE_RESET_PASSES;
+	if (def->m_func == Bench_DeflateConvert || def->m_func == Bench_DeflateConvertReparse
+		|| def->m_func == Bench_DeflateConvertParallel0 || def->m_func == Bench_DeflateConvertParallel1
+		|| def->m_func == Bench_DeflateConvertParallel4 || def->m_func == Bench_DeflateConvertParallel4Reparse)
+		return corpus->m_deflateSize;
+	if (def->m_func == Bench_SynthPredefinedRaw)
+		return corpus->m_synthFrames[BenchSynthKind_PredefinedRaw].m_count;
+	if (def->m_func == Bench_SynthRLE)
+		return corpus->m_synthFrames[BenchSynthKind_RLE].m_count;
+	if (def->m_func == Bench_SynthFSEHuffman1)
+		return corpus->m_synthFrames[BenchSynthKind_FSEHuffman1].m_count;
+	if (def->m_func == Bench_SynthFSEHuffman4)
+		return corpus->m_synthFrames[BenchSynthKind_FSEHuffman4].m_count;
+	if (def->m_func == Bench_SynthReuseHuffman4)
+		return corpus->m_synthFrames[BenchSynthKind_ReuseHuffman4].m_count;
+	if (def->m_func == Bench_SynthRepeatOffsets)
+		return corpus->m_synthFrames[BenchSynthKind_RepeatOffsets].m_count;
+	return corpus->m_size;
+}
+
+static uint64_t GetBenchContentBytes(const BenchDef_t *def, const BenchCorpus_t *corpus)
+{
+	if (def->m_func == Bench_DeflateConvertReset)
+		return (uint64_t)corpus->m_size * BENCH_DEFLATE_RESET_PASSES;
+	return corpus->m_size;
+}
+
+int main(int argc, const char **argv)
+{
+	static const BenchDef_t benchDefs[] =
+	{
+		{ "assemble", Bench_Assemble },
+		{ "disassemble", Bench_Disassemble },
+		{ "huffman_decode", Bench_HuffmanDecode },
+		{ "sequence_decode", Bench_SequenceDecode },
+		{ "deflate_convert", Bench_DeflateConvert },
+		{ "deflate_convert_reparse", Bench_DeflateConvertReparse },
+		{ "deflate_convert_reset", Bench_DeflateConvertReset },
+		{ "deflate_parallel_0", Bench_DeflateConvertParallel0 },
+		{ "deflate_parallel_1", Bench_DeflateConvertParallel1 },
+		{ "deflate_parallel_4", Bench_DeflateConvertParallel4 },
+		{ "deflate_parallel_4_reparse", Bench_DeflateConvertParallel4Reparse },
+		{ "gstd_encode", Bench_GstdEncode },
+		{ "synth_predefined_raw", Bench_SynthPredefinedRaw },
+		{ "synth_rle", Bench_SynthRLE },
+		{ "synth_fse_huffman1", Bench_SynthFSEHuffman1 },
+		{ "synth_fse_huffman4", Bench_SynthFSEHuffman4 },
+		{ "synth_reuse_huffman4", Bench_SynthReuseHuffman4 },
+		{ "synth_repeat_offsets", Bench_SynthRepeatOffsets },
+	};
+
+	const char *outputPath = NULL;
+	const char *filter = NULL;
+	size_t corpusSize = BENCH_DEFAULT_CORPUS_SIZE;
+	double minTime = BENCH_DEFAULT_MIN_TIME_MS / 1000.0;
+	uint64_t seed = 1;
+	BenchCorpus_t corpus;
+	zstdhl_MemoryAllocatorObject_t setupAlloc;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	FILE *outF = stdout;
+	int isFirst = 1;
+	int i = 0;
+	size_t benchIndex = 0;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-o") && i + 1 < argc)
+			outputPath = argv[++i];
+		else if (!strcmp(argv[i], "--size") && i + 1 < argc)
+			corpusSize = (size_t)strtoul(argv[++i], NULL, 10) * 1024;
+		else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+			minTime = strtod(argv[++i], NULL) / 1000.0;
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+			filter = argv[++i];
+		else
+		{
+			fprintf(stderr, "Usage: zstdhl_bench [options]\n");
+			fprintf(stderr, "Options:\n");
+			fprintf(stderr, "    -o <path> - Writes JSON results to a file instead of stdout\n");
+			fprintf(stderr, "    --size <KiB> - Size of the generated corpus (default %u)\n", (unsigned int)(BENCH_DEFAULT_CORPUS_SIZE / 1024));
+			fprintf(stderr, "    --min-time <ms> - Minimum run time per benchmark (default %u)\n", (unsigned int)BENCH_DEFAULT_MIN_TIME_MS);
+			fprintf(stderr, "    --seed <n> - Corpus generator seed\n");
+			fprintf(stderr, "    --filter <text> - Only runs benchmarks with names containing the text\n");
+			return -1;
+		}
+	}
+
+	if (corpusSize == 0)
+	{
+		fprintf(stderr, "Corpus size must be nonzero\n");
+		return -1;
+	}
+
+	setupAlloc.m_reallocFunc = BenchRealloc;
+	setupAlloc.m_userdata = NULL;
+
+	result = InitCorpus(&corpus, corpusSize, seed, &setupAlloc);
+	if (result != ZSTDHL_RESULT_OK)
+	{
+		fprintf(stderr, "Corpus setup failed with error code %i\n", (int)result);
+		return -1;
+	}
+
+	if (outputPath != NULL)
+	{
+		outF = fopen(outputPath, "wb");
+		if (!outF)
+		{
+			fprintf(stderr, "Couldn't open output file\n");
+			DestroyCorpus(&corpus);
+			return -1;
+		}
+	}
+
+	fprintf(outF, "{\n");
+	fprintf(outF, "\t\"corpusBytes\": %llu,\n", (unsigned long long)corpus.m_size);
+	fprintf(outF, "\t\"seed\": %llu,\n", (unsigned long long)seed);
+	fprintf(outF, "\t\"benchmarks\": [");
+
+	for (benchIndex = 0; benchIndex < sizeof(benchDefs) / sizeof(benchDefs[0]); benchIndex++)
+	{
+		const BenchDef_t *def = benchDefs + benchIndex;
+		BenchResult_t benchResult;
+
+		if (filter != NULL && strstr(def->m_name, filter) == NULL)
+			continue;
+
+		fprintf(stderr, "Running %s...\n", def->m_name);
+
+		benchResult.m_inputBytes = GetBenchInputBytes(def, &corpus);
+		benchResult.m_contentBytes = GetBenchContentBytes(def, &corpus);
+
+		result = RunBenchmark(def, &corpus, minTime, &benchResult);
+		if (result != ZSTDHL_RESULT_OK)
+		{
+			fprintf(stderr, "Benchmark %s failed with error code %i\n", def->m_name, (int)result);
+			break;
+		}
+
+		WriteResultJSON(outF, def->m_name, &benchResult, isFirst);
+		isFirst = 0;
+	}
+
+	fprintf(outF, "\n\t]\n}\n");
+
+	if (outF != stdout)
+		fclose(outF);
+
+	DestroyCorpus(&corpus);
+
+	return (result == ZSTDHL_RESULT_OK) ? 0 : -1;
+}
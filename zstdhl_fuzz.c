@@ -0,0 +1,2326 @@
+/*
+Copyright (c) 2023 Eric Lasota
+
+This software is available under the terms of the MIT license
+or the Apache License, Version 2.0.  For more information, see
+the included LICENSE.txt file.
+*/
+
+// Differential round-trip harness.  Each input is run through these stages:
+//    disassemble: Disassembles the input as a Zstandard frame and regenerates its content.
+//    round_trip: Disassembles the input as a Zstandard frame, reassembles every block from its literals and
+//                sequences, then checks that the reassembled frame decodes to the same content.
+//    deflate_convert: Converts the input as a raw deflate stream, then checks that the result decodes to the same
+//                     content as a reference inflater produces, that both accept the same streams, and that no
+//                     block is larger than the window allows.
+//    deflate_reparse: Same as deflate_convert, with re-parsing enabled.
+//    deflate_reset: Converts the input with re-parsing enabled, then converts it again with a converter that was
+//                   reset with zstdhl_DeflateConv_ResetState after a partial conversion, and checks that both
+//                   frames are identical.
+//    deflate_parallel: Converts the input with zstdhl_DeflateConv_ConvertParallel with and without re-parsing,
+//                      checks the result like deflate_convert, and checks that every worker thread count produces
+//                      the same frame.
+//    gstd_transcode: Transcodes the input to gstd, then checks that a reference gstd decoder produces the content
+//                    of the Zstandard frame and consumes the whole output.
+//    synth: Uses the first bytes of the input as synthetic frame generator parameters, favoring small blocks,
+//           then checks that generation succeeds and that the frame decodes to the requested content size.  The
+//           frame is also assembled into a buffer of zstdhl_FrameBound bytes for its block count, and must match.
+//
+// Zstandard content is regenerated by the library's disassembler.  The reference inflater and gstd decoder don't
+// share code with the converter or the gstd encoder.  gstd doesn't transmit the symbol of RLE sequence compression
+// modes, so the gstd stage only compares content up to the first block that uses one.
+//
+// Inputs that a stage rejects are not failures.  Divergences abort.
+//
+// If ZSTDHL_FUZZ_LIBFUZZER is defined, this builds as a libFuzzer target.  Otherwise, it runs each stage
+// on a set of files and reports throughput.
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "zstdhl.h"
+#include "gstdenc.h"
+#include "gstd_constants.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define FUZZ_MAX_MEMORY (256 * 1024 * 1024)
+#define FUZZ_DEFLATE_WINDOW_SIZE 32768
+#define FUZZ_DEFLATE_REPARSE_WINDOW_SIZE 65536
+#define FUZZ_DEFLATE_REPARSE_HASH_LOG 12
+#define FUZZ_DEFLATE_REPARSE_MAX_CHAIN_LENGTH 16
+#define FUZZ_GSTD_MAX_FRAME_SIZE (64 * 1024 * 1024)
+#define FUZZ_GSTD_NUM_LANES 32
+#define FUZZ_DEFAULT_MIN_TIME_MS 500
+#define FUZZ_MIN_ITERATIONS 3
+
+#define FUZZ_INFLATE_MAX_CODE_LENGTH 15
+#define FUZZ_INFLATE_MAX_LIT_LENGTH_CODES 286
+#define FUZZ_INFLATE_MAX_DIST_CODES 30
+
+#define FUZZ_SYNTH_PARAMS_SIZE 18
+#define FUZZ_SYNTH_MAX_BLOCK_SIZE 2048
+
+#define FUZZ_GSTD_WORD_SIZE 4
+#define FUZZ_GSTD_MAX_SYMBOLS (GSTD_MAX_MATCH_LENGTH_CODE + 1)
+#define FUZZ_GSTD_HUFFMAN_LOOKUP_SIZE (1 << GSTD_MAX_HUFFMAN_CODE_LENGTH)
+
+#define FUZZ_CHECKED(n)	\
+	do\
+	{\
+		zstdhl_ResultCode_t result = (n);\
+		if (result != ZSTDHL_RESULT_OK)\
+			return result;\
+	} while(0)
+
+typedef enum FuzzStageResult
+{
+	FuzzStageResult_OK,
+	FuzzStageResult_Rejected,
+} FuzzStageResult_t;
+
+typedef struct FuzzSequence
+{
+	uint32_t m_litLength;
+	uint32_t m_matchLength;
+	uint32_t m_offsetValue;
+	zstdhl_OffsetType_t m_offsetType;
+} FuzzSequence_t;
+
+typedef struct FuzzSeqCollectionState
+{
+	const FuzzSequence_t *m_seqs;
+	size_t m_numRemaining;
+	uint32_t m_offsetDWord;
+} FuzzSeqCollectionState_t;
+
+// Collects the content regenerated by the disassembler, and optionally reassembles each block from its
+// disassembled literals and sequences
+typedef struct FuzzDecodeState
+{
+	zstdhl_Vector_t m_contentVector;
+	zstdhl_Vector_t m_litVector;
+	zstdhl_Vector_t m_seqVector;
+	size_t m_blockStart;
+	size_t m_numBlocks;
+	uint64_t m_maxBlockSize;
+
+	zstdhl_BlockHeaderDesc_t m_blockHeader;
+	zstdhl_LiteralsSectionHeader_t m_litSectionHeader;
+	uint8_t m_rleByte;
+
+	zstdhl_AssemblerContext_t *m_asmContext;
+	const zstdhl_EncoderOutputObject_t *m_asmOutput;
+	zstdhl_ResultCode_t m_asmResult;
+	uint8_t m_oversizedBlockFlag;
+} FuzzDecodeState_t;
+
+typedef struct FuzzInflateState
+{
+	const uint8_t *m_data;
+	size_t m_size;
+	size_t m_pos;
+	uint32_t m_bitBuffer;
+	uint8_t m_numBits;
+	zstdhl_Vector_t *m_output;
+} FuzzInflateState_t;
+
+// Canonical Huffman code, stored as the number of codes of each length and the symbols in code order
+typedef struct FuzzInflateHuffman
+{
+	uint16_t m_counts[FUZZ_INFLATE_MAX_CODE_LENGTH + 1];
+	uint16_t m_symbols[FUZZ_INFLATE_MAX_LIT_LENGTH_CODES + 2];
+} FuzzInflateHuffman_t;
+
+typedef struct FuzzGstdBitstream
+{
+	uint64_t m_bits;
+	uint8_t m_numBits;
+} FuzzGstdBitstream_t;
+
+typedef struct FuzzGstdTable
+{
+	uint32_t m_probs[FUZZ_GSTD_MAX_SYMBOLS];
+	uint32_t m_baselines[FUZZ_GSTD_MAX_SYMBOLS];
+	uint8_t m_cellSymbols[1 << GSTD_MAX_ACCURACY_LOG];
+	uint8_t m_accuracyLog;
+	zstdhl_SequencesCompressionMode_t m_mode;
+} FuzzGstdTable_t;
+
+typedef struct FuzzGstdSequence
+{
+	uint32_t m_litLength;
+	uint32_t m_matchLength;
+	uint32_t m_offsetCode;
+} FuzzGstdSequence_t;
+
+// Reference gstd decoder.  Every stream reads from the same input: whenever a read needs more bits than a stream
+// has buffered, the stream takes the next 32-bit word of the input.
+typedef struct FuzzGstdDecoder
+{
+	const uint8_t *m_data;
+	size_t m_size;
+	size_t m_pos;
+
+	FuzzGstdBitstream_t m_laneStreams[FUZZ_GSTD_NUM_LANES];
+	uint16_t m_laneStates[FUZZ_GSTD_NUM_LANES];
+	FuzzGstdBitstream_t m_controlStream;
+	FuzzGstdBitstream_t m_rawStream;
+
+	FuzzGstdTable_t m_huffWeightTable;
+	FuzzGstdTable_t m_litLengthTable;
+	FuzzGstdTable_t m_matchLengthTable;
+	FuzzGstdTable_t m_offsetTable;
+
+	uint16_t m_huffmanLookup[FUZZ_GSTD_HUFFMAN_LOOKUP_SIZE];	// Symbol in the low 8 bits, code length in the high 8 bits
+	uint8_t m_haveHuffmanTable;
+
+	uint32_t m_repeatOffsets[3];
+
+	uint8_t m_litSectionType;
+	uint32_t m_numLiterals;
+	uint32_t m_numLiteralsConsumed;
+	zstdhl_Vector_t m_litVector;
+	zstdhl_Vector_t m_seqVector;
+	zstdhl_Vector_t *m_content;
+} FuzzGstdDecoder_t;
+
+typedef FuzzStageResult_t (*FuzzStageFunc_t)(const uint8_t *data, size_t size);
+
+typedef struct FuzzStageDef
+{
+	const char *m_name;
+	FuzzStageFunc_t m_func;
+} FuzzStageDef_t;
+
+static const uint16_t g_inflateLengthBases[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t g_inflateLengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t g_inflateDistBases[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t g_inflateDistExtraBits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t g_inflateCodeLengthOrder[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static const uint32_t g_gstdLitLengthBases[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536 };
+static const uint8_t g_gstdLitLengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+static const uint32_t g_gstdMatchLengthBases[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051, 4099, 8195, 16387, 32771, 65539 };
+static const uint8_t g_gstdMatchLengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+static void FuzzFail(const char *stage, const char *message, zstdhl_ResultCode_t result)
+{
+	fprintf(stderr, "%s: %s (error code %i)\n", stage, message, (int)result);
+	abort();
+}
+
+static void *FuzzRealloc(void *userdata, void *ptr, size_t newSize)
+{
+	(void)userdata;
+
+	if (newSize == 0)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	return realloc(ptr, newSize);
+}
+
+static void CreateCappedAlloc(const char *stage, zstdhl_AllocTracker_t **outTracker, zstdhl_MemoryAllocatorObject_t *outAlloc)
+{
+	zstdhl_MemoryAllocatorObject_t baseAlloc;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	baseAlloc.m_reallocFunc = FuzzRealloc;
+	baseAlloc.m_userdata = NULL;
+
+	result = zstdhl_AllocTracker_Create(&baseAlloc, outTracker);
+	if (result != ZSTDHL_RESULT_OK)
+		FuzzFail(stage, "Couldn't create allocation tracker", result);
+
+	zstdhl_AllocTracker_SetLimit(*outTracker, FUZZ_MAX_MEMORY);
+	zstdhl_AllocTracker_GetAllocator(*outTracker, outAlloc);
+}
+
+static void DestroyCappedAlloc(const char *stage, zstdhl_AllocTracker_t *tracker, zstdhl_ResultCode_t result)
+{
+	zstdhl_AllocStats_t stats;
+
+	zstdhl_AllocTracker_GetStats(tracker, &stats, NULL);
+	zstdhl_AllocTracker_Destroy(tracker);
+
+	if (stats.m_currentBytes != 0)
+		FuzzFail(stage, "Memory leaked", result);
+}
+
+static zstdhl_ResultCode_t VectorOutput_WriteBitstream(void *userdata, const void *data, size_t size)
+{
+	return zstdhl_Vector_Append((zstdhl_Vector_t *)userdata, data, size);
+}
+
+static void CompareContent(const char *stage, const zstdhl_Vector_t *content, const zstdhl_Vector_t *expectedContent, int allowPrefix)
+{
+	if (content->m_count > expectedContent->m_count || (!allowPrefix && content->m_count != expectedContent->m_count))
+		FuzzFail(stage, "Content size mismatch", ZSTDHL_RESULT_OK);
+
+	if (content->m_count > 0 && memcmp(content->m_data, expectedContent->m_data, content->m_count) != 0)
+		FuzzFail(stage, "Content mismatch", ZSTDHL_RESULT_OK);
+}
+
+static uint8_t FuzzLog2(uint32_t value)
+{
+	uint8_t result = 0;
+
+	while (value > 1)
+	{
+		value >>= 1;
+		result++;
+	}
+
+	return result;
+}
+
+static zstdhl_ResultCode_t FuzzSeqCollection_GetNextSequence(void *userdata, zstdhl_SequenceDesc_t *sequence)
+{
+	FuzzSeqCollectionState_t *state = (FuzzSeqCollectionState_t *)userdata;
+	const FuzzSequence_t *seq = state->m_seqs;
+	uint32_t offset = 0;
+	size_t numBits = 0;
+
+	if (state->m_numRemaining == 0)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	for (offset = seq->m_offsetValue; offset != 0; offset >>= 1)
+		numBits++;
+
+	state->m_offsetDWord = seq->m_offsetValue;
+
+	sequence->m_litLength = seq->m_litLength;
+	sequence->m_matchLength = seq->m_matchLength;
+	sequence->m_offsetType = seq->m_offsetType;
+	sequence->m_offsetValueBigNum = &state->m_offsetDWord;
+	sequence->m_offsetValueNumBits = numBits;
+
+	state->m_seqs++;
+	state->m_numRemaining--;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static void FuzzDecodeState_Init(FuzzDecodeState_t *state, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_Vector_Init(&state->m_contentVector, 1, alloc);
+	zstdhl_Vector_Init(&state->m_litVector, 1, alloc);
+	zstdhl_Vector_Init(&state->m_seqVector, sizeof(FuzzSequence_t), alloc);
+	state->m_blockStart = 0;
+	state->m_numBlocks = 0;
+	state->m_maxBlockSize = ZSTDHL_MAX_BLOCK_SIZE;
+	state->m_rleByte = 0;
+	state->m_asmContext = NULL;
+	state->m_asmOutput = NULL;
+	state->m_asmResult = ZSTDHL_RESULT_OK;
+	state->m_oversizedBlockFlag = 0;
+}
+
+static void FuzzDecodeState_Destroy(FuzzDecodeState_t *state)
+{
+	zstdhl_Vector_Destroy(&state->m_contentVector);
+	zstdhl_Vector_Destroy(&state->m_litVector);
+	zstdhl_Vector_Destroy(&state->m_seqVector);
+}
+
+static zstdhl_ResultCode_t FuzzDecode_AddSequence(FuzzDecodeState_t *state, const zstdhl_SequenceDesc_t *seqDesc)
+{
+	FuzzSequence_t seq;
+
+	seq.m_litLength = seqDesc->m_litLength;
+	seq.m_matchLength = seqDesc->m_matchLength;
+	seq.m_offsetValue = (seqDesc->m_offsetValueNumBits > 0) ? seqDesc->m_offsetValueBigNum[0] : 0;
+	seq.m_offsetType = seqDesc->m_offsetType;
+
+	return zstdhl_Vector_Append(&state->m_seqVector, &seq, 1);
+}
+
+static zstdhl_ResultCode_t FuzzDecode_AddLiteralsSection(FuzzDecodeState_t *state, const zstdhl_LiteralsSectionDesc_t *litDesc)
+{
+	const zstdhl_StreamSourceObject_t *stream = litDesc->m_decompressedLiteralsStream;
+	size_t numValues = litDesc->m_numValues;
+	size_t regeneratedSize = state->m_litSectionHeader.m_regeneratedSize;
+	uint8_t *dest = NULL;
+
+	FUZZ_CHECKED(zstdhl_Vector_Append(&state->m_litVector, NULL, numValues));
+
+	dest = ((uint8_t *)state->m_litVector.m_dataEnd) - numValues;
+	if (stream->m_readBytesFunc(stream->m_userdata, dest, numValues) != numValues)
+		return ZSTDHL_RESULT_INPUT_FAILED;
+
+	// RLE sections only report the repeated value once
+	if (state->m_litSectionHeader.m_sectionType == ZSTDHL_LITERALS_SECTION_TYPE_RLE && numValues == 1 && regeneratedSize > 1)
+	{
+		FUZZ_CHECKED(zstdhl_Vector_Append(&state->m_litVector, NULL, regeneratedSize - 1u));
+
+		dest = (uint8_t *)state->m_litVector.m_data;
+		memset(dest + 1, dest[0], regeneratedSize - 1u);
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzDecode_ReassembleBlock(FuzzDecodeState_t *state)
+{
+	zstdhl_EncBlockDesc_t blockDesc;
+	zstdhl_MemBufferStreamSource_t litMemSource;
+	zstdhl_StreamSourceObject_t litStream;
+	FuzzSeqCollectionState_t seqState;
+	size_t blockSize = state->m_contentVector.m_count - state->m_blockStart;
+	int i = 0;
+
+	memset(&blockDesc, 0, sizeof(blockDesc));
+	blockDesc.m_blockHeader.m_blockType = state->m_blockHeader.m_blockType;
+	blockDesc.m_blockHeader.m_isLastBlock = state->m_blockHeader.m_isLastBlock;
+
+	switch (state->m_blockHeader.m_blockType)
+	{
+	case ZSTDHL_BLOCK_TYPE_RAW:
+		blockDesc.m_blockHeader.m_blockSize = (uint32_t)blockSize;
+		blockDesc.m_uncompressedOrRLEData = ((const uint8_t *)state->m_contentVector.m_data) + state->m_blockStart;
+		break;
+
+	case ZSTDHL_BLOCK_TYPE_RLE:
+		blockDesc.m_blockHeader.m_blockSize = (uint32_t)blockSize;
+		blockDesc.m_uncompressedOrRLEData = &state->m_rleByte;
+		break;
+
+	case ZSTDHL_BLOCK_TYPE_COMPRESSED:
+		zstdhl_MemBufferStreamSource_Init(&litMemSource, state->m_litVector.m_data, state->m_litVector.m_count);
+		litStream.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+		litStream.m_userdata = &litMemSource;
+
+		seqState.m_seqs = (const FuzzSequence_t *)state->m_seqVector.m_data;
+		seqState.m_numRemaining = state->m_seqVector.m_count;
+		seqState.m_offsetDWord = 0;
+
+		blockDesc.m_autoBlockSizeFlag = 1;
+		blockDesc.m_autoLitCompressedSizeFlag = 1;
+		blockDesc.m_autoLitRegeneratedSizeFlag = 1;
+		for (i = 0; i < 4; i++)
+			blockDesc.m_autoHuffmanStreamSizesFlags[i] = 1;
+		blockDesc.m_autoLitSectionModeFlag = 1;
+		blockDesc.m_autoSeqCompressionModeFlag = 1;
+
+		blockDesc.m_litSectionDesc.m_numValues = state->m_litVector.m_count;
+		blockDesc.m_litSectionDesc.m_decompressedLiteralsStream = &litStream;
+		blockDesc.m_seqSectionDesc.m_numSequences = (uint32_t)seqState.m_numRemaining;
+		blockDesc.m_seqCollection.m_getNextSequence = FuzzSeqCollection_GetNextSequence;
+		blockDesc.m_seqCollection.m_userdata = &seqState;
+		break;
+
+	default:
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+	}
+
+	return zstdhl_AssembleBlockWithContext(state->m_asmContext, &blockDesc, state->m_asmOutput);
+}
+
+static zstdhl_ResultCode_t FuzzDecode_FinishBlock(FuzzDecodeState_t *state)
+{
+	// The block's content has already been written.  The assembler only accepts blocks within the format limit,
+	// but the disassembler doesn't enforce it.
+	if (state->m_contentVector.m_count - state->m_blockStart > state->m_maxBlockSize)
+		state->m_oversizedBlockFlag = 1;
+
+	if (state->m_asmContext != NULL && state->m_asmResult == ZSTDHL_RESULT_OK && !state->m_oversizedBlockFlag)
+		state->m_asmResult = FuzzDecode_ReassembleBlock(state);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzDecode_ReportElement(void *userdata, int elementType, const void *elementData)
+{
+	FuzzDecodeState_t *state = (FuzzDecodeState_t *)userdata;
+
+	switch (elementType)
+	{
+	case ZSTDHL_ELEMENT_TYPE_FRAME_HEADER:
+		{
+			const zstdhl_FrameHeaderDesc_t *frameHeader = (const zstdhl_FrameHeaderDesc_t *)elementData;
+			uint64_t windowSize = frameHeader->m_haveWindowSize ? frameHeader->m_windowSize : frameHeader->m_frameContentSize;
+
+			// Blocks can't be larger than the window
+			if (windowSize < state->m_maxBlockSize)
+				state->m_maxBlockSize = windowSize;
+
+			if (state->m_asmContext != NULL)
+				state->m_asmResult = zstdhl_AssembleFrameWithContext(state->m_asmContext, frameHeader, state->m_asmOutput);
+		}
+		break;
+
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_HEADER:
+		state->m_blockHeader = *(const zstdhl_BlockHeaderDesc_t *)elementData;
+		state->m_blockStart = state->m_contentVector.m_count;
+		state->m_numBlocks++;
+		zstdhl_Vector_Clear(&state->m_litVector);
+		zstdhl_Vector_Clear(&state->m_seqVector);
+		break;
+
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION_HEADER:
+		state->m_litSectionHeader = *(const zstdhl_LiteralsSectionHeader_t *)elementData;
+		break;
+
+	case ZSTDHL_ELEMENT_TYPE_LITERALS_SECTION:
+		if (state->m_asmContext != NULL)
+			return FuzzDecode_AddLiteralsSection(state, (const zstdhl_LiteralsSectionDesc_t *)elementData);
+		break;
+
+	case ZSTDHL_ELEMENT_TYPE_SEQUENCE:
+		if (state->m_asmContext != NULL)
+			return FuzzDecode_AddSequence(state, (const zstdhl_SequenceDesc_t *)elementData);
+		break;
+
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_RLE_DATA:
+		state->m_rleByte = ((const zstdhl_BlockRLEDesc_t *)elementData)->m_value;
+		break;
+
+	case ZSTDHL_ELEMENT_TYPE_BLOCK_END:
+		return FuzzDecode_FinishBlock(state);
+
+	default:
+		break;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzDecodeFrame(FuzzDecodeState_t *state, const void *data, size_t size, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	zstdhl_DisassemblyOutputObject_t disasmOutput;
+	zstdhl_EncoderOutputObject_t contentOutput;
+	zstdhl_DecodeLimits_t limits;
+
+	// Offsets wider than 32 bits can't be in range of any content this can hold
+	limits.m_maxWindowSize = 0;
+	limits.m_maxOffsetBits = 32;
+	limits.m_maxSequencesPerBlock = 0;
+	limits.m_maxMemory = 0;
+
+	zstdhl_MemBufferStreamSource_Init(&memSource, data, size);
+	streamSource.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	streamSource.m_userdata = &memSource;
+
+	disasmOutput.m_reportDisassembledElementFunc = FuzzDecode_ReportElement;
+	disasmOutput.m_userdata = state;
+
+	contentOutput.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	contentOutput.m_userdata = &state->m_contentVector;
+
+	return zstdhl_DisassembleWithOptions(&streamSource, NULL, &limits, ZSTDHL_DISASSEMBLE_FLAG_VERIFY_CHECKSUM, NULL, &contentOutput, &disasmOutput, alloc);
+}
+
+static zstdhl_ResultCode_t FuzzInflate_GetBits(FuzzInflateState_t *state, uint8_t numBits, uint32_t *outValue)
+{
+	while (state->m_numBits < numBits)
+	{
+		if (state->m_pos == state->m_size)
+			return ZSTDHL_RESULT_INPUT_FAILED;
+
+		state->m_bitBuffer |= (uint32_t)state->m_data[state->m_pos++] << state->m_numBits;
+		state->m_numBits += 8;
+	}
+
+	*outValue = state->m_bitBuffer & ((1u << numBits) - 1u);
+	state->m_bitBuffer >>= numBits;
+	state->m_numBits -= numBits;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Incomplete codes are only accepted if allowIncomplete is set and the code has at most one symbol
+static zstdhl_ResultCode_t FuzzInflate_BuildHuffman(FuzzInflateHuffman_t *huff, const uint8_t *lengths, uint16_t numSymbols, int allowIncomplete)
+{
+	uint16_t offsets[FUZZ_INFLATE_MAX_CODE_LENGTH + 1];
+	int32_t codesRemaining = 1;
+	uint16_t sym = 0;
+	uint8_t len = 0;
+
+	for (len = 0; len <= FUZZ_INFLATE_MAX_CODE_LENGTH; len++)
+		huff->m_counts[len] = 0;
+
+	for (sym = 0; sym < numSymbols; sym++)
+		huff->m_counts[lengths[sym]]++;
+
+	// No codes at all is allowed, but nothing can be decoded with it
+	if (huff->m_counts[0] == numSymbols)
+		return ZSTDHL_RESULT_OK;
+
+	for (len = 1; len <= FUZZ_INFLATE_MAX_CODE_LENGTH; len++)
+	{
+		codesRemaining = codesRemaining * 2 - huff->m_counts[len];
+		if (codesRemaining < 0)
+			return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+	}
+
+	if (codesRemaining > 0 && !(allowIncomplete && huff->m_counts[0] + huff->m_counts[1] == numSymbols))
+		return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+
+	offsets[1] = 0;
+	for (len = 1; len < FUZZ_INFLATE_MAX_CODE_LENGTH; len++)
+		offsets[len + 1] = offsets[len] + huff->m_counts[len];
+
+	for (sym = 0; sym < numSymbols; sym++)
+	{
+		if (lengths[sym] != 0)
+			huff->m_symbols[offsets[lengths[sym]]++] = sym;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzInflate_DecodeSymbol(FuzzInflateState_t *state, const FuzzInflateHuffman_t *huff, uint16_t *outSymbol)
+{
+	int32_t code = 0;
+	int32_t first = 0;
+	int32_t index = 0;
+	uint8_t len = 0;
+
+	for (len = 1; len <= FUZZ_INFLATE_MAX_CODE_LENGTH; len++)
+	{
+		uint32_t bit = 0;
+		int32_t count = huff->m_counts[len];
+
+		FUZZ_CHECKED(FuzzInflate_GetBits(state, 1, &bit));
+
+		code |= (int32_t)bit;
+		if (code - count < first)
+		{
+			*outSymbol = huff->m_symbols[index + (code - first)];
+			return ZSTDHL_RESULT_OK;
+		}
+
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+
+	return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+}
+
+static zstdhl_ResultCode_t FuzzInflate_DecodeStoredBlock(FuzzInflateState_t *state)
+{
+	const uint8_t *header = state->m_data + state->m_pos;
+	uint16_t length = 0;
+
+	// Stored blocks start on a byte boundary
+	state->m_bitBuffer = 0;
+	state->m_numBits = 0;
+
+	if (state->m_size - state->m_pos < 4)
+		return ZSTDHL_RESULT_INPUT_FAILED;
+
+	length = (uint16_t)(header[0] | (header[1] << 8));
+	if ((length ^ (uint16_t)(header[2] | (header[3] << 8))) != 0xffffu)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	state->m_pos += 4;
+
+	if (state->m_size - state->m_pos < length)
+		return ZSTDHL_RESULT_INPUT_FAILED;
+
+	FUZZ_CHECKED(zstdhl_Vector_Append(state->m_output, state->m_data + state->m_pos, length));
+	state->m_pos += length;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzInflate_DecodeCodes(FuzzInflateState_t *state, const FuzzInflateHuffman_t *litLengthHuff, const FuzzInflateHuffman_t *distHuff)
+{
+	for (;;)
+	{
+		uint16_t sym = 0;
+		uint32_t extra = 0;
+		uint32_t length = 0;
+		uint32_t dist = 0;
+		const uint8_t *src = NULL;
+		uint8_t *dest = NULL;
+		uint32_t i = 0;
+
+		FUZZ_CHECKED(FuzzInflate_DecodeSymbol(state, litLengthHuff, &sym));
+
+		if (sym < 256)
+		{
+			uint8_t lit = (uint8_t)sym;
+
+			FUZZ_CHECKED(zstdhl_Vector_Append(state->m_output, &lit, 1));
+			continue;
+		}
+
+		if (sym == 256)
+			return ZSTDHL_RESULT_OK;
+
+		sym -= 257;
+		if (sym >= sizeof(g_inflateLengthBases) / sizeof(g_inflateLengthBases[0]))
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		FUZZ_CHECKED(FuzzInflate_GetBits(state, g_inflateLengthExtraBits[sym], &extra));
+		length = g_inflateLengthBases[sym] + extra;
+
+		FUZZ_CHECKED(FuzzInflate_DecodeSymbol(state, distHuff, &sym));
+		if (sym >= FUZZ_INFLATE_MAX_DIST_CODES)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		FUZZ_CHECKED(FuzzInflate_GetBits(state, g_inflateDistExtraBits[sym], &extra));
+		dist = g_inflateDistBases[sym] + extra;
+
+		if (dist > state->m_output->m_count)
+			return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
+
+		FUZZ_CHECKED(zstdhl_Vector_Append(state->m_output, NULL, length));
+
+		dest = ((uint8_t *)state->m_output->m_dataEnd) - length;
+		src = dest - dist;
+		for (i = 0; i < length; i++)
+			dest[i] = src[i];
+	}
+}
+
+static zstdhl_ResultCode_t FuzzInflate_DecodeFixedBlock(FuzzInflateState_t *state)
+{
+	FuzzInflateHuffman_t litLengthHuff;
+	FuzzInflateHuffman_t distHuff;
+	uint8_t lengths[FUZZ_INFLATE_MAX_LIT_LENGTH_CODES + 2];
+	uint16_t sym = 0;
+
+	for (sym = 0; sym < FUZZ_INFLATE_MAX_LIT_LENGTH_CODES + 2; sym++)
+	{
+		if (sym < 144)
+			lengths[sym] = 8;
+		else if (sym < 256)
+			lengths[sym] = 9;
+		else if (sym < 280)
+			lengths[sym] = 7;
+		else
+			lengths[sym] = 8;
+	}
+
+	FUZZ_CHECKED(FuzzInflate_BuildHuffman(&litLengthHuff, lengths, FUZZ_INFLATE_MAX_LIT_LENGTH_CODES + 2, 0));
+
+	for (sym = 0; sym < FUZZ_INFLATE_MAX_DIST_CODES + 2; sym++)
+		lengths[sym] = 5;
+
+	FUZZ_CHECKED(FuzzInflate_BuildHuffman(&distHuff, lengths, FUZZ_INFLATE_MAX_DIST_CODES + 2, 0));
+
+	return FuzzInflate_DecodeCodes(state, &litLengthHuff, &distHuff);
+}
+
+static zstdhl_ResultCode_t FuzzInflate_DecodeDynamicBlock(FuzzInflateState_t *state)
+{
+	FuzzInflateHuffman_t codeLengthHuff;
+	FuzzInflateHuffman_t litLengthHuff;
+	FuzzInflateHuffman_t distHuff;
+	uint8_t lengths[FUZZ_INFLATE_MAX_LIT_LENGTH_CODES + FUZZ_INFLATE_MAX_DIST_CODES];
+	uint32_t numLitLengthCodes = 0;
+	uint32_t numDistCodes = 0;
+	uint32_t numCodeLengthCodes = 0;
+	uint32_t value = 0;
+	uint32_t i = 0;
+
+	FUZZ_CHECKED(FuzzInflate_GetBits(state, 5, &numLitLengthCodes));
+	FUZZ_CHECKED(FuzzInflate_GetBits(state, 5, &numDistCodes));
+	FUZZ_CHECKED(FuzzInflate_GetBits(state, 4, &numCodeLengthCodes));
+
+	numLitLengthCodes += 257;
+	numDistCodes += 1;
+	numCodeLengthCodes += 4;
+
+	if (numLitLengthCodes > FUZZ_INFLATE_MAX_LIT_LENGTH_CODES || numDistCodes > FUZZ_INFLATE_MAX_DIST_CODES)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	for (i = 0; i < sizeof(g_inflateCodeLengthOrder); i++)
+		lengths[g_inflateCodeLengthOrder[i]] = 0;
+
+	for (i = 0; i < numCodeLengthCodes; i++)
+	{
+		FUZZ_CHECKED(FuzzInflate_GetBits(state, 3, &value));
+		lengths[g_inflateCodeLengthOrder[i]] = (uint8_t)value;
+	}
+
+	FUZZ_CHECKED(FuzzInflate_BuildHuffman(&codeLengthHuff, lengths, sizeof(g_inflateCodeLengthOrder), 0));
+
+	i = 0;
+	while (i < numLitLengthCodes + numDistCodes)
+	{
+		uint16_t sym = 0;
+		uint8_t repeatLength = 0;
+		uint32_t repeatCount = 0;
+
+		FUZZ_CHECKED(FuzzInflate_DecodeSymbol(state, &codeLengthHuff, &sym));
+
+		if (sym < 16)
+		{
+			lengths[i++] = (uint8_t)sym;
+			continue;
+		}
+
+		if (sym == 16)
+		{
+			if (i == 0)
+				return ZSTDHL_RESULT_INVALID_VALUE;
+
+			repeatLength = lengths[i - 1];
+			FUZZ_CHECKED(FuzzInflate_GetBits(state, 2, &repeatCount));
+			repeatCount += 3;
+		}
+		else if (sym == 17)
+		{
+			FUZZ_CHECKED(FuzzInflate_GetBits(state, 3, &repeatCount));
+			repeatCount += 3;
+		}
+		else
+		{
+			FUZZ_CHECKED(FuzzInflate_GetBits(state, 7, &repeatCount));
+			repeatCount += 11;
+		}
+
+		if (repeatCount > numLitLengthCodes + numDistCodes - i)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+
+		while (repeatCount-- > 0)
+			lengths[i++] = repeatLength;
+	}
+
+	// The end of block code is required
+	if (lengths[256] == 0)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	FUZZ_CHECKED(FuzzInflate_BuildHuffman(&litLengthHuff, lengths, (uint16_t)numLitLengthCodes, 1));
+	FUZZ_CHECKED(FuzzInflate_BuildHuffman(&distHuff, lengths + numLitLengthCodes, (uint16_t)numDistCodes, 1));
+
+	return FuzzInflate_DecodeCodes(state, &litLengthHuff, &distHuff);
+}
+
+// Decodes a raw deflate stream.  Data after the final block is ignored.
+static zstdhl_ResultCode_t FuzzInflate(const uint8_t *data, size_t size, zstdhl_Vector_t *output)
+{
+	FuzzInflateState_t state;
+	uint32_t isFinalBlock = 0;
+	uint32_t blockType = 0;
+
+	state.m_data = data;
+	state.m_size = size;
+	state.m_pos = 0;
+	state.m_bitBuffer = 0;
+	state.m_numBits = 0;
+	state.m_output = output;
+
+	while (!isFinalBlock)
+	{
+		FUZZ_CHECKED(FuzzInflate_GetBits(&state, 1, &isFinalBlock));
+		FUZZ_CHECKED(FuzzInflate_GetBits(&state, 2, &blockType));
+
+		switch (blockType)
+		{
+		case 0:
+			FUZZ_CHECKED(FuzzInflate_DecodeStoredBlock(&state));
+			break;
+		case 1:
+			FUZZ_CHECKED(FuzzInflate_DecodeFixedBlock(&state));
+			break;
+		case 2:
+			FUZZ_CHECKED(FuzzInflate_DecodeDynamicBlock(&state));
+			break;
+		default:
+			return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
+		}
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_Sync(FuzzGstdDecoder_t *dec, FuzzGstdBitstream_t *stream, uint8_t numBits)
+{
+	while (stream->m_numBits < numBits)
+	{
+		const uint8_t *word = dec->m_data + dec->m_pos;
+
+		if (dec->m_size - dec->m_pos < FUZZ_GSTD_WORD_SIZE)
+			return ZSTDHL_RESULT_FORWARD_BITSTREAM_TRUNCATED;
+
+		stream->m_bits |= (uint64_t)(word[0] | (word[1] << 8) | (word[2] << 16) | ((uint32_t)word[3] << 24)) << stream->m_numBits;
+		stream->m_numBits += 32;
+		dec->m_pos += FUZZ_GSTD_WORD_SIZE;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_SyncLanes(FuzzGstdDecoder_t *dec, uint8_t numBits, size_t numLanes)
+{
+	size_t i = 0;
+
+	for (i = 0; i < numLanes; i++)
+		FUZZ_CHECKED(FuzzGstd_Sync(dec, dec->m_laneStreams + i, numBits));
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_GetBits(FuzzGstdBitstream_t *stream, uint8_t numBits, uint32_t *outValue)
+{
+	if (numBits > stream->m_numBits)
+		return ZSTDHL_RESULT_NOT_ENOUGH_BITS;
+
+	*outValue = (uint32_t)(stream->m_bits & ((1ull << numBits) - 1u));
+	stream->m_bits >>= numBits;
+	stream->m_numBits -= numBits;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_ReadPackedSize(FuzzGstdDecoder_t *dec, uint32_t *outSize)
+{
+	FuzzGstdBitstream_t *stream = &dec->m_rawStream;
+	uint32_t value = 0;
+
+	FUZZ_CHECKED(FuzzGstd_Sync(dec, stream, 8));
+
+	if ((stream->m_bits & 1u) == 0)
+	{
+		FUZZ_CHECKED(FuzzGstd_GetBits(stream, 8, &value));
+		*outSize = (value >> 1);
+	}
+	else if ((stream->m_bits & 2u) == 0)
+	{
+		FUZZ_CHECKED(FuzzGstd_Sync(dec, stream, 16));
+		FUZZ_CHECKED(FuzzGstd_GetBits(stream, 16, &value));
+		*outSize = (value >> 2) + 128u;
+	}
+	else
+	{
+		FUZZ_CHECKED(FuzzGstd_Sync(dec, stream, 24));
+		FUZZ_CHECKED(FuzzGstd_GetBits(stream, 24, &value));
+		*outSize = (value >> 2) + 128u + 16384u;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_BuildTable(FuzzGstdTable_t *table, uint8_t accuracyLog, uint32_t numProbs)
+{
+	uint32_t numCells = (1u << accuracyLog);
+	uint32_t baseline = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+
+	for (i = 0; i < numProbs; i++)
+	{
+		uint32_t prob = table->m_probs[i];
+
+		if (prob > numCells - baseline)
+			return ZSTDHL_RESULT_FSE_TABLE_INVALID;
+
+		table->m_baselines[i] = baseline;
+		for (j = 0; j < prob; j++)
+			table->m_cellSymbols[baseline + j] = (uint8_t)i;
+
+		baseline += prob;
+	}
+
+	if (baseline != numCells)
+		return ZSTDHL_RESULT_FSE_TABLE_INVALID;
+
+	table->m_accuracyLog = accuracyLog;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_LoadDefaultTable(FuzzGstdTable_t *table, const zstdhl_SubstreamCompressionStructureDef_t *sdef)
+{
+	uint32_t i = 0;
+
+	for (i = 0; i < sdef->m_numProbs; i++)
+	{
+		uint32_t prob = sdef->m_defaultProbs[i];
+
+		table->m_probs[i] = (prob == zstdhl_GetLessThanOneConstant()) ? 1u : prob;
+	}
+
+	return FuzzGstd_BuildTable(table, sdef->m_defaultAccuracyLog, sdef->m_numProbs);
+}
+
+// Probabilities are spread over all lanes.  A zero probability is followed by a count of additional zeros.
+static zstdhl_ResultCode_t FuzzGstd_ReadTable(FuzzGstdDecoder_t *dec, FuzzGstdTable_t *table, uint8_t accuracyLog, uint8_t maxAccuracyLog, uint32_t maxSymbols)
+{
+	uint32_t probSpaceRemaining = (1u << accuracyLog);
+	uint32_t numProbs = 0;
+	size_t laneIndex = 0;
+
+	if (accuracyLog > maxAccuracyLog)
+		return ZSTDHL_RESULT_ACCURACY_LOG_TOO_LARGE;
+
+	while (probSpaceRemaining > 0)
+	{
+		FuzzGstdBitstream_t *stream = dec->m_laneStreams + laneIndex;
+		uint32_t prob = 0;
+		uint32_t repeatCount = 0;
+
+		if (laneIndex == 0)
+			FUZZ_CHECKED(FuzzGstd_SyncLanes(dec, maxAccuracyLog + 1 + GSTD_ZERO_PROB_REPEAT_BITS, FUZZ_GSTD_NUM_LANES));
+
+		FUZZ_CHECKED(FuzzGstd_GetBits(stream, FuzzLog2(probSpaceRemaining) + 1, &prob));
+
+		if (prob > probSpaceRemaining)
+			return ZSTDHL_RESULT_FSE_TABLE_INVALID;
+
+		if (prob == 0)
+			FUZZ_CHECKED(FuzzGstd_GetBits(stream, GSTD_ZERO_PROB_REPEAT_BITS, &repeatCount));
+
+		if (repeatCount + 1u > maxSymbols - numProbs)
+			return ZSTDHL_RESULT_TOO_MANY_PROBS;
+
+		table->m_probs[numProbs++] = prob;
+		for (; repeatCount > 0; repeatCount--)
+			table->m_probs[numProbs++] = 0;
+
+		probSpaceRemaining -= prob;
+		laneIndex = (laneIndex + 1) % FUZZ_GSTD_NUM_LANES;
+	}
+
+	return FuzzGstd_BuildTable(table, accuracyLog, numProbs);
+}
+
+// Refills lane states to full precision.  Every rANS value is preceded by a refill.
+static zstdhl_ResultCode_t FuzzGstd_RefillStates(FuzzGstdDecoder_t *dec, size_t numLanes)
+{
+	size_t i = 0;
+
+	for (i = 0; i < numLanes; i++)
+	{
+		uint32_t state = dec->m_laneStates[i];
+		uint8_t numRefillBits = 0;
+		uint32_t refillBits = 0;
+
+		if (state == 0 || FuzzLog2(state) > GSTD_RANS_PRECISION_BITS)
+			return ZSTDHL_RESULT_FSE_TABLE_INVALID;
+
+		numRefillBits = GSTD_RANS_PRECISION_BITS - FuzzLog2(state);
+		FUZZ_CHECKED(FuzzGstd_GetBits(dec->m_laneStreams + i, numRefillBits, &refillBits));
+
+		dec->m_laneStates[i] = (uint16_t)((state << numRefillBits) | refillBits);
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static void FuzzGstd_DecodeRANSValue(FuzzGstdDecoder_t *dec, size_t laneIndex, const FuzzGstdTable_t *table, uint32_t *outValue)
+{
+	uint32_t state = dec->m_laneStates[laneIndex];
+	uint32_t maskedState = state & ((1u << table->m_accuracyLog) - 1u);
+	uint8_t sym = table->m_cellSymbols[maskedState];
+
+	dec->m_laneStates[laneIndex] = (uint16_t)((state >> table->m_accuracyLog) * table->m_probs[sym] + maskedState - table->m_baselines[sym]);
+	*outValue = sym;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_BuildHuffmanLookup(FuzzGstdDecoder_t *dec, const zstdhl_HuffmanTreePartialWeightDesc_t *partialDesc)
+{
+	zstdhl_HuffmanTreeWeightDesc_t weightDesc;
+	uint32_t weightTotal = 0;
+	uint32_t code = 0;
+	uint32_t sym = 0;
+	uint32_t i = 0;
+	uint8_t maxBits = 0;
+	uint8_t numBits = 0;
+
+	FUZZ_CHECKED(zstdhl_ExpandHuffmanWeightTable(partialDesc, &weightDesc));
+
+	for (sym = 0; sym < 256; sym++)
+	{
+		uint8_t weight = weightDesc.m_weights[sym];
+
+		if (weight > GSTD_MAX_HUFFMAN_CODE_LENGTH)
+			return ZSTDHL_RESULT_HUFFMAN_CODE_TOO_LONG;
+
+		if (weight > 0)
+			weightTotal += (1u << (weight - 1));
+	}
+
+	maxBits = FuzzLog2(weightTotal);
+	if (maxBits == 0 || maxBits > GSTD_MAX_HUFFMAN_CODE_LENGTH || weightTotal != (1u << maxBits))
+		return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+
+	for (i = 0; i < FUZZ_GSTD_HUFFMAN_LOOKUP_SIZE; i++)
+		dec->m_huffmanLookup[i] = 0;
+
+	// Canonical codes, longest first, sent first bit first
+	for (numBits = maxBits; numBits > 0; numBits--)
+	{
+		for (sym = 0; sym < 256; sym++)
+		{
+			uint32_t reversedCode = 0;
+
+			if (weightDesc.m_weights[sym] != maxBits + 1 - numBits)
+				continue;
+
+			for (i = 0; i < numBits; i++)
+				reversedCode |= ((code >> i) & 1u) << (numBits - 1 - i);
+
+			for (i = reversedCode; i < FUZZ_GSTD_HUFFMAN_LOOKUP_SIZE; i += (1u << numBits))
+				dec->m_huffmanLookup[i] = (uint16_t)(sym | (numBits << 8));
+
+			code++;
+		}
+
+		code >>= 1;
+	}
+
+	dec->m_haveHuffmanTable = 1;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_ReadHuffmanTree(FuzzGstdDecoder_t *dec, uint32_t auxBit)
+{
+	FuzzGstdBitstream_t *rawStream = &dec->m_rawStream;
+	zstdhl_HuffmanTreePartialWeightDesc_t partialDesc;
+	uint32_t numWeights = 0;
+	uint32_t value = 0;
+	uint32_t i = 0;
+
+	FUZZ_CHECKED(FuzzGstd_Sync(dec, rawStream, 8));
+	FUZZ_CHECKED(FuzzGstd_GetBits(rawStream, 8, &numWeights));
+
+	if (numWeights == 0)
+	{
+		// Uncompressed weights, 4 bits each
+		FUZZ_CHECKED(FuzzGstd_Sync(dec, rawStream, 8));
+		FUZZ_CHECKED(FuzzGstd_GetBits(rawStream, 8, &numWeights));
+
+		for (i = 0; i < numWeights; i++)
+		{
+			if ((i & 1) == 0)
+				FUZZ_CHECKED(FuzzGstd_Sync(dec, rawStream, 8));
+
+			FUZZ_CHECKED(FuzzGstd_GetBits(rawStream, 4, &value));
+			partialDesc.m_specifiedWeights[i] = (uint8_t)value;
+		}
+
+		if (numWeights & 1)
+			FUZZ_CHECKED(FuzzGstd_GetBits(rawStream, 4, &value));
+	}
+	else
+	{
+		FUZZ_CHECKED(FuzzGstd_ReadTable(dec, &dec->m_huffWeightTable, GSTD_MIN_ACCURACY_LOG + auxBit, GSTD_MAX_HUFFMAN_WEIGHT_ACCURACY_LOG, GSTD_MAX_HUFFMAN_WEIGHT + 1));
+
+		for (i = 0; i < numWeights; i++)
+		{
+			size_t laneIndex = i % FUZZ_GSTD_NUM_LANES;
+
+			if (laneIndex == 0)
+			{
+				size_t numLanes = numWeights - i;
+				if (numLanes > FUZZ_GSTD_NUM_LANES)
+					numLanes = FUZZ_GSTD_NUM_LANES;
+
+				FUZZ_CHECKED(FuzzGstd_SyncLanes(dec, GSTD_RANS_PRECISION_BITS, numLanes));
+				FUZZ_CHECKED(FuzzGstd_RefillStates(dec, numLanes));
+			}
+
+			FuzzGstd_DecodeRANSValue(dec, laneIndex, &dec->m_huffWeightTable, &value);
+			partialDesc.m_specifiedWeights[i] = (uint8_t)value;
+		}
+	}
+
+	if (numWeights == 0)
+		return ZSTDHL_RESULT_HUFFMAN_TABLE_EMPTY;
+
+	partialDesc.m_numSpecifiedWeights = (uint8_t)numWeights;
+
+	return FuzzGstd_BuildHuffmanLookup(dec, &partialDesc);
+}
+
+static zstdhl_ResultCode_t FuzzGstd_DecodeHuffmanLiteral(FuzzGstdDecoder_t *dec, FuzzGstdBitstream_t *stream, uint8_t *outLiteral)
+{
+	uint16_t entry = dec->m_huffmanLookup[stream->m_bits & (FUZZ_GSTD_HUFFMAN_LOOKUP_SIZE - 1)];
+	uint32_t code = 0;
+
+	if ((entry >> 8) == 0)
+		return ZSTDHL_RESULT_HUFFMAN_TABLE_DAMAGED;
+
+	FUZZ_CHECKED(FuzzGstd_GetBits(stream, (uint8_t)(entry >> 8), &code));
+	*outLiteral = (uint8_t)(entry & 0xffu);
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Decodes up to 4 literals per lane, interleaved so each lane's literals are contiguous
+static zstdhl_ResultCode_t FuzzGstd_RefillLiterals(FuzzGstdDecoder_t *dec, size_t numLiterals)
+{
+	size_t numLanes = (numLiterals + 3u) / 4u;
+	uint8_t *lits = NULL;
+	uint32_t value = 0;
+	size_t round = 0;
+	size_t i = 0;
+
+	FUZZ_CHECKED(zstdhl_Vector_Append(&dec->m_litVector, NULL, numLiterals));
+	lits = ((uint8_t *)dec->m_litVector.m_dataEnd) - numLiterals;
+
+	if (dec->m_litSectionType == ZSTDHL_LITERALS_SECTION_TYPE_RAW)
+	{
+		FUZZ_CHECKED(FuzzGstd_SyncLanes(dec, 32, numLanes));
+
+		for (i = 0; i < numLiterals; i++)
+		{
+			FUZZ_CHECKED(FuzzGstd_GetBits(dec->m_laneStreams + i / 4u, 8, &value));
+			lits[i] = (uint8_t)value;
+		}
+
+		return ZSTDHL_RESULT_OK;
+	}
+
+	for (round = 0; round < 4; round++)
+	{
+		for (i = 0; i < numLanes; i++)
+		{
+			size_t litIndex = i * 4u + round;
+
+			if (litIndex >= numLiterals)
+				continue;
+
+			if (round == 0 || round == 2)
+				FUZZ_CHECKED(FuzzGstd_Sync(dec, dec->m_laneStreams + i, GSTD_MAX_HUFFMAN_CODE_LENGTH * 2));
+
+			FUZZ_CHECKED(FuzzGstd_DecodeHuffmanLiteral(dec, dec->m_laneStreams + i, lits + litIndex));
+		}
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Literals are decoded in packets of up to 4 per lane, whenever a sequence needs more literals than are buffered
+static zstdhl_ResultCode_t FuzzGstd_ConsumeLiterals(FuzzGstdDecoder_t *dec, uint32_t numLiterals)
+{
+	size_t maxBufferedLiterals = FUZZ_GSTD_NUM_LANES * 4u;
+
+	while (numLiterals > 0)
+	{
+		size_t literalsBuffered = maxBufferedLiterals - (dec->m_numLiteralsConsumed % maxBufferedLiterals);
+		size_t literalsAvailable = dec->m_numLiterals - dec->m_numLiteralsConsumed;
+
+		if (literalsBuffered == maxBufferedLiterals)
+		{
+			if (literalsBuffered > literalsAvailable)
+				literalsBuffered = literalsAvailable;
+
+			if (literalsBuffered == 0)
+				return ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED;
+
+			FUZZ_CHECKED(FuzzGstd_RefillLiterals(dec, literalsBuffered));
+		}
+		else
+		{
+			if (literalsBuffered > literalsAvailable)
+				literalsBuffered = literalsAvailable;
+
+			if (literalsBuffered == 0)
+				return ZSTDHL_RESULT_LITERALS_SECTION_TRUNCATED;
+		}
+
+		if (literalsBuffered > numLiterals)
+			literalsBuffered = numLiterals;
+
+		numLiterals -= (uint32_t)literalsBuffered;
+		dec->m_numLiteralsConsumed += (uint32_t)literalsBuffered;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Repeated modes keep the current table.  Tables only change in blocks with sequences, which can't be repeated
+// modes if no sequences are present.
+static zstdhl_ResultCode_t FuzzGstd_UpdateTableMode(FuzzGstdTable_t *table, uint32_t mode, const zstdhl_SubstreamCompressionStructureDef_t *sdef)
+{
+	switch (mode)
+	{
+	case ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED:
+		if (table->m_mode != ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED)
+			FUZZ_CHECKED(FuzzGstd_LoadDefaultTable(table, sdef));
+		table->m_mode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+		break;
+	case ZSTDHL_SEQ_COMPRESSION_MODE_RLE:
+	case ZSTDHL_SEQ_COMPRESSION_MODE_FSE:
+		table->m_mode = (zstdhl_SequencesCompressionMode_t)mode;
+		break;
+	default:
+		break;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_DecodeSequencesSection(FuzzGstdDecoder_t *dec, uint32_t controlWord)
+{
+	FuzzGstdTable_t *tables[3] = { &dec->m_litLengthTable, &dec->m_matchLengthTable, &dec->m_offsetTable };
+	uint32_t numSequences = 0;
+	uint32_t sliceBase = 0;
+	uint32_t codes[3][FUZZ_GSTD_NUM_LANES];
+	FuzzGstdSequence_t seqs[FUZZ_GSTD_NUM_LANES];
+	size_t laneIndex = 0;
+	size_t i = 0;
+
+	FUZZ_CHECKED(FuzzGstd_UpdateTableMode(&dec->m_litLengthTable, (controlWord >> GSTD_CONTROL_LIT_LENGTH_MODE_OFFSET) & GSTD_CONTROL_LIT_LENGTH_MODE_MASK, zstdhl_GetDefaultLitLengthFSEProperties()));
+	FUZZ_CHECKED(FuzzGstd_UpdateTableMode(&dec->m_offsetTable, (controlWord >> GSTD_CONTROL_OFFSET_MODE_OFFSET) & GSTD_CONTROL_OFFSET_MODE_MASK, zstdhl_GetDefaultOffsetFSEProperties()));
+	FUZZ_CHECKED(FuzzGstd_UpdateTableMode(&dec->m_matchLengthTable, (controlWord >> GSTD_CONTROL_MATCH_LENGTH_MODE_OFFSET) & GSTD_CONTROL_MATCH_LENGTH_MODE_MASK, zstdhl_GetDefaultMatchLengthFSEProperties()));
+
+	// FSE tables are sent in every block that uses them, including repeats
+	if (dec->m_offsetTable.m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE || dec->m_matchLengthTable.m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE || dec->m_litLengthTable.m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+	{
+		uint32_t accuracyByte = 0;
+
+		FUZZ_CHECKED(FuzzGstd_Sync(dec, &dec->m_rawStream, 8));
+		FUZZ_CHECKED(FuzzGstd_GetBits(&dec->m_rawStream, 8, &accuracyByte));
+
+		if (dec->m_offsetTable.m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+			FUZZ_CHECKED(FuzzGstd_ReadTable(dec, &dec->m_offsetTable, GSTD_MIN_ACCURACY_LOG + ((accuracyByte >> GSTD_ACCURACY_BYTE_OFFSET_POS) & GSTD_ACCURACY_BYTE_OFFSET_MASK), GSTD_MAX_OFFSET_ACCURACY_LOG, GSTD_MAX_OFFSET_CODE + 1));
+
+		if (dec->m_matchLengthTable.m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+			FUZZ_CHECKED(FuzzGstd_ReadTable(dec, &dec->m_matchLengthTable, GSTD_MIN_ACCURACY_LOG + ((accuracyByte >> GSTD_ACCURACY_BYTE_MATCH_LENGTH_POS) & GSTD_ACCURACY_BYTE_MATCH_LENGTH_MASK), GSTD_MAX_MATCH_LENGTH_ACCURACY_LOG, GSTD_MAX_MATCH_LENGTH_CODE + 1));
+
+		if (dec->m_litLengthTable.m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+			FUZZ_CHECKED(FuzzGstd_ReadTable(dec, &dec->m_litLengthTable, GSTD_MIN_ACCURACY_LOG + ((accuracyByte >> GSTD_ACCURACY_BYTE_LIT_LENGTH_POS) & GSTD_ACCURACY_BYTE_LIT_LENGTH_MASK), GSTD_MAX_LIT_LENGTH_ACCURACY_LOG, GSTD_MAX_LIT_LENGTH_CODE + 1));
+	}
+
+	FUZZ_CHECKED(FuzzGstd_ReadPackedSize(dec, &numSequences));
+
+	if (numSequences > 0)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			if (tables[i]->m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_INVALID)
+				return ZSTDHL_RESULT_REUSED_TABLE_WITHOUT_EXISTING_TABLE;
+
+			// The RLE symbol isn't transmitted
+			if (tables[i]->m_mode == ZSTDHL_SEQ_COMPRESSION_MODE_RLE)
+				return ZSTDHL_RESULT_NOT_YET_IMPLEMENTED;
+		}
+	}
+
+	for (sliceBase = 0; sliceBase < numSequences; sliceBase += FUZZ_GSTD_NUM_LANES)
+	{
+		size_t numLanes = numSequences - sliceBase;
+		if (numLanes > FUZZ_GSTD_NUM_LANES)
+			numLanes = FUZZ_GSTD_NUM_LANES;
+
+		FUZZ_CHECKED(FuzzGstd_SyncLanes(dec, GSTD_MAX_ACCURACY_LOG * 2 + GSTD_RANS_PRECISION_BITS, numLanes));
+
+		for (i = 0; i < 3; i++)
+		{
+			FUZZ_CHECKED(FuzzGstd_RefillStates(dec, numLanes));
+
+			for (laneIndex = 0; laneIndex < numLanes; laneIndex++)
+				FuzzGstd_DecodeRANSValue(dec, laneIndex, tables[i], &codes[i][laneIndex]);
+		}
+
+		FUZZ_CHECKED(FuzzGstd_SyncLanes(dec, GSTD_MAX_LIT_LENGTH_EXTRA_BITS + GSTD_MAX_MATCH_LENGTH_EXTRA_BITS, numLanes));
+
+		for (laneIndex = 0; laneIndex < numLanes; laneIndex++)
+		{
+			FuzzGstdBitstream_t *stream = dec->m_laneStreams + laneIndex;
+			uint32_t litLengthCode = codes[0][laneIndex];
+			uint32_t matchLengthCode = codes[1][laneIndex];
+			uint32_t extra = 0;
+
+			FUZZ_CHECKED(FuzzGstd_GetBits(stream, g_gstdLitLengthExtraBits[litLengthCode], &extra));
+			seqs[laneIndex].m_litLength = g_gstdLitLengthBases[litLengthCode] + extra;
+
+			FUZZ_CHECKED(FuzzGstd_GetBits(stream, g_gstdMatchLengthExtraBits[matchLengthCode], &extra));
+			seqs[laneIndex].m_matchLength = g_gstdMatchLengthBases[matchLengthCode] + extra;
+		}
+
+		FUZZ_CHECKED(FuzzGstd_SyncLanes(dec, GSTD_MAX_OFFSET_CODE, numLanes));
+
+		for (laneIndex = 0; laneIndex < numLanes; laneIndex++)
+		{
+			uint32_t offsetCode = codes[2][laneIndex];
+			uint32_t extra = 0;
+
+			FUZZ_CHECKED(FuzzGstd_GetBits(dec->m_laneStreams + laneIndex, (uint8_t)offsetCode, &extra));
+			seqs[laneIndex].m_offsetCode = (1u << offsetCode) + extra;
+		}
+
+		if (dec->m_litSectionType != ZSTDHL_LITERALS_SECTION_TYPE_RLE)
+		{
+			for (laneIndex = 0; laneIndex < numLanes; laneIndex++)
+				FUZZ_CHECKED(FuzzGstd_ConsumeLiterals(dec, seqs[laneIndex].m_litLength));
+		}
+
+		FUZZ_CHECKED(zstdhl_Vector_Append(&dec->m_seqVector, seqs, numLanes));
+	}
+
+	if (dec->m_litSectionType != ZSTDHL_LITERALS_SECTION_TYPE_RLE && dec->m_numLiteralsConsumed < dec->m_numLiterals)
+		FUZZ_CHECKED(FuzzGstd_ConsumeLiterals(dec, dec->m_numLiterals - dec->m_numLiteralsConsumed));
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_ExecuteSequences(FuzzGstdDecoder_t *dec, uint32_t blockSize)
+{
+	const FuzzGstdSequence_t *seqs = (const FuzzGstdSequence_t *)dec->m_seqVector.m_data;
+	const uint8_t *lits = (const uint8_t *)dec->m_litVector.m_data;
+	uint32_t *repeatOffsets = dec->m_repeatOffsets;
+	size_t numLits = dec->m_litVector.m_count;
+	size_t litOffset = 0;
+	size_t blockStart = dec->m_content->m_count;
+	size_t i = 0;
+
+	for (i = 0; i < dec->m_seqVector.m_count; i++)
+	{
+		const FuzzGstdSequence_t *seq = seqs + i;
+		uint32_t offset = 0;
+		const uint8_t *src = NULL;
+		uint8_t *dest = NULL;
+		size_t j = 0;
+
+		if (seq->m_offsetCode > 3)
+		{
+			offset = seq->m_offsetCode - 3;
+			repeatOffsets[2] = repeatOffsets[1];
+			repeatOffsets[1] = repeatOffsets[0];
+			repeatOffsets[0] = offset;
+		}
+		else
+		{
+			uint32_t repeatIndex = seq->m_offsetCode - 1 + (seq->m_litLength == 0 ? 1 : 0);
+
+			if (repeatIndex == 0)
+				offset = repeatOffsets[0];
+			else
+			{
+				offset = (repeatIndex == 3) ? repeatOffsets[0] - 1u : repeatOffsets[repeatIndex];
+
+				if (repeatIndex != 1)
+					repeatOffsets[2] = repeatOffsets[1];
+				repeatOffsets[1] = repeatOffsets[0];
+				repeatOffsets[0] = offset;
+			}
+		}
+
+		if (seq->m_litLength > numLits - litOffset)
+			return ZSTDHL_RESULT_SEQUENCE_LIT_LENGTH_EXCEEDS_LITERALS;
+
+		FUZZ_CHECKED(zstdhl_Vector_Append(dec->m_content, lits + litOffset, seq->m_litLength));
+		litOffset += seq->m_litLength;
+
+		if (offset == 0 || offset > dec->m_content->m_count)
+			return ZSTDHL_RESULT_OFFSET_TOO_LARGE;
+
+		FUZZ_CHECKED(zstdhl_Vector_Append(dec->m_content, NULL, seq->m_matchLength));
+
+		dest = ((uint8_t *)dec->m_content->m_dataEnd) - seq->m_matchLength;
+		src = dest - offset;
+		for (j = 0; j < seq->m_matchLength; j++)
+			dest[j] = src[j];
+	}
+
+	FUZZ_CHECKED(zstdhl_Vector_Append(dec->m_content, lits + litOffset, numLits - litOffset));
+
+	if (dec->m_content->m_count - blockStart != blockSize)
+		return ZSTDHL_RESULT_BLOCK_SIZE_INVALID;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_DecodeCompressedBlock(FuzzGstdDecoder_t *dec, uint32_t controlWord)
+{
+	uint32_t auxBit = (controlWord >> GSTD_CONTROL_AUX_BIT_OFFSET) & GSTD_CONTROL_AUX_BIT_MASK;
+	size_t i = 0;
+
+	for (i = 0; i < FUZZ_GSTD_NUM_LANES; i++)
+		dec->m_laneStates[i] = 1;
+
+	dec->m_litSectionType = (uint8_t)((controlWord >> GSTD_CONTROL_LIT_SECTION_TYPE_OFFSET) & GSTD_CONTROL_LIT_SECTION_TYPE_MASK);
+	dec->m_numLiteralsConsumed = 0;
+	zstdhl_Vector_Clear(&dec->m_litVector);
+	zstdhl_Vector_Clear(&dec->m_seqVector);
+
+	FUZZ_CHECKED(FuzzGstd_ReadPackedSize(dec, &dec->m_numLiterals));
+
+	switch (dec->m_litSectionType)
+	{
+	case ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN:
+		FUZZ_CHECKED(FuzzGstd_ReadHuffmanTree(dec, auxBit));
+		break;
+	case ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN_REUSE:
+		if (!dec->m_haveHuffmanTable)
+			return ZSTDHL_RESULT_HUFFMAN_TABLE_NOT_SET;
+		break;
+	case ZSTDHL_LITERALS_SECTION_TYPE_RLE:
+		{
+			uint32_t value = 0;
+
+			FUZZ_CHECKED(FuzzGstd_Sync(dec, &dec->m_rawStream, 8));
+			FUZZ_CHECKED(FuzzGstd_GetBits(&dec->m_rawStream, 8, &value));
+
+			FUZZ_CHECKED(zstdhl_Vector_Append(&dec->m_litVector, NULL, dec->m_numLiterals));
+			memset(dec->m_litVector.m_data, (int)value, dec->m_numLiterals);
+		}
+		break;
+	default:
+		break;
+	}
+
+	FUZZ_CHECKED(FuzzGstd_DecodeSequencesSection(dec, controlWord));
+
+	return FuzzGstd_ExecuteSequences(dec, (controlWord >> GSTD_CONTROL_DECOMPRESSED_SIZE_OFFSET) & GSTD_CONTROL_DECOMPRESSED_SIZE_MASK);
+}
+
+static zstdhl_ResultCode_t FuzzGstd_DecodeRawBlock(FuzzGstdDecoder_t *dec, uint32_t controlWord)
+{
+	uint32_t blockSize = (controlWord >> GSTD_CONTROL_DECOMPRESSED_SIZE_OFFSET) & GSTD_CONTROL_DECOMPRESSED_SIZE_MASK;
+	uint8_t firstByte = (uint8_t)((controlWord >> GSTD_CONTROL_RAW_FIRST_BYTE_OFFSET) & GSTD_CONTROL_RAW_FIRST_BYTE_MASK);
+	size_t numPaddingBytes = 0;
+	size_t i = 0;
+
+	if (blockSize == 0)
+		return ZSTDHL_RESULT_BLOCK_SIZE_INVALID;
+
+	// The rest of the block follows in the input, padded to a word boundary with at least 1 byte
+	numPaddingBytes = FUZZ_GSTD_WORD_SIZE - ((blockSize - 1u) % FUZZ_GSTD_WORD_SIZE);
+
+	if (dec->m_size - dec->m_pos < blockSize - 1u + numPaddingBytes)
+		return ZSTDHL_RESULT_BLOCK_TRUNCATED;
+
+	FUZZ_CHECKED(zstdhl_Vector_Append(dec->m_content, &firstByte, 1));
+	FUZZ_CHECKED(zstdhl_Vector_Append(dec->m_content, dec->m_data + dec->m_pos, blockSize - 1u));
+	dec->m_pos += blockSize - 1u;
+
+	for (i = 0; i < numPaddingBytes; i++)
+	{
+		if (dec->m_data[dec->m_pos++] != 0)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstd_DecodeFrame(FuzzGstdDecoder_t *dec)
+{
+	FuzzGstdBitstream_t *controlStream = &dec->m_controlStream;
+	uint32_t controlWord = 0;
+	size_t i = 0;
+
+	do
+	{
+		uint32_t blockType = 0;
+		uint32_t blockSize = 0;
+
+		FUZZ_CHECKED(FuzzGstd_Sync(dec, controlStream, 32));
+		FUZZ_CHECKED(FuzzGstd_GetBits(controlStream, 32, &controlWord));
+
+		blockType = (controlWord >> GSTD_CONTROL_BLOCK_TYPE_OFFSET) & GSTD_CONTROL_BLOCK_TYPE_MASK;
+		blockSize = (controlWord >> GSTD_CONTROL_DECOMPRESSED_SIZE_OFFSET) & GSTD_CONTROL_DECOMPRESSED_SIZE_MASK;
+
+		switch (blockType)
+		{
+		case GSTD_BLOCK_TYPE_RAW:
+			FUZZ_CHECKED(FuzzGstd_DecodeRawBlock(dec, controlWord));
+			break;
+		case GSTD_BLOCK_TYPE_RLE:
+			if (blockSize == 0)
+				return ZSTDHL_RESULT_BLOCK_SIZE_INVALID;
+
+			FUZZ_CHECKED(zstdhl_Vector_Append(dec->m_content, NULL, blockSize));
+			memset(((uint8_t *)dec->m_content->m_dataEnd) - blockSize, (int)((controlWord >> GSTD_CONTROL_RAW_FIRST_BYTE_OFFSET) & GSTD_CONTROL_RAW_FIRST_BYTE_MASK), blockSize);
+			break;
+		case GSTD_BLOCK_TYPE_COMPRESSED:
+			FUZZ_CHECKED(FuzzGstd_DecodeCompressedBlock(dec, controlWord));
+			break;
+		default:
+			return ZSTDHL_RESULT_BLOCK_TYPE_INVALID;
+		}
+	} while (controlWord & (1u << GSTD_CONTROL_MORE_BLOCKS_BIT_OFFSET));
+
+	// Every reserved word must have been read, and the unread bits are padding
+	if (dec->m_pos != dec->m_size || dec->m_controlStream.m_bits != 0 || dec->m_rawStream.m_bits != 0)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	for (i = 0; i < FUZZ_GSTD_NUM_LANES; i++)
+	{
+		if (dec->m_laneStreams[i].m_bits != 0)
+			return ZSTDHL_RESULT_INVALID_VALUE;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t FuzzGstdDecode(const uint8_t *data, size_t size, zstdhl_Vector_t *content, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	FuzzGstdDecoder_t *dec = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	size_t i = 0;
+
+	dec = (FuzzGstdDecoder_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(FuzzGstdDecoder_t));
+	if (!dec)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	memset(dec, 0, sizeof(FuzzGstdDecoder_t));
+
+	dec->m_data = data;
+	dec->m_size = size;
+	dec->m_content = content;
+	dec->m_huffWeightTable.m_mode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
+	dec->m_litLengthTable.m_mode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
+	dec->m_matchLengthTable.m_mode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
+	dec->m_offsetTable.m_mode = ZSTDHL_SEQ_COMPRESSION_MODE_INVALID;
+	dec->m_repeatOffsets[0] = 1;
+	dec->m_repeatOffsets[1] = 4;
+	dec->m_repeatOffsets[2] = 8;
+
+	for (i = 0; i < FUZZ_GSTD_NUM_LANES; i++)
+		dec->m_laneStates[i] = 1;
+
+	zstdhl_Vector_Init(&dec->m_litVector, 1, alloc);
+	zstdhl_Vector_Init(&dec->m_seqVector, sizeof(FuzzGstdSequence_t), alloc);
+
+	result = FuzzGstd_DecodeFrame(dec);
+
+	zstdhl_Vector_Destroy(&dec->m_litVector);
+	zstdhl_Vector_Destroy(&dec->m_seqVector);
+	alloc->m_reallocFunc(alloc->m_userdata, dec, 0);
+
+	return result;
+}
+
+static FuzzStageResult_t FuzzStage_Disassemble(const uint8_t *data, size_t size)
+{
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	FuzzDecodeState_t decodeState;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	CreateCappedAlloc("disassemble", &allocTracker, &alloc);
+	FuzzDecodeState_Init(&decodeState, &alloc);
+
+	result = FuzzDecodeFrame(&decodeState, data, size, &alloc);
+
+	FuzzDecodeState_Destroy(&decodeState);
+
+	DestroyCappedAlloc("disassemble", allocTracker, result);
+
+	return (result == ZSTDHL_RESULT_OK) ? FuzzStageResult_OK : FuzzStageResult_Rejected;
+}
+
+static FuzzStageResult_t FuzzStage_RoundTrip(const uint8_t *data, size_t size)
+{
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	FuzzDecodeState_t originalState;
+	FuzzDecodeState_t reassembledState;
+	zstdhl_Vector_t reassembledVector;
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	FuzzStageResult_t stageResult = FuzzStageResult_Rejected;
+
+	CreateCappedAlloc("round_trip", &allocTracker, &alloc);
+	FuzzDecodeState_Init(&originalState, &alloc);
+	FuzzDecodeState_Init(&reassembledState, &alloc);
+	zstdhl_Vector_Init(&reassembledVector, 1, &alloc);
+
+	output.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	output.m_userdata = &reassembledVector;
+
+	result = zstdhl_CreateAssemblerContext(&alloc, &originalState.m_asmContext);
+	if (result == ZSTDHL_RESULT_OK)
+	{
+		originalState.m_asmOutput = &output;
+		result = FuzzDecodeFrame(&originalState, data, size, &alloc);
+	}
+
+	if (result == ZSTDHL_RESULT_OK && !originalState.m_oversizedBlockFlag)
+	{
+		result = originalState.m_asmResult;
+		if (result == ZSTDHL_RESULT_OK)
+			result = zstdhl_AssembleFrameEndWithContext(originalState.m_asmContext, &output);
+
+		if (result != ZSTDHL_RESULT_OK && result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+			FuzzFail("round_trip", "Reassembly failed", result);
+
+		if (result == ZSTDHL_RESULT_OK)
+			result = FuzzDecodeFrame(&reassembledState, reassembledVector.m_data, reassembledVector.m_count, &alloc);
+
+		if (result != ZSTDHL_RESULT_OK && result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+			FuzzFail("round_trip", "Reassembled frame failed to decode", result);
+
+		if (result == ZSTDHL_RESULT_OK)
+		{
+			CompareContent("round_trip", &reassembledState.m_contentVector, &originalState.m_contentVector, 0);
+			stageResult = FuzzStageResult_OK;
+		}
+	}
+
+	if (originalState.m_asmContext != NULL)
+		zstdhl_DestroyAssemblerContext(originalState.m_asmContext);
+
+	zstdhl_Vector_Destroy(&reassembledVector);
+	FuzzDecodeState_Destroy(&reassembledState);
+	FuzzDecodeState_Destroy(&originalState);
+
+	DestroyCappedAlloc("round_trip", allocTracker, result);
+
+	return stageResult;
+}
+
+static void FuzzDeflate_InitStreamSource(zstdhl_MemBufferStreamSource_t *memSource, zstdhl_StreamSourceObject_t *streamSource, const uint8_t *data, size_t size)
+{
+	zstdhl_MemBufferStreamSource_Init(memSource, data, size);
+	streamSource->m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	streamSource->m_userdata = memSource;
+}
+
+static void FuzzDeflate_GetReparseOptions(zstdhl_DeflateConv_ReparseOptions_t *options)
+{
+	options->m_windowSize = FUZZ_DEFLATE_REPARSE_WINDOW_SIZE;
+	options->m_hashLog = FUZZ_DEFLATE_REPARSE_HASH_LOG;
+	options->m_maxChainLength = FUZZ_DEFLATE_REPARSE_MAX_CHAIN_LENGTH;
+}
+
+// Converts the deflate stream that convState reads from into a frame with a single-threaded converter
+static zstdhl_ResultCode_t FuzzDeflate_ConvertSerial(zstdhl_DeflateConv_State_t *convState, uint32_t windowSize, zstdhl_Vector_t *frameVector, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_EncBlockDesc_t blockDesc;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	uint8_t eofFlag = 0;
+
+	output.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	output.m_userdata = frameVector;
+
+	memset(&frameHeader, 0, sizeof(frameHeader));
+	frameHeader.m_windowSize = windowSize;
+	frameHeader.m_haveWindowSize = 1;
+
+	result = zstdhl_CreateAssemblerContext(alloc, &context);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_AssembleFrameWithContext(context, &frameHeader, &output);
+
+	while (result == ZSTDHL_RESULT_OK)
+	{
+		memset(&blockDesc, 0, sizeof(blockDesc));
+
+		result = zstdhl_DeflateConv_Convert(convState, &eofFlag, &blockDesc);
+		if (result != ZSTDHL_RESULT_OK || eofFlag)
+			break;
+
+		result = zstdhl_AssembleBlockWithContext(context, &blockDesc, &output);
+	}
+
+	if (context != NULL)
+		zstdhl_DestroyAssemblerContext(context);
+
+	return result;
+}
+
+// Converts a deflate stream into a frame with zstdhl_DeflateConv_ConvertParallel
+static zstdhl_ResultCode_t FuzzDeflate_ConvertParallel(const uint8_t *data, size_t size, size_t numWorkerThreads, const zstdhl_DeflateConv_ReparseOptions_t *reparseOptions, zstdhl_Vector_t *frameVector, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	output.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	output.m_userdata = frameVector;
+
+	FuzzDeflate_InitStreamSource(&memSource, &streamSource, data, size);
+
+	memset(&frameHeader, 0, sizeof(frameHeader));
+	frameHeader.m_windowSize = (reparseOptions != NULL) ? reparseOptions->m_windowSize : FUZZ_DEFLATE_WINDOW_SIZE;
+	frameHeader.m_haveWindowSize = 1;
+
+	result = zstdhl_CreateAssemblerContext(alloc, &context);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_AssembleFrameWithContext(context, &frameHeader, &output);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_DeflateConv_ConvertParallel(alloc, &streamSource, &output, numWorkerThreads, 0, reparseOptions);
+
+	if (context != NULL)
+		zstdhl_DestroyAssemblerContext(context);
+
+	return result;
+}
+
+// Checks a conversion result against the reference inflater.  Anything that converts must decode to the inflated
+// content without oversized blocks, and the converter and the inflater must accept the same streams.
+static zstdhl_ResultCode_t FuzzDeflate_CheckConversion(const char *stage, const uint8_t *data, size_t size, zstdhl_ResultCode_t result, const zstdhl_Vector_t *frameVector, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_Vector_t inflatedVector;
+	FuzzDecodeState_t decodeState;
+	zstdhl_ResultCode_t inflateResult = ZSTDHL_RESULT_OK;
+
+	zstdhl_Vector_Init(&inflatedVector, 1, alloc);
+	FuzzDecodeState_Init(&decodeState, alloc);
+
+	if (result == ZSTDHL_RESULT_OK)
+	{
+		result = FuzzDecodeFrame(&decodeState, frameVector->m_data, frameVector->m_count, alloc);
+
+		if (result != ZSTDHL_RESULT_OK && result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+			FuzzFail(stage, "Converted frame failed to decode", result);
+
+		if (decodeState.m_oversizedBlockFlag)
+			FuzzFail(stage, "Converted frame has a block larger than the maximum block size", result);
+	}
+
+	if (result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+	{
+		inflateResult = FuzzInflate(data, size, &inflatedVector);
+
+		if (inflateResult == ZSTDHL_RESULT_OUT_OF_MEMORY)
+			result = inflateResult;
+		else if (result == ZSTDHL_RESULT_OK && inflateResult != ZSTDHL_RESULT_OK)
+			FuzzFail(stage, "Converter accepted a stream that the reference inflater rejected", inflateResult);
+		else if (result != ZSTDHL_RESULT_OK && inflateResult == ZSTDHL_RESULT_OK)
+			FuzzFail(stage, "Converter rejected a stream that the reference inflater accepted", result);
+	}
+
+	if (result == ZSTDHL_RESULT_OK)
+		CompareContent(stage, &decodeState.m_contentVector, &inflatedVector, 0);
+
+	FuzzDecodeState_Destroy(&decodeState);
+	zstdhl_Vector_Destroy(&inflatedVector);
+
+	return result;
+}
+
+static FuzzStageResult_t FuzzDeflate_ConvertAndCheck(const char *stage, const uint8_t *data, size_t size, const zstdhl_DeflateConv_ReparseOptions_t *reparseOptions)
+{
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	zstdhl_Vector_t frameVector;
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	zstdhl_DeflateConv_State_t *convState = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	CreateCappedAlloc(stage, &allocTracker, &alloc);
+	zstdhl_Vector_Init(&frameVector, 1, &alloc);
+
+	FuzzDeflate_InitStreamSource(&memSource, &streamSource, data, size);
+
+	result = zstdhl_DeflateConv_CreateState(&alloc, &streamSource, &convState);
+	if (result == ZSTDHL_RESULT_OK && reparseOptions != NULL)
+		result = zstdhl_DeflateConv_EnableReparse(convState, reparseOptions);
+	if (result == ZSTDHL_RESULT_OK)
+		result = FuzzDeflate_ConvertSerial(convState, (reparseOptions != NULL) ? reparseOptions->m_windowSize : FUZZ_DEFLATE_WINDOW_SIZE, &frameVector, &alloc);
+
+	result = FuzzDeflate_CheckConversion(stage, data, size, result, &frameVector, &alloc);
+
+	if (convState != NULL)
+		zstdhl_DeflateConv_DestroyState(convState);
+
+	zstdhl_Vector_Destroy(&frameVector);
+
+	DestroyCappedAlloc(stage, allocTracker, result);
+
+	return (result == ZSTDHL_RESULT_OK) ? FuzzStageResult_OK : FuzzStageResult_Rejected;
+}
+
+static FuzzStageResult_t FuzzStage_DeflateConvert(const uint8_t *data, size_t size)
+{
+	return FuzzDeflate_ConvertAndCheck("deflate_convert", data, size, NULL);
+}
+
+static FuzzStageResult_t FuzzStage_DeflateReparse(const uint8_t *data, size_t size)
+{
+	zstdhl_DeflateConv_ReparseOptions_t reparseOptions;
+
+	FuzzDeflate_GetReparseOptions(&reparseOptions);
+
+	return FuzzDeflate_ConvertAndCheck("deflate_reparse", data, size, &reparseOptions);
+}
+
+static FuzzStageResult_t FuzzStage_DeflateReset(const uint8_t *data, size_t size)
+{
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	zstdhl_Vector_t freshFrameVector;
+	zstdhl_Vector_t reusedFrameVector;
+	zstdhl_MemBufferStreamSource_t freshMemSource;
+	zstdhl_StreamSourceObject_t freshStreamSource;
+	zstdhl_MemBufferStreamSource_t reusedMemSource;
+	zstdhl_StreamSourceObject_t reusedStreamSource;
+	zstdhl_DeflateConv_ReparseOptions_t reparseOptions;
+	zstdhl_DeflateConv_State_t *freshState = NULL;
+	zstdhl_DeflateConv_State_t *reusedState = NULL;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	zstdhl_ResultCode_t reusedResult = ZSTDHL_RESULT_OK;
+
+	CreateCappedAlloc("deflate_reset", &allocTracker, &alloc);
+	zstdhl_Vector_Init(&freshFrameVector, 1, &alloc);
+	zstdhl_Vector_Init(&reusedFrameVector, 1, &alloc);
+
+	FuzzDeflate_GetReparseOptions(&reparseOptions);
+
+	FuzzDeflate_InitStreamSource(&freshMemSource, &freshStreamSource, data, size);
+
+	result = zstdhl_DeflateConv_CreateState(&alloc, &freshStreamSource, &freshState);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_DeflateConv_EnableReparse(freshState, &reparseOptions);
+	if (result == ZSTDHL_RESULT_OK)
+		result = FuzzDeflate_ConvertSerial(freshState, reparseOptions.m_windowSize, &freshFrameVector, &alloc);
+
+	result = FuzzDeflate_CheckConversion("deflate_reset", data, size, result, &freshFrameVector, &alloc);
+
+	// Leave a converter partway through the first half of the stream, usually failed on truncation, then reset it
+	// and convert the whole stream.  It must produce the same frame as a new converter.
+	if (result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+	{
+		FuzzDeflate_InitStreamSource(&reusedMemSource, &reusedStreamSource, data, size / 2u);
+
+		reusedResult = zstdhl_DeflateConv_CreateState(&alloc, &reusedStreamSource, &reusedState);
+		if (reusedResult == ZSTDHL_RESULT_OK)
+			reusedResult = zstdhl_DeflateConv_EnableReparse(reusedState, &reparseOptions);
+		if (reusedResult == ZSTDHL_RESULT_OK)
+		{
+			FuzzDeflate_ConvertSerial(reusedState, reparseOptions.m_windowSize, &reusedFrameVector, &alloc);
+			zstdhl_Vector_Clear(&reusedFrameVector);
+
+			FuzzDeflate_InitStreamSource(&reusedMemSource, &reusedStreamSource, data, size);
+			zstdhl_DeflateConv_ResetState(reusedState, &reusedStreamSource);
+
+			reusedResult = FuzzDeflate_ConvertSerial(reusedState, reparseOptions.m_windowSize, &reusedFrameVector, &alloc);
+		}
+
+		if (reusedResult == ZSTDHL_RESULT_OUT_OF_MEMORY)
+			result = reusedResult;
+		else if (reusedResult != result)
+			FuzzFail("deflate_reset", "Reset converter and new converter returned different results", reusedResult);
+		else if (result == ZSTDHL_RESULT_OK)
+			CompareContent("deflate_reset", &reusedFrameVector, &freshFrameVector, 0);
+	}
+
+	if (freshState != NULL)
+		zstdhl_DeflateConv_DestroyState(freshState);
+
+	if (reusedState != NULL)
+		zstdhl_DeflateConv_DestroyState(reusedState);
+
+	zstdhl_Vector_Destroy(&reusedFrameVector);
+	zstdhl_Vector_Destroy(&freshFrameVector);
+
+	DestroyCappedAlloc("deflate_reset", allocTracker, result);
+
+	return (result == ZSTDHL_RESULT_OK) ? FuzzStageResult_OK : FuzzStageResult_Rejected;
+}
+
+static FuzzStageResult_t FuzzStage_DeflateParallel(const uint8_t *data, size_t size)
+{
+	static const size_t workerCounts[] = { 0, 1, 3 };
+
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	zstdhl_Vector_t inlineFrameVector;
+	zstdhl_Vector_t threadedFrameVector;
+	zstdhl_DeflateConv_ReparseOptions_t reparseOptions;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	int reparse = 0;
+	size_t i = 0;
+
+	CreateCappedAlloc("deflate_parallel", &allocTracker, &alloc);
+	zstdhl_Vector_Init(&inlineFrameVector, 1, &alloc);
+	zstdhl_Vector_Init(&threadedFrameVector, 1, &alloc);
+
+	FuzzDeflate_GetReparseOptions(&reparseOptions);
+
+	for (reparse = 0; reparse < 2 && result == ZSTDHL_RESULT_OK; reparse++)
+	{
+		const zstdhl_DeflateConv_ReparseOptions_t *options = reparse ? &reparseOptions : NULL;
+
+		// Converting on the calling thread is checked against the reference inflater, and worker threads must
+		// produce the same frame
+		zstdhl_Vector_Clear(&inlineFrameVector);
+
+		result = FuzzDeflate_ConvertParallel(data, size, workerCounts[0], options, &inlineFrameVector, &alloc);
+		result = FuzzDeflate_CheckConversion("deflate_parallel", data, size, result, &inlineFrameVector, &alloc);
+
+		for (i = 1; i < sizeof(workerCounts) / sizeof(workerCounts[0]) && result != ZSTDHL_RESULT_OUT_OF_MEMORY; i++)
+		{
+			zstdhl_ResultCode_t threadedResult = ZSTDHL_RESULT_OK;
+
+			zstdhl_Vector_Clear(&threadedFrameVector);
+
+			threadedResult = FuzzDeflate_ConvertParallel(data, size, workerCounts[i], options, &threadedFrameVector, &alloc);
+
+			if (threadedResult == ZSTDHL_RESULT_OUT_OF_MEMORY)
+				result = threadedResult;
+			else if (threadedResult != result)
+				FuzzFail("deflate_parallel", "Worker threads returned a different result than the calling thread", threadedResult);
+			else if (result == ZSTDHL_RESULT_OK)
+				CompareContent("deflate_parallel", &threadedFrameVector, &inlineFrameVector, 0);
+		}
+	}
+
+	zstdhl_Vector_Destroy(&threadedFrameVector);
+	zstdhl_Vector_Destroy(&inlineFrameVector);
+
+	DestroyCappedAlloc("deflate_parallel", allocTracker, result);
+
+	return (result == ZSTDHL_RESULT_OK) ? FuzzStageResult_OK : FuzzStageResult_Rejected;
+}
+
+static FuzzStageResult_t FuzzStage_GstdTranscode(const uint8_t *data, size_t size)
+{
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	zstdhl_Vector_t gstdVector;
+	zstdhl_Vector_t gstdContentVector;
+	zstdhl_EncoderOutputObject_t output;
+	zstdhl_MemBufferStreamSource_t memSource;
+	zstdhl_StreamSourceObject_t streamSource;
+	gstd_EncoderState_t *encState = NULL;
+	FuzzDecodeState_t decodeState;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	FuzzStageResult_t stageResult = FuzzStageResult_Rejected;
+
+	CreateCappedAlloc("gstd_transcode", &allocTracker, &alloc);
+	zstdhl_Vector_Init(&gstdVector, 1, &alloc);
+	zstdhl_Vector_Init(&gstdContentVector, 1, &alloc);
+	FuzzDecodeState_Init(&decodeState, &alloc);
+
+	output.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	output.m_userdata = &gstdVector;
+
+	zstdhl_MemBufferStreamSource_Init(&memSource, data, size);
+	streamSource.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	streamSource.m_userdata = &memSource;
+
+	result = gstd_Encoder_Create(&output, FUZZ_GSTD_NUM_LANES, gstd_ComputeMaxOffsetExtraBits(FUZZ_GSTD_MAX_FRAME_SIZE), 0, &alloc, &encState);
+	if (result == ZSTDHL_RESULT_OK)
+	{
+		result = gstd_Encoder_Transcode(encState, &streamSource, NULL, &alloc);
+		gstd_Encoder_Destroy(encState);
+	}
+
+	// Only frames that decode have content to compare with
+	if (result == ZSTDHL_RESULT_OK)
+		result = FuzzDecodeFrame(&decodeState, data, size, &alloc);
+
+	if (result == ZSTDHL_RESULT_OK)
+	{
+		result = FuzzGstdDecode((const uint8_t *)gstdVector.m_data, gstdVector.m_count, &gstdContentVector, &alloc);
+
+		if (result != ZSTDHL_RESULT_OK && result != ZSTDHL_RESULT_OUT_OF_MEMORY && result != ZSTDHL_RESULT_NOT_YET_IMPLEMENTED)
+			FuzzFail("gstd_transcode", "Transcoded output failed to decode", result);
+
+		if (result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+		{
+			CompareContent("gstd_transcode", &gstdContentVector, &decodeState.m_contentVector, result == ZSTDHL_RESULT_NOT_YET_IMPLEMENTED);
+			result = ZSTDHL_RESULT_OK;
+			stageResult = FuzzStageResult_OK;
+		}
+	}
+
+	FuzzDecodeState_Destroy(&decodeState);
+	zstdhl_Vector_Destroy(&gstdContentVector);
+	zstdhl_Vector_Destroy(&gstdVector);
+
+	DestroyCappedAlloc("gstd_transcode", allocTracker, result);
+
+	return stageResult;
+}
+
+static uint32_t FuzzReadU16(const uint8_t *data)
+{
+	return data[0] | ((uint32_t)data[1] << 8);
+}
+
+static zstdhl_ResultCode_t FuzzSynth_GetNextBlock(void *userdata, uint8_t *outEOFFlag, zstdhl_EncBlockDesc_t *outBlock)
+{
+	return zstdhl_Synth_GenerateBlock((zstdhl_Synth_State_t *)userdata, outEOFFlag, outBlock);
+}
+
+// Assembles the frame again directly into a buffer sized by zstdhl_FrameBound, which must fit it exactly as streamed
+static zstdhl_ResultCode_t FuzzSynth_AssembleToBuffer(const zstdhl_Synth_Params_t *params, const zstdhl_Vector_t *frameVector, size_t numBlocks, const zstdhl_MemoryAllocatorObject_t *alloc)
+{
+	zstdhl_Synth_State_t *synthState = NULL;
+	zstdhl_AssemblerContext_t *context = NULL;
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_EncBlockSourceObject_t blockSource;
+	zstdhl_Vector_t bufferVector;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	size_t frameSize = 0;
+
+	zstdhl_Vector_Init(&bufferVector, 1, alloc);
+
+	result = zstdhl_Synth_CreateState(alloc, params, &synthState);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_CreateAssemblerContext(alloc, &context);
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_Vector_Append(&bufferVector, NULL, zstdhl_FrameBound(params->m_contentSize, numBlocks));
+
+	if (result == ZSTDHL_RESULT_OK)
+	{
+		zstdhl_Synth_GetFrameHeader(synthState, &frameHeader);
+
+		blockSource.m_getNextBlockFunc = FuzzSynth_GetNextBlock;
+		blockSource.m_userdata = synthState;
+
+		result = zstdhl_AssembleFrameToBuffer(context, &frameHeader, &blockSource, bufferVector.m_data, bufferVector.m_count, &frameSize);
+
+		if (result != ZSTDHL_RESULT_OK && result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+			FuzzFail("synth", "Frame didn't assemble into a buffer of zstdhl_FrameBound bytes", result);
+	}
+
+	if (result == ZSTDHL_RESULT_OK && (frameSize != frameVector->m_count || memcmp(bufferVector.m_data, frameVector->m_data, frameSize) != 0))
+		FuzzFail("synth", "Frame assembled into a buffer differs from the streamed frame", result);
+
+	if (context != NULL)
+		zstdhl_DestroyAssemblerContext(context);
+
+	if (synthState != NULL)
+		zstdhl_Synth_DestroyState(synthState);
+
+	zstdhl_Vector_Destroy(&bufferVector);
+
+	return result;
+}
+
+static FuzzStageResult_t FuzzStage_Synth(const uint8_t *data, size_t size)
+{
+	zstdhl_AllocTracker_t *allocTracker = NULL;
+	zstdhl_MemoryAllocatorObject_t alloc;
+	zstdhl_Synth_Params_t params;
+	zstdhl_Vector_t frameVector;
+	zstdhl_EncoderOutputObject_t output;
+	FuzzDecodeState_t decodeState;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+
+	if (size < FUZZ_SYNTH_PARAMS_SIZE)
+		return FuzzStageResult_Rejected;
+
+	// Block sizes are kept small so that blocks often have code streams with only a few distinct codes
+	zstdhl_Synth_InitDefaultParams(&params);
+	params.m_seed = FuzzReadU16(data) | ((uint64_t)FuzzReadU16(data + 2) << 16);
+	params.m_contentSize = 1u + FuzzReadU16(data + 4);
+	params.m_blockSize = 1u + (FuzzReadU16(data + 6) % FUZZ_SYNTH_MAX_BLOCK_SIZE);
+	params.m_literalAlphabetSize = (uint16_t)(1u + data[8]);
+	params.m_sequencesPerBlock = 1u + (data[9] % 64u);
+	params.m_maxLitLength = data[10] % 32u;
+	params.m_minMatchLength = 3u + (data[11] % 8u);
+	params.m_maxMatchLength = params.m_minMatchLength + data[12];
+	params.m_maxOffset = 1u + FuzzReadU16(data + 13);
+	params.m_repeatOffsetPercent = (uint8_t)(data[15] % 101u);
+	params.m_literalsMode = (zstdhl_Synth_LiteralsMode_t)(data[16] % 5u);
+	params.m_seqMode = (zstdhl_Synth_SeqMode_t)(data[17] % 5u);
+
+	CreateCappedAlloc("synth", &allocTracker, &alloc);
+	zstdhl_Vector_Init(&frameVector, 1, &alloc);
+	FuzzDecodeState_Init(&decodeState, &alloc);
+
+	output.m_writeBitstreamFunc = VectorOutput_WriteBitstream;
+	output.m_userdata = &frameVector;
+
+	result = zstdhl_Synth_GenerateFrame(&alloc, &params, &output);
+
+	if (result != ZSTDHL_RESULT_OK && result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+		FuzzFail("synth", "Frame generation failed", result);
+
+	if (result == ZSTDHL_RESULT_OK)
+	{
+		result = FuzzDecodeFrame(&decodeState, frameVector.m_data, frameVector.m_count, &alloc);
+
+		if (result != ZSTDHL_RESULT_OK && result != ZSTDHL_RESULT_OUT_OF_MEMORY)
+			FuzzFail("synth", "Generated frame failed to decode", result);
+
+		if (result == ZSTDHL_RESULT_OK && decodeState.m_contentVector.m_count != params.m_contentSize)
+			FuzzFail("synth", "Generated frame has the wrong content size", result);
+
+		if (decodeState.m_oversizedBlockFlag)
+			FuzzFail("synth", "Generated frame has a block larger than the maximum block size", result);
+	}
+
+	if (result == ZSTDHL_RESULT_OK)
+		result = FuzzSynth_AssembleToBuffer(&params, &frameVector, decodeState.m_numBlocks, &alloc);
+
+	FuzzDecodeState_Destroy(&decodeState);
+	zstdhl_Vector_Destroy(&frameVector);
+
+	DestroyCappedAlloc("synth", allocTracker, result);
+
+	return (result == ZSTDHL_RESULT_OK) ? FuzzStageResult_OK : FuzzStageResult_Rejected;
+}
+
+static const FuzzStageDef_t g_fuzzStages[] =
+{
+	{ "disassemble", FuzzStage_Disassemble },
+	{ "round_trip", FuzzStage_RoundTrip },
+	{ "deflate_convert", FuzzStage_DeflateConvert },
+	{ "deflate_reparse", FuzzStage_DeflateReparse },
+	{ "deflate_reset", FuzzStage_DeflateReset },
+	{ "deflate_parallel", FuzzStage_DeflateParallel },
+	{ "gstd_transcode", FuzzStage_GstdTranscode },
+	{ "synth", FuzzStage_Synth },
+};
+
+#ifdef ZSTDHL_FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	// Disassembly alone is covered by the round trip
+	size_t i = 0;
+
+	for (i = 1; i < sizeof(g_fuzzStages) / sizeof(g_fuzzStages[0]); i++)
+		g_fuzzStages[i].m_func(data, size);
+
+	return 0;
+}
+
+#else
+
+static double GetTimeSeconds(void)
+{
+	struct timespec ts;
+
+	timespec_get(&ts, TIME_UTC);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double ComputeMBPerSec(uint64_t bytes, double seconds)
+{
+	if (seconds <= 0.0)
+		return 0.0;
+
+	return (double)bytes / seconds / (1024.0 * 1024.0);
+}
+
+static int LoadFile(const char *path, uint8_t **outData, size_t *outSize)
+{
+	FILE *f = fopen(path, "rb");
+	uint8_t *data = NULL;
+	long size = 0;
+
+	if (!f)
+		return 0;
+
+	if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0)
+	{
+		fclose(f);
+		return 0;
+	}
+
+	data = (uint8_t *)malloc(size > 0 ? (size_t)size : 1u);
+	if (!data || fread(data, 1, (size_t)size, f) != (size_t)size)
+	{
+		free(data);
+		fclose(f);
+		return 0;
+	}
+
+	fclose(f);
+
+	*outData = data;
+	*outSize = (size_t)size;
+
+	return 1;
+}
+
+static void RunStage(const FuzzStageDef_t *def, const char *path, const uint8_t *data, size_t size, double minTime)
+{
+	size_t iterations = 0;
+	double totalSeconds = 0.0;
+	double bestSeconds = 0.0;
+
+	// The first run also checks for divergences, so rejected inputs are reported and not timed
+	if (def->m_func(data, size) != FuzzStageResult_OK)
+	{
+		printf("%s\t%s\trejected\n", path, def->m_name);
+		return;
+	}
+
+	while (iterations < FUZZ_MIN_ITERATIONS || totalSeconds < minTime)
+	{
+		double startTime = GetTimeSeconds();
+		double elapsed = 0.0;
+
+		def->m_func(data, size);
+		elapsed = GetTimeSeconds() - startTime;
+
+		if (iterations == 0 || elapsed < bestSeconds)
+			bestSeconds = elapsed;
+
+		totalSeconds += elapsed;
+		iterations++;
+	}
+
+	printf("%s\t%s\t%.3f MB/s best\t%.3f MB/s mean\t%u iterations\n", path, def->m_name, ComputeMBPerSec(size, bestSeconds), ComputeMBPerSec((uint64_t)size * iterations, totalSeconds), (unsigned int)iterations);
+}
+
+int main(int argc, const char **argv)
+{
+	const char *filter = NULL;
+	double minTime = FUZZ_DEFAULT_MIN_TIME_MS / 1000.0;
+	int numFiles = 0;
+	int i = 0;
+	size_t stageIndex = 0;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+			minTime = strtod(argv[++i], NULL) / 1000.0;
+		else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+			filter = argv[++i];
+		else if (argv[i][0] == '-')
+		{
+			numFiles = 0;
+			break;
+		}
+		else
+			numFiles++;
+	}
+
+	if (numFiles == 0)
+	{
+		fprintf(stderr, "Usage: zstdhl_fuzz [options] <input files...>\n");
+		fprintf(stderr, "Checks each input and reports throughput of each stage that accepts it\n");
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "    --min-time <ms> - Minimum run time per stage (default %u)\n", (unsigned int)FUZZ_DEFAULT_MIN_TIME_MS);
+		fprintf(stderr, "    --filter <text> - Only runs stages with names containing the text\n");
+		return -1;
+	}
+
+	for (i = 1; i < argc; i++)
+	{
+		uint8_t *data = NULL;
+		size_t size = 0;
+
+		if (!strcmp(argv[i], "--min-time") || !strcmp(argv[i], "--filter"))
+		{
+			i++;
+			continue;
+		}
+
+		if (!LoadFile(argv[i], &data, &size))
+		{
+			fprintf(stderr, "Couldn't read input file %s\n", argv[i]);
+			return -1;
+		}
+
+		for (stageIndex = 0; stageIndex < sizeof(g_fuzzStages) / sizeof(g_fuzzStages[0]); stageIndex++)
+		{
+			const FuzzStageDef_t *def = g_fuzzStages + stageIndex;
+
+			if (filter != NULL && strstr(def->m_name, filter) == NULL)
+				continue;
+
+			RunStage(def, argv[i], data, size, minTime);
+		}
+
+		free(data);
+	}
+
+	return 0;
+}
+
+#endif
@@ -13,8 +13,22 @@ the included LICENSE.txt file.
 
 #include <stdint.h>
 
+#include "zstdhl.h"
+
 int zstdhl_Log2_32(uint32_t value);
 uint32_t zstdhl_ReverseBits32(uint32_t value);
 int zstdhl_IsPowerOf2(uint32_t value);
 
+// Estimates the entropy-coded size in bits of symbols with the given counts, or 0 if fewer than 2 symbols are used
+uint64_t zstdhl_EstimateEntropyBits(const size_t *stats, size_t numStats);
+
+// Selects the smallest literals section type and Huffman stream layout for a block's literals.  prevTree is the
+// tree that can be reused, or NULL if there isn't one.  If a new tree is selected, it is written to outNewTree.
+// The stream mode is ZSTDHL_HUFFMAN_STREAM_MODE_NONE for raw and RLE sections.
+zstdhl_ResultCode_t zstdhl_SelectLiteralsSection(const uint8_t *lits, size_t numLits, const zstdhl_HuffmanTreeDesc_t *prevTree, zstdhl_HuffmanTreeDesc_t *outNewTree, zstdhl_LiteralsSectionType_t *outSectionType, zstdhl_HuffmanStreamMode_t *outStreamMode);
+
+// Allocations from library containers go through this so that tracking allocators can attribute them
+void *zstdhl_ReallocAtSite(const zstdhl_MemoryAllocatorObject_t *alloc, void *ptr, size_t newSize, zstdhl_AllocSite_t site);
+void *zstdhl_AllocTracker_ReallocAtSite(zstdhl_AllocTracker_t *tracker, void *ptr, size_t newSize, zstdhl_AllocSite_t site);
+
 #endif
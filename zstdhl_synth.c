@@ -0,0 +1,694 @@
+/*
+Copyright (c) 2023 Eric Lasota
+
+This software is available under the terms of the MIT license
+or the Apache License, Version 2.0.  For more information, see
+the included LICENSE.txt file.
+*/
+#include "zstdhl.h"
+#include "zstdhl_util.h"
+#include "zstdhl_internal.h"
+
+#define ZSTDHL_SYNTH_MAX_OFFSET						(1 << 28)
+#define ZSTDHL_SYNTH_MAX_LIT_LENGTH					131071
+#define ZSTDHL_SYNTH_MAX_MATCH_LENGTH				131074
+#define ZSTDHL_SYNTH_MIN_WINDOW_SIZE				1024
+
+// Keeps the compressed size of 1-stream Huffman literals under the 10-bit size field limit, including the tree
+#define ZSTDHL_SYNTH_MAX_1_STREAM_LITERALS			640
+#define ZSTDHL_SYNTH_MIN_4_STREAM_LITERALS			16
+
+typedef struct zstdhl_Synth_Sequence
+{
+	uint32_t m_litLength;
+	uint32_t m_matchLength;
+	uint32_t m_offsetValue;
+	zstdhl_OffsetType_t m_offsetType;
+} zstdhl_Synth_Sequence_t;
+
+struct zstdhl_Synth_State
+{
+	zstdhl_MemoryAllocatorObject_t m_memAlloc;
+	zstdhl_Synth_Params_t m_params;
+
+	uint64_t m_rngState;
+	uint64_t m_contentGenerated;
+	uint32_t m_windowSize;
+	uint8_t m_rleLiteral;
+	uint8_t m_haveReuseTables;
+	uint8_t m_emittedLastBlock;
+
+	zstdhl_Vector_t m_literalsVector;
+	zstdhl_Vector_t m_sequencesVector;
+	size_t m_sequenceReadPos;
+	uint32_t m_offsetDWord;
+
+	zstdhl_MemBufferStreamSource_t m_litMemSource;
+	zstdhl_StreamSourceObject_t m_litStream;
+
+	zstdhl_Vector_t m_litLengthProbsVector;
+	zstdhl_Vector_t m_matchLengthProbsVector;
+	zstdhl_Vector_t m_offsetProbsVector;
+
+	zstdhl_FSETableDef_t m_litLengthTable;
+	zstdhl_FSETableDef_t m_matchLengthTable;
+	zstdhl_FSETableDef_t m_offsetTable;
+
+	size_t m_litLengthCounts[ZSTDHL_SEQ_CONST_NUM_LITERAL_LENGTH_CODES];
+	size_t m_matchLengthCounts[ZSTDHL_SEQ_CONST_NUM_MATCH_LENGTH_CODES];
+	size_t m_offsetCounts[ZSTDHL_SEQ_CONST_NUM_OFFSET_CODES];
+	size_t m_literalCounts[256];
+};
+
+static uint32_t zstdhl_Synth_Random(zstdhl_Synth_State_t *state)
+{
+	state->m_rngState = state->m_rngState * 6364136223846793005ull + 1442695040888963407ull;
+	return (uint32_t)(state->m_rngState >> 33);
+}
+
+static uint32_t zstdhl_Synth_RandomRange(zstdhl_Synth_State_t *state, uint32_t minValue, uint32_t maxValue)
+{
+	uint64_t range = (uint64_t)maxValue - minValue + 1u;
+
+	return minValue + (uint32_t)(zstdhl_Synth_Random(state) % range);
+}
+
+// Picks a power-of-2 bucket uniformly, then a value uniformly within it.  minValue must be nonzero.
+static uint32_t zstdhl_Synth_RandomLogUniform(zstdhl_Synth_State_t *state, uint32_t minValue, uint32_t maxValue)
+{
+	int minLog = zstdhl_Log2_32(minValue);
+	int maxLog = zstdhl_Log2_32(maxValue);
+	int bucket = (int)zstdhl_Synth_RandomRange(state, (uint32_t)minLog, (uint32_t)maxLog);
+	uint32_t low = (uint32_t)1 << bucket;
+	uint32_t high = (uint32_t)((((uint64_t)1) << (bucket + 1)) - 1u);
+
+	if (low < minValue)
+		low = minValue;
+	if (high > maxValue)
+		high = maxValue;
+
+	return zstdhl_Synth_RandomRange(state, low, high);
+}
+
+static uint8_t zstdhl_Synth_OffsetValueCode(uint32_t offsetValue)
+{
+	return (uint8_t)zstdhl_Log2_32(offsetValue + 3u);
+}
+
+void zstdhl_Synth_InitDefaultParams(zstdhl_Synth_Params_t *params)
+{
+	params->m_seed = 1;
+	params->m_contentSize = 1024 * 1024;
+	params->m_blockSize = ZSTDHL_MAX_BLOCK_SIZE;
+	params->m_literalAlphabetSize = 64;
+	params->m_sequencesPerBlock = 4096;
+	params->m_maxLitLength = 16;
+	params->m_minMatchLength = 3;
+	params->m_maxMatchLength = 64;
+	params->m_maxOffset = 65536;
+	params->m_repeatOffsetPercent = 10;
+	params->m_literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_AUTO;
+	params->m_seqMode = ZSTDHL_SYNTH_SEQ_MODE_AUTO;
+}
+
+zstdhl_ResultCode_t zstdhl_Synth_CreateState(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_Synth_Params_t *params, zstdhl_Synth_State_t **outState)
+{
+	zstdhl_Synth_State_t *state = NULL;
+	uint32_t windowSize = ZSTDHL_SYNTH_MIN_WINDOW_SIZE;
+
+	if (params->m_blockSize == 0 || params->m_blockSize > ZSTDHL_MAX_BLOCK_SIZE)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (params->m_literalAlphabetSize == 0 || params->m_literalAlphabetSize > 256)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (params->m_maxLitLength > ZSTDHL_SYNTH_MAX_LIT_LENGTH)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (params->m_minMatchLength < 3 || params->m_maxMatchLength < params->m_minMatchLength || params->m_maxMatchLength > ZSTDHL_SYNTH_MAX_MATCH_LENGTH)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	if (params->m_maxOffset == 0 || params->m_maxOffset > ZSTDHL_SYNTH_MAX_OFFSET || params->m_repeatOffsetPercent > 100)
+		return ZSTDHL_RESULT_INVALID_VALUE;
+
+	while (windowSize < params->m_maxOffset || windowSize < params->m_blockSize)
+		windowSize <<= 1;
+
+	state = (zstdhl_Synth_State_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_Synth_State_t));
+	if (!state)
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+
+	state->m_memAlloc.m_reallocFunc = alloc->m_reallocFunc;
+	state->m_memAlloc.m_userdata = alloc->m_userdata;
+	state->m_params = *params;
+
+	state->m_rngState = params->m_seed;
+	state->m_contentGenerated = 0;
+	state->m_windowSize = windowSize;
+	state->m_haveReuseTables = 0;
+	state->m_emittedLastBlock = 0;
+	state->m_rleLiteral = (uint8_t)zstdhl_Synth_RandomRange(state, 0, params->m_literalAlphabetSize - 1u);
+
+	zstdhl_Vector_Init(&state->m_literalsVector, 1, alloc);
+	zstdhl_Vector_Init(&state->m_sequencesVector, sizeof(zstdhl_Synth_Sequence_t), alloc);
+	state->m_sequenceReadPos = 0;
+	state->m_offsetDWord = 0;
+
+	state->m_litStream.m_readBytesFunc = zstdhl_MemBufferStreamSource_ReadBytes;
+	state->m_litStream.m_userdata = &state->m_litMemSource;
+
+	zstdhl_Vector_Init(&state->m_litLengthProbsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&state->m_matchLengthProbsVector, sizeof(uint32_t), alloc);
+	zstdhl_Vector_Init(&state->m_offsetProbsVector, sizeof(uint32_t), alloc);
+
+	*outState = state;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_Synth_GetFrameHeader(const zstdhl_Synth_State_t *state, zstdhl_FrameHeaderDesc_t *outFrameHeader)
+{
+	outFrameHeader->m_windowSize = state->m_windowSize;
+	outFrameHeader->m_frameContentSize = state->m_params.m_contentSize;
+	outFrameHeader->m_dictionaryID = 0;
+	outFrameHeader->m_haveDictionaryID = 0;
+	outFrameHeader->m_haveContentChecksum = 0;
+	outFrameHeader->m_haveFrameContentSize = 1;
+	outFrameHeader->m_haveWindowSize = 1;
+	outFrameHeader->m_isSingleSegment = 0;
+}
+
+static zstdhl_ResultCode_t zstdhl_Synth_ReadSequence(void *userdata, zstdhl_SequenceDesc_t *sequence)
+{
+	zstdhl_Synth_State_t *state = (zstdhl_Synth_State_t *)userdata;
+	const zstdhl_Synth_Sequence_t *inSeq = ((const zstdhl_Synth_Sequence_t *)state->m_sequencesVector.m_data) + state->m_sequenceReadPos;
+
+	if (state->m_sequenceReadPos == state->m_sequencesVector.m_count)
+		return ZSTDHL_RESULT_INTERNAL_ERROR;
+
+	state->m_offsetDWord = inSeq->m_offsetValue;
+
+	sequence->m_litLength = inSeq->m_litLength;
+	sequence->m_matchLength = inSeq->m_matchLength;
+	sequence->m_offsetType = inSeq->m_offsetType;
+
+	if (inSeq->m_offsetType == ZSTDHL_OFFSET_TYPE_SPECIFIED)
+	{
+		sequence->m_offsetValueBigNum = &state->m_offsetDWord;
+		sequence->m_offsetValueNumBits = zstdhl_Log2_32(inSeq->m_offsetValue) + 1;
+	}
+	else
+	{
+		sequence->m_offsetValueBigNum = NULL;
+		sequence->m_offsetValueNumBits = 0;
+	}
+
+	state->m_sequenceReadPos++;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_Synth_AppendLiterals(zstdhl_Synth_State_t *state, uint32_t count)
+{
+	uint8_t *literals = NULL;
+	uint32_t i = 0;
+
+	ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_literalsVector, NULL, count));
+
+	literals = ((uint8_t *)state->m_literalsVector.m_data) + state->m_literalsVector.m_count - count;
+
+	if (state->m_params.m_literalsMode == ZSTDHL_SYNTH_LITERALS_MODE_RLE)
+	{
+		for (i = 0; i < count; i++)
+			literals[i] = state->m_rleLiteral;
+	}
+	else
+	{
+		for (i = 0; i < count; i++)
+			literals[i] = (uint8_t)(zstdhl_Synth_Random(state) % state->m_params.m_literalAlphabetSize);
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_Synth_GenerateSequences(zstdhl_Synth_State_t *state, uint32_t targetSize, uint32_t maxLiterals, uint32_t *outBlockSize)
+{
+	const zstdhl_Synth_Params_t *params = &state->m_params;
+	uint8_t isRLE = (params->m_seqMode == ZSTDHL_SYNTH_SEQ_MODE_RLE);
+	uint32_t rleLitLength = 0;
+	uint32_t rleMatchLength = 0;
+	uint32_t rleMinOffset = 0;
+	uint32_t rleMaxOffset = 0;
+	uint32_t blockSize = 0;
+	uint32_t numLiterals = 0;
+	uint32_t trailingLiterals = 0;
+	uint32_t i = 0;
+
+	if (isRLE)
+	{
+		rleLitLength = zstdhl_Synth_RandomRange(state, 0, params->m_maxLitLength);
+		rleMatchLength = zstdhl_Synth_RandomLogUniform(state, params->m_minMatchLength, params->m_maxMatchLength);
+
+		if (state->m_contentGenerated == 0 && rleLitLength == 0)
+			rleLitLength = 1;
+	}
+
+	for (i = 0; i < params->m_sequencesPerBlock; i++)
+	{
+		zstdhl_Synth_Sequence_t seq;
+		uint64_t availableHistory = 0;
+		uint32_t maxOffset = params->m_maxOffset;
+
+		if (isRLE)
+		{
+			seq.m_litLength = rleLitLength;
+			seq.m_matchLength = rleMatchLength;
+		}
+		else
+		{
+			seq.m_litLength = zstdhl_Synth_RandomRange(state, 0, params->m_maxLitLength);
+			seq.m_matchLength = zstdhl_Synth_RandomLogUniform(state, params->m_minMatchLength, params->m_maxMatchLength);
+
+			if (state->m_contentGenerated + blockSize == 0 && seq.m_litLength == 0)
+				seq.m_litLength = 1;
+		}
+
+		if ((uint64_t)blockSize + seq.m_litLength + seq.m_matchLength > targetSize || numLiterals + seq.m_litLength > maxLiterals)
+			break;
+
+		availableHistory = state->m_contentGenerated + blockSize + seq.m_litLength;
+		if (availableHistory < maxOffset)
+			maxOffset = (uint32_t)availableHistory;
+
+		if (isRLE)
+		{
+			// Every offset must have the same offset code as the first
+			if (i == 0)
+			{
+				uint8_t offsetCode = zstdhl_Synth_OffsetValueCode(zstdhl_Synth_RandomLogUniform(state, 1, maxOffset));
+
+				rleMinOffset = ((uint32_t)1 << offsetCode) - 3u;
+				rleMaxOffset = ((uint32_t)2 << offsetCode) - 4u;
+
+				if (rleMinOffset < 1)
+					rleMinOffset = 1;
+			}
+
+			if (rleMaxOffset < maxOffset)
+				maxOffset = rleMaxOffset;
+
+			seq.m_offsetType = ZSTDHL_OFFSET_TYPE_SPECIFIED;
+			seq.m_offsetValue = zstdhl_Synth_RandomRange(state, rleMinOffset, maxOffset);
+		}
+		else if (availableHistory >= 8 && zstdhl_Synth_RandomRange(state, 0, 99) < params->m_repeatOffsetPercent)
+		{
+			// Repeat offsets start as 1, 4, and 8 and only ever hold earlier valid offsets, so they are always in range
+			if (seq.m_litLength == 0)
+				seq.m_offsetType = (zstdhl_Synth_RandomRange(state, 0, 1) == 0) ? ZSTDHL_OFFSET_TYPE_REPEAT_2 : ZSTDHL_OFFSET_TYPE_REPEAT_3;
+			else
+				seq.m_offsetType = (zstdhl_OffsetType_t)(ZSTDHL_OFFSET_TYPE_REPEAT_1 + zstdhl_Synth_RandomRange(state, 0, 2));
+
+			seq.m_offsetValue = 0;
+		}
+		else
+		{
+			seq.m_offsetType = ZSTDHL_OFFSET_TYPE_SPECIFIED;
+			seq.m_offsetValue = zstdhl_Synth_RandomLogUniform(state, 1, maxOffset);
+		}
+
+		ZSTDHL_CHECKED(zstdhl_Synth_AppendLiterals(state, seq.m_litLength));
+		ZSTDHL_CHECKED(zstdhl_Vector_Append(&state->m_sequencesVector, &seq, 1));
+
+		blockSize += seq.m_litLength + seq.m_matchLength;
+		numLiterals += seq.m_litLength;
+	}
+
+	trailingLiterals = targetSize - blockSize;
+	if (trailingLiterals > maxLiterals - numLiterals)
+		trailingLiterals = maxLiterals - numLiterals;
+
+	ZSTDHL_CHECKED(zstdhl_Synth_AppendLiterals(state, trailingLiterals));
+
+	*outBlockSize = blockSize + trailingLiterals;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_Synth_CountSequenceCodes(zstdhl_Synth_State_t *state, uint8_t *outLitLengthCode, uint8_t *outMatchLengthCode, uint8_t *outOffsetCode)
+{
+	const zstdhl_Synth_Sequence_t *seqs = (const zstdhl_Synth_Sequence_t *)state->m_sequencesVector.m_data;
+	size_t i = 0;
+
+	for (i = 0; i < ZSTDHL_SEQ_CONST_NUM_LITERAL_LENGTH_CODES; i++)
+		state->m_litLengthCounts[i] = 0;
+	for (i = 0; i < ZSTDHL_SEQ_CONST_NUM_MATCH_LENGTH_CODES; i++)
+		state->m_matchLengthCounts[i] = 0;
+	for (i = 0; i < ZSTDHL_SEQ_CONST_NUM_OFFSET_CODES; i++)
+		state->m_offsetCounts[i] = 0;
+
+	for (i = 0; i < state->m_sequencesVector.m_count; i++)
+	{
+		const zstdhl_Synth_Sequence_t *seq = seqs + i;
+		uint32_t litLengthCode = 0;
+		uint32_t matchLengthCode = 0;
+		uint32_t offsetCode = 0;
+		uint32_t offsetFSEValue = 0;
+		uint32_t extraValue = 0;
+		uint8_t extraBits = 0;
+
+		ZSTDHL_CHECKED(zstdhl_EncodeLitLength(seq->m_litLength, &litLengthCode, &extraValue, &extraBits));
+		ZSTDHL_CHECKED(zstdhl_EncodeMatchLength(seq->m_matchLength, &matchLengthCode, &extraValue, &extraBits));
+		ZSTDHL_CHECKED(zstdhl_ResolveOffsetCode32(seq->m_offsetType, seq->m_litLength, seq->m_offsetValue, &offsetCode));
+		ZSTDHL_CHECKED(zstdhl_EncodeOffsetCode(offsetCode, &offsetFSEValue, &extraValue, &extraBits));
+
+		state->m_litLengthCounts[litLengthCode]++;
+		state->m_matchLengthCounts[matchLengthCode]++;
+		state->m_offsetCounts[offsetFSEValue]++;
+
+		*outLitLengthCode = (uint8_t)litLengthCode;
+		*outMatchLengthCode = (uint8_t)matchLengthCode;
+		*outOffsetCode = (uint8_t)offsetFSEValue;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// Gives every code that the parameters can produce a nonzero count, so that the tables can be reused by later blocks
+static zstdhl_ResultCode_t zstdhl_Synth_AddReusableCodes(zstdhl_Synth_State_t *state)
+{
+	const zstdhl_Synth_Params_t *params = &state->m_params;
+	uint32_t maxLitLengthCode = 0;
+	uint32_t maxMatchLengthCode = 0;
+	uint32_t extraValue = 0;
+	uint8_t extraBits = 0;
+	uint32_t i = 0;
+
+	ZSTDHL_CHECKED(zstdhl_EncodeLitLength(params->m_maxLitLength, &maxLitLengthCode, &extraValue, &extraBits));
+	ZSTDHL_CHECKED(zstdhl_EncodeMatchLength(params->m_maxMatchLength, &maxMatchLengthCode, &extraValue, &extraBits));
+
+	for (i = 0; i <= maxLitLengthCode; i++)
+		state->m_litLengthCounts[i]++;
+	for (i = 0; i <= maxMatchLengthCode; i++)
+		state->m_matchLengthCounts[i]++;
+	for (i = 0; i <= zstdhl_Synth_OffsetValueCode(params->m_maxOffset); i++)
+		state->m_offsetCounts[i]++;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+// A table with a single symbol has no state bits to encode it with, so a stream with only one code uses RLE instead
+static zstdhl_ResultCode_t zstdhl_Synth_SetFSEOrRLEMode(const size_t *counts, size_t numCounts, zstdhl_Vector_t *probsVector, uint8_t maxAccuracyLog, zstdhl_FSETableDef_t *tableDef, zstdhl_SequencesCompressionMode_t *outMode, zstdhl_EncSeqCompressionDesc_t *outDesc)
+{
+	size_t numDistinct = 0;
+	size_t i = 0;
+
+	for (i = 0; i < numCounts; i++)
+	{
+		if (counts[i] != 0)
+		{
+			numDistinct++;
+			outDesc->m_rleByte = (uint8_t)i;
+		}
+	}
+
+	if (numDistinct == 1)
+	{
+		*outMode = ZSTDHL_SEQ_COMPRESSION_MODE_RLE;
+		return ZSTDHL_RESULT_OK;
+	}
+
+	outDesc->m_rleByte = 0;
+	*outMode = ZSTDHL_SEQ_COMPRESSION_MODE_FSE;
+
+	return zstdhl_CreateFSEDefFromSymbolCounts(counts, numCounts, probsVector, maxAccuracyLog, tableDef);
+}
+
+static zstdhl_ResultCode_t zstdhl_Synth_SetSequenceModes(zstdhl_Synth_State_t *state, zstdhl_EncBlockDesc_t *blockDesc)
+{
+	zstdhl_SequencesCompressionMode_t mode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+	zstdhl_SequencesCompressionMode_t litLengthMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+	zstdhl_SequencesCompressionMode_t matchLengthMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+	zstdhl_SequencesCompressionMode_t offsetMode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+	uint8_t litLengthCode = 0;
+	uint8_t matchLengthCode = 0;
+	uint8_t offsetCode = 0;
+
+	blockDesc->m_literalLengthsCompressionDesc.m_fseProbs = &state->m_litLengthTable;
+	blockDesc->m_literalLengthsCompressionDesc.m_rleByte = 0;
+	blockDesc->m_matchLengthsCompressionDesc.m_fseProbs = &state->m_matchLengthTable;
+	blockDesc->m_matchLengthsCompressionDesc.m_rleByte = 0;
+	blockDesc->m_offsetsModeCompressionDesc.m_fseProbs = &state->m_offsetTable;
+	blockDesc->m_offsetsModeCompressionDesc.m_rleByte = 0;
+
+	if (state->m_sequencesVector.m_count > 0)
+	{
+		switch (state->m_params.m_seqMode)
+		{
+		case ZSTDHL_SYNTH_SEQ_MODE_AUTO:
+			blockDesc->m_autoSeqCompressionModeFlag = 1;
+			break;
+
+		case ZSTDHL_SYNTH_SEQ_MODE_PREDEFINED:
+			mode = ZSTDHL_SEQ_COMPRESSION_MODE_PREDEFINED;
+			break;
+
+		case ZSTDHL_SYNTH_SEQ_MODE_RLE:
+			ZSTDHL_CHECKED(zstdhl_Synth_CountSequenceCodes(state, &litLengthCode, &matchLengthCode, &offsetCode));
+			blockDesc->m_literalLengthsCompressionDesc.m_rleByte = litLengthCode;
+			blockDesc->m_matchLengthsCompressionDesc.m_rleByte = matchLengthCode;
+			blockDesc->m_offsetsModeCompressionDesc.m_rleByte = offsetCode;
+			mode = ZSTDHL_SEQ_COMPRESSION_MODE_RLE;
+			break;
+
+		case ZSTDHL_SYNTH_SEQ_MODE_REUSE:
+			if (state->m_haveReuseTables)
+			{
+				mode = ZSTDHL_SEQ_COMPRESSION_MODE_REUSE;
+				break;
+			}
+
+			ZSTDHL_CHECKED(zstdhl_Synth_CountSequenceCodes(state, &litLengthCode, &matchLengthCode, &offsetCode));
+			ZSTDHL_CHECKED(zstdhl_Synth_AddReusableCodes(state));
+			state->m_haveReuseTables = 1;
+			mode = ZSTDHL_SEQ_COMPRESSION_MODE_FSE;
+			break;
+
+		case ZSTDHL_SYNTH_SEQ_MODE_FSE:
+			ZSTDHL_CHECKED(zstdhl_Synth_CountSequenceCodes(state, &litLengthCode, &matchLengthCode, &offsetCode));
+			mode = ZSTDHL_SEQ_COMPRESSION_MODE_FSE;
+			break;
+
+		default:
+			return ZSTDHL_RESULT_INVALID_VALUE;
+		}
+
+		litLengthMode = mode;
+		matchLengthMode = mode;
+		offsetMode = mode;
+
+		if (mode == ZSTDHL_SEQ_COMPRESSION_MODE_FSE)
+		{
+			ZSTDHL_CHECKED(zstdhl_Synth_SetFSEOrRLEMode(state->m_litLengthCounts, ZSTDHL_SEQ_CONST_NUM_LITERAL_LENGTH_CODES, &state->m_litLengthProbsVector, ZSTDHL_MAX_LIT_LENGTH_ACCURACY_LOG, &state->m_litLengthTable, &litLengthMode, &blockDesc->m_literalLengthsCompressionDesc));
+			ZSTDHL_CHECKED(zstdhl_Synth_SetFSEOrRLEMode(state->m_matchLengthCounts, ZSTDHL_SEQ_CONST_NUM_MATCH_LENGTH_CODES, &state->m_matchLengthProbsVector, ZSTDHL_MAX_MATCH_LENGTH_ACCURACY_LOG, &state->m_matchLengthTable, &matchLengthMode, &blockDesc->m_matchLengthsCompressionDesc));
+			ZSTDHL_CHECKED(zstdhl_Synth_SetFSEOrRLEMode(state->m_offsetCounts, ZSTDHL_SEQ_CONST_NUM_OFFSET_CODES, &state->m_offsetProbsVector, ZSTDHL_MAX_OFFSET_ACCURACY_LOG, &state->m_offsetTable, &offsetMode, &blockDesc->m_offsetsModeCompressionDesc));
+		}
+	}
+
+	blockDesc->m_seqSectionDesc.m_numSequences = (uint32_t)state->m_sequencesVector.m_count;
+	blockDesc->m_seqSectionDesc.m_literalLengthsMode = litLengthMode;
+	blockDesc->m_seqSectionDesc.m_matchLengthsMode = matchLengthMode;
+	blockDesc->m_seqSectionDesc.m_offsetsMode = offsetMode;
+
+	blockDesc->m_seqCollection.m_getNextSequence = zstdhl_Synth_ReadSequence;
+	blockDesc->m_seqCollection.m_userdata = state;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+static zstdhl_ResultCode_t zstdhl_Synth_SetLiteralsMode(zstdhl_Synth_State_t *state, zstdhl_EncBlockDesc_t *blockDesc)
+{
+	const uint8_t *literals = (const uint8_t *)state->m_literalsVector.m_data;
+	size_t numLiterals = state->m_literalsVector.m_count;
+	zstdhl_Synth_LiteralsMode_t literalsMode = state->m_params.m_literalsMode;
+	size_t numDistinct = 0;
+	size_t maxLiteral = 0;
+	size_t i = 0;
+
+	zstdhl_MemBufferStreamSource_Init(&state->m_litMemSource, literals, numLiterals);
+
+	blockDesc->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RAW;
+	blockDesc->m_litSectionHeader.m_regeneratedSize = (uint32_t)numLiterals;
+	blockDesc->m_litSectionHeader.m_compressedSize = 0;
+
+	blockDesc->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_NONE;
+	for (i = 0; i < 4; i++)
+		blockDesc->m_litSectionDesc.m_huffmanStreamSizes[i] = 0;
+	blockDesc->m_litSectionDesc.m_numValues = numLiterals;
+	blockDesc->m_litSectionDesc.m_decompressedLiteralsStream = &state->m_litStream;
+
+	if (literalsMode == ZSTDHL_SYNTH_LITERALS_MODE_AUTO)
+	{
+		blockDesc->m_autoLitSectionModeFlag = 1;
+		return ZSTDHL_RESULT_OK;
+	}
+
+	if (literalsMode == ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_1_STREAM || literalsMode == ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_4_STREAMS)
+	{
+		for (i = 0; i < 256; i++)
+			state->m_literalCounts[i] = 0;
+
+		for (i = 0; i < numLiterals; i++)
+			state->m_literalCounts[literals[i]]++;
+
+		for (i = 0; i < 256; i++)
+		{
+			if (state->m_literalCounts[i] != 0)
+			{
+				numDistinct++;
+				maxLiteral = i;
+			}
+		}
+
+		if (numDistinct < 2)
+			literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_RLE;
+		else if (numLiterals < ZSTDHL_SYNTH_MIN_4_STREAM_LITERALS)
+			literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_1_STREAM;
+	}
+
+	if (numLiterals == 0)
+		literalsMode = ZSTDHL_SYNTH_LITERALS_MODE_RAW;
+
+	switch (literalsMode)
+	{
+	case ZSTDHL_SYNTH_LITERALS_MODE_RAW:
+		break;
+
+	case ZSTDHL_SYNTH_LITERALS_MODE_RLE:
+		blockDesc->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_RLE;
+		blockDesc->m_litSectionDesc.m_numValues = 1;
+		break;
+
+	case ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_1_STREAM:
+	case ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_4_STREAMS:
+		ZSTDHL_CHECKED(zstdhl_CreateHuffmanDescFromSymbolCounts(state->m_literalCounts, maxLiteral + 1, &blockDesc->m_huffmanTreeDesc));
+		blockDesc->m_huffmanTreeDesc.m_weightTable.m_probabilities = blockDesc->m_huffmanTreeDesc.m_weightTableProbabilities;
+
+		blockDesc->m_litSectionHeader.m_sectionType = ZSTDHL_LITERALS_SECTION_TYPE_HUFFMAN;
+		if (literalsMode == ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_1_STREAM)
+			blockDesc->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_1_STREAM;
+		else
+			blockDesc->m_litSectionDesc.m_huffmanStreamMode = ZSTDHL_HUFFMAN_STREAM_MODE_4_STREAMS;
+		break;
+
+	default:
+		return ZSTDHL_RESULT_INVALID_VALUE;
+	}
+
+	return ZSTDHL_RESULT_OK;
+}
+
+zstdhl_ResultCode_t zstdhl_Synth_GenerateBlock(zstdhl_Synth_State_t *state, uint8_t *outEOFFlag, zstdhl_EncBlockDesc_t *outTempBlockDesc)
+{
+	const zstdhl_Synth_Params_t *params = &state->m_params;
+	uint64_t contentRemaining = params->m_contentSize - state->m_contentGenerated;
+	uint32_t targetSize = params->m_blockSize;
+	uint32_t maxLiterals = 0;
+	uint32_t blockSize = 0;
+
+	if (state->m_emittedLastBlock)
+	{
+		*outEOFFlag = 1;
+		return ZSTDHL_RESULT_OK;
+	}
+
+	*outEOFFlag = 0;
+
+	if (targetSize > contentRemaining)
+		targetSize = (uint32_t)contentRemaining;
+
+	maxLiterals = targetSize;
+	if (params->m_literalsMode == ZSTDHL_SYNTH_LITERALS_MODE_HUFFMAN_1_STREAM && maxLiterals > ZSTDHL_SYNTH_MAX_1_STREAM_LITERALS)
+		maxLiterals = ZSTDHL_SYNTH_MAX_1_STREAM_LITERALS;
+
+	zstdhl_Vector_Clear(&state->m_literalsVector);
+	zstdhl_Vector_Clear(&state->m_sequencesVector);
+	state->m_sequenceReadPos = 0;
+
+	ZSTDHL_CHECKED(zstdhl_Synth_GenerateSequences(state, targetSize, maxLiterals, &blockSize));
+
+	state->m_contentGenerated += blockSize;
+
+	outTempBlockDesc->m_blockHeader.m_blockType = ZSTDHL_BLOCK_TYPE_COMPRESSED;
+	state->m_emittedLastBlock = (state->m_contentGenerated == params->m_contentSize);
+
+	outTempBlockDesc->m_blockHeader.m_isLastBlock = state->m_emittedLastBlock;
+	outTempBlockDesc->m_blockHeader.m_blockSize = 0;
+
+	outTempBlockDesc->m_autoBlockSizeFlag = 1;
+	outTempBlockDesc->m_autoLitCompressedSizeFlag = 1;
+	outTempBlockDesc->m_autoLitRegeneratedSizeFlag = 1;
+	outTempBlockDesc->m_autoHuffmanStreamSizesFlags[0] = 1;
+	outTempBlockDesc->m_autoHuffmanStreamSizesFlags[1] = 1;
+	outTempBlockDesc->m_autoHuffmanStreamSizesFlags[2] = 1;
+	outTempBlockDesc->m_autoHuffmanStreamSizesFlags[3] = 1;
+	outTempBlockDesc->m_autoLitSectionModeFlag = 0;
+	outTempBlockDesc->m_autoSeqCompressionModeFlag = 0;
+
+	outTempBlockDesc->m_uncompressedOrRLEData = NULL;
+
+	ZSTDHL_CHECKED(zstdhl_Synth_SetLiteralsMode(state, outTempBlockDesc));
+	ZSTDHL_CHECKED(zstdhl_Synth_SetSequenceModes(state, outTempBlockDesc));
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_Synth_DestroyState(zstdhl_Synth_State_t *state)
+{
+	zstdhl_Vector_Destroy(&state->m_literalsVector);
+	zstdhl_Vector_Destroy(&state->m_sequencesVector);
+	zstdhl_Vector_Destroy(&state->m_litLengthProbsVector);
+	zstdhl_Vector_Destroy(&state->m_matchLengthProbsVector);
+	zstdhl_Vector_Destroy(&state->m_offsetProbsVector);
+
+	state->m_memAlloc.m_reallocFunc(state->m_memAlloc.m_userdata, state, 0);
+}
+
+zstdhl_ResultCode_t zstdhl_Synth_GenerateFrame(const zstdhl_MemoryAllocatorObject_t *alloc, const zstdhl_Synth_Params_t *params, const zstdhl_EncoderOutputObject_t *assemblyOutput)
+{
+	zstdhl_Synth_State_t *state = NULL;
+	zstdhl_AssemblerPersistentState_t *persistentState = NULL;
+	zstdhl_FrameHeaderDesc_t frameHeader;
+	zstdhl_EncBlockDesc_t blockDesc;
+	zstdhl_ResultCode_t result = ZSTDHL_RESULT_OK;
+	uint8_t eofFlag = 0;
+
+	ZSTDHL_CHECKED(zstdhl_Synth_CreateState(alloc, params, &state));
+
+	persistentState = (zstdhl_AssemblerPersistentState_t *)alloc->m_reallocFunc(alloc->m_userdata, NULL, sizeof(zstdhl_AssemblerPersistentState_t));
+	if (!persistentState)
+	{
+		zstdhl_Synth_DestroyState(state);
+		return ZSTDHL_RESULT_OUT_OF_MEMORY;
+	}
+
+	zstdhl_Synth_GetFrameHeader(state, &frameHeader);
+
+	result = zstdhl_InitAssemblerState(persistentState);
+
+	if (result == ZSTDHL_RESULT_OK)
+		result = zstdhl_AssembleFrame(&frameHeader, assemblyOutput, params->m_contentSize);
+
+	while (result == ZSTDHL_RESULT_OK)
+	{
+		result = zstdhl_Synth_GenerateBlock(state, &eofFlag, &blockDesc);
+		if (result != ZSTDHL_RESULT_OK || eofFlag)
+			break;
+
+		result = zstdhl_AssembleBlock(persistentState, &blockDesc, assemblyOutput, alloc);
+	}
+
+	alloc->m_reallocFunc(alloc->m_userdata, persistentState, 0);
+	zstdhl_Synth_DestroyState(state);
+
+	return result;
+}
@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2023 Eric Lasota
+
+This software is available under the terms of the MIT license
+or the Apache License, Version 2.0.  For more information, see
+the included LICENSE.txt file.
+*/
+
+#include "zstdhl_thread.h"
+
+#ifdef _WIN32
+
+static DWORD WINAPI zstdhl_Thread_Trampoline(LPVOID param)
+{
+	zstdhl_Thread_t *thread = (zstdhl_Thread_t *)param;
+
+	thread->m_func(thread->m_userdata);
+
+	return 0;
+}
+
+zstdhl_ResultCode_t zstdhl_Thread_Create(zstdhl_Thread_t *thread, zstdhl_ThreadFunc_t func, void *userdata)
+{
+	thread->m_func = func;
+	thread->m_userdata = userdata;
+	thread->m_handle = CreateThread(NULL, 0, zstdhl_Thread_Trampoline, thread, 0, NULL);
+
+	if (thread->m_handle == NULL)
+		return ZSTDHL_RESULT_FAIL;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_Thread_Join(zstdhl_Thread_t *thread)
+{
+	WaitForSingleObject(thread->m_handle, INFINITE);
+	CloseHandle(thread->m_handle);
+}
+
+zstdhl_ResultCode_t zstdhl_Mutex_Init(zstdhl_Mutex_t *mutex)
+{
+	InitializeCriticalSection(&mutex->m_cs);
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_Mutex_Lock(zstdhl_Mutex_t *mutex)
+{
+	EnterCriticalSection(&mutex->m_cs);
+}
+
+void zstdhl_Mutex_Unlock(zstdhl_Mutex_t *mutex)
+{
+	LeaveCriticalSection(&mutex->m_cs);
+}
+
+void zstdhl_Mutex_Destroy(zstdhl_Mutex_t *mutex)
+{
+	DeleteCriticalSection(&mutex->m_cs);
+}
+
+zstdhl_ResultCode_t zstdhl_CondVar_Init(zstdhl_CondVar_t *condVar)
+{
+	InitializeConditionVariable(&condVar->m_cv);
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_CondVar_Wait(zstdhl_CondVar_t *condVar, zstdhl_Mutex_t *mutex)
+{
+	SleepConditionVariableCS(&condVar->m_cv, &mutex->m_cs, INFINITE);
+}
+
+void zstdhl_CondVar_Signal(zstdhl_CondVar_t *condVar)
+{
+	WakeConditionVariable(&condVar->m_cv);
+}
+
+void zstdhl_CondVar_Broadcast(zstdhl_CondVar_t *condVar)
+{
+	WakeAllConditionVariable(&condVar->m_cv);
+}
+
+void zstdhl_CondVar_Destroy(zstdhl_CondVar_t *condVar)
+{
+}
+
+static BOOL CALLBACK zstdhl_Once_Trampoline(PINIT_ONCE initOnce, PVOID param, PVOID *context)
+{
+	const zstdhl_OnceFunc_t *func = (const zstdhl_OnceFunc_t *)param;
+
+	(*func)();
+
+	return TRUE;
+}
+
+void zstdhl_Once_Call(zstdhl_Once_t *once, zstdhl_OnceFunc_t func)
+{
+	InitOnceExecuteOnce(&once->m_once, zstdhl_Once_Trampoline, &func, NULL);
+}
+
+#else
+
+static void *zstdhl_Thread_Trampoline(void *param)
+{
+	zstdhl_Thread_t *thread = (zstdhl_Thread_t *)param;
+
+	thread->m_func(thread->m_userdata);
+
+	return NULL;
+}
+
+zstdhl_ResultCode_t zstdhl_Thread_Create(zstdhl_Thread_t *thread, zstdhl_ThreadFunc_t func, void *userdata)
+{
+	thread->m_func = func;
+	thread->m_userdata = userdata;
+
+	if (pthread_create(&thread->m_thread, NULL, zstdhl_Thread_Trampoline, thread) != 0)
+		return ZSTDHL_RESULT_FAIL;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_Thread_Join(zstdhl_Thread_t *thread)
+{
+	pthread_join(thread->m_thread, NULL);
+}
+
+zstdhl_ResultCode_t zstdhl_Mutex_Init(zstdhl_Mutex_t *mutex)
+{
+	if (pthread_mutex_init(&mutex->m_mutex, NULL) != 0)
+		return ZSTDHL_RESULT_FAIL;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_Mutex_Lock(zstdhl_Mutex_t *mutex)
+{
+	pthread_mutex_lock(&mutex->m_mutex);
+}
+
+void zstdhl_Mutex_Unlock(zstdhl_Mutex_t *mutex)
+{
+	pthread_mutex_unlock(&mutex->m_mutex);
+}
+
+void zstdhl_Mutex_Destroy(zstdhl_Mutex_t *mutex)
+{
+	pthread_mutex_destroy(&mutex->m_mutex);
+}
+
+zstdhl_ResultCode_t zstdhl_CondVar_Init(zstdhl_CondVar_t *condVar)
+{
+	if (pthread_cond_init(&condVar->m_cond, NULL) != 0)
+		return ZSTDHL_RESULT_FAIL;
+
+	return ZSTDHL_RESULT_OK;
+}
+
+void zstdhl_CondVar_Wait(zstdhl_CondVar_t *condVar, zstdhl_Mutex_t *mutex)
+{
+	pthread_cond_wait(&condVar->m_cond, &mutex->m_mutex);
+}
+
+void zstdhl_CondVar_Signal(zstdhl_CondVar_t *condVar)
+{
+	pthread_cond_signal(&condVar->m_cond);
+}
+
+void zstdhl_CondVar_Broadcast(zstdhl_CondVar_t *condVar)
+{
+	pthread_cond_broadcast(&condVar->m_cond);
+}
+
+void zstdhl_CondVar_Destroy(zstdhl_CondVar_t *condVar)
+{
+	pthread_cond_destroy(&condVar->m_cond);
+}
+
+void zstdhl_Once_Call(zstdhl_Once_t *once, zstdhl_OnceFunc_t func)
+{
+	pthread_once(&once->m_once, func);
+}
+
+#endif
@@ -0,0 +1,91 @@
+/*
+Copyright (c) 2023 Eric Lasota
+
+This software is available under the terms of the MIT license
+or the Apache License, Version 2.0.  For more information, see
+the included LICENSE.txt file.
+*/
+
+#pragma once
+
+#ifndef __ZSTDHL_THREAD_H__
+#define __ZSTDHL_THREAD_H__
+
+#include "zstdhl.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+typedef void (*zstdhl_ThreadFunc_t)(void *userdata);
+typedef void (*zstdhl_OnceFunc_t)(void);
+
+typedef struct zstdhl_Thread
+{
+	zstdhl_ThreadFunc_t m_func;
+	void *m_userdata;
+
+#ifdef _WIN32
+	HANDLE m_handle;
+#else
+	pthread_t m_thread;
+#endif
+} zstdhl_Thread_t;
+
+typedef struct zstdhl_Mutex
+{
+#ifdef _WIN32
+	CRITICAL_SECTION m_cs;
+#else
+	pthread_mutex_t m_mutex;
+#endif
+} zstdhl_Mutex_t;
+
+typedef struct zstdhl_CondVar
+{
+#ifdef _WIN32
+	CONDITION_VARIABLE m_cv;
+#else
+	pthread_cond_t m_cond;
+#endif
+} zstdhl_CondVar_t;
+
+typedef struct zstdhl_Once
+{
+#ifdef _WIN32
+	INIT_ONCE m_once;
+#else
+	pthread_once_t m_once;
+#endif
+} zstdhl_Once_t;
+
+#ifdef _WIN32
+#define ZSTDHL_ONCE_INIT { INIT_ONCE_STATIC_INIT }
+#else
+#define ZSTDHL_ONCE_INIT { PTHREAD_ONCE_INIT }
+#endif
+
+// The thread object must stay at the same address until it is joined
+zstdhl_ResultCode_t zstdhl_Thread_Create(zstdhl_Thread_t *thread, zstdhl_ThreadFunc_t func, void *userdata);
+void zstdhl_Thread_Join(zstdhl_Thread_t *thread);
+
+zstdhl_ResultCode_t zstdhl_Mutex_Init(zstdhl_Mutex_t *mutex);
+void zstdhl_Mutex_Lock(zstdhl_Mutex_t *mutex);
+void zstdhl_Mutex_Unlock(zstdhl_Mutex_t *mutex);
+void zstdhl_Mutex_Destroy(zstdhl_Mutex_t *mutex);
+
+zstdhl_ResultCode_t zstdhl_CondVar_Init(zstdhl_CondVar_t *condVar);
+void zstdhl_CondVar_Wait(zstdhl_CondVar_t *condVar, zstdhl_Mutex_t *mutex);
+void zstdhl_CondVar_Signal(zstdhl_CondVar_t *condVar);
+void zstdhl_CondVar_Broadcast(zstdhl_CondVar_t *condVar);
+void zstdhl_CondVar_Destroy(zstdhl_CondVar_t *condVar);
+
+// Runs func exactly once for a once object initialized with ZSTDHL_ONCE_INIT, other callers wait until it completes
+void zstdhl_Once_Call(zstdhl_Once_t *once, zstdhl_OnceFunc_t func);
+
+#endif
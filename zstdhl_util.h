@@ -16,3 +16,29 @@ the included LICENSE.txt file.
 	} while(0)
 
 void zstdhl_ReportErrorCode(zstdhl_ResultCode_t errorCode);
+
+#ifdef ZSTDHL_ENABLE_INSTRUMENTATION
+
+#define ZSTDHL_CHECKED_PHASE(instrumentation, phase, numBytes, numSymbols, n) do {\
+		const zstdhl_InstrumentationObject_t *phaseInstrumentation = (instrumentation);\
+		if (phaseInstrumentation && phaseInstrumentation->m_reportPhaseFunc)\
+		{\
+			uint64_t phaseStartTicks = zstdhl_ReadTicks();\
+			zstdhl_ResultCode_t phaseResult = (n);\
+			phaseInstrumentation->m_reportPhaseFunc(phaseInstrumentation->m_userdata, (phase), zstdhl_ReadTicks() - phaseStartTicks, (numBytes), (numSymbols));\
+			ZSTDHL_CHECKED(phaseResult);\
+		}\
+		else\
+			ZSTDHL_CHECKED(n);\
+	} while(0)
+
+uint64_t zstdhl_ReadTicks(void);
+
+#else
+
+#define ZSTDHL_CHECKED_PHASE(instrumentation, phase, numBytes, numSymbols, n) do {\
+		(void)(instrumentation);\
+		ZSTDHL_CHECKED(n);\
+	} while(0)
+
+#endif